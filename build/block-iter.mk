@@ -0,0 +1,25 @@
+build/block-iter.o: src/block-iter.c src/block-iter.h src/block.h \
+ src/util/debug.h src/util/errorcode.h src/util/macros.h src/util/list.h \
+ src/util/macros.h src/util/string-view.h src/util/ascii.h \
+ src/util/debug.h src/util/xmemrchr.h src/util/xstring.h \
+ src/util/unicode.h src/util/ascii.h src/util/utf8.h src/util/unicode.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xmemrchr.h
+src/block-iter.h:
+src/block.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/list.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/unicode.h:
+src/util/ascii.h:
+src/util/utf8.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xmemrchr.h:
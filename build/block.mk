@@ -0,0 +1,18 @@
+build/block.o: src/block.c src/block.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/list.h src/util/macros.h \
+ src/util/align.h src/util/bit.h src/util/debug.h src/util/log.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h src/util/ascii.h
+src/block.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/list.h:
+src/util/macros.h:
+src/util/align.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/log.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
@@ -0,0 +1,126 @@
+build/cmdline.o: src/cmdline.c src/cmdline.h src/command/run.h \
+ src/command/error.h src/util/macros.h src/util/string-view.h \
+ src/util/ascii.h src/util/macros.h src/util/debug.h src/util/errorcode.h \
+ src/util/xmemrchr.h src/util/xstring.h src/history.h src/command/error.h \
+ src/util/hashmap.h src/util/container.h src/util/macros.h \
+ src/util/string.h src/util/arith.h src/util/bit.h src/util/str-util.h \
+ src/util/string-view.h src/util/unicode.h src/util/xmalloc.h \
+ src/util/ptr-array.h src/util/string-view.h src/command/args.h \
+ src/command/run.h src/util/base64.h src/util/debug.h src/command/macro.h \
+ src/util/ptr-array.h src/util/string.h src/util/unicode.h src/commands.h \
+ src/config.h src/util/align.h src/util/errorcode.h src/completion.h \
+ src/util/debug.h src/copy.h src/view.h src/block-iter.h src/block.h \
+ src/util/list.h src/util/unicode.h src/editor.h src/buffer.h \
+ src/change.h src/edit.h src/lock.h src/match-cache.h src/options.h \
+ src/regexp.h src/syntax/highlight.h src/block-iter.h src/syntax/color.h \
+ src/terminal/style.h src/terminal/color.h src/terminal/feature.h \
+ src/util/hashmap.h src/syntax/syntax.h src/command/error.h \
+ src/syntax/bitset.h src/util/byte-class.h src/util/hashset.h \
+ src/syntax/syntax.h src/file-history.h src/frame.h src/grep.h src/msg.h \
+ src/bookmark.h src/util/xmalloc.h src/window.h src/mode.h \
+ src/terminal/key.h src/util/intmap.h src/search.h src/syntax/color.h \
+ src/syntax/state.h src/tag.h src/ctags.h src/terminal/cursor.h \
+ src/terminal/color.h src/terminal/terminal.h src/terminal/key.h \
+ src/terminal/style.h src/terminal/terminal.h src/util/hashset.h \
+ src/vars.h src/selection.h src/terminal/osc52.h src/terminal/terminal.h \
+ src/util/arith.h src/util/ascii.h src/util/bsearch.h src/util/array.h \
+ src/util/ptr-array.h src/util/log.h src/util/utf8.h
+src/cmdline.h:
+src/command/run.h:
+src/command/error.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/history.h:
+src/command/error.h:
+src/util/hashmap.h:
+src/util/container.h:
+src/util/macros.h:
+src/util/string.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/util/ptr-array.h:
+src/util/string-view.h:
+src/command/args.h:
+src/command/run.h:
+src/util/base64.h:
+src/util/debug.h:
+src/command/macro.h:
+src/util/ptr-array.h:
+src/util/string.h:
+src/util/unicode.h:
+src/commands.h:
+src/config.h:
+src/util/align.h:
+src/util/errorcode.h:
+src/completion.h:
+src/util/debug.h:
+src/copy.h:
+src/view.h:
+src/block-iter.h:
+src/block.h:
+src/util/list.h:
+src/util/unicode.h:
+src/editor.h:
+src/buffer.h:
+src/change.h:
+src/edit.h:
+src/lock.h:
+src/match-cache.h:
+src/options.h:
+src/regexp.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/hashmap.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/syntax/bitset.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/syntax/syntax.h:
+src/file-history.h:
+src/frame.h:
+src/grep.h:
+src/msg.h:
+src/bookmark.h:
+src/util/xmalloc.h:
+src/window.h:
+src/mode.h:
+src/terminal/key.h:
+src/util/intmap.h:
+src/search.h:
+src/syntax/color.h:
+src/syntax/state.h:
+src/tag.h:
+src/ctags.h:
+src/terminal/cursor.h:
+src/terminal/color.h:
+src/terminal/terminal.h:
+src/terminal/key.h:
+src/terminal/style.h:
+src/terminal/terminal.h:
+src/util/hashset.h:
+src/vars.h:
+src/selection.h:
+src/terminal/osc52.h:
+src/terminal/terminal.h:
+src/util/arith.h:
+src/util/ascii.h:
+src/util/bsearch.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/log.h:
+src/util/utf8.h:
@@ -0,0 +1,26 @@
+build/command/args.o: src/command/args.c src/command/args.h \
+ src/command/error.h src/util/macros.h src/command/run.h \
+ src/util/string-view.h src/util/ascii.h src/util/macros.h \
+ src/util/debug.h src/util/errorcode.h src/util/xmemrchr.h \
+ src/util/xstring.h src/util/base64.h src/util/debug.h \
+ src/util/str-array.h src/util/str-util.h src/util/string-view.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h
+src/command/args.h:
+src/command/error.h:
+src/util/macros.h:
+src/command/run.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/base64.h:
+src/util/debug.h:
+src/util/str-array.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
@@ -0,0 +1,11 @@
+build/command/error.o: src/command/error.c src/command/error.h \
+ src/util/macros.h src/util/log.h src/util/debug.h src/util/errorcode.h \
+ src/util/macros.h src/util/xstdio.h src/util/xreadwrite.h
+src/command/error.h:
+src/util/macros.h:
+src/util/log.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/xstdio.h:
+src/util/xreadwrite.h:
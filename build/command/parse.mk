@@ -0,0 +1,40 @@
+build/command/parse.o: src/command/parse.c src/command/parse.h \
+ src/command/run.h src/command/error.h src/util/macros.h \
+ src/util/string-view.h src/util/ascii.h src/util/macros.h \
+ src/util/debug.h src/util/errorcode.h src/util/xmemrchr.h \
+ src/util/xstring.h src/util/ptr-array.h src/util/bit.h \
+ src/util/container.h src/util/xmalloc.h src/util/arith.h src/trace.h \
+ src/util/debug.h src/util/log.h src/util/macros.h src/util/ascii.h \
+ src/util/debug.h src/util/string.h src/util/str-util.h \
+ src/util/string-view.h src/util/unicode.h src/util/strtonum.h \
+ src/util/unicode.h src/util/xmalloc.h src/util/xstring.h
+src/command/parse.h:
+src/command/run.h:
+src/command/error.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/trace.h:
+src/util/debug.h:
+src/util/log.h:
+src/util/macros.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/string.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/strtonum.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/util/xstring.h:
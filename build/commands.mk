@@ -0,0 +1,172 @@
+build/commands.o: src/commands.c src/commands.h src/command/run.h \
+ src/command/error.h src/util/macros.h src/util/string-view.h \
+ src/util/ascii.h src/util/macros.h src/util/debug.h src/util/errorcode.h \
+ src/util/xmemrchr.h src/util/xstring.h src/config.h src/util/align.h \
+ src/util/errorcode.h src/util/macros.h src/util/ptr-array.h \
+ src/util/bit.h src/util/container.h src/util/xmalloc.h src/util/arith.h \
+ src/util/string-view.h src/util/string.h src/util/str-util.h \
+ src/util/string-view.h src/util/unicode.h src/bind.h src/command/cache.h \
+ src/command/run.h src/mode.h src/terminal/key.h src/util/hashmap.h \
+ src/util/intmap.h src/bookmark.h src/command/error.h src/util/xmalloc.h \
+ src/view.h src/block-iter.h src/block.h src/util/debug.h src/util/list.h \
+ src/util/unicode.h src/window.h src/buffer.h src/change.h src/edit.h \
+ src/lock.h src/match-cache.h src/options.h src/regexp.h \
+ src/syntax/highlight.h src/block-iter.h src/syntax/color.h \
+ src/terminal/style.h src/terminal/color.h src/terminal/feature.h \
+ src/util/ptr-array.h src/util/hashmap.h src/util/string.h \
+ src/syntax/syntax.h src/command/error.h src/syntax/bitset.h \
+ src/util/debug.h src/util/byte-class.h src/util/hashset.h \
+ src/syntax/syntax.h src/frame.h src/case.h src/cmdline.h src/history.h \
+ src/command/alias.h src/command/args.h src/command/run.h \
+ src/util/base64.h src/command/macro.h src/util/unicode.h src/compiler.h \
+ src/convert.h src/copy.h src/delete.h src/editor.h src/file-history.h \
+ src/grep.h src/msg.h src/search.h src/syntax/color.h src/syntax/state.h \
+ src/tag.h src/ctags.h src/terminal/cursor.h src/terminal/color.h \
+ src/terminal/terminal.h src/terminal/key.h src/terminal/style.h \
+ src/terminal/terminal.h src/util/hashset.h src/vars.h src/encoding.h \
+ src/exec.h src/file-option.h src/filetype.h src/indent.h src/util/bit.h \
+ src/insert.h src/join.h src/load-save.h src/move.h src/replace.h \
+ src/selection.h src/show.h src/spawn.h src/undo-file.h \
+ src/terminal/mode.h src/terminal/osc52.h src/terminal/terminal.h \
+ src/terminal/style.h src/ui.h src/terminal/output.h src/util/utf8.h \
+ src/util/arith.h src/util/array.h src/util/ptr-array.h src/util/ascii.h \
+ src/util/bsearch.h src/util/array.h src/util/intern.h src/util/log.h \
+ src/util/numtostr.h src/util/path.h src/util/str-array.h \
+ src/util/str-util.h src/util/strtonum.h src/util/time-util.h \
+ src/util/log.h src/util/xsnprintf.h src/util/xstring.h src/wrap.h
+src/commands.h:
+src/command/run.h:
+src/command/error.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/config.h:
+src/util/align.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/string-view.h:
+src/util/string.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/bind.h:
+src/command/cache.h:
+src/command/run.h:
+src/mode.h:
+src/terminal/key.h:
+src/util/hashmap.h:
+src/util/intmap.h:
+src/bookmark.h:
+src/command/error.h:
+src/util/xmalloc.h:
+src/view.h:
+src/block-iter.h:
+src/block.h:
+src/util/debug.h:
+src/util/list.h:
+src/util/unicode.h:
+src/window.h:
+src/buffer.h:
+src/change.h:
+src/edit.h:
+src/lock.h:
+src/match-cache.h:
+src/options.h:
+src/regexp.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/ptr-array.h:
+src/util/hashmap.h:
+src/util/string.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/syntax/bitset.h:
+src/util/debug.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/syntax/syntax.h:
+src/frame.h:
+src/case.h:
+src/cmdline.h:
+src/history.h:
+src/command/alias.h:
+src/command/args.h:
+src/command/run.h:
+src/util/base64.h:
+src/command/macro.h:
+src/util/unicode.h:
+src/compiler.h:
+src/convert.h:
+src/copy.h:
+src/delete.h:
+src/editor.h:
+src/file-history.h:
+src/grep.h:
+src/msg.h:
+src/search.h:
+src/syntax/color.h:
+src/syntax/state.h:
+src/tag.h:
+src/ctags.h:
+src/terminal/cursor.h:
+src/terminal/color.h:
+src/terminal/terminal.h:
+src/terminal/key.h:
+src/terminal/style.h:
+src/terminal/terminal.h:
+src/util/hashset.h:
+src/vars.h:
+src/encoding.h:
+src/exec.h:
+src/file-option.h:
+src/filetype.h:
+src/indent.h:
+src/util/bit.h:
+src/insert.h:
+src/join.h:
+src/load-save.h:
+src/move.h:
+src/replace.h:
+src/selection.h:
+src/show.h:
+src/spawn.h:
+src/undo-file.h:
+src/terminal/mode.h:
+src/terminal/osc52.h:
+src/terminal/terminal.h:
+src/terminal/style.h:
+src/ui.h:
+src/terminal/output.h:
+src/util/utf8.h:
+src/util/arith.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/ascii.h:
+src/util/bsearch.h:
+src/util/array.h:
+src/util/intern.h:
+src/util/log.h:
+src/util/numtostr.h:
+src/util/path.h:
+src/util/str-array.h:
+src/util/str-util.h:
+src/util/strtonum.h:
+src/util/time-util.h:
+src/util/log.h:
+src/util/xsnprintf.h:
+src/util/xstring.h:
+src/wrap.h:
@@ -0,0 +1,32 @@
+build/compat.o: src/compat.c build/gen/build-defs.h \
+ build/gen/buildvar-iconv.h build/gen/buildvar-threads.h src/compat.h \
+ src/regexp.h src/command/error.h src/util/macros.h src/util/macros.h \
+ src/util/string-view.h src/util/ascii.h src/util/macros.h \
+ src/util/debug.h src/util/errorcode.h src/util/xmemrchr.h \
+ src/util/xstring.h src/util/string.h src/util/arith.h src/util/bit.h \
+ src/util/str-util.h src/util/string-view.h src/util/unicode.h \
+ src/util/xmalloc.h src/util/debug.h src/util/unicode.h
+build/gen/build-defs.h:
+build/gen/buildvar-iconv.h:
+build/gen/buildvar-threads.h:
+src/compat.h:
+src/regexp.h:
+src/command/error.h:
+src/util/macros.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/string.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/util/debug.h:
+src/util/unicode.h:
@@ -0,0 +1,38 @@
+build/compiler.o: src/compiler.c src/compiler.h src/util/hashmap.h \
+ src/util/container.h src/util/macros.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/ptr-array.h \
+ src/util/bit.h src/util/xmalloc.h src/util/arith.h src/util/xstring.h \
+ src/util/ascii.h src/util/string.h src/util/str-util.h \
+ src/util/string-view.h src/util/xmemrchr.h src/util/unicode.h \
+ src/command/serialize.h src/util/macros.h src/util/string.h \
+ src/util/string-view.h src/util/array.h src/util/ptr-array.h \
+ src/util/debug.h src/util/intern.h src/util/str-util.h \
+ src/util/xmalloc.h
+src/compiler.h:
+src/util/hashmap.h:
+src/util/container.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/string.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/unicode.h:
+src/command/serialize.h:
+src/util/macros.h:
+src/util/string.h:
+src/util/string-view.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/debug.h:
+src/util/intern.h:
+src/util/str-util.h:
+src/util/xmalloc.h:
@@ -0,0 +1,44 @@
+build/editorconfig/editorconfig.o: src/editorconfig/editorconfig.c \
+ src/editorconfig/editorconfig.h src/util/macros.h src/editorconfig/ini.h \
+ src/util/string-view.h src/util/ascii.h src/util/macros.h \
+ src/util/debug.h src/util/errorcode.h src/util/xmemrchr.h \
+ src/util/xstring.h src/editorconfig/match.h src/util/string.h \
+ src/util/arith.h src/util/bit.h src/util/str-util.h \
+ src/util/string-view.h src/util/unicode.h src/util/xmalloc.h \
+ src/options.h src/command/error.h src/regexp.h src/util/macros.h \
+ src/util/string-view.h src/util/string.h src/util/debug.h \
+ src/util/ptr-array.h src/util/container.h src/util/debug.h \
+ src/util/path.h src/util/readfile.h src/util/strtonum.h \
+ src/util/xstring.h
+src/editorconfig/editorconfig.h:
+src/util/macros.h:
+src/editorconfig/ini.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/editorconfig/match.h:
+src/util/string.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/options.h:
+src/command/error.h:
+src/regexp.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/string.h:
+src/util/debug.h:
+src/util/ptr-array.h:
+src/util/container.h:
+src/util/debug.h:
+src/util/path.h:
+src/util/readfile.h:
+src/util/strtonum.h:
+src/util/xstring.h:
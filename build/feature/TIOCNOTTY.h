@@ -0,0 +1 @@
+#define HAVE_TIOCNOTTY 1
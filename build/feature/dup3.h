@@ -0,0 +1 @@
+#define HAVE_DUP3 1
@@ -0,0 +1 @@
+#define HAVE_EMBED 0
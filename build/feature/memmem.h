@@ -0,0 +1 @@
+#define HAVE_MEMMEM 1
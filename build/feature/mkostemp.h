@@ -0,0 +1 @@
+#define HAVE_MKOSTEMP 1
@@ -0,0 +1 @@
+#define HAVE_PIPE2 1
@@ -0,0 +1 @@
+#define HAVE_QSORT_R 1
@@ -0,0 +1 @@
+#define THREADS_DISABLE 0
@@ -0,0 +1,11 @@
+# Generated by mk/compiler.sh; do not edit
+BASIC_CFLAGS += -std=gnu11
+BASIC_CFLAGS += -fvisibility=hidden
+BASIC_CFLAGS += @mk/cflags/warnings-gcc4.8.txt
+CC_SANITIZER_FLAGS += @mk/cflags/sanitizer.txt
+CC_PTHREAD += -pthread
+BASIC_CFLAGS += -Wno-unterminated-string-initialization
+CC_NO_UNWIND_TABLES += -fno-asynchronous-unwind-tables
+CC_DEPFLAGS = -MMD -MP -MF $(@:.o=.mk)
+CC_IS_CCACHE = 0
+CC_TARGET = x86_64-linux-gnu
@@ -0,0 +1 @@
+#define VERSION "1.11.1-unknown"
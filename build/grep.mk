@@ -0,0 +1,90 @@
+build/grep.o: src/grep.c build/gen/build-defs.h \
+ build/gen/buildvar-threads.h src/grep.h src/command/error.h \
+ src/util/macros.h src/msg.h src/bookmark.h src/util/macros.h \
+ src/util/ptr-array.h src/util/bit.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/container.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h src/util/ascii.h \
+ src/util/xmalloc.h src/view.h src/block-iter.h src/block.h \
+ src/util/debug.h src/util/list.h src/util/string-view.h \
+ src/util/xmemrchr.h src/util/unicode.h src/util/string.h \
+ src/util/str-util.h src/util/string-view.h src/util/unicode.h \
+ src/window.h src/buffer.h src/change.h src/edit.h src/lock.h \
+ src/match-cache.h src/options.h src/regexp.h src/syntax/highlight.h \
+ src/block-iter.h src/syntax/color.h src/terminal/style.h \
+ src/terminal/color.h src/terminal/feature.h src/util/ptr-array.h \
+ src/util/hashmap.h src/util/string.h src/syntax/syntax.h \
+ src/command/error.h src/syntax/bitset.h src/util/debug.h \
+ src/util/byte-class.h src/util/hashset.h src/util/string-view.h \
+ src/syntax/syntax.h src/frame.h src/util/arith.h src/util/ascii.h \
+ src/util/count-nl.h src/util/fd.h src/util/parallel.h src/util/path.h \
+ src/util/xdirent.h src/util/maybebool.h src/util/xmemmem.h \
+ src/util/xmemrchr.h src/util/xreadwrite.h src/util/xstring.h
+build/gen/build-defs.h:
+build/gen/buildvar-threads.h:
+src/grep.h:
+src/command/error.h:
+src/util/macros.h:
+src/msg.h:
+src/bookmark.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/xmalloc.h:
+src/view.h:
+src/block-iter.h:
+src/block.h:
+src/util/debug.h:
+src/util/list.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/unicode.h:
+src/util/string.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/window.h:
+src/buffer.h:
+src/change.h:
+src/edit.h:
+src/lock.h:
+src/match-cache.h:
+src/options.h:
+src/regexp.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/ptr-array.h:
+src/util/hashmap.h:
+src/util/string.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/syntax/bitset.h:
+src/util/debug.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/util/string-view.h:
+src/syntax/syntax.h:
+src/frame.h:
+src/util/arith.h:
+src/util/ascii.h:
+src/util/count-nl.h:
+src/util/fd.h:
+src/util/parallel.h:
+src/util/path.h:
+src/util/xdirent.h:
+src/util/maybebool.h:
+src/util/xmemmem.h:
+src/util/xmemrchr.h:
+src/util/xreadwrite.h:
+src/util/xstring.h:
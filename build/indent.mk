@@ -0,0 +1,70 @@
+build/indent.o: src/indent.c src/indent.h src/block-iter.h src/block.h \
+ src/util/debug.h src/util/errorcode.h src/util/macros.h src/util/list.h \
+ src/util/macros.h src/util/string-view.h src/util/ascii.h \
+ src/util/debug.h src/util/xmemrchr.h src/util/xstring.h \
+ src/util/unicode.h src/options.h src/command/error.h src/util/macros.h \
+ src/regexp.h src/util/string.h src/util/arith.h src/util/bit.h \
+ src/util/str-util.h src/util/string-view.h src/util/unicode.h \
+ src/util/xmalloc.h src/util/ptr-array.h src/util/container.h \
+ src/util/bit.h src/view.h src/buffer.h src/change.h src/edit.h \
+ src/lock.h src/match-cache.h src/syntax/highlight.h src/block-iter.h \
+ src/syntax/color.h src/terminal/style.h src/terminal/color.h \
+ src/terminal/feature.h src/util/ptr-array.h src/util/hashmap.h \
+ src/util/string.h src/syntax/syntax.h src/command/error.h \
+ src/syntax/bitset.h src/util/debug.h src/util/byte-class.h \
+ src/util/hashset.h src/util/string-view.h src/syntax/syntax.h src/move.h \
+ src/selection.h src/util/xmalloc.h
+src/indent.h:
+src/block-iter.h:
+src/block.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/list.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/unicode.h:
+src/options.h:
+src/command/error.h:
+src/util/macros.h:
+src/regexp.h:
+src/util/string.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/util/ptr-array.h:
+src/util/container.h:
+src/util/bit.h:
+src/view.h:
+src/buffer.h:
+src/change.h:
+src/edit.h:
+src/lock.h:
+src/match-cache.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/ptr-array.h:
+src/util/hashmap.h:
+src/util/string.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/syntax/bitset.h:
+src/util/debug.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/util/string-view.h:
+src/syntax/syntax.h:
+src/move.h:
+src/selection.h:
+src/util/xmalloc.h:
@@ -0,0 +1,82 @@
+build/load-save.o: src/load-save.c build/gen/build-defs.h src/load-save.h \
+ src/buffer.h src/block-iter.h src/block.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/list.h src/util/macros.h \
+ src/util/string-view.h src/util/ascii.h src/util/debug.h \
+ src/util/xmemrchr.h src/util/xstring.h src/util/unicode.h src/change.h \
+ src/command/error.h src/util/macros.h src/edit.h src/view.h \
+ src/util/string.h src/util/arith.h src/util/bit.h src/util/str-util.h \
+ src/util/string-view.h src/util/unicode.h src/util/xmalloc.h src/lock.h \
+ src/match-cache.h src/options.h src/regexp.h src/util/ptr-array.h \
+ src/util/container.h src/syntax/highlight.h src/block-iter.h \
+ src/syntax/color.h src/terminal/style.h src/terminal/color.h \
+ src/terminal/feature.h src/util/ptr-array.h src/util/hashmap.h \
+ src/util/string.h src/syntax/syntax.h src/command/error.h \
+ src/syntax/bitset.h src/util/debug.h src/util/byte-class.h \
+ src/util/hashset.h src/util/string-view.h src/syntax/syntax.h \
+ src/convert.h src/encoding.h src/util/fd.h src/util/log.h \
+ src/util/numtostr.h src/util/path.h src/util/str-util.h \
+ src/util/time-util.h src/util/log.h src/util/xadvise.h \
+ src/util/xreadwrite.h src/util/xstring.h
+build/gen/build-defs.h:
+src/load-save.h:
+src/buffer.h:
+src/block-iter.h:
+src/block.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/list.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/unicode.h:
+src/change.h:
+src/command/error.h:
+src/util/macros.h:
+src/edit.h:
+src/view.h:
+src/util/string.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/lock.h:
+src/match-cache.h:
+src/options.h:
+src/regexp.h:
+src/util/ptr-array.h:
+src/util/container.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/ptr-array.h:
+src/util/hashmap.h:
+src/util/string.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/syntax/bitset.h:
+src/util/debug.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/util/string-view.h:
+src/syntax/syntax.h:
+src/convert.h:
+src/encoding.h:
+src/util/fd.h:
+src/util/log.h:
+src/util/numtostr.h:
+src/util/path.h:
+src/util/str-util.h:
+src/util/time-util.h:
+src/util/log.h:
+src/util/xadvise.h:
+src/util/xreadwrite.h:
+src/util/xstring.h:
@@ -0,0 +1,138 @@
+build/main.o: src/main.c src/block.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/list.h src/util/macros.h \
+ src/buffer.h src/block-iter.h src/util/string-view.h src/util/ascii.h \
+ src/util/debug.h src/util/xmemrchr.h src/util/xstring.h \
+ src/util/unicode.h src/change.h src/command/error.h src/util/macros.h \
+ src/edit.h src/view.h src/util/string.h src/util/arith.h src/util/bit.h \
+ src/util/str-util.h src/util/string-view.h src/util/unicode.h \
+ src/util/xmalloc.h src/lock.h src/match-cache.h src/options.h \
+ src/regexp.h src/util/ptr-array.h src/util/container.h \
+ src/syntax/highlight.h src/block-iter.h src/syntax/color.h \
+ src/terminal/style.h src/terminal/color.h src/terminal/feature.h \
+ src/util/ptr-array.h src/util/hashmap.h src/util/string.h \
+ src/syntax/syntax.h src/command/error.h src/syntax/bitset.h \
+ src/util/debug.h src/util/byte-class.h src/util/hashset.h \
+ src/util/string-view.h src/syntax/syntax.h src/commands.h \
+ src/command/run.h src/command/error.h src/config.h src/util/align.h \
+ src/util/errorcode.h src/compat.h src/editor.h src/cmdline.h \
+ src/history.h src/util/hashmap.h src/command/macro.h src/util/unicode.h \
+ src/copy.h src/file-history.h src/frame.h src/grep.h src/msg.h \
+ src/bookmark.h src/util/xmalloc.h src/window.h src/mode.h \
+ src/terminal/key.h src/util/intmap.h src/search.h src/syntax/color.h \
+ src/syntax/state.h src/tag.h src/ctags.h src/terminal/cursor.h \
+ src/terminal/color.h src/terminal/terminal.h src/terminal/key.h \
+ src/terminal/style.h src/terminal/terminal.h src/util/hashset.h \
+ src/vars.h src/encoding.h src/load-save.h src/move.h src/palette.h \
+ src/util/exitcode.h src/util/xreadwrite.h src/showkey.h src/signals.h \
+ src/terminal/mode.h src/terminal/output.h src/terminal/terminal.h \
+ src/trace.h src/util/log.h src/ui.h src/util/utf8.h src/util/fd.h \
+ src/util/path.h src/util/progname.h src/util/str-util.h \
+ src/util/strtonum.h src/util/xreadwrite.h build/gen/version.h
+src/block.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/list.h:
+src/util/macros.h:
+src/buffer.h:
+src/block-iter.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/unicode.h:
+src/change.h:
+src/command/error.h:
+src/util/macros.h:
+src/edit.h:
+src/view.h:
+src/util/string.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/lock.h:
+src/match-cache.h:
+src/options.h:
+src/regexp.h:
+src/util/ptr-array.h:
+src/util/container.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/ptr-array.h:
+src/util/hashmap.h:
+src/util/string.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/syntax/bitset.h:
+src/util/debug.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/util/string-view.h:
+src/syntax/syntax.h:
+src/commands.h:
+src/command/run.h:
+src/command/error.h:
+src/config.h:
+src/util/align.h:
+src/util/errorcode.h:
+src/compat.h:
+src/editor.h:
+src/cmdline.h:
+src/history.h:
+src/util/hashmap.h:
+src/command/macro.h:
+src/util/unicode.h:
+src/copy.h:
+src/file-history.h:
+src/frame.h:
+src/grep.h:
+src/msg.h:
+src/bookmark.h:
+src/util/xmalloc.h:
+src/window.h:
+src/mode.h:
+src/terminal/key.h:
+src/util/intmap.h:
+src/search.h:
+src/syntax/color.h:
+src/syntax/state.h:
+src/tag.h:
+src/ctags.h:
+src/terminal/cursor.h:
+src/terminal/color.h:
+src/terminal/terminal.h:
+src/terminal/key.h:
+src/terminal/style.h:
+src/terminal/terminal.h:
+src/util/hashset.h:
+src/vars.h:
+src/encoding.h:
+src/load-save.h:
+src/move.h:
+src/palette.h:
+src/util/exitcode.h:
+src/util/xreadwrite.h:
+src/showkey.h:
+src/signals.h:
+src/terminal/mode.h:
+src/terminal/output.h:
+src/terminal/terminal.h:
+src/trace.h:
+src/util/log.h:
+src/ui.h:
+src/util/utf8.h:
+src/util/fd.h:
+src/util/path.h:
+src/util/progname.h:
+src/util/str-util.h:
+src/util/strtonum.h:
+src/util/xreadwrite.h:
+build/gen/version.h:
@@ -0,0 +1,7 @@
+build/palette.o: src/palette.c src/palette.h src/util/exitcode.h \
+ src/util/macros.h src/util/xreadwrite.h src/util/errorcode.h
+src/palette.h:
+src/util/exitcode.h:
+src/util/macros.h:
+src/util/xreadwrite.h:
+src/util/errorcode.h:
@@ -0,0 +1,36 @@
+build/regexp.o: src/regexp.c src/regexp.h src/command/error.h \
+ src/util/macros.h src/util/macros.h src/util/string-view.h \
+ src/util/ascii.h src/util/macros.h src/util/debug.h src/util/errorcode.h \
+ src/util/xmemrchr.h src/util/xstring.h src/util/string.h \
+ src/util/arith.h src/util/bit.h src/util/str-util.h \
+ src/util/string-view.h src/util/unicode.h src/util/xmalloc.h \
+ src/util/arith.h src/util/ascii.h src/util/debug.h src/util/hashmap.h \
+ src/util/container.h src/util/intern.h src/util/ptr-array.h \
+ src/util/xmalloc.h src/util/xstring.h
+src/regexp.h:
+src/command/error.h:
+src/util/macros.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/string.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/hashmap.h:
+src/util/container.h:
+src/util/intern.h:
+src/util/ptr-array.h:
+src/util/xmalloc.h:
+src/util/xstring.h:
@@ -0,0 +1,136 @@
+build/show.o: src/show.c src/show.h src/util/macros.h \
+ src/util/ptr-array.h src/util/bit.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/container.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h src/util/ascii.h \
+ src/util/string.h src/util/str-util.h src/util/string-view.h \
+ src/util/xmemrchr.h src/util/unicode.h src/bind.h src/command/cache.h \
+ src/command/run.h src/command/error.h src/util/macros.h \
+ src/util/string-view.h src/mode.h src/command/run.h src/terminal/key.h \
+ src/util/hashmap.h src/util/intmap.h src/buffer.h src/block-iter.h \
+ src/block.h src/util/debug.h src/util/list.h src/util/string-view.h \
+ src/util/unicode.h src/change.h src/command/error.h src/edit.h \
+ src/view.h src/lock.h src/match-cache.h src/options.h src/regexp.h \
+ src/syntax/highlight.h src/block-iter.h src/syntax/color.h \
+ src/terminal/style.h src/terminal/color.h src/terminal/feature.h \
+ src/util/ptr-array.h src/util/hashmap.h src/util/string.h \
+ src/syntax/syntax.h src/command/error.h src/syntax/bitset.h \
+ src/util/debug.h src/util/byte-class.h src/util/hashset.h \
+ src/syntax/syntax.h src/cmdline.h src/history.h src/command/alias.h \
+ src/command/macro.h src/util/unicode.h src/command/serialize.h \
+ src/commands.h src/config.h src/util/align.h src/util/errorcode.h \
+ src/compiler.h src/completion.h src/editor.h src/copy.h \
+ src/file-history.h src/frame.h src/grep.h src/msg.h src/bookmark.h \
+ src/util/xmalloc.h src/window.h src/search.h src/syntax/color.h \
+ src/syntax/state.h src/tag.h src/ctags.h src/terminal/cursor.h \
+ src/terminal/color.h src/terminal/terminal.h src/terminal/key.h \
+ src/terminal/style.h src/terminal/terminal.h src/util/hashset.h \
+ src/vars.h src/file-option.h src/filetype.h src/terminal/style.h \
+ src/util/array.h src/util/ptr-array.h src/util/bsearch.h \
+ src/util/array.h src/util/environ.h src/util/intern.h src/util/log.h \
+ src/util/numtostr.h src/util/xsnprintf.h src/util/xstring.h
+src/show.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/string.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/unicode.h:
+src/bind.h:
+src/command/cache.h:
+src/command/run.h:
+src/command/error.h:
+src/util/macros.h:
+src/util/string-view.h:
+src/mode.h:
+src/command/run.h:
+src/terminal/key.h:
+src/util/hashmap.h:
+src/util/intmap.h:
+src/buffer.h:
+src/block-iter.h:
+src/block.h:
+src/util/debug.h:
+src/util/list.h:
+src/util/string-view.h:
+src/util/unicode.h:
+src/change.h:
+src/command/error.h:
+src/edit.h:
+src/view.h:
+src/lock.h:
+src/match-cache.h:
+src/options.h:
+src/regexp.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/ptr-array.h:
+src/util/hashmap.h:
+src/util/string.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/syntax/bitset.h:
+src/util/debug.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/syntax/syntax.h:
+src/cmdline.h:
+src/history.h:
+src/command/alias.h:
+src/command/macro.h:
+src/util/unicode.h:
+src/command/serialize.h:
+src/commands.h:
+src/config.h:
+src/util/align.h:
+src/util/errorcode.h:
+src/compiler.h:
+src/completion.h:
+src/editor.h:
+src/copy.h:
+src/file-history.h:
+src/frame.h:
+src/grep.h:
+src/msg.h:
+src/bookmark.h:
+src/util/xmalloc.h:
+src/window.h:
+src/search.h:
+src/syntax/color.h:
+src/syntax/state.h:
+src/tag.h:
+src/ctags.h:
+src/terminal/cursor.h:
+src/terminal/color.h:
+src/terminal/terminal.h:
+src/terminal/key.h:
+src/terminal/style.h:
+src/terminal/terminal.h:
+src/util/hashset.h:
+src/vars.h:
+src/file-option.h:
+src/filetype.h:
+src/terminal/style.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/bsearch.h:
+src/util/array.h:
+src/util/environ.h:
+src/util/intern.h:
+src/util/log.h:
+src/util/numtostr.h:
+src/util/xsnprintf.h:
+src/util/xstring.h:
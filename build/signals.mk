@@ -0,0 +1,25 @@
+build/signals.o: src/signals.c build/gen/build-defs.h src/signals.h \
+ src/util/errorcode.h src/util/array.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/ptr-array.h \
+ src/util/bit.h src/util/container.h src/util/xmalloc.h src/util/arith.h \
+ src/util/xstring.h src/util/ascii.h src/util/debug.h src/util/exitcode.h \
+ src/util/xreadwrite.h src/util/log.h src/util/macros.h
+build/gen/build-defs.h:
+src/signals.h:
+src/util/errorcode.h:
+src/util/array.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/exitcode.h:
+src/util/xreadwrite.h:
+src/util/log.h:
+src/util/macros.h:
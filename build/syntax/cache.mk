@@ -0,0 +1,126 @@
+build/syntax/cache.o: src/syntax/cache.c src/syntax/cache.h \
+ src/syntax/state.h src/syntax/syntax.h src/command/error.h \
+ src/util/macros.h src/syntax/bitset.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/syntax/color.h \
+ src/terminal/style.h src/terminal/color.h src/terminal/feature.h \
+ src/util/ptr-array.h src/util/bit.h src/util/debug.h \
+ src/util/container.h src/util/xmalloc.h src/util/arith.h \
+ src/util/xstring.h src/util/ascii.h src/util/hashmap.h src/util/string.h \
+ src/util/str-util.h src/util/string-view.h src/util/xmemrchr.h \
+ src/util/unicode.h src/util/byte-class.h src/util/hashset.h \
+ src/util/string-view.h src/config.h src/command/run.h \
+ src/command/error.h src/util/align.h src/util/errorcode.h \
+ src/util/macros.h src/util/ptr-array.h src/util/string-view.h \
+ src/util/string.h src/editor.h src/buffer.h src/block-iter.h src/block.h \
+ src/util/debug.h src/util/list.h src/util/unicode.h src/change.h \
+ src/command/error.h src/edit.h src/view.h src/lock.h src/match-cache.h \
+ src/options.h src/regexp.h src/syntax/highlight.h src/block-iter.h \
+ src/syntax/syntax.h src/cmdline.h src/history.h src/util/hashmap.h \
+ src/command/macro.h src/util/unicode.h src/commands.h src/config.h \
+ src/copy.h src/file-history.h src/frame.h src/grep.h src/msg.h \
+ src/bookmark.h src/util/xmalloc.h src/window.h src/mode.h \
+ src/terminal/key.h src/util/intmap.h src/search.h src/syntax/color.h \
+ src/syntax/state.h src/tag.h src/ctags.h src/terminal/cursor.h \
+ src/terminal/color.h src/terminal/terminal.h src/terminal/key.h \
+ src/terminal/style.h src/terminal/terminal.h src/util/hashset.h \
+ src/vars.h src/syntax/merge.h src/util/hash.h src/util/intern.h \
+ src/util/log.h src/util/path.h src/util/readfile.h src/util/xmalloc.h \
+ src/util/xreadwrite.h src/util/xstring.h build/gen/version.h
+src/syntax/cache.h:
+src/syntax/state.h:
+src/syntax/syntax.h:
+src/command/error.h:
+src/util/macros.h:
+src/syntax/bitset.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/syntax/color.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/hashmap.h:
+src/util/string.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/unicode.h:
+src/util/byte-class.h:
+src/util/hashset.h:
+src/util/string-view.h:
+src/config.h:
+src/command/run.h:
+src/command/error.h:
+src/util/align.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/string-view.h:
+src/util/string.h:
+src/editor.h:
+src/buffer.h:
+src/block-iter.h:
+src/block.h:
+src/util/debug.h:
+src/util/list.h:
+src/util/unicode.h:
+src/change.h:
+src/command/error.h:
+src/edit.h:
+src/view.h:
+src/lock.h:
+src/match-cache.h:
+src/options.h:
+src/regexp.h:
+src/syntax/highlight.h:
+src/block-iter.h:
+src/syntax/syntax.h:
+src/cmdline.h:
+src/history.h:
+src/util/hashmap.h:
+src/command/macro.h:
+src/util/unicode.h:
+src/commands.h:
+src/config.h:
+src/copy.h:
+src/file-history.h:
+src/frame.h:
+src/grep.h:
+src/msg.h:
+src/bookmark.h:
+src/util/xmalloc.h:
+src/window.h:
+src/mode.h:
+src/terminal/key.h:
+src/util/intmap.h:
+src/search.h:
+src/syntax/color.h:
+src/syntax/state.h:
+src/tag.h:
+src/ctags.h:
+src/terminal/cursor.h:
+src/terminal/color.h:
+src/terminal/terminal.h:
+src/terminal/key.h:
+src/terminal/style.h:
+src/terminal/terminal.h:
+src/util/hashset.h:
+src/vars.h:
+src/syntax/merge.h:
+src/util/hash.h:
+src/util/intern.h:
+src/util/log.h:
+src/util/path.h:
+src/util/readfile.h:
+src/util/xmalloc.h:
+src/util/xreadwrite.h:
+src/util/xstring.h:
+build/gen/version.h:
@@ -0,0 +1,29 @@
+build/terminal/cursor.o: src/terminal/cursor.c src/terminal/cursor.h \
+ src/terminal/color.h src/terminal/feature.h src/util/macros.h \
+ src/terminal/terminal.h src/terminal/key.h src/terminal/style.h \
+ src/terminal/color.h src/util/ptr-array.h src/util/bit.h \
+ src/util/debug.h src/util/errorcode.h src/util/macros.h \
+ src/util/container.h src/util/xmalloc.h src/util/arith.h \
+ src/util/xstring.h src/util/ascii.h src/util/array.h \
+ src/util/ptr-array.h src/util/debug.h
+src/terminal/cursor.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/macros.h:
+src/terminal/terminal.h:
+src/terminal/key.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/debug.h:
@@ -0,0 +1,31 @@
+build/terminal/feature.o: src/terminal/feature.c src/terminal/feature.h \
+ src/util/macros.h src/util/array.h src/util/debug.h src/util/errorcode.h \
+ src/util/macros.h src/util/ptr-array.h src/util/bit.h \
+ src/util/container.h src/util/xmalloc.h src/util/arith.h \
+ src/util/xstring.h src/util/ascii.h src/util/bit.h src/util/bsearch.h \
+ src/util/array.h src/util/debug.h src/util/log.h src/util/str-util.h \
+ src/util/string-view.h src/util/xmemrchr.h src/util/string-view.h \
+ src/util/xstring.h
+src/terminal/feature.h:
+src/util/macros.h:
+src/util/array.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/bit.h:
+src/util/bsearch.h:
+src/util/array.h:
+src/util/debug.h:
+src/util/log.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/string-view.h:
+src/util/xstring.h:
@@ -0,0 +1,44 @@
+build/terminal/input.o: src/terminal/input.c src/terminal/input.h \
+ src/terminal/key.h src/util/macros.h src/terminal/terminal.h \
+ src/terminal/feature.h src/terminal/style.h src/terminal/color.h \
+ src/util/ptr-array.h src/util/bit.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/container.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h src/util/ascii.h \
+ src/terminal/linux.h src/terminal/output.h src/util/unicode.h \
+ src/terminal/parse.h src/terminal/rxvt.h src/trace.h src/util/debug.h \
+ src/util/log.h src/util/macros.h src/util/ascii.h src/util/debug.h \
+ src/util/log.h src/util/time-util.h src/util/log.h src/util/utf8.h \
+ src/util/unicode.h
+src/terminal/input.h:
+src/terminal/key.h:
+src/util/macros.h:
+src/terminal/terminal.h:
+src/terminal/feature.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/terminal/linux.h:
+src/terminal/output.h:
+src/util/unicode.h:
+src/terminal/parse.h:
+src/terminal/rxvt.h:
+src/trace.h:
+src/util/debug.h:
+src/util/log.h:
+src/util/macros.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/log.h:
+src/util/time-util.h:
+src/util/log.h:
+src/util/utf8.h:
+src/util/unicode.h:
@@ -0,0 +1,30 @@
+build/terminal/key.o: src/terminal/key.c src/terminal/key.h \
+ src/util/macros.h src/util/array.h src/util/debug.h src/util/errorcode.h \
+ src/util/macros.h src/util/ptr-array.h src/util/bit.h \
+ src/util/container.h src/util/xmalloc.h src/util/arith.h \
+ src/util/xstring.h src/util/ascii.h src/util/ascii.h src/util/debug.h \
+ src/util/numtostr.h src/util/str-util.h src/util/string-view.h \
+ src/util/xmemrchr.h src/util/unicode.h src/util/utf8.h \
+ src/util/unicode.h
+src/terminal/key.h:
+src/util/macros.h:
+src/util/array.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/numtostr.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/unicode.h:
+src/util/utf8.h:
+src/util/unicode.h:
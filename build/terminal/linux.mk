@@ -0,0 +1,13 @@
+build/terminal/linux.o: src/terminal/linux.c src/terminal/linux.h \
+ src/terminal/key.h src/util/macros.h src/terminal/parse.h \
+ src/util/xstring.h src/util/ascii.h src/util/macros.h src/util/debug.h \
+ src/util/errorcode.h
+src/terminal/linux.h:
+src/terminal/key.h:
+src/util/macros.h:
+src/terminal/parse.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
@@ -0,0 +1,32 @@
+build/terminal/osc52.o: src/terminal/osc52.c src/terminal/osc52.h \
+ src/terminal/terminal.h src/terminal/feature.h src/util/macros.h \
+ src/terminal/key.h src/terminal/style.h src/terminal/color.h \
+ src/util/ptr-array.h src/util/bit.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/container.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h src/util/ascii.h \
+ src/util/string-view.h src/util/xmemrchr.h src/terminal/output.h \
+ src/util/unicode.h src/util/base64.h src/util/debug.h src/util/xstring.h
+src/terminal/osc52.h:
+src/terminal/terminal.h:
+src/terminal/feature.h:
+src/util/macros.h:
+src/terminal/key.h:
+src/terminal/style.h:
+src/terminal/color.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/terminal/output.h:
+src/util/unicode.h:
+src/util/base64.h:
+src/util/debug.h:
+src/util/xstring.h:
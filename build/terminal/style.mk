@@ -0,0 +1,32 @@
+build/terminal/style.o: src/terminal/style.c src/terminal/style.h \
+ src/terminal/color.h src/terminal/feature.h src/util/macros.h \
+ src/util/ptr-array.h src/util/bit.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/container.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h src/util/ascii.h \
+ src/util/array.h src/util/ptr-array.h src/util/ascii.h src/util/debug.h \
+ src/util/numtostr.h src/util/str-util.h src/util/string-view.h \
+ src/util/xmemrchr.h src/util/strtonum.h src/util/xmalloc.h
+src/terminal/style.h:
+src/terminal/color.h:
+src/terminal/feature.h:
+src/util/macros.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/ascii.h:
+src/util/debug.h:
+src/util/numtostr.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/strtonum.h:
+src/util/xmalloc.h:
@@ -0,0 +1,25 @@
+build/trace.o: src/trace.c src/trace.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/log.h src/util/debug.h \
+ src/util/macros.h src/util/array.h src/util/ptr-array.h src/util/bit.h \
+ src/util/container.h src/util/xmalloc.h src/util/arith.h \
+ src/util/xstring.h src/util/ascii.h src/util/str-util.h \
+ src/util/string-view.h src/util/xmemrchr.h src/util/xstring.h
+src/trace.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/log.h:
+src/util/debug.h:
+src/util/macros.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
@@ -0,0 +1,6 @@
+build/util/arith.o: src/util/arith.c src/util/arith.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h
+src/util/arith.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
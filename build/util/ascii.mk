@@ -0,0 +1,3 @@
+build/util/ascii.o: src/util/ascii.c src/util/ascii.h src/util/macros.h
+src/util/ascii.h:
+src/util/macros.h:
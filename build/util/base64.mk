@@ -0,0 +1,6 @@
+build/util/base64.o: src/util/base64.c src/util/base64.h \
+ src/util/macros.h src/util/debug.h src/util/errorcode.h
+src/util/base64.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
@@ -0,0 +1,7 @@
+build/util/byte-class.o: src/util/byte-class.c src/util/byte-class.h \
+ src/util/macros.h src/util/bit.h src/util/debug.h src/util/errorcode.h
+src/util/byte-class.h:
+src/util/macros.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
@@ -0,0 +1,4 @@
+build/util/count-nl.o: src/util/count-nl.c src/util/count-nl.h \
+ src/util/macros.h
+src/util/count-nl.h:
+src/util/macros.h:
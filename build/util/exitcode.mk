@@ -0,0 +1,6 @@
+build/util/exitcode.o: src/util/exitcode.c src/util/exitcode.h \
+ src/util/macros.h src/util/xreadwrite.h src/util/errorcode.h
+src/util/exitcode.h:
+src/util/macros.h:
+src/util/xreadwrite.h:
+src/util/errorcode.h:
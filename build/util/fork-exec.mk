@@ -0,0 +1,17 @@
+build/util/fork-exec.o: src/util/fork-exec.c build/gen/build-defs.h \
+ src/util/fork-exec.h src/util/macros.h src/util/debug.h \
+ src/util/errorcode.h src/util/fd.h src/util/log.h src/util/numtostr.h \
+ src/terminal/ioctl.h src/util/errorcode.h src/util/macros.h \
+ src/util/xreadwrite.h
+build/gen/build-defs.h:
+src/util/fork-exec.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/fd.h:
+src/util/log.h:
+src/util/numtostr.h:
+src/terminal/ioctl.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/xreadwrite.h:
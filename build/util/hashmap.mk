@@ -0,0 +1,14 @@
+build/util/hashmap.o: src/util/hashmap.c src/util/hashmap.h \
+ src/util/container.h src/util/macros.h src/util/debug.h \
+ src/util/errorcode.h src/util/arith.h src/util/bit.h src/util/hash.h \
+ src/util/ascii.h src/util/xstring.h
+src/util/hashmap.h:
+src/util/container.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/arith.h:
+src/util/bit.h:
+src/util/hash.h:
+src/util/ascii.h:
+src/util/xstring.h:
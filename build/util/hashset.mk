@@ -0,0 +1,14 @@
+build/util/hashset.o: src/util/hashset.c src/util/hashset.h \
+ src/util/macros.h src/util/bit.h src/util/debug.h src/util/errorcode.h \
+ src/util/hash.h src/util/ascii.h src/util/xmalloc.h src/util/arith.h \
+ src/util/xstring.h
+src/util/hashset.h:
+src/util/macros.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/hash.h:
+src/util/ascii.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
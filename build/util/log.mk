@@ -0,0 +1,19 @@
+build/util/log.o: src/util/log.c src/util/log.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/array.h \
+ src/util/ptr-array.h src/util/bit.h src/util/container.h \
+ src/util/xmalloc.h src/util/arith.h src/util/xstring.h src/util/ascii.h \
+ src/util/fd.h src/util/xreadwrite.h
+src/util/log.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/array.h:
+src/util/ptr-array.h:
+src/util/bit.h:
+src/util/container.h:
+src/util/xmalloc.h:
+src/util/arith.h:
+src/util/xstring.h:
+src/util/ascii.h:
+src/util/fd.h:
+src/util/xreadwrite.h:
@@ -0,0 +1,7 @@
+build/util/numtostr.o: src/util/numtostr.c src/util/numtostr.h \
+ src/util/macros.h src/util/bit.h src/util/debug.h src/util/errorcode.h
+src/util/numtostr.h:
+src/util/macros.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
@@ -0,0 +1,14 @@
+build/util/parallel.o: src/util/parallel.c build/gen/buildvar-threads.h \
+ src/util/parallel.h src/util/macros.h src/util/arith.h src/util/debug.h \
+ src/util/errorcode.h src/util/log.h src/util/xmalloc.h \
+ src/util/xstring.h src/util/ascii.h
+build/gen/buildvar-threads.h:
+src/util/parallel.h:
+src/util/macros.h:
+src/util/arith.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/log.h:
+src/util/xmalloc.h:
+src/util/xstring.h:
+src/util/ascii.h:
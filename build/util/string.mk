@@ -0,0 +1,19 @@
+build/util/string.o: src/util/string.c src/util/string.h src/util/arith.h \
+ src/util/debug.h src/util/errorcode.h src/util/macros.h src/util/bit.h \
+ src/util/str-util.h src/util/string-view.h src/util/ascii.h \
+ src/util/xmemrchr.h src/util/xstring.h src/util/unicode.h \
+ src/util/xmalloc.h src/util/utf8.h
+src/util/string.h:
+src/util/arith.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/bit.h:
+src/util/str-util.h:
+src/util/string-view.h:
+src/util/ascii.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
+src/util/unicode.h:
+src/util/xmalloc.h:
+src/util/utf8.h:
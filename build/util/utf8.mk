@@ -0,0 +1,10 @@
+build/util/utf8.o: src/util/utf8.c src/util/utf8.h src/util/debug.h \
+ src/util/errorcode.h src/util/macros.h src/util/unicode.h \
+ src/util/ascii.h src/util/numtostr.h
+src/util/utf8.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/macros.h:
+src/util/unicode.h:
+src/util/ascii.h:
+src/util/numtostr.h:
@@ -0,0 +1,8 @@
+build/util/xadvise.o: src/util/xadvise.c build/gen/build-defs.h \
+ src/util/xadvise.h src/util/macros.h src/util/debug.h \
+ src/util/errorcode.h
+build/gen/build-defs.h:
+src/util/xadvise.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
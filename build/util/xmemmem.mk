@@ -0,0 +1,13 @@
+build/util/xmemmem.o: src/util/xmemmem.c build/gen/build-defs.h \
+ src/util/xmemmem.h src/util/macros.h src/util/ascii.h src/util/bit.h \
+ src/util/debug.h src/util/errorcode.h src/util/xmemrchr.h \
+ src/util/xstring.h
+build/gen/build-defs.h:
+src/util/xmemmem.h:
+src/util/macros.h:
+src/util/ascii.h:
+src/util/bit.h:
+src/util/debug.h:
+src/util/errorcode.h:
+src/util/xmemrchr.h:
+src/util/xstring.h:
@@ -0,0 +1,5 @@
+build/util/xmemrchr.o: src/util/xmemrchr.c build/gen/build-defs.h \
+ src/util/xmemrchr.h src/util/macros.h
+build/gen/build-defs.h:
+src/util/xmemrchr.h:
+src/util/macros.h:
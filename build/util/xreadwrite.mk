@@ -0,0 +1,5 @@
+build/util/xreadwrite.o: src/util/xreadwrite.c src/util/xreadwrite.h \
+ src/util/errorcode.h src/util/macros.h
+src/util/xreadwrite.h:
+src/util/errorcode.h:
+src/util/macros.h:
@@ -0,0 +1,6 @@
+build/util/xsnprintf.o: src/util/xsnprintf.c src/util/xsnprintf.h \
+ src/util/macros.h src/util/debug.h src/util/errorcode.h
+src/util/xsnprintf.h:
+src/util/macros.h:
+src/util/debug.h:
+src/util/errorcode.h:
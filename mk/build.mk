@@ -27,16 +27,16 @@ BUILTIN_CONFIGS = $(addprefix config/, \
 
 TEST_CONFIGS := $(addprefix test/data/, $(addsuffix .dterc, \
     env thai crlf insert join change pipe redo replace indent repeat \
-    fuzz1 fuzz2 wrap exec move delete new-line tag ))
+    fuzz1 fuzz2 wrap exec move delete new-line tag search ))
 
 CC_VERSION = $(or \
     $(shell $(CC) --version 2>/dev/null | head -n1), \
     $(shell $(CC) -v 2>&1 | grep version) )
 
 util_objects := $(call prefix-obj, build/util/, \
-    arith array ascii base64 debug exitcode fd fork-exec hashmap hashset \
-    intern intmap log numtostr path ptr-array readfile string strtonum \
-    time-util unicode utf8 xadvise xdirent xmalloc xmemmem xmemrchr \
+    arith array ascii base64 byte-class count-nl debug exitcode fd fork-exec hashmap \
+    hashset intern intmap log numtostr parallel path ptr-array readfile string \
+    strtonum time-util unicode utf8 xadvise xdirent xmalloc xmemmem xmemrchr \
     xreadwrite xsnprintf xstdio )
 
 command_objects := $(call prefix-obj, build/command/, \
@@ -46,7 +46,7 @@ editorconfig_objects := $(call prefix-obj, build/editorconfig/, \
     editorconfig ini match )
 
 syntax_objects := $(call prefix-obj, build/syntax/, \
-    color highlight merge state syntax )
+    cache color highlight merge state syntax )
 
 terminal_objects := $(call prefix-obj, build/terminal/, \
     color cursor feature input ioctl key linux mode osc52 output parse \
@@ -55,10 +55,11 @@ terminal_objects := $(call prefix-obj, build/terminal/, \
 editor_objects := $(call prefix-obj, build/, \
     bind block block-iter bookmark buffer case change cmdline commands \
     compat compiler completion config convert copy ctags delete edit \
-    editor encoding exec file-history file-option filetype frame history \
-    indent insert join load-save lock main mode move msg options palette \
-    regexp replace search selection show showkey signals spawn status \
-    tag trace vars view window wrap \
+    editor encoding exec file-history file-option filetype frame grep \
+    history indent insert join load-save lock main match-cache mode move \
+    msg options palette regexp regexp-stream replace search selection \
+    show showkey signals spawn status tag trace undo-file vars view window \
+    wrap \
     $(addprefix ui-, cmdline prompt status tabbar view window) ui ) \
     $(command_objects) \
     $(editorconfig_objects) \
@@ -68,8 +69,8 @@ editor_objects := $(call prefix-obj, build/, \
 
 test_objects := $(call prefix-obj, build/test/, \
     bind bookmark buffer cmdline command config ctags dump editorconfig \
-    encoding error filetype frame history indent init main options regexp \
-    spawn status syntax terminal test util )
+    encoding error filetype frame grep history indent init main options \
+    regexp spawn status syntax terminal test util )
 
 bench_objects := $(call prefix-obj, build/test/, benchmark)
 
@@ -97,6 +98,11 @@ ifneq "$(ICONV_DISABLE)" "1"
   LDLIBS += $(LDLIBS_ICONV)
 endif
 
+ifneq "$(THREADS_DISABLE)" "1"
+  BASIC_CFLAGS += $(CC_PTHREAD)
+  BASIC_LDFLAGS += $(CC_PTHREAD)
+endif
+
 ifeq "$(SANE_WCTYPE)" "1"
   BASIC_CPPFLAGS += -DSANE_WCTYPE=1
 endif
@@ -157,15 +163,18 @@ build/config.o: build/gen/build-defs.h build/gen/builtin-config.h build/gen/buil
 build/test/config.o: build/gen/build-defs.h build/gen/test-data.h build/gen/test-data-embed.h
 build/main.o: build/gen/version.h
 build/editor.o: build/gen/version.h
+build/syntax/cache.o: build/gen/version.h
 build/test/command.o: build/gen/version.h
 build/test/init.o: build/gen/version.h
-build/compat.o: build/gen/build-defs.h build/gen/buildvar-iconv.h
+build/compat.o: build/gen/build-defs.h build/gen/buildvar-iconv.h build/gen/buildvar-threads.h
+build/grep.o: build/gen/build-defs.h build/gen/buildvar-threads.h
 build/load-save.o: build/gen/build-defs.h
 build/signals.o: build/gen/build-defs.h
 build/tag.o: build/gen/build-defs.h
 build/terminal/ioctl.o: build/gen/build-defs.h
 build/util/fd.o: build/gen/build-defs.h
 build/util/fork-exec.o: build/gen/build-defs.h
+build/util/parallel.o: build/gen/buildvar-threads.h
 build/util/xadvise.o: build/gen/build-defs.h
 build/util/xdirent.o: build/gen/build-defs.h
 build/util/xmemmem.o: build/gen/build-defs.h
@@ -206,6 +215,9 @@ build/gen/version.h: FORCE | build/gen/
 build/gen/buildvar-iconv.h: FORCE | build/gen/
 	@$(OPTCHECK) '$(HASH)define ICONV_DISABLE $(if $(call xstreq,$(ICONV_DISABLE),1),1,0)' $@
 
+build/gen/buildvar-threads.h: FORCE | build/gen/
+	@$(OPTCHECK) '$(HASH)define THREADS_DISABLE $(if $(call xstreq,$(THREADS_DISABLE),1),1,0)' $@
+
 build/gen/builtin-config.mk: FORCE | build/gen/
 	@$(OPTCHECK) '$(@:.mk=.h): $(BUILTIN_CONFIGS)' $@
 
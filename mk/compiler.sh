@@ -66,6 +66,10 @@ detect_cflags_any '@mk/cflags/warnings-gcc14.txt' '@mk/cflags/warnings-clang18.t
 detect_cflags "@mk/cflags/warnings-gcc15.txt"
 detect_cflags_for_var CC_SANITIZER_FLAGS '@mk/cflags/sanitizer.txt'
 
+# https://gcc.gnu.org/onlinedocs/gcc/Preprocessor-Options.html#index-pthread
+# https://clang.llvm.org/docs/ClangCommandLineReference.html#cmdoption-clang-pthread
+detect_cflags_for_var CC_PTHREAD '-pthread'
+
 # This is enabled by -Wextra in GCC 15, despite not being documented in the
 # list of changes (https://gcc.gnu.org/gcc-15/changes.html). The workaround
 # suggested in the warning message (use the `nonstring` attribute) isn't
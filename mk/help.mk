@@ -10,7 +10,7 @@ USERVARS = \
     $(call echo-if-set, LC_CTYPE LC_ALL) \
     DEBUG AWK CC CFLAGS \
     $(call echo-if-set, CPPFLAGS LDFLAGS LDLIBS TESTFLAGS WERROR V) \
-    $(call echo-if-set, ICONV_DISABLE NO_DEPS NO_COLOR NO_CONFIG_MK)
+    $(call echo-if-set, ICONV_DISABLE THREADS_DISABLE NO_DEPS NO_COLOR NO_CONFIG_MK)
 
 USERVARS_VERBOSE = \
     PANDOC LUA DESTDIR prefix bindir mandir \
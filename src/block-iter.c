@@ -293,47 +293,28 @@ void block_iter_skip_bytes(BlockIter *bi, size_t count)
 
 void block_iter_goto_offset(BlockIter *bi, size_t offset)
 {
-    Block *blk;
-    block_for_each(blk, bi->head) {
-        if (offset <= blk->size) {
-            bi->blk = blk;
-            bi->offset = offset;
-            return;
-        }
-        offset -= blk->size;
+    if (unlikely(offset > block_total_size(bi->blk))) {
+        return;
     }
+    bi->blk = block_find_offset(bi->blk, &offset);
+    bi->offset = offset;
 }
 
 void block_iter_goto_line(BlockIter *bi, size_t line)
 {
-    Block *blk = BLOCK(bi->head->next);
-    size_t nl = 0;
-    while (blk->node.next != bi->head && nl + blk->nl < line) {
-        nl += blk->nl;
-        blk = BLOCK(blk->node.next);
-    }
-
-    bi->blk = blk;
+    bi->blk = block_find_line(bi->blk, &line);
     bi->offset = 0;
-    while (nl < line) {
+    while (line > 0) {
         if (!block_iter_eat_line(bi)) {
             break;
         }
-        nl++;
+        line--;
     }
 }
 
 size_t block_iter_get_offset(const BlockIter *bi)
 {
-    const Block *blk;
-    size_t offset = 0;
-    block_for_each(blk, bi->head) {
-        if (blk == bi->blk) {
-            break;
-        }
-        offset += blk->size;
-    }
-    return offset + bi->offset;
+    return block_get_offset(bi->blk) + bi->offset;
 }
 
 char *block_iter_get_bytes(const BlockIter *bi, size_t len)
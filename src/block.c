@@ -1,28 +1,569 @@
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "block.h"
+#include "util/align.h"
 #include "util/bit.h"
+#include "util/log.h"
 #include "util/xmalloc.h"
 
-Block *block_new(size_t alloc)
+/*
+ * The Blocks of a Buffer are indexed by a treap, keyed implicitly by
+ * position (i.e. an in-order traversal visits the Blocks in the same
+ * order as the ListHead links). Each node caches the sum of `size` and
+ * `nl` for its whole subtree, which allows mapping offsets and line
+ * numbers to Blocks (and vice versa) in O(log n) time.
+ *
+ * The root isn't stored anywhere; it's found by following `parent`
+ * links from any member Block. This keeps BlockIter unchanged and
+ * means a lone Block (e.g. from block_new()) is a valid, single-node
+ * tree.
+ *
+ * See also:
+ * • https://en.wikipedia.org/wiki/Treap
+ * • https://en.wikipedia.org/wiki/Order_statistic_tree
+ */
+
+static unsigned int next_priority(void)
 {
-    Block *blk = xcalloc1(sizeof(*blk));
-    alloc = next_multiple(alloc, BLOCK_ALLOC_MULTIPLE);
-    blk->data = xmalloc(alloc);
+    // Marsaglia's xorshift32; the priorities need only be "random enough"
+    // to keep the expected tree depth logarithmic
+    static uint32_t x = 2463534242u; // NOLINT(*-avoid-non-const-global-variables)
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static size_t subtree_size(const Block *blk)
+{
+    return blk ? blk->subtree_size : 0;
+}
+
+static size_t subtree_nl(const Block *blk)
+{
+    return blk ? blk->subtree_nl : 0;
+}
+
+static void recompute(Block *blk)
+{
+    blk->subtree_size = subtree_size(blk->left) + blk->size + subtree_size(blk->right);
+    blk->subtree_nl = subtree_nl(blk->left) + blk->nl + subtree_nl(blk->right);
+}
+
+static void recompute_path(Block *blk)
+{
+    for (; blk; blk = blk->parent) {
+        recompute(blk);
+    }
+}
+
+static const Block *tree_root(const Block *blk)
+{
+    while (blk->parent) {
+        blk = blk->parent;
+    }
+    return blk;
+}
+
+static void replace_child(Block *parent, const Block *old, Block *new)
+{
+    if (parent) {
+        if (parent->left == old) {
+            parent->left = new;
+        } else {
+            BUG_ON(parent->right != old);
+            parent->right = new;
+        }
+    }
+}
+
+// Rotate `blk` into the position of its parent, preserving in-order
+// sequence. The subtree sums of any ancestors above are unaffected.
+static void rotate_up(Block *blk)
+{
+    Block *parent = blk->parent;
+    BUG_ON(!parent);
+    Block *grandparent = parent->parent;
+
+    if (parent->left == blk) {
+        parent->left = blk->right;
+        if (blk->right) {
+            blk->right->parent = parent;
+        }
+        blk->right = parent;
+    } else {
+        parent->right = blk->left;
+        if (blk->left) {
+            blk->left->parent = parent;
+        }
+        blk->left = parent;
+    }
+
+    replace_child(grandparent, parent, blk);
+    blk->parent = grandparent;
+    parent->parent = blk;
+    recompute(parent);
+    recompute(blk);
+}
+
+// Called after `blk` has been attached as a leaf node
+static void insert_fixup(Block *blk)
+{
+    blk->left = NULL;
+    blk->right = NULL;
+    blk->priority = next_priority();
+    recompute_path(blk);
+    while (blk->parent && blk->parent->priority < blk->priority) {
+        rotate_up(blk);
+    }
+}
+
+static void tree_remove(Block *blk)
+{
+    // Rotate `blk` down until it's a leaf, then detach it
+    while (blk->left || blk->right) {
+        Block *l = blk->left;
+        Block *r = blk->right;
+        rotate_up((!r || (l && l->priority > r->priority)) ? l : r);
+    }
+
+    Block *parent = blk->parent;
+    replace_child(parent, blk, NULL);
+    recompute_path(parent);
+    blk->parent = NULL;
+}
+
+/*
+ * BlockArena allocations are carved sequentially out of the first slab
+ * in BlockArena::slabs and a new slab is started when it's full. Freed
+ * allocations are never returned to a slab, but are instead pushed onto
+ * the free list for their size, to be reused by the next allocation of
+ * the same size. The slabs themselves are only freed by
+ * block_arena_free(), when the whole Buffer is freed.
+ */
+
+typedef struct BlockSlab {
+    struct BlockSlab *next;
+    size_t used;
+    MAXALIGN char data[];
+} BlockSlab;
+
+typedef struct FreeNode {
+    struct FreeNode *next;
+} FreeNode;
+
+static size_t header_size(void)
+{
+    return next_multiple(sizeof(Block), ALIGNOF(FreeNode));
+}
+
+static void *arena_alloc(BlockArena *arena, void **free_list, size_t size)
+{
+    FreeNode *node = *free_list;
+    if (node) {
+        *free_list = node->next;
+        return node;
+    }
+
+    const size_t slab_data_size = BLOCK_SLAB_SIZE - sizeof(BlockSlab);
+    BlockSlab *slab = arena->slabs;
+    if (!slab || slab_data_size - slab->used < size) {
+        slab = xmalloc(BLOCK_SLAB_SIZE);
+        slab->next = arena->slabs;
+        slab->used = 0;
+        arena->slabs = slab;
+        arena->nr_slabs++;
+    }
+
+    void *ptr = slab->data + slab->used;
+    slab->used += size;
+    return ptr;
+}
+
+static void arena_release(void **free_list, void *ptr)
+{
+    FreeNode *node = ptr;
+    node->next = *free_list;
+    *free_list = node;
+}
+
+static void **data_free_list(BlockArena *arena, size_t alloc)
+{
+    BUG_ON(alloc == 0 || alloc > BLOCK_ARENA_DATA_MAX);
+    BUG_ON(alloc % BLOCK_ALLOC_MULTIPLE != 0);
+    return &arena->free_data[(alloc / BLOCK_ALLOC_MULTIPLE) - 1];
+}
+
+static bool is_foreign(const Block *blk)
+{
+    return !blk->arena_header || !blk->arena_data;
+}
+
+static void update_foreign_count(const Block *blk, bool was_foreign)
+{
+    BlockArena *arena = blk->arena;
+    bool foreign = is_foreign(blk);
+    if (arena && foreign != was_foreign) {
+        BUG_ON(!foreign && arena->nr_foreign == 0);
+        arena->nr_foreign = foreign ? arena->nr_foreign + 1 : arena->nr_foreign - 1;
+    }
+}
+
+// Set `data` to a new allocation of `alloc` bytes (a multiple of
+// BLOCK_ALLOC_MULTIPLE), taken from the arena if it's small enough
+static void alloc_data(Block *blk, size_t alloc)
+{
+    BlockArena *arena = blk->arena;
+    blk->arena_data = arena && alloc <= BLOCK_ARENA_DATA_MAX;
+    blk->data = blk->arena_data ? arena_alloc(arena, data_free_list(arena, alloc), alloc) : xmalloc(alloc);
     blk->alloc = alloc;
+}
+
+static void free_data(Block *blk)
+{
+    if (blk->mapping) {
+        block_mapping_unref(blk->mapping);
+    } else if (blk->arena_data) {
+        arena_release(data_free_list(blk->arena, blk->alloc), blk->data);
+    } else {
+        free(blk->data);
+    }
+}
+
+// Move `data` to a new allocation of `alloc` bytes
+static void move_data(Block *blk, size_t alloc)
+{
+    Block old = *blk;
+    alloc_data(blk, alloc);
+    memcpy(blk->data, old.data, blk->size);
+    blk->mapping = NULL;
+    free_data(&old);
+}
+
+// Create a new Block, with room for at least `alloc` bytes of data.
+// If `arena` is non-NULL, the Block is allocated from it (and must only
+// ever be added to the Block list of the Buffer that owns it), otherwise
+// it's allocated by malloc(3) and may be created on any thread.
+Block *block_new(BlockArena *arena, size_t alloc)
+{
+    Block *blk;
+    if (arena) {
+        blk = arena_alloc(arena, &arena->free_headers, header_size());
+        memset(blk, 0, sizeof(*blk));
+        blk->arena = arena;
+        blk->arena_header = true;
+    } else {
+        blk = xcalloc1(sizeof(*blk));
+    }
+
+    alloc_data(blk, next_multiple(alloc, BLOCK_ALLOC_MULTIPLE));
+    update_foreign_count(blk, false);
     return blk;
 }
 
+// Create a Block that references `size` bytes of `data` (which must
+// be within `map`), instead of allocating and copying. This allows
+// files to be "loaded" without copying the parts that are never edited.
+Block *block_new_mapped(BlockMapping *map, const char *data, size_t size, size_t nl)
+{
+    BUG_ON(size == 0);
+    BUG_ON(data < (const char*)map->addr);
+    BUG_ON(data + size > (const char*)map->addr + map->size);
+    Block *blk = xcalloc1(sizeof(*blk));
+    blk->data = (char*)data;
+    blk->size = size;
+    blk->nl = nl;
+    blk->mapping = map;
+    map->refcount++;
+    return blk;
+}
+
+BlockMapping *block_mapping_new(void *addr, size_t size)
+{
+    BlockMapping *map = xmalloc(sizeof(*map));
+    *map = (BlockMapping) {
+        .addr = addr,
+        .size = size,
+        .refcount = 1,
+    };
+    return map;
+}
+
+BlockMapping *block_mapping_ref(BlockMapping *map)
+{
+    BUG_ON(map->refcount == 0);
+    map->refcount++;
+    return map;
+}
+
+void block_mapping_unref(BlockMapping *map)
+{
+    BUG_ON(map->refcount == 0);
+    if (--map->refcount == 0) {
+        int r = munmap(map->addr, map->size); // Can only fail due to usage error
+        LOG_ERRNO_ON(r, "munmap");
+        free(map);
+    }
+}
+
+// Copy the contents of a mapped Block into a new allocation (of at
+// least `alloc` bytes) and release its reference to the mapping
+static void unmap_block(Block *blk, size_t alloc)
+{
+    bool was_foreign = is_foreign(blk);
+    move_data(blk, next_multiple(MAX3(alloc, blk->size, 1), BLOCK_ALLOC_MULTIPLE));
+    update_foreign_count(blk, was_foreign);
+}
+
+void block_make_writable(Block *blk)
+{
+    if (unlikely(blk->mapping)) {
+        unmap_block(blk, blk->size);
+    }
+}
+
 void block_grow(Block *blk, size_t alloc)
 {
-    if (alloc > blk->alloc) {
-        blk->alloc = next_multiple(alloc, BLOCK_ALLOC_MULTIPLE);
-        blk->data = xrealloc(blk->data, blk->alloc);
+    if (unlikely(blk->mapping)) {
+        unmap_block(blk, alloc);
+    } else if (alloc > blk->alloc) {
+        alloc = next_multiple(alloc, BLOCK_ALLOC_MULTIPLE);
+        if (blk->arena_data) {
+            move_data(blk, alloc);
+            update_foreign_count(blk, false);
+        } else {
+            blk->data = xrealloc(blk->data, alloc);
+            blk->alloc = alloc;
+        }
+    }
+}
+
+// Reduce `alloc` to the minimum needed for the current `size`, if more
+// than a quarter of it is unused, and return the number of bytes freed
+size_t block_shrink_to_fit(Block *blk)
+{
+    size_t alloc = next_multiple(MAX(blk->size, 1), BLOCK_ALLOC_MULTIPLE);
+    if (blk->mapping || blk->alloc - alloc <= blk->alloc / 4) {
+        return 0;
+    }
+
+    size_t freed = blk->alloc - alloc;
+    if (blk->arena_data || (blk->arena && alloc <= BLOCK_ARENA_DATA_MAX)) {
+        // Move to a smaller size class (or into the arena)
+        bool was_foreign = is_foreign(blk);
+        move_data(blk, alloc);
+        update_foreign_count(blk, was_foreign);
+    } else {
+        blk->data = xrealloc(blk->data, alloc);
+        blk->alloc = alloc;
+    }
+    return freed;
+}
+
+static void free_block_memory(Block *blk)
+{
+    BlockArena *arena = blk->arena;
+    if (arena && is_foreign(blk)) {
+        BUG_ON(arena->nr_foreign == 0);
+        arena->nr_foreign--;
+    }
+
+    free_data(blk);
+    if (blk->arena_header) {
+        arena_release(&arena->free_headers, blk);
+    } else {
+        free(blk);
     }
 }
 
 void block_free(Block *blk)
 {
     list_remove(&blk->node);
-    free(blk->data);
-    free(blk);
+    tree_remove(blk);
+    free_block_memory(blk);
+}
+
+// Free every Block in the list at `head`, without maintaining the list
+// or tree structure as each one is removed. If the Blocks belong to
+// `arena` (which may be NULL), the arena is also freed and any Blocks
+// entirely within it are released along with it, instead of being
+// visited individually.
+void block_free_all(ListHead *head, BlockArena *arena)
+{
+    if (!arena || arena->nr_foreign > 0) {
+        ListHead *item = head->next;
+        while (item != head) {
+            ListHead *next = item->next;
+            Block *blk = BLOCK(item);
+            if (!arena || is_foreign(blk)) {
+                BUG_ON(blk->arena != arena);
+                free_block_memory(blk);
+            }
+            item = next;
+        }
+    }
+
+    list_init(head);
+    if (arena) {
+        block_arena_free(arena);
+    }
+}
+
+// Make `blk` (which was allocated by block_new() without an arena, or
+// by block_new_mapped()) count as part of `arena`, so that block_free()
+// and block_grow() can move its data into the arena and so that
+// block_free_all() knows to free it individually
+void block_arena_adopt(BlockArena *arena, Block *blk)
+{
+    BUG_ON(blk->arena);
+    blk->arena = arena;
+    arena->nr_foreign++;
+}
+
+// Free all slabs owned by `arena` (and thus every Block allocated from
+// it) and reset it to the initial (empty) state
+void block_arena_free(BlockArena *arena)
+{
+    for (BlockSlab *slab = arena->slabs, *next; slab; slab = next) {
+        next = slab->next;
+        free(slab);
+    }
+    *arena = (BlockArena){.slabs = NULL};
+}
+
+// Insert `blk` into the list (and tree) that `next` belongs to,
+// immediately before `next`
+void block_insert_before(Block *blk, Block *next)
+{
+    BUG_ON(blk->parent);
+    list_insert_before(&blk->node, &next->node);
+
+    Block *parent = next->left;
+    if (!parent) {
+        next->left = blk;
+        parent = next;
+    } else {
+        while (parent->right) {
+            parent = parent->right;
+        }
+        parent->right = blk;
+    }
+
+    blk->parent = parent;
+    insert_fixup(blk);
+}
+
+// Insert `blk` at the end of the Block list starting at `head`
+void block_append(Block *blk, ListHead *head)
+{
+    BUG_ON(blk->parent);
+    if (list_empty(head)) {
+        list_insert_before(&blk->node, head);
+        blk->left = NULL;
+        blk->right = NULL;
+        recompute(blk);
+        return;
+    }
+
+    Block *last = BLOCK(head->prev);
+    BUG_ON(last->right);
+    list_insert_before(&blk->node, head);
+    last->right = blk;
+    blk->parent = last;
+    insert_fixup(blk);
+}
+
+// Update the index after the `size` and/or `nl` members of `blk` have
+// been modified
+void block_counts_changed(Block *blk)
+{
+    recompute_path(blk);
+}
+
+// Return the sum of `size` for all Blocks before `blk`
+size_t block_get_offset(const Block *blk)
+{
+    size_t offset = subtree_size(blk->left);
+    for (const Block *p = blk->parent; p; blk = p, p = p->parent) {
+        if (p->right == blk) {
+            offset += subtree_size(p->left) + p->size;
+        }
+    }
+    return offset;
+}
+
+// Return the sum of `nl` for all Blocks before `blk`
+size_t block_get_line(const Block *blk)
+{
+    size_t line = subtree_nl(blk->left);
+    for (const Block *p = blk->parent; p; blk = p, p = p->parent) {
+        if (p->right == blk) {
+            line += subtree_nl(p->left) + p->nl;
+        }
+    }
+    return line;
+}
+
+// Return the sum of `size` for all Blocks in the same list as `blk`
+size_t block_total_size(const Block *blk)
+{
+    return tree_root(blk)->subtree_size;
+}
+
+// Return the sum of `nl` for all Blocks in the same list as `blk`
+size_t block_total_nl(const Block *blk)
+{
+    return tree_root(blk)->subtree_nl;
+}
+
+// Find the first Block (in the same list as `blk`) that ends at or after
+// `*offset` and update `*offset` to be relative to the Block found. If
+// `*offset` is past the end of the list, the last Block is returned.
+Block *block_find_offset(const Block *blk, size_t *offset)
+{
+    size_t remaining = *offset;
+    blk = tree_root(blk);
+    while (1) {
+        size_t left = subtree_size(blk->left);
+        if (blk->left && remaining <= left) {
+            blk = blk->left;
+            continue;
+        }
+        remaining -= left;
+        if (remaining <= blk->size || !blk->right) {
+            break;
+        }
+        remaining -= blk->size;
+        blk = blk->right;
+    }
+
+    *offset = remaining;
+    return (Block*)blk;
+}
+
+// Like block_find_offset(), but for Block::nl instead of Block::size.
+// If `*line` is greater than the total number of lines, the last Block
+// is returned and the updated `*line` will be greater than its `nl`.
+Block *block_find_line(const Block *blk, size_t *line)
+{
+    size_t remaining = *line;
+    blk = tree_root(blk);
+    while (1) {
+        size_t left = subtree_nl(blk->left);
+        if (blk->left && remaining <= left) {
+            blk = blk->left;
+            continue;
+        }
+        remaining -= left;
+        if (remaining <= blk->nl || !blk->right) {
+            break;
+        }
+        remaining -= blk->nl;
+        blk = blk->right;
+    }
+
+    *line = remaining;
+    return (Block*)blk;
 }
@@ -1,25 +1,84 @@
 #ifndef BLOCK_H
 #define BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include "util/debug.h"
 #include "util/list.h"
 #include "util/macros.h"
 
+// A reference-counted, read-only mapping of a file, which Blocks
+// created by block_new_mapped() point into (see read_blocks())
+typedef struct {
+    void *addr;
+    size_t size;
+    size_t refcount;
+} BlockMapping;
+
+enum {
+    BLOCK_ALLOC_MULTIPLE = 64,
+    // Number of size classes for Block::data in a BlockArena (i.e. all
+    // multiples of BLOCK_ALLOC_MULTIPLE, up to BLOCK_ARENA_DATA_MAX)
+    BLOCK_ARENA_NR_CLASSES = 8,
+    BLOCK_ARENA_DATA_MAX = BLOCK_ALLOC_MULTIPLE * BLOCK_ARENA_NR_CLASSES,
+    BLOCK_SLAB_SIZE = 64 << 10,
+};
+
+// A slab allocator for the Blocks of a single Buffer. Block structs
+// and any Block::data allocation of up to BLOCK_ARENA_DATA_MAX bytes
+// (i.e. the typical blocks created by editing) are carved out of large
+// slabs and recycled via per-size free lists, which keeps them close
+// together in memory and allows all of them to be released at once by
+// block_arena_free().
+typedef struct {
+    struct BlockSlab *slabs; // Singly linked list; the first is the one allocated from
+    void *free_headers; // Free list of Block structs
+    void *free_data[BLOCK_ARENA_NR_CLASSES]; // Free lists of Block::data, by size class
+    size_t nr_slabs;
+    size_t nr_foreign; // Number of Blocks in the arena that own memory outside of it
+} BlockArena;
+
 // Blocks always contain whole lines.
 // There's one zero-sized block for an empty file.
 // Otherwise zero-sized blocks are forbidden.
-typedef struct {
+typedef struct Block {
     ListHead node;
     char NONSTRING *data;
     size_t size;
     size_t alloc;
     size_t nl;
-} Block;
 
-enum {
-    BLOCK_ALLOC_MULTIPLE = 64,
-};
+    // If non-NULL, `data` points into this mapping (instead of being
+    // owned by the Block) and `alloc` is 0. Such Blocks are converted
+    // into regular Blocks by block_make_writable(), which must be called
+    // before `data` is modified in place (block_grow() does so
+    // implicitly).
+    BlockMapping *mapping;
+
+    // The arena that the Block belongs to (see block_new() and
+    // block_arena_adopt()) or NULL. The struct itself and `data` may
+    // each be allocated from the arena or by malloc(3); Blocks where
+    // either one isn't are counted by BlockArena::nr_foreign, so that
+    // block_arena_free() can tell when freeing them individually is
+    // necessary.
+    BlockArena *arena;
+    bool arena_header;
+    bool arena_data;
+
+    // Every Block in a list is also a node in a balanced binary tree
+    // (a treap), with the same in-order sequence as the list. Each node
+    // stores the total `size` and `nl` counts of its subtree, so that
+    // offset/line lookups are O(log n) instead of a walk from the head.
+    // These members are private to block.c and are kept in sync by
+    // block_insert_before(), block_append(), block_counts_changed()
+    // and block_free().
+    struct Block *parent;
+    struct Block *left;
+    struct Block *right;
+    size_t subtree_size;
+    size_t subtree_nl;
+    unsigned int priority;
+} Block;
 
 #define block_for_each(block_, list_head_) \
     for ( \
@@ -38,17 +97,44 @@ static inline Block *BLOCK(ListHead *item)
 static inline void block_sanity_check(const Block *blk)
 {
     BUG_ON(!blk);
-    BUG_ON(blk->size > blk->alloc);
     BUG_ON(blk->nl > blk->size);
+    BUG_ON(!blk->data);
+
+    if (blk->mapping) {
+        // Mapped Blocks own no allocation (see block_new_mapped())
+        BUG_ON(blk->alloc != 0);
+        BUG_ON(blk->mapping->refcount == 0);
+        return;
+    }
 
     // block_new() forbids `alloc == 0` and thus always allocates
     // at least BLOCK_ALLOC_MULTIPLE bytes
+    BUG_ON(blk->size > blk->alloc);
     BUG_ON(blk->alloc < BLOCK_ALLOC_MULTIPLE);
-    BUG_ON(!blk->data);
+    BUG_ON(blk->arena_data && blk->alloc > BLOCK_ARENA_DATA_MAX);
+    BUG_ON((blk->arena_data || blk->arena_header) && !blk->arena);
 }
 
-Block *block_new(size_t alloc) RETURNS_NONNULL;
+Block *block_new(BlockArena *arena, size_t alloc) RETURNS_NONNULL;
+Block *block_new_mapped(BlockMapping *map, const char *data, size_t size, size_t nl) NONNULL_ARGS_AND_RETURN;
 void block_grow(Block *blk, size_t alloc) NONNULL_ARGS;
+void block_make_writable(Block *blk) NONNULL_ARGS;
+size_t block_shrink_to_fit(Block *blk) NONNULL_ARGS;
 void block_free(Block *blk) NONNULL_ARGS;
+void block_free_all(ListHead *head, BlockArena *arena) NONNULL_ARG(1);
+BlockMapping *block_mapping_new(void *addr, size_t size) NONNULL_ARGS_AND_RETURN;
+BlockMapping *block_mapping_ref(BlockMapping *map) NONNULL_ARGS_AND_RETURN;
+void block_mapping_unref(BlockMapping *map) NONNULL_ARGS;
+void block_arena_adopt(BlockArena *arena, Block *blk) NONNULL_ARGS;
+void block_arena_free(BlockArena *arena) NONNULL_ARGS;
+void block_insert_before(Block *blk, Block *next) NONNULL_ARGS;
+void block_append(Block *blk, ListHead *head) NONNULL_ARGS;
+void block_counts_changed(Block *blk) NONNULL_ARGS;
+size_t block_get_offset(const Block *blk) NONNULL_ARGS WARN_UNUSED_RESULT;
+size_t block_get_line(const Block *blk) NONNULL_ARGS WARN_UNUSED_RESULT;
+size_t block_total_size(const Block *blk) NONNULL_ARGS WARN_UNUSED_RESULT;
+size_t block_total_nl(const Block *blk) NONNULL_ARGS WARN_UNUSED_RESULT;
+Block *block_find_offset(const Block *blk, size_t *offset) NONNULL_ARGS_AND_RETURN READWRITE(2);
+Block *block_find_line(const Block *blk, size_t *line) NONNULL_ARGS_AND_RETURN READWRITE(2);
 
 #endif
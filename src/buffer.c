@@ -6,7 +6,9 @@
 #include "encoding.h"
 #include "file-option.h"
 #include "filetype.h"
+#include "load-save.h"
 #include "syntax/state.h"
+#include "undo-file.h"
 #include "util/intern.h"
 #include "util/path.h"
 #include "util/xmalloc.h"
@@ -64,6 +66,7 @@ Buffer *buffer_new(PointerArray *buffers, const GlobalOptions *gopts, const char
     buffer->saved_change = &buffer->change_head;
     buffer->id = ++id;
     buffer->crlf_newlines = gopts->crlf_newlines;
+    buffer->compact_offset = SIZE_MAX;
 
     if (encoding) {
         buffer_set_encoding(buffer, encoding, gopts->utf8_bom);
@@ -89,22 +92,16 @@ Buffer *open_empty_buffer(PointerArray *buffers, const GlobalOptions *gopts)
     Buffer *buffer = buffer_new(buffers, gopts, encoding_from_type(UTF8));
 
     // At least one block required
-    Block *blk = block_new(1);
-    list_insert_before(&blk->node, &buffer->blocks);
+    Block *blk = block_new(&buffer->arena, 1);
+    block_append(blk, &buffer->blocks);
 
     return buffer;
 }
 
 void free_blocks(Buffer *buffer)
 {
-    ListHead *item = buffer->blocks.next;
-    while (item != &buffer->blocks) {
-        ListHead *next = item->next;
-        Block *blk = BLOCK(item);
-        free(blk->data);
-        free(blk);
-        item = next;
-    }
+    load_buffer_cancel(buffer);
+    block_free_all(&buffer->blocks, &buffer->arena);
 }
 
 static void buffer_unlock_and_free (
@@ -116,8 +113,12 @@ static void buffer_unlock_and_free (
         unlock_file(locks_ctx, ebuf, buffer->abs_filename);
     }
 
-    free_changes(&buffer->change_head);
-    ptr_array_free_array(&buffer->line_start_states);
+    undo_file_close(buffer);
+    free_changes(buffer);
+    hl_free_line_states(&buffer->line_start_states);
+    match_cache_free(&buffer->match_cache);
+    match_count_free(&buffer->match_count);
+    match_list_free(&buffer->reverse_matches);
     ptr_array_free_array(&buffer->views);
     free(buffer->display_filename);
     free(buffer->abs_filename);
@@ -247,13 +248,7 @@ void buffer_update_syntax(EditorState *e, Buffer *buffer)
 
     buffer->syntax = syn;
     if (syn) {
-        // Start state of first line is constant
-        PointerArray *s = &buffer->line_start_states;
-        if (!s->alloc) {
-            ptr_array_init(s, 64);
-        }
-        s->ptrs[0] = syn->start_state;
-        s->count = 1;
+        hl_reset_start_states(&buffer->line_start_states, syn->start_state);
     }
 
     mark_all_lines_changed(buffer);
@@ -421,7 +416,47 @@ void buffer_setup(EditorState *e, Buffer *buffer)
     sanity_check_local_options(&buffer->options);
 }
 
-void buffer_count_blocks_and_bytes(const Buffer *buffer, uintmax_t counts[static 2])
+// Note that `heredoc_states` and `heredoc_bytes` are for Buffer::syntax,
+// which may be shared with other Buffers
+void buffer_get_memory_usage(const Buffer *buffer, BufferMemoryUsage *usage)
+{
+    *usage = (BufferMemoryUsage) {
+        .arena_slabs = (uintmax_t)buffer->arena.nr_slabs * BLOCK_SLAB_SIZE,
+    };
+
+    const Block *blk;
+    block_for_each(blk, &buffer->blocks) {
+        usage->blocks++;
+        usage->block_headers += sizeof(*blk);
+        if (blk->mapping) {
+            usage->block_mapped += blk->size;
+        } else {
+            usage->block_payload += blk->size;
+            usage->block_slack += blk->alloc - blk->size;
+        }
+    }
+
+    uintmax_t counts[3];
+    count_changes(&buffer->change_head, counts);
+    usage->changes = counts[0];
+    usage->undo_text = counts[1];
+    usage->undo_other = counts[2];
+
+    const LineStates *lss = &buffer->line_start_states;
+    usage->line_states = lss->count;
+    usage->line_states_bytes = hl_line_states_memory_usage(lss);
+
+    if (buffer->syntax) {
+        size_t nr_states;
+        usage->heredoc_bytes = syntax_heredoc_memory_usage(buffer->syntax, &nr_states);
+        usage->heredoc_states = nr_states;
+    }
+}
+
+// Count the Blocks and bytes of `buffer` (in `counts[0]` and `counts[1]`)
+// and report the Blocks and bytes reclaimed by compact_blocks() so far
+// (in `counts[2]` and `counts[3]`)
+void buffer_count_blocks_and_bytes(const Buffer *buffer, uintmax_t counts[static 4])
 {
     uintmax_t blocks = 0;
     uintmax_t bytes = 0;
@@ -432,4 +467,6 @@ void buffer_count_blocks_and_bytes(const Buffer *buffer, uintmax_t counts[static
     }
     counts[0] = blocks;
     counts[1] = bytes;
+    counts[2] = buffer->compacted_blocks;
+    counts[3] = buffer->compacted_bytes;
 }
@@ -10,7 +10,9 @@
 #include "change.h"
 #include "command/error.h"
 #include "lock.h"
+#include "match-cache.h"
 #include "options.h"
+#include "syntax/highlight.h"
 #include "syntax/syntax.h"
 #include "util/debug.h"
 #include "util/list.h"
@@ -43,9 +45,12 @@ typedef struct {
  */
 typedef struct Buffer {
     ListHead blocks; // Doubly linked list of Blocks, forming the text contents
+    BlockArena arena; // Allocator for `blocks` (see block_new())
     Change change_head;
+    ChangeArena change_arena; // Allocator for the Changes below `change_head`
     Change *cur_change;
     Change *saved_change; // Used to determine if there are unsaved changes
+    StringView undo_file; // Mapped undo history, not yet loaded (see undo_file_open())
     FileInfo file; // File metadata, taken from the most recent stat(3) call
     unsigned long id; // Needed for identifying buffers whose filename is NULL
     size_t nl; // Total number of lines (sum of all Block::nl counts)
@@ -64,11 +69,42 @@ typedef struct Buffer {
     Syntax *syntax;
     long changed_line_min;
     long changed_line_max;
-    // Index 0 is always syn->states.ptrs[0].
-    // Lowest bit of an invalidated value is 1.
-    PointerArray line_start_states;
+    LineStates line_start_states;
+    size_t hl_target; // Line that continue_highlight() fills in start states up to (or 0)
+    bool hl_provisional; // Lines were drawn with provisional styles (see update_range())
+    MatchCache match_cache; // Matches shown by the "highlight-search" option
+    MatchCount match_count; // Matches counted for the "[N/M]" status (see add_search_position())
+    MatchList reverse_matches; // Matches found by the last reverse search (see do_search_bwd())
+    struct FileLoader *loader; // Non-NULL while still loading (see load_buffer_continue())
+    size_t compact_offset; // Where compact_blocks() resumes (or SIZE_MAX, if there's nothing to do)
+    uintmax_t compacted_blocks; // Number of Blocks freed by compact_blocks()
+    uintmax_t compacted_bytes; // Number of allocated bytes released by compact_blocks()
 } Buffer;
 
+// Breakdown of the memory used by a Buffer (see buffer_get_memory_usage())
+typedef struct {
+    uintmax_t blocks; // Number of Blocks
+    uintmax_t block_headers; // Bytes used by Block structs
+    uintmax_t block_payload; // Sum of Block::size (excluding mapped Blocks)
+    uintmax_t block_slack; // Sum of `Block::alloc - Block::size`
+    uintmax_t block_mapped; // Sum of Block::size for mapped Blocks (not heap memory)
+    uintmax_t arena_slabs; // Bytes reserved by BlockArena slabs
+    uintmax_t changes; // Number of Changes in the undo tree
+    uintmax_t undo_text; // Bytes of deleted text stored in Change::buf
+    uintmax_t undo_other; // Bytes used by the Change structs themselves
+    uintmax_t line_states; // Number of Buffer::line_start_states checkpoints
+    uintmax_t line_states_bytes;
+    uintmax_t heredoc_states; // States merged into Buffer::syntax for heredocs
+    uintmax_t heredoc_bytes;
+} BufferMemoryUsage;
+
+static inline uintmax_t buffer_memory_total(const BufferMemoryUsage *u)
+{
+    return u->block_headers + u->block_payload + u->block_slack
+        + u->undo_text + u->undo_other + u->line_states_bytes
+        + u->heredoc_bytes;
+}
+
 static inline void mark_all_lines_changed(Buffer *buffer)
 {
     buffer->changed_line_min = 0;
@@ -106,7 +142,8 @@ void buffer_update_short_filename(Buffer *buffer, StringView home) NONNULL_ARGS;
 bool buffer_detect_filetype(Buffer *buffer, const PointerArray *filetypes) NONNULL_ARGS;
 void buffer_update_syntax(struct EditorState *e, Buffer *buffer) NONNULL_ARGS;
 void buffer_setup(struct EditorState *e, Buffer *buffer) NONNULL_ARGS;
-void buffer_count_blocks_and_bytes(const Buffer *buffer, uintmax_t counts[static 2]) NONNULL_ARGS;
+void buffer_get_memory_usage(const Buffer *buffer, BufferMemoryUsage *usage) NONNULL_ARGS;
+void buffer_count_blocks_and_bytes(const Buffer *buffer, uintmax_t counts[static 4]) NONNULL_ARGS;
 void buffer_remove_unlock_and_free(PointerArray *buffers, Buffer *buffer, ErrorBuffer *ebuf, const FileLocksContext *locks_ctx) NONNULL_ARG(1, 2, 4);
 void free_blocks(Buffer *buffer) NONNULL_ARGS;
 
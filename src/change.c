@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "change.h"
@@ -5,28 +6,97 @@
 #include "command/error.h"
 #include "edit.h"
 #include "editor.h"
+#include "load-save.h"
+#include "undo-file.h"
+#include "util/arith.h"
 #include "util/debug.h"
+#include "util/ptr-array.h"
 #include "util/xmalloc.h"
 #include "window.h"
 
+enum {
+    CHANGES_PER_SLAB = 64,
+};
+
+typedef struct ChangeSlab {
+    struct ChangeSlab *next;
+    size_t used;
+    Change changes[CHANGES_PER_SLAB];
+} ChangeSlab;
+
 static struct {
     ChangeMergeEnum merge;
     ChangeMergeEnum prev_merge;
-    // This doesn't need to be local to Buffer, because commands are atomic
-    Change *barrier;
+    // These don't need to be local to Buffer, because commands are atomic
+    bool in_chain; // Between begin_change_chain() and end_change_chain()
+    bool barrier; // Chain barrier not yet added (see new_change())
 } cs; // NOLINT(*-avoid-non-const-global-variables)
 
-static Change *alloc_change(void)
+static size_t prev_array_size(unsigned long nr_prev)
 {
-    return xcalloc1(sizeof(Change));
+    // A single `prev` pointer is stored inline (see add_change())
+    return (nr_prev > 1) ? nr_prev * sizeof(Change*) : 0;
+}
+
+static Change *alloc_change(Buffer *buffer)
+{
+    ChangeArena *arena = &buffer->change_arena;
+    arena->memory_usage += sizeof(Change);
+
+    Change *change = arena->free_list;
+    if (change) {
+        arena->free_list = change->next;
+        *change = (Change){.next = NULL};
+        return change;
+    }
+
+    ChangeSlab *slab = arena->slabs;
+    if (!slab || slab->used >= ARRAYLEN(slab->changes)) {
+        slab = xmalloc(sizeof(*slab));
+        slab->next = arena->slabs;
+        slab->used = 0;
+        arena->slabs = slab;
+        arena->nr_slabs++;
+    }
+
+    change = &slab->changes[slab->used++];
+    *change = (Change){.next = NULL};
+    return change;
+}
+
+// Free everything owned by `change` (other than the Changes in its
+// `prev` array) and return it to the free list
+static void release_change(ChangeArena *arena, Change *change)
+{
+    size_t buf_size = change->buf ? change->del_count : 0;
+    arena->memory_usage -= sizeof(*change) + buf_size + prev_array_size(change->nr_prev);
+    if (change->prev != &change->prev_inline) {
+        free(change->prev);
+    }
+    free(change->buf);
+    change->next = arena->free_list;
+    arena->free_list = change;
 }
 
 static void add_change(Buffer *buffer, Change *change)
 {
     Change *head = buffer->cur_change;
+    const unsigned long n = head->nr_prev;
     change->next = head;
-    head->prev = xrenew(head->prev, head->nr_prev + 1);
-    head->prev[head->nr_prev++] = change;
+
+    if (n == 0) {
+        head->prev = &head->prev_inline;
+    } else if (n == 1) {
+        Change **prev = xmallocarray(2, sizeof(*prev));
+        prev[0] = head->prev_inline;
+        head->prev = prev;
+    } else {
+        head->prev = xrenew(head->prev, n + 1);
+    }
+
+    head->prev[n] = change;
+    head->nr_prev = n + 1;
+    buffer->change_arena.memory_usage += prev_array_size(n + 1) - prev_array_size(n);
     buffer->cur_change = change;
 }
 
@@ -37,6 +107,7 @@ static bool is_change_chain_barrier(const Change *change)
 
 static Change *new_change(Buffer *buffer)
 {
+    undo_file_load(buffer);
     if (cs.barrier) {
         /*
          * We are recording series of changes (:replace for example)
@@ -47,15 +118,163 @@ static Change *new_change(Buffer *buffer)
          * chain but then we may have ended up with an empty chain.
          * We don't want to record empty changes ever.
          */
-        add_change(buffer, cs.barrier);
-        cs.barrier = NULL;
+        add_change(buffer, alloc_change(buffer));
+        cs.barrier = false;
     }
 
-    Change *change = alloc_change();
+    Change *change = alloc_change(buffer);
     add_change(buffer, change);
     return change;
 }
 
+// Free the subtree of Changes rooted at `root` (including `root` itself),
+// which must already have been detached from its parent
+static void free_change_tree(Buffer *buffer, Change *root)
+{
+    ChangeArena *arena = &buffer->change_arena;
+    Change *c = root;
+
+    while (1) {
+        while (c->nr_prev) {
+            c = c->prev[c->nr_prev - 1];
+        }
+
+        // `c` is a leaf now
+        Change *parent = c->next;
+        bool done = (c == root);
+        if (c == buffer->saved_change) {
+            // The saved state is no longer reachable
+            buffer->saved_change = NULL;
+        }
+
+        release_change(arena, c);
+        if (done) {
+            return;
+        }
+
+        unsigned long n = parent->nr_prev--;
+        arena->memory_usage -= prev_array_size(n) - prev_array_size(n - 1);
+        c = parent;
+    }
+}
+
+// Return the child of `parent` that leads to (or is) `target`
+static Change *child_leading_to(const Change *parent, Change *target)
+{
+    if (parent->nr_prev == 1) {
+        return parent->prev[0];
+    }
+
+    Change *c = target;
+    while (c->next != parent) {
+        BUG_ON(!c->next);
+        c = c->next;
+    }
+    return c;
+}
+
+// Free the children of `parent` (and their subtrees), except for `keep`
+static void free_other_branches(Buffer *buffer, Change *parent, const Change *keep)
+{
+    for (unsigned long i = 0, n = parent->nr_prev; i < n; i++) {
+        Change *c = parent->prev[i];
+        if (c != keep) {
+            c->next = NULL;
+            free_change_tree(buffer, c);
+        }
+    }
+}
+
+/*
+ * Discard the oldest undo history of `buffer`, one undo step (i.e. a
+ * single Change or a whole change chain) at a time, until the memory
+ * used by its Changes is no more than 3/4 of `limit`. The state after
+ * each discarded step becomes the new `change_head` and any redo branches
+ * that can no longer be reached from `cur_change` are discarded along
+ * the way. The most recent step (i.e. the one `cur_change` refers to) is
+ * never discarded, so that the last edit can always be undone.
+ */
+static void evict_old_changes(Buffer *buffer, size_t limit)
+{
+    ChangeArena *arena = &buffer->change_arena;
+    if (limit == 0 || arena->memory_usage <= limit) {
+        return;
+    }
+
+    Change *head = &buffer->change_head;
+    const size_t target = limit - (limit / 4);
+
+    while (arena->memory_usage > target && buffer->cur_change != head) {
+        Change *cur = buffer->cur_change;
+        Change *first = child_leading_to(head, cur);
+        Change *last = first;
+        if (is_change_chain_barrier(first)) {
+            do {
+                BUG_ON(last == cur);
+                last = child_leading_to(last, cur);
+            } while (!is_change_chain_barrier(last));
+        }
+
+        if (last == cur) {
+            break;
+        }
+
+        // The state at `change_head` is about to become unreachable
+        if (buffer->saved_change == head) {
+            buffer->saved_change = NULL;
+        }
+
+        free_other_branches(buffer, head, first);
+        arena->memory_usage -= prev_array_size(head->nr_prev);
+        if (head->prev != &head->prev_inline) {
+            free(head->prev);
+        }
+
+        // Release the Changes from `first` to `last`, except for the
+        // `prev` array of `last`, which is taken over by `head`
+        for (Change *c = first; c != last; ) {
+            Change *next = child_leading_to(c, cur);
+            free_other_branches(buffer, c, next);
+            if (c == buffer->saved_change) {
+                buffer->saved_change = NULL;
+            }
+            release_change(arena, c);
+            c = next;
+        }
+
+        const unsigned long n = last->nr_prev;
+        BUG_ON(n == 0);
+        if (n == 1) {
+            head->prev_inline = last->prev_inline;
+            head->prev = &head->prev_inline;
+        } else {
+            head->prev = last->prev;
+            last->prev = NULL;
+        }
+
+        // Note that the size of the `prev` array is still accounted for
+        head->nr_prev = n;
+        last->nr_prev = 0;
+        for (unsigned long i = 0; i < n; i++) {
+            head->prev[i]->next = head;
+        }
+
+        if (buffer->saved_change == last) {
+            buffer->saved_change = head;
+        }
+
+        release_change(arena, last);
+    }
+}
+
+static void changes_recorded(View *view)
+{
+    if (!cs.in_chain) {
+        const GlobalOptions *gopts = &view->window->editor->options;
+        evict_old_changes(view->buffer, MIN(gopts->undo_memory_limit, SIZE_MAX));
+    }
+}
+
 static size_t buffer_offset(const View *view)
 {
     return block_iter_get_offset(&view->cursor);
@@ -74,6 +293,7 @@ static void record_insert(View *view, size_t len)
     Change *change = new_change(view->buffer);
     change->offset = buffer_offset(view);
     change->ins_count = len;
+    changes_recorded(view);
 }
 
 static void record_delete(View *view, char *buf, size_t len, bool move_after)
@@ -99,6 +319,8 @@ static void record_delete(View *view, char *buf, size_t len, bool move_after)
         change->buf = xrealloc(left, change->del_count);
         memcpy(change->buf + left_len, right, right_len);
         free(right);
+        view->buffer->change_arena.memory_usage += len;
+        changes_recorded(view);
         return;
     }
 
@@ -107,6 +329,8 @@ static void record_delete(View *view, char *buf, size_t len, bool move_after)
     change->del_count = len;
     change->move_after = move_after;
     change->buf = buf;
+    view->buffer->change_arena.memory_usage += len;
+    changes_recorded(view);
 }
 
 static void record_replace(View *view, char *deleted, size_t del_count, size_t ins_count)
@@ -120,6 +344,8 @@ static void record_replace(View *view, char *deleted, size_t del_count, size_t i
     change->ins_count = ins_count;
     change->del_count = del_count;
     change->buf = deleted;
+    view->buffer->change_arena.memory_usage += del_count;
+    changes_recorded(view);
 }
 
 void begin_change(ChangeMergeEnum m)
@@ -134,24 +360,30 @@ void end_change(void)
 
 void begin_change_chain(void)
 {
-    BUG_ON(cs.barrier);
+    BUG_ON(cs.in_chain);
 
-    // Allocate change chain barrier but add it to the change tree only if
-    // there will be any real changes
-    cs.barrier = alloc_change();
+    // Add a change chain barrier to the change tree only if there will
+    // be any real changes (see new_change())
+    cs.in_chain = true;
+    cs.barrier = true;
     cs.merge = CHANGE_MERGE_NONE;
 }
 
 void end_change_chain(View *view)
 {
+    BUG_ON(!cs.in_chain);
+    cs.in_chain = false;
+
     if (cs.barrier) {
         // There were no changes in this change chain
-        free(cs.barrier);
-        cs.barrier = NULL;
-    } else {
-        // There were some changes; add end of chain marker
-        add_change(view->buffer, alloc_change());
+        cs.barrier = false;
+        return;
     }
+
+    // There were some changes; add end of chain marker
+    Buffer *buffer = view->buffer;
+    add_change(buffer, alloc_change(buffer));
+    changes_recorded(view);
 }
 
 static void fix_cursors(const View *view, size_t offset, size_t del, size_t ins)
@@ -176,6 +408,12 @@ static void reverse_change(View *view, Change *change)
     const size_t del_count = change->del_count;
     BUG_ON(!del_count && !ins_count);
 
+    // The text stored in `change->buf` is about to become the inserted
+    // text (and vice versa)
+    size_t *memory_usage = &view->buffer->change_arena.memory_usage;
+    *memory_usage += ins_count;
+    *memory_usage -= del_count;
+
     if (view->buffer->views.count > 1) {
         // NOLINTNEXTLINE(readability-suspicious-call-argument)
         fix_cursors(view, change->offset, ins_count, del_count);
@@ -213,8 +451,108 @@ static void reverse_change(View *view, Change *change)
     change->del_count = ins_count;
 }
 
+// Reverse all Changes of a chain (in the order given) with one call to
+// do_edits(), which saves a block walk, a buffer_mark_lines_changed() call
+// and an update of `line_start_states` per Change. This is only possible
+// if the edits don't overlap and are either all before the previous one
+// (as when undoing a chain created in forward order, e.g. by `replace`)
+// or all after the previous one (as when redoing it). Returns false
+// without doing anything if that's not the case.
+static bool reverse_chain(View *view, Change **changes, size_t n)
+{
+    BUG_ON(n < 2);
+    bool forward = true;
+    bool backward = true;
+    for (size_t i = 1; i < n && (forward || backward); i++) {
+        const Change *prev = changes[i - 1];
+        const Change *c = changes[i];
+        // Note that `ins_count` is the number of bytes about to be removed
+        // and `del_count` the number about to be inserted
+        backward = backward && c->offset + c->ins_count <= prev->offset;
+        forward = forward && c->offset >= prev->offset + prev->del_count;
+    }
+
+    if (!forward && !backward) {
+        return false;
+    }
+
+    // Sort the edits by offset and map them to the offsets of the text
+    // as it is before any of them are applied
+    TextEdit *edits = xmallocarray(n, sizeof(*edits));
+    size_t added = 0;
+    size_t removed = 0;
+    for (size_t i = 0; i < n; i++) {
+        const Change *c = changes[i];
+        size_t offset = c->offset;
+        if (forward) {
+            offset = offset + removed - added;
+            added += c->del_count;
+            removed += c->ins_count;
+        }
+        edits[forward ? i : n - 1 - i] = (TextEdit) {
+            .offset = offset,
+            .del_count = c->ins_count,
+            .ins = c->buf,
+            .ins_count = c->del_count,
+        };
+    }
+
+    Buffer *buffer = view->buffer;
+    const Change *last = changes[n - 1];
+    size_t cursor_offset = last->offset;
+    if (last->ins_count == 0 && last->move_after) {
+        cursor_offset += last->del_count;
+    }
+
+    size_t ins_total = 0;
+    size_t del_total = 0;
+    for (size_t i = 0; i < n; i++) {
+        const Change *c = changes[i];
+        ins_total += c->del_count;
+        del_total += c->ins_count;
+        if (buffer->views.count > 1) {
+            // NOLINTNEXTLINE(readability-suspicious-call-argument)
+            fix_cursors(view, c->offset, c->ins_count, c->del_count);
+        }
+    }
+
+    // The stored text of each Change is about to become the inserted
+    // text (and vice versa); see reverse_change()
+    size_t *memory_usage = &buffer->change_arena.memory_usage;
+    *memory_usage += del_total;
+    *memory_usage -= ins_total;
+
+    do_edits(view, edits, n);
+
+    for (size_t i = 0; i < n; i++) {
+        Change *c = changes[forward ? i : n - 1 - i];
+        const TextEdit *edit = &edits[i];
+        free(c->buf);
+        c->buf = edit->deleted;
+        c->ins_count = edit->ins_count;
+        c->del_count = edit->del_count;
+    }
+
+    free(edits);
+    block_iter_goto_offset(&view->cursor, cursor_offset);
+    return true;
+}
+
+static void reverse_changes(View *view, PointerArray *chain)
+{
+    Change **changes = (Change**)chain->ptrs;
+    size_t n = chain->count;
+    if (n < 2 || !reverse_chain(view, changes, n)) {
+        for (size_t i = 0; i < n; i++) {
+            reverse_change(view, changes[i]);
+        }
+    }
+    ptr_array_free_array(chain);
+}
+
 bool undo(View *view, ErrorBuffer *ebuf)
 {
+    undo_file_load(view->buffer);
     Change *change = view->buffer->cur_change;
     view_reset_preferred_x(view);
     if (!change->next) {
@@ -222,15 +560,16 @@ bool undo(View *view, ErrorBuffer *ebuf)
     }
 
     if (is_change_chain_barrier(change)) {
-        unsigned long count = 0;
+        PointerArray chain = PTR_ARRAY_INIT;
         while (1) {
             change = change->next;
             if (is_change_chain_barrier(change)) {
                 break;
             }
-            reverse_change(view, change);
-            count++;
+            ptr_array_append(&chain, change);
         }
+        unsigned long count = chain.count;
+        reverse_changes(view, &chain);
         if (count > 1) {
             info_msg(ebuf, "Undid %lu changes", count);
         }
@@ -244,9 +583,10 @@ bool undo(View *view, ErrorBuffer *ebuf)
 
 bool redo(View *view, ErrorBuffer *ebuf, unsigned long change_id)
 {
+    undo_file_load(view->buffer);
     Change *change = view->buffer->cur_change;
     view_reset_preferred_x(view);
-    if (!change->prev) {
+    if (change->nr_prev == 0) {
         // Don't complain if change_id is 0
         if (change_id) {
             error_msg(ebuf, "Nothing to redo");
@@ -274,15 +614,16 @@ bool redo(View *view, ErrorBuffer *ebuf, unsigned long change_id)
 
     change = change->prev[change_id];
     if (is_change_chain_barrier(change)) {
-        unsigned long count = 0;
+        PointerArray chain = PTR_ARRAY_INIT;
         while (1) {
             change = change->prev[change->nr_prev - 1];
             if (is_change_chain_barrier(change)) {
                 break;
             }
-            reverse_change(view, change);
-            count++;
+            ptr_array_append(&chain, change);
         }
+        unsigned long count = chain.count;
+        reverse_changes(view, &chain);
         if (count > 1) {
             info_msg(ebuf, "Redid %lu changes", count);
         }
@@ -294,27 +635,301 @@ bool redo(View *view, ErrorBuffer *ebuf, unsigned long change_id)
     return true;
 }
 
-void free_changes(Change *c)
+// Count the Changes in the undo tree rooted at `head` (in `counts[0]`),
+// the bytes of deleted text they store (in `counts[1]`) and the bytes
+// used by the Change structs and their `prev` arrays (in `counts[2]`).
+// The sum of the latter 2 always equals ChangeArena::memory_usage.
+void count_changes(const Change *head, uintmax_t counts[static 3])
 {
-top:
-    while (c->nr_prev) {
-        c = c->prev[c->nr_prev - 1];
+    uintmax_t nr_changes = 0;
+    uintmax_t text_bytes = 0;
+    uintmax_t other_bytes = prev_array_size(head->nr_prev);
+    const Change *c = head;
+    unsigned long idx = 0; // Index of the next child of `c` to visit
+
+    while (1) {
+        if (idx < c->nr_prev) {
+            // Descend into the next child
+            c = c->prev[idx];
+            idx = 0;
+            nr_changes++;
+            text_bytes += c->buf ? c->del_count : 0;
+            other_bytes += sizeof(*c) + prev_array_size(c->nr_prev);
+            continue;
+        }
+
+        if (c == head) {
+            break;
+        }
+
+        // Return to the parent and continue with the next sibling
+        const Change *parent = c->next;
+        for (idx = 0; parent->prev[idx] != c; idx++) {
+            BUG_ON(idx + 1 >= parent->nr_prev);
+        }
+        idx++;
+        c = parent;
     }
 
-    // c is leaf now
-    while (c->next) {
-        Change *next = c->next;
-        free(c->buf);
-        free(c);
+    counts[0] = nr_changes;
+    counts[1] = text_bytes;
+    counts[2] = other_bytes;
+}
+
+static void append_uint(String *buf, uintmax_t x)
+{
+    for (; x >= 0x80; x >>= 7) {
+        string_append_byte(buf, (x & 0x7F) | 0x80);
+    }
+    string_append_byte(buf, x);
+}
+
+static bool read_uint(StringView *sv, size_t *valp)
+{
+    size_t val = 0;
+    for (size_t i = 0, shift = 0; i < sv->length && shift < BITSIZE(val); i++, shift += 7) {
+        unsigned char byte = sv->data[i];
+        val |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            strview_remove_prefix(sv, i + 1);
+            *valp = val;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Append a compact encoding of the undo tree of `buffer` to `buf`, as it
+ * applies to the text at `saved_change`, and return the index of the
+ * latter in the encoding (where 0 refers to `change_head`), or SIZE_MAX
+ * if there's no such encoding.
+ *
+ * Each Change is encoded in pre-order, as a series of variable-length
+ * integers (the number of levels to ascend from the previously encoded
+ * Change to reach its parent, followed by `offset`, `del_count`,
+ * `ins_count` and `move_after`) and then the `del_count` bytes of
+ * `buf`, if any.
+ *
+ * Note that the Changes leading up to `cur_change` are stored in their
+ * "applied" form and all others in their "reversed" form, so any Changes
+ * made since `saved_change` must be omitted. If `saved_change` isn't an
+ * ancestor of `cur_change`, there's no way to make the encoding consistent
+ * (without the text of the intermediate states) and nothing is encoded.
+ */
+size_t serialize_changes(const Buffer *buffer, String *buf)
+{
+    const Change *head = &buffer->change_head;
+    const Change *saved = buffer->saved_change;
+    const Change *skip = NULL; // First Change made since `saved_change`
+    for (const Change *c = buffer->cur_change; c != saved; c = c->next) {
+        if (!c->next) {
+            return SIZE_MAX;
+        }
+        skip = c;
+    }
 
-        c = next;
-        if (--c->nr_prev) {
-            goto top;
+    const Change *c = head;
+    unsigned long idx = 0; // Index of the next child of `c` to visit
+    size_t nr_changes = 0;
+    size_t nr_ascended = 0;
+    size_t saved_idx = (saved == head) ? 0 : SIZE_MAX;
+
+    while (1) {
+        if (idx < c->nr_prev) {
+            if (c->prev[idx] == skip) {
+                idx++;
+                continue;
+            }
+            c = c->prev[idx];
+            idx = 0;
+            append_uint(buf, nr_ascended);
+            append_uint(buf, c->offset);
+            append_uint(buf, c->del_count);
+            append_uint(buf, c->ins_count);
+            append_uint(buf, c->move_after);
+            if (c->del_count) {
+                string_append_buf(buf, c->buf, c->del_count);
+            }
+            nr_ascended = 0;
+            if (c == saved) {
+                saved_idx = nr_changes + 1;
+            }
+            nr_changes++;
+            continue;
         }
 
-        // We have become leaf
-        free(c->prev);
+        if (c == head) {
+            break;
+        }
+
+        const Change *parent = c->next;
+        for (idx = 0; parent->prev[idx] != c; idx++) {
+            BUG_ON(idx + 1 >= parent->nr_prev);
+        }
+        idx++;
+        c = parent;
+        nr_ascended++;
     }
+
+    return saved_idx;
+}
+
+// Return the number of bytes deleted from the text by redoing `change`,
+// where `applied` indicates which form it's in (see serialize_changes())
+static size_t redo_del_count(const Change *change, bool applied)
+{
+    return applied ? change->del_count : change->ins_count;
+}
+
+// Like redo_del_count(), but for the number of bytes inserted
+static size_t redo_ins_count(const Change *change, bool applied)
+{
+    return applied ? change->ins_count : change->del_count;
+}
+
+// Check that every Change decoded by deserialize_changes() fits the text
+// it would be applied to, i.e. that none of them could ever delete bytes
+// past the end of it, given the size of the text at `saved` (a Change with
+// a bad offset would otherwise be found only when reached by undo/redo,
+// and cause out of bounds reads/writes)
+static bool changes_fit_text(const Change *head, const Change *saved, size_t saved_size)
+{
+    // Find the size of the text at `head`, by undoing the Changes leading
+    // up to `saved` (which are in the "applied" form), and record the
+    // latter by depth, so they can be recognized when walking the tree
+    PointerArray path = PTR_ARRAY_INIT;
+    size_t size = saved_size;
+    bool ok = true;
+    for (const Change *c = saved; c != head && ok; c = c->next) {
+        ptr_array_append(&path, (void*)c);
+        ok = c->offset <= size && c->ins_count <= size - c->offset;
+        size += c->del_count - c->ins_count;
+        ok = ok && size >= c->del_count; // Overflow check
+    }
+
+    // Walk the whole tree in pre-order (as in serialize_changes()),
+    // keeping `size` in sync with the text at `c`
+    const size_t path_len = path.count;
+    const Change *c = head;
+    unsigned long idx = 0;
+    size_t depth = 0;
+    while (ok) {
+        if (idx < c->nr_prev) {
+            const Change *child = c->prev[idx];
+            bool applied = depth < path_len && path.ptrs[path_len - depth - 1] == child;
+            size_t del = redo_del_count(child, applied);
+            size_t ins = redo_ins_count(child, applied);
+            ok = child->offset <= size && del <= size - child->offset;
+            ok = ok && !size_add_overflows(size - del, ins, &size);
+            c = child;
+            idx = 0;
+            depth++;
+            continue;
+        }
+
+        if (c == head) {
+            break;
+        }
+
+        const Change *parent = c->next;
+        bool applied = depth <= path_len && path.ptrs[path_len - depth] == c;
+        size += redo_del_count(c, applied) - redo_ins_count(c, applied);
+        for (idx = 0; parent->prev[idx] != c; idx++) {
+            BUG_ON(idx + 1 >= parent->nr_prev);
+        }
+        idx++;
+        c = parent;
+        depth--;
+    }
+
+    ptr_array_free_array(&path);
+    return ok;
+}
+
+// Rebuild the undo tree of `buffer` from data produced by serialize_changes()
+// and make the Change at `saved_idx` both current and saved. The text of
+// `buffer` must be in the state that `saved_idx` refers to. If any part of
+// the data is invalid, nothing is kept and false is returned.
+bool deserialize_changes(Buffer *buffer, StringView data, size_t saved_idx)
+{
+    Change *head = &buffer->change_head;
+    BUG_ON(head->nr_prev);
+    BUG_ON(buffer->cur_change != head);
+
+    Change *saved = (saved_idx == 0) ? head : NULL;
+    Change *prev = head;
+    for (size_t i = 1; data.length; i++) {
+        size_t nr_ascended, offset, del_count, ins_count, move_after;
+        bool ok = read_uint(&data, &nr_ascended)
+            && read_uint(&data, &offset)
+            && read_uint(&data, &del_count)
+            && read_uint(&data, &ins_count)
+            && read_uint(&data, &move_after)
+            && move_after <= 1
+            && del_count <= data.length;
+
+        if (unlikely(!ok)) {
+            goto error;
+        }
+
+        Change *parent = prev;
+        for (; nr_ascended; nr_ascended--) {
+            if (unlikely(!parent->next)) {
+                goto error;
+            }
+            parent = parent->next;
+        }
+
+        Change *change = alloc_change(buffer);
+        buffer->cur_change = parent;
+        add_change(buffer, change);
+        change->offset = offset;
+        change->del_count = del_count;
+        change->ins_count = ins_count;
+        change->move_after = move_after;
+        if (del_count) {
+            change->buf = xmemdup(data.data, del_count);
+            strview_remove_prefix(&data, del_count);
+            buffer->change_arena.memory_usage += del_count;
+        }
+
+        saved = (i == saved_idx) ? change : saved;
+        prev = change;
+    }
+
+    size_t size = block_total_size(BLOCK(buffer->blocks.next));
+    if (unlikely(!saved || !changes_fit_text(head, saved, size))) {
+        goto error;
+    }
+
+    buffer->cur_change = saved;
+    buffer->saved_change = saved;
+    return true;
+
+error:
+    free_changes(buffer);
+    return false;
+}
+
+void free_changes(Buffer *buffer)
+{
+    Change *head = &buffer->change_head;
+    free_other_branches(buffer, head, NULL);
+    if (head->prev != &head->prev_inline) {
+        free(head->prev);
+    }
+
+    ChangeArena *arena = &buffer->change_arena;
+    for (ChangeSlab *slab = arena->slabs, *next; slab; slab = next) {
+        next = slab->next;
+        free(slab);
+    }
+
+    *head = (Change){.next = NULL};
+    *arena = (ChangeArena){.slabs = NULL};
+    buffer->cur_change = head;
+    buffer->saved_change = head;
 }
 
 void buffer_insert_bytes(View *view, const char *buf, const size_t len)
@@ -428,3 +1043,62 @@ void buffer_replace_bytes(View *view, size_t del_count, const char *ins, size_t
         fix_cursors(view, block_iter_get_offset(&view->cursor), del_count, ins_count);
     }
 }
+
+// Apply `n` edits (see do_edits()) and record them as a chain of Changes,
+// one per edit, each storing only the text removed by that edit
+void buffer_replace_edits(View *view, TextEdit *edits, size_t n)
+{
+    view_reset_preferred_x(view);
+    if (n == 0) {
+        return;
+    }
+
+    // Check if all newlines from EOF would be deleted by the last edit
+    // (see buffer_delete_bytes_internal() and buffer_replace_bytes())
+    TextEdit *last = &edits[n - 1];
+    load_buffer_finish(view->buffer);
+    BlockIter bi = view->cursor;
+    block_iter_goto_offset(&bi, last->offset);
+    if (last->del_count && would_delete_last_bytes(&bi, last->del_count)) {
+        CodePoint u;
+        bool keep_newline = last->ins_count
+            ? last->ins[last->ins_count - 1] != '\n'
+            : block_iter_prev_char(&bi, &u) && u != '\n'
+        ;
+        if (keep_newline) {
+            last->del_count--;
+            if (!last->del_count && !last->ins_count && --n == 0) {
+                return;
+            }
+        }
+    }
+
+    Buffer *buffer = view->buffer;
+    do_edits(view, edits, n);
+    if (n > 1) {
+        begin_change_chain();
+    }
+
+    size_t added = 0;
+    size_t removed = 0;
+    for (size_t i = 0; i < n; i++) {
+        const TextEdit *edit = &edits[i];
+        Change *change = new_change(buffer);
+        change->offset = edit->offset + added - removed;
+        change->del_count = edit->del_count;
+        change->ins_count = edit->ins_count;
+        change->buf = edit->deleted;
+        buffer->change_arena.memory_usage += edit->del_count;
+        if (buffer->views.count > 1) {
+            fix_cursors(view, change->offset, edit->del_count, edit->ins_count);
+        }
+        added += edit->ins_count;
+        removed += edit->del_count;
+    }
+
+    if (n > 1) {
+        end_change_chain(view);
+    } else {
+        changes_recorded(view);
+    }
+}
@@ -3,8 +3,12 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "command/error.h"
+#include "edit.h"
 #include "util/macros.h"
+#include "util/string-view.h"
+#include "util/string.h"
 #include "view.h"
 
 typedef enum {
@@ -16,7 +20,8 @@ typedef enum {
 
 typedef struct Change {
     struct Change *next;
-    struct Change **prev;
+    struct Change **prev; // Points to `prev_inline`, if `nr_prev` is 1
+    struct Change *prev_inline;
     unsigned long nr_prev;
     bool move_after; // Move after inserted text when undoing delete?
     size_t offset;
@@ -25,16 +30,33 @@ typedef struct Change {
     char *buf; // Deleted bytes (inserted bytes need not be saved)
 } Change;
 
+// An append-only allocator for the Changes of a single Buffer. Change
+// structs are carved sequentially out of slabs and only ever recycled
+// (via `free_list`) when old history is evicted, so that recording a
+// long undo history doesn't require a malloc(3) call for every edit.
+typedef struct {
+    struct ChangeSlab *slabs; // Singly linked list; the first is the one allocated from
+    Change *free_list; // Linked via Change::next
+    size_t nr_slabs;
+    size_t memory_usage; // Bytes used by all Changes (see count_changes())
+} ChangeArena;
+
+struct Buffer;
+
 void begin_change(ChangeMergeEnum m);
 void end_change(void);
 void begin_change_chain(void);
 void end_change_chain(View *view) NONNULL_ARGS;
 bool undo(View *view, ErrorBuffer *ebuf) NONNULL_ARG(1) WARN_UNUSED_RESULT;
 bool redo(View *view, ErrorBuffer *ebuf, unsigned long change_id) NONNULL_ARG(1) WARN_UNUSED_RESULT;
-void free_changes(Change *c) NONNULL_ARGS;
+void free_changes(struct Buffer *buffer) NONNULL_ARGS;
+size_t serialize_changes(const struct Buffer *buffer, String *buf) NONNULL_ARGS;
+bool deserialize_changes(struct Buffer *buffer, StringView data, size_t saved_idx) NONNULL_ARG(1) WARN_UNUSED_RESULT;
+void count_changes(const Change *head, uintmax_t counts[static 3]) NONNULL_ARGS;
 void buffer_insert_bytes(View *view, const char *buf, size_t len) NONNULL_ARG(1) NONNULL_ARG_IF_NONZERO_LENGTH(2, 3);
 void buffer_delete_bytes(View *view, size_t len) NONNULL_ARGS;
 void buffer_erase_bytes(View *view, size_t len) NONNULL_ARGS;
 void buffer_replace_bytes(View *view, size_t del_count, const char *ins, size_t ins_count) NONNULL_ARG(1) NONNULL_ARG_IF_NONZERO_LENGTH(3, 4);
+void buffer_replace_edits(View *view, TextEdit *edits, size_t n) NONNULL_ARG(1);
 
 #endif
@@ -28,6 +28,7 @@
 #include "file-option.h"
 #include "filetype.h"
 #include "frame.h"
+#include "grep.h"
 #include "history.h"
 #include "indent.h"
 #include "insert.h"
@@ -46,6 +47,7 @@
 #include "syntax/color.h"
 #include "syntax/syntax.h"
 #include "tag.h"
+#include "undo-file.h"
 #include "terminal/cursor.h"
 #include "terminal/mode.h"
 #include "terminal/osc52.h"
@@ -859,6 +861,70 @@ static bool cmd_ft(EditorState *e, const CommandArgs *a)
     return nfailed == 0;
 }
 
+static bool cmd_grep(EditorState *e, const CommandArgs *a)
+{
+    const char *pattern = a->args[0];
+    if (!pattern) {
+        // Cancel any search still in progress, keeping the results found
+        // so far
+        if (e->grep) {
+            grep_free(e->grep);
+            e->grep = NULL;
+        }
+        return true;
+    }
+
+    char *alloc = NULL;
+    if (has_flag(a, 'e')) {
+        StringView pat = strview(pattern);
+        if (strview_contains_char_type(pat, ASCII_REGEX)) {
+            pattern = alloc = regexp_escape(pattern, pat.length);
+        }
+    }
+
+    char abc = cmdargs_pick_winning_flag(a, "ABC");
+    size_t idx = abc ? abc - 'A' : e->options.msg_compile;
+    MessageList *msgs = &e->messages[idx];
+    char dot[] = ".";
+    char *cwd[] = {dot, NULL};
+    char **paths = (a->nr_args > 1) ? a->args + 1 : cwd;
+    bool icase = has_flag(a, 'i');
+
+    // The pattern and paths are checked before anything is cancelled or
+    // cleared, so that a mistake doesn't lose the previous results
+    GrepSearch *gs = grep_start(msgs, &e->err, pattern, icase, paths);
+    free(alloc);
+    if (!gs) {
+        return false;
+    }
+
+    if (e->grep) {
+        grep_free(e->grep);
+    }
+
+    // No Messages are added to `msgs` until grep_continue() is called
+    clear_messages(msgs);
+
+    if (!(e->flags & EFLAG_HEADLESS)) {
+        // The search continues while the editor is idle (see continue_grep())
+        e->grep = gs;
+        return true;
+    }
+
+    e->grep = NULL;
+    while (grep_continue(gs, 1000)) {
+        ;
+    }
+    grep_free(gs);
+
+    if (msgs->array.count == 0) {
+        return error_msg(&e->err, "Pattern '%s' not found", a->args[0]);
+    }
+
+    activate_current_message_save(msgs, &e->bookmarks, e->view, &e->err);
+    return true;
+}
+
 static bool cmd_hi(EditorState *e, const CommandArgs *a)
 {
     if (unlikely(a->nr_args == 0)) {
@@ -1952,6 +2018,10 @@ static bool cmd_save(EditorState *e, const CommandArgs *a)
         }
     }
 
+    if (e->options.persistent_undo) {
+        undo_file_save(buffer, e->user_config_dir, ebuf);
+    }
+
     return true;
 
 error:
@@ -2655,6 +2725,7 @@ static const Command cmds[] = {
     {"errorfmt", "ci", RC, 1, 2 + ERRORFMT_CAPTURE_MAX, cmd_errorfmt},
     {"exec", "e=i=lmno=pst", NFAA, 1, -1, cmd_exec},
     {"ft", "bcfi", RC | NFAA, 2, -1, cmd_ft},
+    {"grep", "ABCei", NA, 0, -1, cmd_grep},
     {"hi", "cq", RC | NFAA, 0, -1, cmd_hi},
     {"include", "bq", RC, 1, 1, cmd_include},
     {"indent", "r", NA, 0, 1, cmd_indent},
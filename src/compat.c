@@ -1,6 +1,7 @@
 #include "build-defs.h" // HAVE_*
 #include <sys/stat.h> // S_ISVTX
 #include "buildvar-iconv.h" // ICONV_DISABLE
+#include "buildvar-threads.h" // THREADS_DISABLE
 #include "compat.h"
 #include "regexp.h" // HAVE_REG_STARTEND, REG_ENHANCED (macOS)
 #include "util/debug.h" // DEBUG
@@ -66,6 +67,9 @@ const char buildvar_string[] =
 #if ICONV_DISABLE == 1
     " ICONV_DISABLE"
 #endif
+#if THREADS_DISABLE == 1
+    " THREADS_DISABLE"
+#endif
 #ifdef SANE_WCTYPE
     " SANE_WCTYPE"
 #endif
@@ -25,6 +25,7 @@
 #include "terminal/cursor.h"
 #include "terminal/key.h"
 #include "terminal/style.h"
+#include "undo-file.h"
 #include "util/arith.h"
 #include "util/array.h"
 #include "util/ascii.h"
@@ -55,13 +56,6 @@ static bool is_executable(int dir_fd, const char *filename)
     return faccessat(dir_fd, filename, X_OK, 0) == 0;
 }
 
-static bool is_ignored_dir_entry(StringView name)
-{
-    return unlikely(name.length == 0)
-        || strview_equal_cstring(name, ".")
-        || strview_equal_cstring(name, "..");
-}
-
 static bool do_collect_files (
     PointerArray *array,
     const char *dirname,
@@ -468,6 +462,13 @@ static void complete_move_tab(EditorState *e, const CommandArgs *a)
     COLLECT_STRINGS(words, &cs->completions, cs->parsed);
 }
 
+static void complete_grep(EditorState *e, const CommandArgs *a)
+{
+    if (a->nr_args >= 1) {
+        collect_files(e, &e->cmdline.completion, COLLECT_ALL);
+    }
+}
+
 static void complete_open(EditorState *e, const CommandArgs *a)
 {
     if (!cmdargs_has_flag(a, 't')) {
@@ -503,6 +504,7 @@ static void complete_quit(EditorState *e, const CommandArgs* UNUSED_ARG(a))
 
 static void complete_redo(EditorState *e, const CommandArgs* UNUSED_ARG(a))
 {
+    undo_file_load(e->buffer);
     const Change *change = e->buffer->cur_change;
     CompletionState *cs = &e->cmdline.completion;
     for (unsigned long i = 1, n = change->nr_prev; i <= n; i++) {
@@ -589,6 +591,7 @@ static const CompletionHandler completion_handlers[] = {
     {"errorfmt", complete_errorfmt},
     {"exec", complete_exec},
     {"ft", complete_ft},
+    {"grep", complete_grep},
     {"hi", complete_hi},
     {"include", complete_include},
     {"macro", complete_macro},
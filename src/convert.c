@@ -11,6 +11,7 @@
 #include "util/list.h"
 #include "util/log.h"
 #include "util/numtostr.h"
+#include "util/parallel.h"
 #include "util/str-util.h"
 #include "util/utf8.h"
 #include "util/xmalloc.h"
@@ -25,60 +26,160 @@ typedef struct {
 static void add_block(Buffer *buffer, Block *blk)
 {
     buffer->nl += blk->nl;
-    list_insert_before(&blk->node, &buffer->blocks);
+    block_arena_adopt(&buffer->arena, blk);
+    block_append(blk, &buffer->blocks);
 }
 
-static Block *add_utf8_line (
+static void check_syntax_line_limit (
     Buffer *buffer,
     const GlobalOptions *gopts,
     ErrorBuffer *errbuf,
-    Block *blk,
-    StringView line
+    size_t line_length
 ) {
     size_t slimit = gopts->syntax_line_limit;
-    size_t size = line.length + 1;
-
-    if (blk) {
-        size_t avail = blk->alloc - blk->size;
-        if (size <= avail) {
-            goto copy;
-        }
-        add_block(buffer, blk);
-    }
-
-    size = MAX(size, 8192);
-    blk = block_new(size);
-
-copy:
-    if (unlikely(slimit && line.length > slimit && buffer->options.syntax)) {
+    if (unlikely(slimit && line_length > slimit && buffer->options.syntax)) {
         char limit_str[PRECISE_FILESIZE_STR_MAX];
         filesize_to_str_precise(slimit, limit_str);
         error_msg (
             errbuf,
             "line length (%zu) exceeds 'syntax-line-limit' option (%s); "
             "disabling syntax highlighting",
-            line.length, limit_str
+            line_length, limit_str
         );
         buffer->options.syntax = false;
     }
-
-    memcpy(blk->data + blk->size, line.data, line.length);
-    blk->size += line.length;
-    blk->data[blk->size++] = '\n';
-    blk->nl++;
-    return blk;
 }
 
-static bool read_utf8_line(FileDecoder *dec, StringView *linep)
+typedef struct {
+    StringView text;
+    ListHead blocks;
+    size_t max_line_len;
+    bool crlf;
+} DecodeChunk;
+
+enum {
+    // Files smaller than twice this size are decoded by a single thread
+    DECODE_CHUNK_MIN = 4 << 20, // 4MiB
+    DECODE_CHUNKS_MAX = 64,
+};
+
+// Decode a chunk of text into a private list of Blocks. This is called
+// from worker threads, so it must not access any shared state (i.e. the
+// Blocks aren't added to the Buffer or its index here).
+static void decode_utf8_chunk(void *data, size_t idx)
 {
-    size_t len = dec->text.length;
-    if (dec->ipos >= len) {
-        BUG_ON(dec->ipos > len);
-        return false;
+    DecodeChunk *chunk = (DecodeChunk*)data + idx;
+    const char *text = chunk->text.data;
+    const size_t len = chunk->text.length;
+    const bool crlf = chunk->crlf;
+    size_t max_line_len = 0;
+    Block *blk = NULL;
+
+    for (size_t pos = 0; pos < len; ) {
+        StringView line = get_delim(text, &pos, len, '\n');
+        if (crlf) {
+            strview_remove_matching_suffix(&line, "\r");
+        }
+
+        size_t size = line.length + 1;
+        if (!blk || blk->alloc - blk->size < size) {
+            blk = block_new(NULL, MAX(size, 8192));
+            list_insert_before(&blk->node, &chunk->blocks);
+        }
+
+        max_line_len = MAX(max_line_len, line.length);
+        memcpy(blk->data + blk->size, line.data, line.length);
+        blk->size += line.length;
+        blk->data[blk->size++] = '\n';
+        blk->nl++;
     }
 
-    *linep = get_delim(dec->text.data, &dec->ipos, len, '\n');
-    return true;
+    chunk->max_line_len = max_line_len;
+}
+
+// Split `text` into chunks that end at line boundaries, decode them
+// (in parallel, if the text is large enough) and then add the resulting
+// Blocks to `buffer` in order
+static void decode_utf8 (
+    Buffer *buffer,
+    const GlobalOptions *gopts,
+    ErrorBuffer *errbuf,
+    StringView text
+) {
+    const char *const data = text.data;
+    const size_t len = text.length;
+    size_t max_chunks = CLAMP(len / DECODE_CHUNK_MIN, 1, DECODE_CHUNKS_MAX);
+    size_t target_size = len / max_chunks;
+    DecodeChunk *chunks = xmallocarray(max_chunks, sizeof(*chunks));
+    size_t nr_chunks = 0;
+
+    for (size_t pos = 0; pos < len; nr_chunks++) {
+        size_t end = len;
+        if (nr_chunks + 1 < max_chunks && len - pos > target_size) {
+            const char *nl = memchr(data + pos + target_size, '\n', len - pos - target_size);
+            end = nl ? (size_t)(nl - data) + 1 : len;
+        }
+        chunks[nr_chunks] = (DecodeChunk) {
+            .text = string_view(data + pos, end - pos),
+            .crlf = buffer->crlf_newlines,
+        };
+        list_init(&chunks[nr_chunks].blocks);
+        pos = end;
+    }
+
+    run_in_parallel(decode_utf8_chunk, chunks, nr_chunks, get_nr_cpus());
+
+    for (size_t i = 0; i < nr_chunks; i++) {
+        const DecodeChunk *chunk = &chunks[i];
+        check_syntax_line_limit(buffer, gopts, errbuf, chunk->max_line_len);
+        ListHead *item = chunk->blocks.next;
+        while (item != &chunk->blocks) {
+            ListHead *next = item->next;
+            add_block(buffer, BLOCK(item));
+            item = next;
+        }
+    }
+
+    free(chunks);
+}
+
+// Add Blocks that point directly into `map` (see block_new_mapped()),
+// instead of copying `text`
+static void add_mapped_blocks (
+    Buffer *buffer,
+    const GlobalOptions *gopts,
+    ErrorBuffer *errbuf,
+    StringView text,
+    BlockMapping *map
+) {
+    // Mapped Blocks are larger than the ones created by decode_utf8(),
+    // since they cost nothing until edited and split_and_insert() breaks
+    // them up into BLOCK_EDIT_SIZE pieces anyway
+    const size_t target_size = 64 << 10;
+    const char *const data = text.data;
+    const size_t len = text.length;
+
+    for (size_t pos = 0; pos < len; ) {
+        const size_t start = pos;
+        size_t nl = 0;
+        size_t max_line_len = 0;
+        while (pos < len && pos - start < target_size) {
+            const char *eol = memchr(data + pos, '\n', len - pos);
+            size_t end = eol ? (size_t)(eol - data) : len;
+            max_line_len = MAX(max_line_len, end - pos);
+            nl += !!eol;
+            pos = end + !!eol;
+        }
+
+        check_syntax_line_limit(buffer, gopts, errbuf, max_line_len);
+        add_block(buffer, block_new_mapped(map, data + start, pos - start, nl));
+    }
+}
+
+static bool has_crlf_first_line(StringView text)
+{
+    const char *first_nl = memchr(text.data, '\n', text.length);
+    return first_nl && first_nl > text.data && first_nl[-1] == '\r';
 }
 
 static bool file_decoder_read_utf8 (
@@ -92,36 +193,63 @@ static bool file_decoder_read_utf8 (
         return false;
     }
 
-    FileDecoder dec = {.text = text};
-    StringView line;
-    if (!read_utf8_line(&dec, &line)) {
+    if (text.length == 0) {
         return true;
     }
 
-    if (strview_remove_matching_suffix(&line, "\r")) {
+    if (has_crlf_first_line(text)) {
         buffer->crlf_newlines = true;
     }
 
-    Block *blk = add_utf8_line(buffer, gopts, errbuf, NULL, line);
+    decode_utf8(buffer, gopts, errbuf, text);
+    return true;
+}
 
-    if (unlikely(buffer->crlf_newlines)) {
-        while (read_utf8_line(&dec, &line)) {
-            strview_remove_matching_suffix(&line, "\r");
-            blk = add_utf8_line(buffer, gopts, errbuf, blk, line);
-        }
-    } else {
-        while (read_utf8_line(&dec, &line)) {
-            blk = add_utf8_line(buffer, gopts, errbuf, blk, line);
-        }
+/*
+ * Like file_decoder_read_utf8(), but creating Blocks that point directly
+ * into `map`. This is only possible when no conversion is needed, so files
+ * with CRLF line endings are handed off to file_decoder_read_utf8().
+ */
+bool file_decoder_read_mapped (
+    Buffer *buffer,
+    const GlobalOptions *gopts,
+    ErrorBuffer *errbuf,
+    StringView text,
+    BlockMapping *map
+) {
+    if (unlikely(!encoding_is_utf8(buffer->encoding))) {
+        errno = EINVAL;
+        return false;
     }
 
-    if (blk) {
-        add_block(buffer, blk);
+    if (has_crlf_first_line(text)) {
+        return file_decoder_read_utf8(buffer, gopts, errbuf, text);
     }
 
+    add_mapped_blocks(buffer, gopts, errbuf, text, map);
     return true;
 }
 
+// Add more UTF-8 text to a Buffer that was previously populated by
+// file_decoder_read() or file_decoder_read_mapped(). The text must begin
+// at a line boundary and Buffer::crlf_newlines is used as already set
+// by the previous call, instead of being detected from the first line.
+// If `map` is non-NULL, Blocks may reference it instead of copying text.
+void file_decoder_read_more (
+    Buffer *buffer,
+    const GlobalOptions *gopts,
+    ErrorBuffer *errbuf,
+    StringView text,
+    BlockMapping *map
+) {
+    BUG_ON(!encoding_is_utf8(buffer->encoding));
+    if (map && !buffer->crlf_newlines) {
+        add_mapped_blocks(buffer, gopts, errbuf, text, map);
+    } else {
+        decode_utf8(buffer, gopts, errbuf, text);
+    }
+}
+
 static size_t unix_to_dos(FileEncoder *enc, StringView text, size_t nr_newlines)
 {
     BUG_ON(text.length && !strview_has_suffix(text, "\n")); // See sanity_check_blocks()
@@ -557,6 +685,35 @@ size_t file_encoder_get_nr_errors(const FileEncoder *enc)
     return enc->cconv ? enc->cconv->errors : 0;
 }
 
+static Block *add_utf8_line (
+    Buffer *buffer,
+    const GlobalOptions *gopts,
+    ErrorBuffer *errbuf,
+    Block *blk,
+    StringView line
+) {
+    size_t size = line.length + 1;
+
+    if (blk) {
+        size_t avail = blk->alloc - blk->size;
+        if (size <= avail) {
+            goto copy;
+        }
+        add_block(buffer, blk);
+    }
+
+    size = MAX(size, 8192);
+    blk = block_new(NULL, size);
+
+copy:
+    check_syntax_line_limit(buffer, gopts, errbuf, line.length);
+    memcpy(blk->data + blk->size, line.data, line.length);
+    blk->size += line.length;
+    blk->data[blk->size++] = '\n';
+    blk->nl++;
+    return blk;
+}
+
 static bool fill(FileDecoder *dec)
 {
     StringView text = dec->text;
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <sys/types.h>
+#include "block.h"
 #include "buffer.h"
 #include "command/error.h"
 #include "options.h"
@@ -19,6 +20,8 @@ typedef struct {
 
 bool conversion_supported_by_iconv(const char *from, const char *to) NONNULL_ARGS WARN_UNUSED_RESULT;
 bool file_decoder_read(Buffer *buffer, const GlobalOptions *gopts, ErrorBuffer *errbuf, StringView text) NONNULL_ARG(1, 2) WARN_UNUSED_RESULT;
+bool file_decoder_read_mapped(Buffer *buffer, const GlobalOptions *gopts, ErrorBuffer *errbuf, StringView text, BlockMapping *map) NONNULL_ARG(1, 2, 5) WARN_UNUSED_RESULT;
+void file_decoder_read_more(Buffer *buffer, const GlobalOptions *gopts, ErrorBuffer *errbuf, StringView text, BlockMapping *map) NONNULL_ARG(1, 2);
 
 FileEncoder file_encoder(const char *encoding, bool crlf, int fd) NONNULL_ARGS WARN_UNUSED_RESULT;
 void file_encoder_free(FileEncoder *enc) NONNULL_ARGS;
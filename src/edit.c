@@ -1,8 +1,11 @@
+#include <stdint.h>
 #include <string.h>
 #include "edit.h"
 #include "block.h"
 #include "buffer.h"
+#include "load-save.h"
 #include "syntax/highlight.h"
+#include "util/count-nl.h"
 #include "util/debug.h"
 #include "util/list.h"
 #include "util/xmalloc.h"
@@ -33,6 +36,8 @@ static void sanity_check_blocks(const View *view, bool check_newlines)
     }
 
     unsigned int cursor_seen = 0;
+    size_t size = 0;
+    size_t nl = 0;
     block_for_each(blk, &buffer->blocks) {
         block_sanity_check(blk);
         cursor_seen += (blk == cursor_blk);
@@ -43,21 +48,26 @@ static void sanity_check_blocks(const View *view, bool check_newlines)
         BUG_ON(check_newlines && blk->data[blk->size - 1] != '\n');
         BUG_ON(blk->nl < 1);
         BUG_ON(DEBUG > 2 && count_nl(blk->data, blk->size) != blk->nl);
+
+        // The Block index must agree with the list (see block.c)
+        BUG_ON(DEBUG > 2 && block_get_offset(blk) != size);
+        BUG_ON(DEBUG > 2 && block_get_line(blk) != nl);
+        size += blk->size;
+        nl += blk->nl;
     }
 
     BUG_ON(cursor_seen != 1);
+    BUG_ON(block_total_size(cursor_blk) != size);
+    BUG_ON(block_total_nl(cursor_blk) != nl);
+    BUG_ON(nl != buffer->nl);
 }
 
-static size_t copy_count_nl(char *dst, const char *src, size_t len)
+// Schedule the Blocks from `blk` onwards (including the one before it,
+// which may have become mergeable) to be visited by compact_blocks()
+static void compact_blocks_from(Buffer *buffer, const Block *blk)
 {
-    size_t nl = 0;
-    for (size_t i = 0; i < len; i++) {
-        dst[i] = src[i];
-        if (src[i] == '\n') {
-            nl++;
-        }
-    }
-    return nl;
+    size_t offset = block_get_offset(blk);
+    buffer->compact_offset = MIN(buffer->compact_offset, offset);
 }
 
 static size_t insert_to_current(BlockIter *cursor, const char *buf, size_t len)
@@ -70,6 +80,7 @@ static size_t insert_to_current(BlockIter *cursor, const char *buf, size_t len)
     size_t nl = copy_count_nl(blk->data + offset, buf, len);
     blk->nl += nl;
     blk->size = size;
+    block_counts_changed(blk);
     return nl;
 }
 
@@ -153,7 +164,7 @@ static size_t split_and_insert(BlockIter *cursor, const char *buf, size_t len)
         }
 
         BUG_ON(!size);
-        Block *new = block_new(size);
+        Block *new = block_new(blk->arena, size);
         if (start < size1) {
             size_t avail = size1 - start;
             size_t count = MIN(size, avail);
@@ -181,7 +192,7 @@ static size_t split_and_insert(BlockIter *cursor, const char *buf, size_t len)
 
         new->size = size;
         BUG_ON(copied != size);
-        list_insert_before(&new->node, &blk->node);
+        block_insert_before(new, blk);
 
         nl_added += new->nl;
         size = 0;
@@ -221,12 +232,17 @@ static size_t insert_bytes(BlockIter *cursor, const char *buf, size_t len)
 void do_insert(View *view, const char *buf, size_t len)
 {
     Buffer *buffer = view->buffer;
+    load_buffer_finish(buffer);
     size_t nl = insert_bytes(&view->cursor, buf, len);
     buffer->nl += nl;
     sanity_check_blocks(view, true);
+    compact_blocks_from(buffer, view->cursor.blk);
 
     view_update_cursor_y(view);
     buffer_mark_lines_changed(buffer, view->cy, nl ? LONG_MAX : view->cy);
+    match_cache_edit(&buffer->match_cache, view->cy, 0, nl);
+    match_count_edit(&buffer->match_count, view->cy, 0, nl);
+    buffer->reverse_matches.generation = 0;
     if (buffer->syntax) {
         hl_insert(&buffer->line_start_states, view->cy, nl);
     }
@@ -237,22 +253,20 @@ static bool only_block(const Buffer *buffer, const Block *blk)
     return blk->node.prev == &buffer->blocks && blk->node.next == &buffer->blocks;
 }
 
-char *do_delete(View *view, size_t len, bool sanity_check_newlines)
+// Delete `len` bytes at `cursor` and return the deleted text, along
+// with the number of newlines in it (via `nlp`). Only the Blocks and
+// Buffer::nl are updated; see do_delete().
+static char *delete_bytes(Buffer *buffer, BlockIter *cursor, size_t len, size_t *nlp)
 {
-    if (len == 0) {
-        return NULL;
-    }
-
     ListHead *saved_prev_node = NULL;
-    Block *blk = view->cursor.blk;
-    size_t offset = view->cursor.offset;
+    Block *blk = cursor->blk;
+    size_t offset = cursor->offset;
     if (!offset) {
         // The block where the cursor is can become empty and thus
         // may be deleted
         saved_prev_node = blk->node.prev;
     }
 
-    Buffer *buffer = view->buffer;
     char *deleted = xmalloc(len);
     size_t pos = 0;
     size_t deleted_nl = 0;
@@ -261,9 +275,10 @@ char *do_delete(View *view, size_t len, bool sanity_check_newlines)
         ListHead *next = blk->node.next;
         size_t avail = blk->size - offset;
         size_t count = MIN(len - pos, avail);
-        char *ptr = blk->data + offset;
-        size_t nl = copy_count_nl(deleted + pos, ptr, count);
+        size_t nl = copy_count_nl(deleted + pos, blk->data + offset, count);
         if (count < avail) {
+            block_make_writable(blk);
+            char *ptr = blk->data + offset;
             memmove(ptr, ptr + count, avail - count);
         }
 
@@ -273,6 +288,8 @@ char *do_delete(View *view, size_t len, bool sanity_check_newlines)
         blk->size -= count;
         if (!blk->size && !only_block(buffer, blk)) {
             block_free(blk);
+        } else {
+            block_counts_changed(blk);
         }
 
         offset = 0;
@@ -284,14 +301,14 @@ char *do_delete(View *view, size_t len, bool sanity_check_newlines)
     if (saved_prev_node) {
         // Cursor was at beginning of a block that was possibly deleted
         if (saved_prev_node->next == &buffer->blocks) {
-            view->cursor.blk = BLOCK(saved_prev_node);
-            view->cursor.offset = view->cursor.blk->size;
+            cursor->blk = BLOCK(saved_prev_node);
+            cursor->offset = cursor->blk->size;
         } else {
-            view->cursor.blk = BLOCK(saved_prev_node->next);
+            cursor->blk = BLOCK(saved_prev_node->next);
         }
     }
 
-    blk = view->cursor.blk;
+    blk = cursor->blk;
 
     if (
         blk->size
@@ -305,12 +322,32 @@ char *do_delete(View *view, size_t len, bool sanity_check_newlines)
         blk->size = size;
         blk->nl += next->nl;
         block_free(next);
+        block_counts_changed(blk);
+    }
+
+    *nlp = deleted_nl;
+    return deleted;
+}
+
+char *do_delete(View *view, size_t len, bool sanity_check_newlines)
+{
+    if (len == 0) {
+        return NULL;
     }
 
+    Buffer *buffer = view->buffer;
+    load_buffer_finish(buffer);
+    size_t deleted_nl;
+    char *deleted = delete_bytes(buffer, &view->cursor, len, &deleted_nl);
+
     sanity_check_blocks(view, sanity_check_newlines);
+    compact_blocks_from(buffer, view->cursor.blk);
 
     view_update_cursor_y(view);
     buffer_mark_lines_changed(buffer, view->cy, deleted_nl ? LONG_MAX : view->cy);
+    match_cache_edit(&buffer->match_cache, view->cy, deleted_nl, 0);
+    match_count_edit(&buffer->match_count, view->cy, deleted_nl, 0);
+    buffer->reverse_matches.generation = 0;
 
     if (buffer->syntax) {
         hl_delete(&buffer->line_start_states, view->cy, deleted_nl);
@@ -319,14 +356,22 @@ char *do_delete(View *view, size_t len, bool sanity_check_newlines)
     return deleted;
 }
 
-char *do_replace(View *view, size_t del, const char *buf, size_t ins)
-{
-    BUG_ON(del == 0);
-    BUG_ON(ins == 0);
-    block_iter_normalize(&view->cursor);
-
-    Block *blk = view->cursor.blk;
-    size_t offset = view->cursor.offset;
+// Replace `del` bytes at `cursor` with `ins` bytes of `buf` (both of
+// which must be non-zero) and return the deleted text, along with the
+// number of newlines deleted and inserted. Only the Blocks and
+// Buffer::nl are updated, as for delete_bytes().
+static char *replace_bytes (
+    Buffer *buffer,
+    BlockIter *cursor,
+    size_t del,
+    const char *buf,
+    size_t ins,
+    size_t *del_nlp,
+    size_t *ins_nlp
+) {
+    block_iter_normalize(cursor);
+    Block *blk = cursor->blk;
+    size_t offset = cursor->offset;
     size_t avail = blk->size - offset;
     if (del >= avail) {
         goto slow;
@@ -344,7 +389,6 @@ char *do_replace(View *view, size_t del, const char *buf, size_t ins)
     block_grow(blk, new_size);
 
     // Modification is limited to one block
-    Buffer *buffer = view->buffer;
     char *ptr = blk->data + offset;
     char *deleted = xmalloc(del);
     size_t del_nl = copy_count_nl(deleted, ptr, del);
@@ -359,27 +403,195 @@ char *do_replace(View *view, size_t del, const char *buf, size_t ins)
     blk->nl += ins_nl;
     buffer->nl += ins_nl;
     blk->size = new_size;
-    sanity_check_blocks(view, true);
-    view_update_cursor_y(view);
+    block_counts_changed(blk);
+    *del_nlp = del_nl;
+    *ins_nlp = ins_nl;
+    return deleted;
+
+slow:
+    // This may remove a terminating newline that insert_bytes() is
+    // going to insert again at a different position (see do_replace())
+    deleted = delete_bytes(buffer, cursor, del, del_nlp);
+    *ins_nlp = insert_bytes(cursor, buf, ins);
+    buffer->nl += *ins_nlp;
+    return deleted;
+}
+
+// Update the line-based state of the Buffer after
+// an edit that started on `line` and replaced `del_nl` newlines with
+// `ins_nl` newlines
+static void lines_replaced(View *view, long line, size_t del_nl, size_t ins_nl)
+{
+    Buffer *buffer = view->buffer;
 
     // If the number of inserted and removed bytes are the same, some
     // line(s) changed but the lines after them didn't move up or down
-    long max = (del_nl == ins_nl) ? view->cy + del_nl : LONG_MAX;
-    buffer_mark_lines_changed(buffer, view->cy, max);
+    long max = (del_nl == ins_nl) ? line + del_nl : LONG_MAX;
+    buffer_mark_lines_changed(buffer, line, max);
+    match_cache_edit(&buffer->match_cache, line, del_nl, ins_nl);
+    match_count_edit(&buffer->match_count, line, del_nl, ins_nl);
+    buffer->reverse_matches.generation = 0;
 
     if (buffer->syntax) {
-        hl_delete(&buffer->line_start_states, view->cy, del_nl);
-        hl_insert(&buffer->line_start_states, view->cy, ins_nl);
+        hl_delete(&buffer->line_start_states, line, del_nl);
+        hl_insert(&buffer->line_start_states, line, ins_nl);
     }
+}
 
-    return deleted;
+char *do_replace(View *view, size_t del, const char *buf, size_t ins)
+{
+    BUG_ON(del == 0);
+    BUG_ON(ins == 0);
+    Buffer *buffer = view->buffer;
+    load_buffer_finish(buffer);
 
-slow:
-    // The "sanity_check_newlines" argument of do_delete() is false here
-    // because it may be removing a terminating newline that do_insert()
-    // is going to insert again at a different position:
-    deleted = do_delete(view, del, false);
-    BUG_ON(!deleted); // do_delete() only returns NULL if len is 0
-    do_insert(view, buf, ins);
+    size_t del_nl, ins_nl;
+    char *deleted = replace_bytes(buffer, &view->cursor, del, buf, ins, &del_nl, &ins_nl);
+    sanity_check_blocks(view, true);
+    compact_blocks_from(buffer, view->cursor.blk);
+    view_update_cursor_y(view);
+    lines_replaced(view, view->cy, del_nl, ins_nl);
     return deleted;
 }
+
+/*
+ * Apply `n` edits, which must be sorted by TextEdit::offset and must not
+ * overlap, in one forward pass over the Blocks. Only the Blocks at each
+ * edit are modified and the unchanged text in between is skipped over
+ * (via the Block index, where it spans multiple Blocks), rather than
+ * being copied. The line-based state of the Buffer is then updated once,
+ * for the lines from the first edit to the last. The text removed by
+ * each edit is returned in TextEdit::deleted and the cursor is left
+ * after the text inserted by the last one.
+ */
+void do_edits(View *view, TextEdit *edits, size_t n)
+{
+    BUG_ON(n == 0);
+    Buffer *buffer = view->buffer;
+    load_buffer_finish(buffer);
+
+    BlockIter *cursor = &view->cursor;
+    const size_t start = edits[0].offset;
+    block_iter_goto_offset(cursor, start);
+    view_update_cursor_y(view);
+    const long first_line = view->cy;
+
+    size_t pos = start; // Offset of `cursor`, before any of the edits
+    size_t added = 0; // Bytes inserted by the edits so far
+    size_t removed = 0; // Bytes deleted by the edits so far
+    size_t del_total = 0; // Newlines removed by all edits
+    size_t ins_total = 0; // Newlines inserted by all edits
+
+    for (size_t i = 0; i < n; i++) {
+        TextEdit *edit = &edits[i];
+        BUG_ON(edit->offset < pos);
+        BUG_ON(!edit->del_count && !edit->ins_count);
+        size_t gap = edit->offset - pos;
+        if (gap <= cursor->blk->size - cursor->offset) {
+            cursor->offset += gap;
+        } else {
+            block_iter_goto_offset(cursor, edit->offset + added - removed);
+        }
+
+        size_t del_nl = 0;
+        size_t ins_nl = 0;
+        const size_t del = edit->del_count;
+        const size_t ins = edit->ins_count;
+        if (del && ins) {
+            edit->deleted = replace_bytes(buffer, cursor, del, edit->ins, ins, &del_nl, &ins_nl);
+        } else if (del) {
+            edit->deleted = delete_bytes(buffer, cursor, del, &del_nl);
+        } else {
+            edit->deleted = NULL;
+            ins_nl = insert_bytes(cursor, edit->ins, ins);
+            buffer->nl += ins_nl;
+        }
+
+        block_iter_skip_bytes(cursor, ins);
+        del_total += del_nl;
+        ins_total += ins_nl;
+        pos = edit->offset + del;
+        added += ins;
+        removed += del;
+    }
+
+    sanity_check_blocks(view, true);
+    buffer->compact_offset = MIN(buffer->compact_offset, start); // See compact_blocks_from()
+
+    // The newlines between the first edit and the end of the last one,
+    // both before and after the edits (including any unchanged ones in
+    // between)
+    view_update_cursor_y(view);
+    size_t new_nl = view->cy - first_line;
+    size_t old_nl = new_nl - ins_total + del_total;
+    lines_replaced(view, first_line, old_nl, new_nl);
+}
+
+// Merge the Block after `blk` into `blk` and return the number of
+// allocated bytes released by doing so
+static size_t merge_next_block(BlockIter *cursor, Block *blk)
+{
+    Block *next = BLOCK(blk->node.next);
+    size_t size = blk->size;
+    size_t alloc = blk->alloc + next->alloc;
+    block_grow(blk, size + next->size);
+    memcpy(blk->data + size, next->data, next->size);
+    blk->size += next->size;
+    blk->nl += next->nl;
+
+    if (cursor->blk == next) {
+        cursor->blk = blk;
+        cursor->offset += size;
+    }
+
+    block_free(next);
+    block_counts_changed(blk);
+    BUG_ON(blk->alloc > alloc);
+    return alloc - blk->alloc;
+}
+
+/*
+ * Incrementally undo the fragmentation caused by editing, by merging
+ * runs of adjacent Blocks that fit within BLOCK_EDIT_SIZE and shrinking
+ * over-allocated Blocks. At most `max_blocks` Blocks are visited per
+ * call, starting from Buffer::compact_offset (which is lowered to the
+ * position of each edit by the functions above). Blocks referencing a
+ * file mapping are skipped, since merging them would mean copying data
+ * that's never been edited. The totals reclaimed are reported by
+ * buffer_count_blocks_and_bytes(). Returns true if there's more to do.
+ */
+bool compact_blocks(View *view, size_t max_blocks)
+{
+    Buffer *buffer = view->buffer;
+    size_t offset = buffer->compact_offset;
+    if (offset == SIZE_MAX || buffer->loader) {
+        return false;
+    }
+
+    const ListHead *head = &buffer->blocks;
+    Block *blk = block_find_offset(BLOCK(head->next), &offset);
+    for (size_t n = 0; n < max_blocks; n++) {
+        if (!blk->mapping) {
+            while (blk->node.next != head) {
+                const Block *next = BLOCK(blk->node.next);
+                if (next->mapping || blk->size + next->size > BLOCK_EDIT_SIZE) {
+                    break;
+                }
+                buffer->compacted_bytes += merge_next_block(&view->cursor, blk);
+                buffer->compacted_blocks++;
+            }
+            buffer->compacted_bytes += block_shrink_to_fit(blk);
+        }
+
+        if (blk->node.next == head) {
+            buffer->compact_offset = SIZE_MAX;
+            sanity_check_blocks(view, true);
+            return false;
+        }
+        blk = BLOCK(blk->node.next);
+    }
+
+    buffer->compact_offset = block_get_offset(blk);
+    sanity_check_blocks(view, true);
+    return true;
+}
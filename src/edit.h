@@ -6,8 +6,20 @@
 #include "util/macros.h"
 #include "view.h"
 
+// A replacement of `del_count` bytes at `offset` with `ins_count` bytes
+// of `ins`, as applied by do_edits()
+typedef struct {
+    size_t offset; // Offset of the edit, before any of the edits are applied
+    size_t del_count;
+    const char *ins;
+    size_t ins_count;
+    char *deleted; // The text removed by the edit (set by do_edits())
+} TextEdit;
+
 void do_insert(View *view, const char *buf, size_t len) NONNULL_ARG(1);
 char *do_delete(View *view, size_t len, bool sanity_check_newlines) NONNULL_ARGS;
 char *do_replace(View *view, size_t del, const char *buf, size_t ins) NONNULL_ARGS_AND_RETURN;
+void do_edits(View *view, TextEdit *edits, size_t n) NONNULL_ARGS;
+bool compact_blocks(View *view, size_t max_blocks) NONNULL_ARGS;
 
 #endif
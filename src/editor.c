@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <langinfo.h>
 #include <locale.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -9,11 +10,14 @@
 #include "bind.h"
 #include "bookmark.h"
 #include "compiler.h"
+#include "edit.h"
 #include "encoding.h"
 #include "file-option.h"
 #include "filetype.h"
+#include "load-save.h"
 #include "lock.h"
 #include "signals.h"
+#include "syntax/highlight.h"
 #include "syntax/syntax.h"
 #include "terminal/color.h"
 #include "terminal/input.h"
@@ -124,23 +128,29 @@ EditorState *init_editor_state(const char *home, const char *dte_home)
             .ws_error = WSE_SPECIAL,
 
             // Global-only options
+            .async_load_threshold = 0, // Disabled
             .case_sensitive_search = CSS_TRUE,
             .crlf_newlines = false,
             .display_special = false,
             .esc_timeout = 100,
             .filesize_limit = 250ULL << 20, // 250MiB
+            .highlight_search = false,
             .lock_files = true,
+            .mmap_threshold = 0, // Disabled
             .msg_compile = 0,
             .msg_tag = 0,
             .optimize_true_color = true,
+            .persistent_undo = false,
             .scroll_margin = 0,
             .select_cursor_char = true,
             .set_window_title = false,
             .show_line_numbers = false,
             .statusline_left = str_intern(" %f%s%m%s%r%s%M"),
             .statusline_right = str_intern(" %y,%X  %u  %o  %E%s%b%s%n %t   %p "),
+            .syntax_cache = false,
             .syntax_line_limit = 512ULL << 10, // 512KiB
             .tab_bar = true,
+            .undo_memory_limit = 128ULL << 20, // 128MiB
             .utf8_bom = false,
             .window_separator = WINSEP_BAR,
         }
@@ -229,6 +239,9 @@ void free_editor_state(EditorState *e)
     history_free(&e->command_history);
     history_free(&e->search_history);
     search_free_regexp(&e->search);
+    if (e->grep) {
+        grep_free(e->grep);
+    }
     clear_all_messages(e);
     cmdline_free(&e->cmdline);
     free_macro(&e->macro);
@@ -246,6 +259,7 @@ void free_editor_state(EditorState *e)
 
     free_interned_strings();
     free_interned_regexps();
+    free_cached_regexps();
     free(e);
 }
 
@@ -371,6 +385,123 @@ static void log_timing_info(const struct timespec *start, bool enabled)
     LOG_INFO("main loop time: %.3f ms", ms);
 }
 
+// Load more of the current Buffer, if it's still being loaded (see
+// load_buffer_continue()) and there's no pending input to be handled
+// first. Returns true if anything was loaded.
+static bool continue_async_load(EditorState *e)
+{
+    Buffer *buffer = e->buffer;
+    if (likely(!buffer->loader) || term_input_pending(&e->terminal)) {
+        return false;
+    }
+
+    const ScreenState s = get_screen_state(e);
+    load_buffer_continue(buffer, 4 << 20);
+    buffer_mark_tabbars_changed(buffer);
+    update_screen(e, &s);
+    return true;
+}
+
+// Continue defragmenting the Blocks of the current Buffer (see
+// compact_blocks()), if there's no pending input
+static bool continue_compaction(EditorState *e)
+{
+    if (likely(e->buffer->compact_offset == SIZE_MAX) || term_input_pending(&e->terminal)) {
+        return false;
+    }
+    return compact_blocks(e->view, 256);
+}
+
+// Continue counting the matches of the most recent search pattern in
+// the current Buffer (see match_count_continue()), if there's no pending
+// input, so that the "[N/M]" status (see add_search_position()) never
+// delays handling of input
+static bool continue_match_count(EditorState *e)
+{
+    Buffer *buffer = e->buffer;
+    MatchCount *mc = &buffer->match_count;
+    SearchState *search = &e->search;
+    if (likely(!mc->enabled) || term_input_pending(&e->terminal)) {
+        return false;
+    }
+
+    const regex_t *re = search_get_regex(search);
+    if (!re || !match_count_pending(mc, search->generation, buffer->nl)) {
+        return false;
+    }
+
+    const ScreenState s = get_screen_state(e);
+    BlockIter bof = block_iter(buffer);
+    match_count_continue(mc, re, search->pattern, search->generation, bof, buffer->nl, 1 << 20);
+    update_screen(e, &s);
+    return true;
+}
+
+// Continue the search started by the "grep" command (see grep_continue()),
+// if there's no pending input and it can make progress without waiting
+// for its worker threads (which instead wake up main_loop() when they
+// have more results). The first result is activated as soon as it's
+// found, so that it can be viewed (and the rest navigated) while the
+// search continues. The screen is only updated when results are added.
+static bool continue_grep(EditorState *e)
+{
+    GrepSearch *gs = e->grep;
+    if (likely(!gs) || !grep_is_ready(gs) || term_input_pending(&e->terminal)) {
+        return false;
+    }
+
+    const ScreenState s = get_screen_state(e);
+    MessageList *msgs = grep_get_messages(gs);
+    size_t count = msgs->array.count;
+    bool running = grep_continue(gs, 0);
+
+    if (running && msgs->array.count == count) {
+        return true; // Nothing to redraw
+    }
+
+    if (count == 0 && msgs->array.count > 0) {
+        activate_current_message_save(msgs, &e->bookmarks, e->view, &e->err);
+    }
+
+    if (!running) {
+        if (msgs->array.count == 0) {
+            error_msg(&e->err, "Pattern '%s' not found", grep_get_pattern(gs));
+        }
+        grep_free(gs);
+        e->grep = NULL;
+    }
+
+    update_screen(e, &s);
+    return true;
+}
+
+// Continue filling in the syntax highlighting start states of the
+// current Buffer, up to the line requested by update_range(), if there's
+// no pending input. Any lines drawn with provisional styles in the
+// meantime are redrawn once it's finished.
+static bool continue_highlight(EditorState *e)
+{
+    Buffer *buffer = e->buffer;
+    if (likely(buffer->hl_target == 0) || term_input_pending(&e->terminal)) {
+        return false;
+    }
+
+    const ScreenState s = get_screen_state(e);
+    LineStates *lss = &buffer->line_start_states;
+    size_t line_nr = MIN(buffer->hl_target, buffer->nl);
+    BlockIter bi = block_iter(buffer);
+    if (hl_fill_start_states(buffer->syntax, lss, &e->styles, &bi, line_nr, 1 << 20)) {
+        buffer->hl_target = 0;
+        if (buffer->hl_provisional) {
+            buffer->hl_provisional = false;
+            mark_all_lines_changed(buffer);
+        }
+    }
+
+    update_screen(e, &s);
+    return true;
+}
+
 void main_loop(EditorState *e, unsigned int terminal_query_level, bool timing)
 {
     BUG_ON(e->flags & EFLAG_HEADLESS);
@@ -382,6 +513,25 @@ void main_loop(EditorState *e, unsigned int terminal_query_level, bool timing)
             ui_resize(e);
         }
 
+        if (unlikely(
+            continue_async_load(e)
+            || continue_compaction(e)
+            || continue_match_count(e)
+            || continue_grep(e)
+            || continue_highlight(e)
+        )) {
+            continue;
+        }
+
+        if (unlikely(e->grep)) {
+            // Wait for input or for more results, whichever comes first
+            // (see grep_get_wakeup_fd())
+            int fd = grep_get_wakeup_fd(e->grep);
+            if (!term_wait_for_input(&e->terminal, fd)) {
+                continue;
+            }
+        }
+
         KeyCode key = term_read_input(&e->terminal, e->options.esc_timeout);
         if (unlikely(key == KEY_NONE)) {
             continue;
@@ -13,6 +13,7 @@
 #include "copy.h"
 #include "file-history.h"
 #include "frame.h"
+#include "grep.h"
 #include "history.h"
 #include "lock.h"
 #include "mode.h"
@@ -110,6 +111,7 @@ typedef struct EditorState {
     PointerArray file_options;
     PointerArray bookmarks;
     MessageList messages[3];
+    GrepSearch *grep; // In-progress "grep" command (see continue_grep()), or NULL
     FileHistory file_history;
     History search_history;
     History command_history;
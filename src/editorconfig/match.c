@@ -222,15 +222,14 @@ bool ec_pattern_match(StringView section, StringView dir, const char *path)
 {
     String re_str = ec_pattern_to_regex(section, dir);
     int flags = REG_EXTENDED | REG_NOSUB;
-    regex_t re;
-    bool compiled = !regcomp(&re, string_borrow_cstring(&re_str), flags);
+    const regex_t *re = regexp_cache_get(NULL, string_borrow_cstring(&re_str), flags);
     string_free(&re_str);
 
-    if (!compiled) {
+    if (!re) {
         return false;
     }
 
-    bool match = !regexec(&re, path, 0, NULL, 0);
-    regfree(&re);
+    bool match = !regexec(re, path, 0, NULL, 0);
+    regexp_cache_release(re);
     return match;
 }
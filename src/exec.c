@@ -10,6 +10,7 @@
 #include "commands.h"
 #include "ctags.h"
 #include "editor.h"
+#include "load-save.h"
 #include "move.h"
 #include "msg.h"
 #include "selection.h"
@@ -295,6 +296,7 @@ ssize_t handle_exec (
         break;
     case EXEC_BUFFER:
         input_from_buffer = true;
+        load_buffer_finish(view->buffer);
         if (!view->selection) {
             const Block *blk;
             block_for_each(blk, &view->buffer->blocks) {
@@ -151,6 +151,15 @@ void file_history_free(FileHistory *history)
     history->last = NULL;
 }
 
+size_t file_history_memory_usage(const FileHistory *history)
+{
+    size_t total = hashmap_memory_usage(&history->entries);
+    for (const FileHistoryEntry *e = history->first; e; e = e->next) {
+        total += sizeof(*e) + strlen(e->filename) + 1;
+    }
+    return total;
+}
+
 String file_history_dump(const FileHistory *history)
 {
     size_t nr_entries = history->entries.count;
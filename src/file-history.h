@@ -28,6 +28,7 @@ void file_history_save(const FileHistory *hist, ErrorBuffer *ebuf) NONNULL_ARG(1
 bool file_history_find(const FileHistory *hist, const char *filename, unsigned long *row, unsigned long *col) NONNULL_ARGS WARN_UNUSED_RESULT;
 void file_history_free(FileHistory *history) NONNULL_ARGS;
 String file_history_dump(const FileHistory *history) NONNULL_ARGS;
+size_t file_history_memory_usage(const FileHistory *history) NONNULL_ARGS;
 String file_history_dump_relative(const FileHistory *history) NONNULL_ARGS;
 
 #endif
@@ -0,0 +1,814 @@
+#include "build-defs.h"
+#include "buildvar-threads.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "grep.h"
+#include "bookmark.h"
+#include "regexp.h"
+#include "util/arith.h"
+#include "util/ascii.h"
+#include "util/count-nl.h"
+#include "util/fd.h"
+#include "util/parallel.h"
+#include "util/path.h"
+#include "util/ptr-array.h"
+#include "util/xdirent.h"
+#include "util/xmalloc.h"
+#include "util/xmemmem.h"
+#include "util/xmemrchr.h"
+#include "util/xreadwrite.h"
+#include "util/xstring.h"
+
+#if THREADS_DISABLE == 0
+    #include <pthread.h>
+#endif
+
+/*
+ * A search is driven by grep_continue(), which is called repeatedly by
+ * the main loop while it's idle (see continue_grep()), or in a loop by
+ * grep_paths(). It walks the directory tree a few directories at a time,
+ * appending the files found to a queue, from which they're taken by a
+ * pool of worker threads that lasts for the duration of the search. The
+ * walk therefore overlaps with the searching and the editor stays
+ * responsive, while the search can be cancelled at any time (see
+ * grep_free()).
+ *
+ * Each file is mapped into memory and matched as a whole, instead of
+ * line by line. The Messages for each file are added to the MessageList
+ * by grep_continue(), in the order the files were found, so the results
+ * don't depend on how the work was divided between threads. If no
+ * threads can be used, grep_continue() searches a few files itself on
+ * each call instead.
+ *
+ * While grep_continue() has nothing to do but wait for the workers, the
+ * main loop instead waits for input on the terminal and on the pipe
+ * returned by grep_get_wakeup_fd(), which is written to by the workers
+ * when the file at the head of the queue is done (see wake_main_loop()).
+ */
+
+enum {
+    GREP_QUEUE_MAX = 4096, // Max. number of files queued, before the walk waits for results to be taken
+    GREP_WALK_DIRS = 256, // Max. number of directories read per grep_continue() call
+    GREP_SERIAL_FILES = 32, // Number of files searched per grep_continue() call, without threads
+    GREP_BINARY_PROBE = 8192, // Files with a NUL byte in this many initial bytes are skipped
+    GREP_MAX_MSG_LEN = 256, // Max. number of bytes of the matching line used for each Message
+};
+
+// Without REG_STARTEND, regexp_exec() makes a copy of the text it's
+// given, so the amount of text searched per call is limited to roughly
+// this many bytes (rounded up to the end of a line)
+#define CHUNK_MAX (HAVE_REG_STARTEND ? SIZE_MAX : 256)
+
+typedef enum {
+    ENTRY_OTHER,
+    ENTRY_FILE,
+    ENTRY_DIR,
+} EntryType;
+
+typedef struct {
+    char *pattern;
+    int re_flags;
+    char *literal; // Unescaped `pattern` (see regexp_get_literal()), or NULL
+    size_t literal_len;
+    bool icase;
+} GrepPattern;
+
+typedef struct GrepFile {
+    struct GrepFile *next;
+    PointerArray results; // Messages for the matching lines
+    bool done; // Whether the file has been searched
+    char path[];
+} GrepFile;
+
+struct GrepSearch {
+    GrepPattern pattern;
+    MessageList *msgs;
+    PointerArray paths; // Paths given to grep_start(), not yet walked (in reverse order)
+    PointerArray dirs; // Directories not yet walked (in reverse order)
+    GrepFile *head; // Oldest file with Messages not yet added to `msgs` (or NULL)
+    GrepFile *tail; // Most recently found file (or NULL)
+    GrepFile *next_job; // Oldest file not yet taken by a worker (or NULL)
+    size_t nr_files; // Number of files from `head` to `tail`
+    ThreadGroup *workers; // Or NULL, if files are searched by grep_continue()
+    bool walking; // Whether walk_more() has parts of the tree left to walk
+    bool cancel; // Whether the workers should exit
+    bool woken; // Whether a byte has been written to `wakeup_fd[1]` and not yet read
+    int wakeup_fd[2]; // See grep_get_wakeup_fd()
+#if THREADS_DISABLE == 0
+    // Protects the links between files (other than `head` and `tail`),
+    // `next_job`, GrepFile::done, `cancel` and `woken`
+    pthread_mutex_t mutex;
+    pthread_cond_t job_added;
+    pthread_cond_t job_done;
+#endif
+};
+
+// Like is_dir_or_symlink_to_dir(), but symlinks to directories aren't
+// followed, since they could lead to cycles
+static EntryType get_entry_type(const struct dirent *ent, int dir_fd)
+{
+#if HAVE_DIRENT_D_TYPE
+    switch (ent->d_type) {
+        case DT_UNKNOWN: break; // Extra syscall needed for type info
+        case DT_LNK: break; // Symlink (extra syscall needed to follow)
+        case DT_REG: return ENTRY_FILE;
+        case DT_DIR: return ENTRY_DIR;
+        default: return ENTRY_OTHER;
+    }
+#endif
+
+    struct stat st;
+    if (fstatat(dir_fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return ENTRY_OTHER;
+    }
+
+    if (S_ISLNK(st.st_mode)) {
+        bool ok = (fstatat(dir_fd, ent->d_name, &st, 0) == 0);
+        return (ok && S_ISREG(st.st_mode)) ? ENTRY_FILE : ENTRY_OTHER;
+    }
+
+    return S_ISREG(st.st_mode) ? ENTRY_FILE : (S_ISDIR(st.st_mode) ? ENTRY_DIR : ENTRY_OTHER);
+}
+
+// Find the first match in `text`, starting at `pos` (which must be the
+// start of a line), with the offsets in `m` being relative to `text`
+static bool find_next (
+    const GrepPattern *gp,
+    const regex_t *re,
+    const char *text,
+    size_t len,
+    size_t pos,
+    regmatch_t *m
+) {
+    if (!re) {
+        const char *s = gp->literal;
+        size_t n = gp->literal_len;
+        const char *found = (len - pos < n) ? NULL
+            : gp->icase ? xmemmem_icase(text + pos, len - pos, s, n)
+            : xmemmem(text + pos, len - pos, s, n);
+        if (!found) {
+            return false;
+        }
+        m->rm_so = found - text;
+        m->rm_eo = m->rm_so + n;
+        return true;
+    }
+
+    while (pos < len) {
+        size_t n = len - pos;
+        if (n > CHUNK_MAX) {
+            const char *eol = memchr(text + pos + CHUNK_MAX - 1, '\n', n - (CHUNK_MAX - 1));
+            n = eol ? (size_t)(eol - (text + pos)) + 1 : n;
+        }
+
+        // The position after a final newline belongs to the next chunk
+        // (or to no line at all, at the end of the file)
+        bool complete = (text[pos + n - 1] == '\n');
+        int eflags = complete ? REG_NOTEOL : 0;
+        if (
+            regexp_exec(re, text + pos, n, 1, m, eflags)
+            && (size_t)m->rm_so < n
+        ) {
+            m->rm_so += pos;
+            m->rm_eo += pos;
+            return true;
+        }
+        pos += n;
+    }
+
+    return false;
+}
+
+static size_t count_columns(const char *buf, size_t len)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        n += ((unsigned char)buf[i] & 0xC0) != 0x80;
+    }
+    return n;
+}
+
+static Message *new_grep_message(const char *path, const char *line, size_t len, size_t line_nr, size_t col)
+{
+    len -= (len && line[len - 1] == '\r');
+    size_t n = len;
+    while (n && ascii_isblank(line[0])) {
+        line++;
+        n--;
+    }
+
+    if (n > GREP_MAX_MSG_LEN) {
+        // Truncate, without splitting a UTF-8 sequence
+        n = GREP_MAX_MSG_LEN;
+        while (n && ((unsigned char)line[n] & 0xC0) == 0x80) {
+            n--;
+        }
+    }
+
+    Message *m = new_message(line, n);
+    m->loc = new_file_location(xstrdup(path), 0, line_nr, col);
+    return m;
+}
+
+static void grep_text (
+    const GrepPattern *gp,
+    const regex_t *re,
+    const char *path,
+    const char *text,
+    size_t len,
+    PointerArray *results
+) {
+    size_t line_nr = 1;
+    size_t counted = 0; // Offset up to which newlines have been counted in `line_nr`
+    regmatch_t m;
+
+    for (size_t pos = 0; pos < len && find_next(gp, re, text, len, pos, &m); ) {
+        size_t so = m.rm_so;
+        const char *sol = xmemrchr(text + pos, '\n', so - pos);
+        const char *eol = memchr(text + so, '\n', len - so);
+        size_t line_start = sol ? (size_t)(sol - text) + 1 : pos;
+        size_t line_end = eol ? (size_t)(eol - text) : len;
+        const char *line = text + line_start;
+        pos = line_end + 1;
+
+        if ((size_t)m.rm_eo > line_end) {
+            // The match spans a newline (e.g. via "[[:space:]]"), so
+            // search only the line where it started, as if the text
+            // had been split into lines
+            if (!regexp_exec(re, line, line_end - line_start, 1, &m, 0)) {
+                continue;
+            }
+            so = line_start + m.rm_so;
+        }
+
+        line_nr += count_nl(text + counted, line_start - counted);
+        counted = line_start;
+        size_t col = count_columns(line, so - line_start) + 1;
+        size_t line_len = line_end - line_start;
+        ptr_array_append(results, new_grep_message(path, line, line_len, line_nr, col));
+    }
+}
+
+static void grep_file(const GrepPattern *gp, const regex_t *re, const char *path, PointerArray *results)
+{
+    int fd = xopen(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        xclose(fd);
+        return;
+    }
+
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    xclose(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+
+    const char *text = map;
+    if (!memchr(text, '\0', MIN(size, GREP_BINARY_PROBE))) {
+        grep_text(gp, re, path, text, size, results);
+    }
+
+    munmap(map, size);
+}
+
+#if THREADS_DISABLE == 0
+static void lock(GrepSearch *gs)
+{
+    pthread_mutex_lock(&gs->mutex);
+}
+
+static void unlock(GrepSearch *gs)
+{
+    pthread_mutex_unlock(&gs->mutex);
+}
+
+// Wait until a worker has finished searching a file, or until
+// `timeout_ms` milliseconds have passed
+static void wait_for_job_done(GrepSearch *gs, unsigned int timeout_ms)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        return;
+    }
+
+    unsigned long ns = ts.tv_nsec + (timeout_ms % 1000) * 1000000UL;
+    ts.tv_sec += timeout_ms / 1000 + ns / 1000000000UL;
+    ts.tv_nsec = ns % 1000000000UL;
+    pthread_cond_timedwait(&gs->job_done, &gs->mutex, &ts);
+}
+
+// Make `wakeup_fd[0]` readable, if it isn't already, so that the main
+// loop calls grep_continue() again (called with `mutex` locked)
+static void wake_main_loop(GrepSearch *gs)
+{
+    if (!gs->woken) {
+        gs->woken = (xwrite(gs->wakeup_fd[1], "", 1) == 1);
+    }
+}
+
+static void grep_worker(void *data)
+{
+    GrepSearch *gs = data;
+    const GrepPattern *gp = &gs->pattern;
+    regex_t re;
+    const regex_t *rp = NULL;
+
+    // Each worker uses its own regex_t, since regexec(3) may lock it
+    // (e.g. in glibc), which would serialize the threads sharing it.
+    // The pattern has already been validated by grep_start(), but if
+    // compiling fails anyway, the files are still marked as done (with
+    // no results), so that grep_continue() doesn't wait for them.
+    bool ok = !!gp->literal;
+    if (!ok && regexp_compile(NULL, &re, gp->pattern, gp->re_flags)) {
+        rp = &re;
+        ok = true;
+    }
+
+    lock(gs);
+    while (!gs->cancel) {
+        GrepFile *file = gs->next_job;
+        if (!file) {
+            pthread_cond_wait(&gs->job_added, &gs->mutex);
+            continue;
+        }
+
+        gs->next_job = file->next;
+        unlock(gs);
+        if (ok) {
+            grep_file(gp, rp, file->path, &file->results);
+        }
+        lock(gs);
+        file->done = true;
+        pthread_cond_signal(&gs->job_done);
+        if (file == gs->head) {
+            // Files after the head can't be added to the MessageList yet,
+            // so only this one makes it worth waking the main loop
+            wake_main_loop(gs);
+        }
+    }
+    unlock(gs);
+
+    if (rp) {
+        regfree(&re);
+    }
+}
+
+static void close_wakeup_pipe(GrepSearch *gs)
+{
+    xclose(gs->wakeup_fd[0]);
+    xclose(gs->wakeup_fd[1]);
+    gs->wakeup_fd[0] = -1;
+    gs->wakeup_fd[1] = -1;
+}
+
+static void start_workers(GrepSearch *gs)
+{
+    int fds[2];
+    if (xpipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        return;
+    }
+
+    gs->wakeup_fd[0] = fds[0];
+    gs->wakeup_fd[1] = fds[1];
+    if (pthread_mutex_init(&gs->mutex, NULL) != 0) {
+        close_wakeup_pipe(gs);
+        return;
+    }
+    if (pthread_cond_init(&gs->job_added, NULL) != 0) {
+        pthread_mutex_destroy(&gs->mutex);
+        close_wakeup_pipe(gs);
+        return;
+    }
+    if (pthread_cond_init(&gs->job_done, NULL) != 0) {
+        pthread_cond_destroy(&gs->job_added);
+        pthread_mutex_destroy(&gs->mutex);
+        close_wakeup_pipe(gs);
+        return;
+    }
+
+    gs->workers = start_threads(grep_worker, gs, get_nr_cpus());
+    if (!gs->workers) {
+        pthread_cond_destroy(&gs->job_done);
+        pthread_cond_destroy(&gs->job_added);
+        pthread_mutex_destroy(&gs->mutex);
+        close_wakeup_pipe(gs);
+    }
+}
+
+static void stop_workers(GrepSearch *gs)
+{
+    if (!gs->workers) {
+        return;
+    }
+
+    lock(gs);
+    gs->cancel = true;
+    pthread_cond_broadcast(&gs->job_added);
+    unlock(gs);
+
+    join_threads(gs->workers);
+    gs->workers = NULL;
+    pthread_cond_destroy(&gs->job_done);
+    pthread_cond_destroy(&gs->job_added);
+    pthread_mutex_destroy(&gs->mutex);
+    close_wakeup_pipe(gs);
+}
+
+#else
+
+// Without threads, `workers` is always NULL and GrepSearch is never
+// accessed concurrently
+static void lock(GrepSearch* UNUSED_ARG(gs)) {}
+static void unlock(GrepSearch* UNUSED_ARG(gs)) {}
+static void wait_for_job_done(GrepSearch* UNUSED_ARG(gs), unsigned int UNUSED_ARG(timeout_ms)) {}
+static void start_workers(GrepSearch* UNUSED_ARG(gs)) {}
+static void stop_workers(GrepSearch* UNUSED_ARG(gs)) {}
+
+#endif
+
+// Append the list of `n` files from `first` to `last` to the queue
+static void add_files(GrepSearch *gs, GrepFile *first, GrepFile *last, size_t n)
+{
+    lock(gs);
+    if (gs->tail) {
+        gs->tail->next = first;
+    } else {
+        gs->head = first;
+    }
+    if (!gs->next_job) {
+        gs->next_job = first;
+    }
+#if THREADS_DISABLE == 0
+    if (gs->workers) {
+        pthread_cond_broadcast(&gs->job_added);
+    }
+#endif
+    unlock(gs);
+    gs->tail = last;
+    gs->nr_files += n;
+}
+
+static GrepFile *new_grep_file(const char *path, size_t len)
+{
+    GrepFile *file = xmalloc(xadd3(sizeof(*file), len, 1));
+    file->next = NULL;
+    file->results = (PointerArray)PTR_ARRAY_INIT;
+    file->done = false;
+    memcpy(file->path, path, len + 1);
+    return file;
+}
+
+static void free_grep_file(GrepFile *file)
+{
+    ptr_array_free_cb(&file->results, FREE_FUNC(free_message));
+    free(file);
+}
+
+static int path_cmp(const void *v1, const void *v2)
+{
+    const char *const *p1 = v1;
+    const char *const *p2 = v2;
+    return strcmp(*p1, *p2);
+}
+
+// Queue the files in `dir` (which may be empty, for the working directory)
+// and add its subdirectories to GrepSearch::dirs, excluding hidden ones
+// (as for the completion of filenames)
+static void walk_dir(GrepSearch *gs, const char *dir)
+{
+    DIR *const d = xopendir(dir[0] ? dir : ".");
+    if (!d) {
+        return;
+    }
+
+    const int dir_fd = dirfd(d);
+    if (unlikely(dir_fd < 0)) {
+        xclosedir(d);
+        return;
+    }
+
+    PointerArray files = PTR_ARRAY_INIT;
+    PointerArray subdirs = PTR_ARRAY_INIT;
+    for (const struct dirent *de; (de = xreaddir(d)); ) {
+        const char *name = de->d_name;
+        if (name[0] == '.' || is_ignored_dir_entry(strview(name))) {
+            continue;
+        }
+        switch (get_entry_type(de, dir_fd)) {
+        case ENTRY_FILE:
+            ptr_array_append(&files, path_join(dir, name));
+            break;
+        case ENTRY_DIR:
+            ptr_array_append(&subdirs, path_join(dir, name));
+            break;
+        case ENTRY_OTHER:
+            break;
+        }
+    }
+
+    xclosedir(d);
+    ptr_array_sort(&files, path_cmp);
+    ptr_array_sort(&subdirs, path_cmp);
+
+    GrepFile *first = NULL;
+    GrepFile *last = NULL;
+    for (size_t i = 0, n = files.count; i < n; i++) {
+        const char *path = files.ptrs[i];
+        GrepFile *file = new_grep_file(path, strlen(path));
+        if (last) {
+            last->next = file;
+        } else {
+            first = file;
+        }
+        last = file;
+    }
+
+    if (first) {
+        add_files(gs, first, last, files.count);
+    }
+    ptr_array_free(&files);
+
+    // Subdirectories are walked in order (and before any directories
+    // already found), so they're added to the stack in reverse order
+    for (size_t n = subdirs.count, i = n - 1; i < n; i--) {
+        ptr_array_append(&gs->dirs, subdirs.ptrs[i]);
+    }
+    ptr_array_free_array(&subdirs);
+}
+
+static char *pop_path(PointerArray *stack)
+{
+    return stack->count ? stack->ptrs[--stack->count] : NULL;
+}
+
+// Walk more of the directory tree, until GREP_QUEUE_MAX files are queued
+// or GREP_WALK_DIRS directories have been read, and return true if there
+// are still parts of it left to be walked
+static bool walk_more(GrepSearch *gs)
+{
+    for (size_t nr_dirs = 0; gs->nr_files < GREP_QUEUE_MAX && nr_dirs < GREP_WALK_DIRS; ) {
+        char *dir = pop_path(&gs->dirs);
+        if (dir) {
+            walk_dir(gs, dir);
+            free(dir);
+            nr_dirs++;
+            continue;
+        }
+
+        char *path = pop_path(&gs->paths);
+        if (!path) {
+            return false;
+        }
+
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            free(path);
+        } else if (S_ISDIR(st.st_mode)) {
+            if (streq(path, ".")) {
+                path[0] = '\0';
+            }
+            ptr_array_append(&gs->dirs, path);
+        } else {
+            GrepFile *file = new_grep_file(path, strlen(path));
+            add_files(gs, file, file, 1);
+            free(path);
+        }
+    }
+
+    return true;
+}
+
+// Search up to GREP_SERIAL_FILES queued files in the calling thread,
+// when there are no workers to do it
+static void search_files(GrepSearch *gs)
+{
+    BUG_ON(gs->workers);
+    const GrepPattern *gp = &gs->pattern;
+    regex_t re;
+    const regex_t *rp = NULL;
+    if (!gp->literal) {
+        if (!regexp_compile(NULL, &re, gp->pattern, gp->re_flags)) {
+            // See grep_worker()
+            for (GrepFile *f = gs->next_job; f; f = f->next) {
+                f->done = true;
+            }
+            gs->next_job = NULL;
+            return;
+        }
+        rp = &re;
+    }
+
+    for (size_t i = 0; i < GREP_SERIAL_FILES && gs->next_job; i++) {
+        GrepFile *file = gs->next_job;
+        gs->next_job = file->next;
+        grep_file(gp, rp, file->path, &file->results);
+        file->done = true;
+    }
+
+    if (rp) {
+        regfree(&re);
+    }
+}
+
+// Continue the search started by grep_start(), by walking more of the
+// directory tree and adding the Messages for any files searched since
+// the last call to the MessageList. If the workers haven't finished
+// searching any more files and nothing is left to walk, this waits for
+// them for up to `timeout_ms` milliseconds. Returns false once the
+// search is complete.
+bool grep_continue(GrepSearch *gs, unsigned int timeout_ms)
+{
+    bool walking = walk_more(gs);
+    gs->walking = walking;
+    if (!gs->workers && gs->next_job) {
+        search_files(gs);
+    }
+
+    lock(gs);
+    if (gs->woken) {
+        char byte;
+        (void)!xread(gs->wakeup_fd[0], &byte, 1);
+        gs->woken = false;
+    }
+
+    GrepFile *head = gs->head;
+    if (head && !head->done && (!walking || gs->nr_files >= GREP_QUEUE_MAX)) {
+        wait_for_job_done(gs, timeout_ms);
+    }
+
+    // Take the run of files at the head of the queue that are done
+    GrepFile *last = NULL;
+    size_t n = 0;
+    for (GrepFile *f = head; f && f->done; f = f->next) {
+        last = f;
+        n++;
+    }
+    if (last) {
+        gs->head = last->next;
+        last->next = NULL;
+    }
+    unlock(gs);
+
+    if (!last) {
+        return walking || head;
+    }
+
+    if (!gs->head) {
+        gs->tail = NULL;
+    }
+    gs->nr_files -= n;
+
+    for (GrepFile *f = head, *next; f; f = next) {
+        next = f->next;
+        PointerArray *r = &f->results;
+        for (size_t i = 0, count = r->count; i < count; i++) {
+            add_message(gs->msgs, r->ptrs[i]);
+        }
+        ptr_array_free_array(r);
+        free(f);
+    }
+
+    return walking || gs->head;
+}
+
+// Return true if grep_continue() would make progress if called now,
+// instead of only waiting for the workers
+bool grep_is_ready(GrepSearch *gs)
+{
+    if (!gs->workers || (gs->walking && gs->nr_files < GREP_QUEUE_MAX)) {
+        return true;
+    }
+
+    lock(gs);
+    bool ready = !gs->head || gs->head->done;
+    unlock(gs);
+    return ready;
+}
+
+// Return a file descriptor that becomes readable when grep_is_ready()
+// may have changed to true, or -1 if it never returns false
+int grep_get_wakeup_fd(const GrepSearch *gs)
+{
+    return gs->wakeup_fd[0];
+}
+
+static bool is_ascii(const char *str)
+{
+    for (size_t i = 0; str[i]; i++) {
+        if ((unsigned char)str[i] >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Start searching for lines matching `pattern` in `paths` (in the
+// background; see grep_continue()), with a Message for each one being
+// added to `msgs`. Each directory is searched recursively. Hidden files
+// and directories, binary files and symlinks to directories are skipped.
+// Returns NULL (after reporting the error) if `pattern` isn't a valid
+// regex or any of `paths` doesn't exist.
+GrepSearch *grep_start(MessageList *msgs, ErrorBuffer *ebuf, const char *pattern, bool icase, char **paths)
+{
+    int re_flags = REG_NEWLINE | (icase ? REG_ICASE : 0);
+    if (!regexp_is_valid(ebuf, pattern, re_flags)) {
+        return NULL;
+    }
+
+    size_t nr_paths = 0;
+    for (size_t i = 0; paths[i]; i++, nr_paths++) {
+        struct stat st;
+        if (stat(paths[i], &st) != 0) {
+            error_msg(ebuf, "%s: %s", paths[i], strerror(errno));
+            return NULL;
+        }
+    }
+
+    // REG_ICASE may also fold the case of non-ASCII characters, so the
+    // literal fast path is only used for ASCII in that case
+    char *literal = regexp_get_literal(pattern);
+    if (literal && icase && !is_ascii(literal)) {
+        free(literal);
+        literal = NULL;
+    }
+
+    GrepSearch *gs = xmalloc(sizeof(*gs));
+    *gs = (GrepSearch) {
+        .pattern = {
+            .pattern = xstrdup(pattern),
+            .re_flags = re_flags,
+            .literal = literal,
+            .literal_len = literal ? strlen(literal) : 0,
+            .icase = icase,
+        },
+        .msgs = msgs,
+        .paths = PTR_ARRAY_INIT,
+        .dirs = PTR_ARRAY_INIT,
+        .walking = true,
+        .wakeup_fd = {-1, -1},
+    };
+
+    // The paths are walked in the order given, so they're added to the
+    // stack in reverse order (see walk_more())
+    ptr_array_init(&gs->paths, nr_paths);
+    for (size_t i = nr_paths; i > 0; i--) {
+        ptr_array_append(&gs->paths, xstrdup(paths[i - 1]));
+    }
+
+    start_workers(gs);
+    return gs;
+}
+
+const char *grep_get_pattern(const GrepSearch *gs)
+{
+    return gs->pattern.pattern;
+}
+
+MessageList *grep_get_messages(const GrepSearch *gs)
+{
+    return gs->msgs;
+}
+
+// Stop the search (if it's still in progress) and free it
+void grep_free(GrepSearch *gs)
+{
+    stop_workers(gs);
+    for (GrepFile *f = gs->head, *next; f; f = next) {
+        next = f->next;
+        free_grep_file(f);
+    }
+
+    ptr_array_free(&gs->paths);
+    ptr_array_free(&gs->dirs);
+    free(gs->pattern.pattern);
+    free(gs->pattern.literal);
+    free(gs);
+}
+
+// Like grep_start(), but return only once the search is complete
+bool grep_paths(MessageList *msgs, ErrorBuffer *ebuf, const char *pattern, bool icase, char **paths)
+{
+    GrepSearch *gs = grep_start(msgs, ebuf, pattern, icase, paths);
+    if (!gs) {
+        return false;
+    }
+
+    while (grep_continue(gs, 1000)) {
+        ;
+    }
+
+    grep_free(gs);
+    return true;
+}
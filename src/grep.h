@@ -0,0 +1,34 @@
+#ifndef GREP_H
+#define GREP_H
+
+#include <stdbool.h>
+#include "command/error.h"
+#include "msg.h"
+#include "util/macros.h"
+
+typedef struct GrepSearch GrepSearch;
+
+GrepSearch *grep_start (
+    MessageList *msgs,
+    ErrorBuffer *ebuf,
+    const char *pattern,
+    bool icase,
+    char **paths
+) NONNULL_ARG(1, 3, 5) WARN_UNUSED_RESULT;
+
+bool grep_continue(GrepSearch *gs, unsigned int timeout_ms) NONNULL_ARGS;
+bool grep_is_ready(GrepSearch *gs) NONNULL_ARGS WARN_UNUSED_RESULT;
+int grep_get_wakeup_fd(const GrepSearch *gs) NONNULL_ARGS WARN_UNUSED_RESULT;
+const char *grep_get_pattern(const GrepSearch *gs) NONNULL_ARGS_AND_RETURN;
+MessageList *grep_get_messages(const GrepSearch *gs) NONNULL_ARGS_AND_RETURN;
+void grep_free(GrepSearch *gs) NONNULL_ARGS;
+
+bool grep_paths (
+    MessageList *msgs,
+    ErrorBuffer *ebuf,
+    const char *pattern,
+    bool icase,
+    char **paths
+) NONNULL_ARG(1, 3, 5) WARN_UNUSED_RESULT;
+
+#endif
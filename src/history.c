@@ -144,6 +144,15 @@ void history_free(History *history)
     history->last = NULL;
 }
 
+size_t history_memory_usage(const History *history)
+{
+    size_t total = hashmap_memory_usage(&history->entries);
+    for (const HistoryEntry *e = history->first; e; e = e->next) {
+        total += sizeof(*e) + strlen(e->text) + 1;
+    }
+    return total;
+}
+
 String history_dump(const History *history)
 {
     const size_t nr_entries = history->entries.count;
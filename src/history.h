@@ -34,5 +34,6 @@ void history_load(History *history, ErrorBuffer *ebuf, char *filename, size_t si
 void history_save(const History *history, ErrorBuffer *ebuf) NONNULL_ARG(1);
 void history_free(History *history) NONNULL_ARGS;
 String history_dump(const History *history) NONNULL_ARGS;
+size_t history_memory_usage(const History *history) NONNULL_ARGS;
 
 #endif
@@ -23,13 +23,48 @@
 #include "util/xreadwrite.h"
 #include "util/xstring.h"
 
-static bool decode_and_add_blocks (
-    Buffer *buffer,
-    const GlobalOptions *gopts,
-    ErrorBuffer *errbuf,
-    StringView text
-) {
-    EncodingType bom_type = detect_encoding_from_bom(text);
+static void fixup_blocks(Buffer *buffer)
+{
+    if (list_empty(&buffer->blocks)) {
+        Block *blk = block_new(&buffer->arena, 1);
+        block_append(blk, &buffer->blocks);
+        return;
+    }
+
+    Block *lastblk = BLOCK(buffer->blocks.prev);
+    BUG_ON(!lastblk);
+    size_t n = lastblk->size;
+    if (n && lastblk->data[n - 1] != '\n') {
+        // Incomplete lines are not allowed because they're special
+        // cases and cause lots of trouble
+        block_grow(lastblk, n + 1);
+        lastblk->data[n] = '\n';
+        lastblk->size++;
+        lastblk->nl++;
+        block_counts_changed(lastblk);
+        buffer->nl++;
+    }
+}
+
+typedef struct FileLoader {
+    BlockMapping *map; // Mapping of the whole file
+    StringView text; // The part of `map` that hasn't been decoded yet
+    bool map_blocks; // Whether Blocks may reference `map` (see `mmap-threshold`)
+    const GlobalOptions *gopts;
+    ErrorBuffer *ebuf;
+} FileLoader;
+
+enum {
+    // Amount of text decoded by load_buffer() before returning, when
+    // loading progressively (i.e. enough to fill the first screen)
+    ASYNC_LOAD_FIRST_SIZE = 64 << 10,
+};
+
+// Set Buffer::encoding (and Buffer::bom) according to the byte order
+// mark at the start of `text` (if any) and remove it
+static void detect_encoding(Buffer *buffer, const GlobalOptions *gopts, StringView *text)
+{
+    EncodingType bom_type = detect_encoding_from_bom(*text);
     if (!buffer->encoding && bom_type != UNKNOWN_ENCODING) {
         const char *enc = encoding_from_type(bom_type);
         if (!conversion_supported_by_iconv(enc, "UTF-8")) {
@@ -44,7 +79,7 @@ static bool decode_and_add_blocks (
     if (bom_type != UNKNOWN_ENCODING && bom_type == lookup_encoding(buffer->encoding)) {
         const ByteOrderMark *bom = get_bom_for_encoding(bom_type);
         if (bom) {
-            strview_remove_prefix(&text, bom->len);
+            strview_remove_prefix(text, bom->len);
             buffer->bom = true;
         }
     }
@@ -53,30 +88,133 @@ static bool decode_and_add_blocks (
         buffer->encoding = encoding_from_type(UTF8);
         buffer->bom = gopts->utf8_bom;
     }
+}
 
-    return file_decoder_read(buffer, gopts, errbuf, text);
+static bool decode_and_add_blocks (
+    Buffer *buffer,
+    const GlobalOptions *gopts,
+    ErrorBuffer *ebuf,
+    StringView text,
+    BlockMapping *map
+) {
+    if (map && encoding_is_utf8(buffer->encoding)) {
+        return file_decoder_read_mapped(buffer, gopts, ebuf, text, map);
+    }
+    return file_decoder_read(buffer, gopts, ebuf, text);
 }
 
-static void fixup_blocks(Buffer *buffer)
+// Return the length of the shortest prefix of `text` that's at least
+// `min` bytes long and ends at a line boundary (or the whole length,
+// if there's no such prefix)
+static size_t line_aligned_length(StringView text, size_t min)
 {
-    if (list_empty(&buffer->blocks)) {
-        Block *blk = block_new(1);
-        list_insert_before(&blk->node, &buffer->blocks);
-        return;
+    BUG_ON(min == 0);
+    if (min >= text.length) {
+        return text.length;
     }
+    const char *nl = memchr(text.data + min - 1, '\n', text.length - min + 1);
+    return nl ? (size_t)(nl - text.data) + 1 : text.length;
+}
 
-    Block *lastblk = BLOCK(buffer->blocks.prev);
-    BUG_ON(!lastblk);
-    size_t n = lastblk->size;
-    if (n && lastblk->data[n - 1] != '\n') {
-        // Incomplete lines are not allowed because they're special
-        // cases and cause lots of trouble
-        block_grow(lastblk, n + 1);
-        lastblk->data[n] = '\n';
-        lastblk->size++;
-        lastblk->nl++;
-        buffer->nl++;
+// Decode only the first part of `text` and keep a reference to `map`,
+// so that the rest can be added incrementally by load_buffer_continue()
+static bool start_async_load (
+    Buffer *buffer,
+    const GlobalOptions *gopts,
+    ErrorBuffer *ebuf,
+    StringView text,
+    BlockMapping *map,
+    bool map_blocks
+) {
+    size_t n = line_aligned_length(text, ASYNC_LOAD_FIRST_SIZE);
+    StringView first = string_view(text.data, n);
+    if (!decode_and_add_blocks(buffer, gopts, ebuf, first, map_blocks ? map : NULL)) {
+        return false;
+    }
+
+    strview_remove_prefix(&text, n);
+    if (text.length == 0) {
+        return true;
     }
+
+    FileLoader *loader = xmalloc(sizeof(*loader));
+    *loader = (FileLoader) {
+        .map = block_mapping_ref(map),
+        .text = text,
+        .map_blocks = map_blocks,
+        .gopts = gopts,
+        .ebuf = ebuf,
+    };
+
+    buffer->loader = loader;
+    LOG_INFO("loading %zu remaining bytes asynchronously", text.length);
+    return true;
+}
+
+static void free_loader(Buffer *buffer)
+{
+    FileLoader *loader = buffer->loader;
+    block_mapping_unref(loader->map);
+    free(loader);
+    buffer->loader = NULL;
+}
+
+// Decode at least `min_bytes` more of a Buffer that's being loaded
+// asynchronously (see `async-load-threshold`) and return true if there's
+// still more to be loaded
+bool load_buffer_continue(Buffer *buffer, size_t min_bytes)
+{
+    FileLoader *loader = buffer->loader;
+    if (!loader) {
+        return false;
+    }
+
+    StringView *text = &loader->text;
+    size_t n = line_aligned_length(*text, min_bytes);
+    size_t first_new_line = buffer->nl;
+    BlockMapping *map = loader->map_blocks ? loader->map : NULL;
+    file_decoder_read_more(buffer, loader->gopts, loader->ebuf, string_view(text->data, n), map);
+    buffer_mark_lines_changed(buffer, first_new_line, LONG_MAX);
+    strview_remove_prefix(text, n);
+
+    if (text->length) {
+        return true;
+    }
+
+    free_loader(buffer);
+    fixup_blocks(buffer);
+    return false;
+}
+
+// Load the remainder of a Buffer, for operations that require the whole
+// file to be present (e.g. editing, saving and searching)
+void load_buffer_finish(Buffer *buffer)
+{
+    if (unlikely(buffer->loader)) {
+        LOG_INFO("waiting for %s to finish loading", buffer_filename(buffer));
+        load_buffer_continue(buffer, SIZE_MAX);
+    }
+}
+
+// Free the state associated with an incomplete (asynchronous) load,
+// leaving the Buffer with only the parts already decoded
+void load_buffer_cancel(Buffer *buffer)
+{
+    if (buffer->loader) {
+        free_loader(buffer);
+    }
+}
+
+// Return the percentage of the file that has been loaded so far
+unsigned int load_buffer_progress(const Buffer *buffer)
+{
+    const FileLoader *loader = buffer->loader;
+    if (!loader) {
+        return 100;
+    }
+    uintmax_t total = loader->map->size;
+    uintmax_t done = total - loader->text.length;
+    return (unsigned int)((done * 100) / total);
 }
 
 static bool update_file_info(FileInfo *info, const struct stat *st)
@@ -109,12 +247,16 @@ bool read_blocks (
     Buffer *buffer,
     const GlobalOptions *gopts,
     ErrorBuffer *ebuf,
-    int fd
+    int fd,
+    bool allow_async
 ) {
     const size_t map_size = 64 * 1024;
     size_t size = buffer->file.size;
     char *text = NULL;
+    BlockMapping *map = NULL;
     bool mapped = false;
+    bool map_blocks = false;
+    bool async = false;
     bool ret = false;
 
     if (size >= map_size) {
@@ -123,6 +265,16 @@ bool read_blocks (
         if (text != MAP_FAILED) {
             advise_sequential(text, size);
             mapped = true;
+            uintmax_t threshold = gopts->mmap_threshold;
+            map_blocks = threshold && size >= threshold;
+            threshold = gopts->async_load_threshold;
+            async = allow_async && threshold && size >= threshold;
+            if (map_blocks || async) {
+                // Allow Blocks (and/or a FileLoader) to keep referencing
+                // the mapping, after the reference taken here is dropped
+                // below
+                map = block_mapping_new(text, size);
+            }
             goto decode;
         }
         LOG_ERRNO("mmap() failed");
@@ -174,18 +326,26 @@ bool read_blocks (
         size = pos;
     }
 
-decode:
-    ret = decode_and_add_blocks(buffer, gopts, ebuf, string_view(text, size));
+decode:;
+    StringView sv = string_view(text, size);
+    detect_encoding(buffer, gopts, &sv);
+    if (async && encoding_is_utf8(buffer->encoding)) {
+        ret = start_async_load(buffer, gopts, ebuf, sv, map, map_blocks);
+    } else {
+        ret = decode_and_add_blocks(buffer, gopts, ebuf, sv, map_blocks ? map : NULL);
+    }
 
 error:
-    if (mapped) {
+    if (map) {
+        block_mapping_unref(map);
+    } else if (mapped) {
         int r = munmap(text, size); // Can only fail due to usage error
         LOG_ERRNO_ON(r, "munmap");
     } else {
         free(text);
     }
 
-    if (ret) {
+    if (ret && !buffer->loader) {
         fixup_blocks(buffer);
     }
 
@@ -214,8 +374,8 @@ bool load_buffer (
             buffer->encoding = encoding_from_type(UTF8);
             buffer->bom = gopts->utf8_bom;
         }
-        Block *blk = block_new(1);
-        list_insert_before(&blk->node, &buffer->blocks);
+        Block *blk = block_new(&buffer->arena, 1);
+        block_append(blk, &buffer->blocks);
         return true;
     }
 
@@ -247,7 +407,7 @@ bool load_buffer (
         goto error;
     }
 
-    if (!read_blocks(buffer, gopts, ebuf, fd)) {
+    if (!read_blocks(buffer, gopts, ebuf, fd, true)) {
         error_msg(ebuf, "Error reading %s: %s", filename, strerror(errno));
         goto error;
     }
@@ -392,10 +552,19 @@ static int tmp_file (
     return fd;
 }
 
+static void unmap_blocks(Buffer *buffer)
+{
+    Block *blk;
+    block_for_each(blk, &buffer->blocks) {
+        block_make_writable(blk);
+    }
+}
+
 bool save_buffer(Buffer *buffer, const char *filename, const FileSaveContext *ctx)
 {
     ErrorBuffer *ebuf = ctx->ebuf;
     BUG_ON(!ctx->encoding);
+    load_buffer_finish(buffer);
     char tmp[8192];
     tmp[0] = '\0';
     int fd = -1;
@@ -410,6 +579,10 @@ bool save_buffer(Buffer *buffer, const char *filename, const FileSaveContext *ct
     if (fd < 0) {
         // Overwrite the original file directly (if it exists).
         // Ownership is preserved automatically if the file exists.
+        // Blocks still referencing a mapping of the file must first be
+        // copied, since O_TRUNC would pull the contents out from under
+        // them (see read_blocks()).
+        unmap_blocks(buffer);
         mode_t mode = buffer->file.mode;
         if (mode == 0) {
             // New file
@@ -19,6 +19,10 @@ typedef struct {
 
 bool load_buffer(Buffer *buffer, const char *filename, const GlobalOptions *gopts, ErrorBuffer *ebuf, bool must_exist) NONNULL_ARG(1, 2, 3) WARN_UNUSED_RESULT;
 bool save_buffer(Buffer *buffer, const char *filename, const FileSaveContext *ctx) NONNULL_ARGS WARN_UNUSED_RESULT;
-bool read_blocks(Buffer *buffer, const GlobalOptions *gopts, ErrorBuffer *ebuf, int fd) NONNULL_ARG(1, 2) WARN_UNUSED_RESULT;
+bool read_blocks(Buffer *buffer, const GlobalOptions *gopts, ErrorBuffer *ebuf, int fd, bool allow_async) NONNULL_ARG(1, 2) WARN_UNUSED_RESULT;
+bool load_buffer_continue(Buffer *buffer, size_t min_bytes) NONNULL_ARGS;
+void load_buffer_finish(Buffer *buffer) NONNULL_ARGS;
+void load_buffer_cancel(Buffer *buffer) NONNULL_ARGS;
+unsigned int load_buffer_progress(const Buffer *buffer) NONNULL_ARGS WARN_UNUSED_RESULT;
 
 #endif
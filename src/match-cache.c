@@ -0,0 +1,511 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "match-cache.h"
+#include "regexp-stream.h"
+#include "regexp.h"
+#include "util/arith.h"
+#include "util/count-nl.h"
+#include "util/debug.h"
+#include "util/xmalloc.h"
+
+// Shared by all lines without matches, to avoid allocating anything for them
+static LineMatches no_matches;
+
+static void free_line_matches(LineMatches *m)
+{
+    if (m != &no_matches) {
+        free(m);
+    }
+}
+
+enum {
+    // Number of lines kept in MatchCache::lines
+    MATCH_CACHE_SIZE = 256,
+};
+
+static void discard_cached_line(CachedLineMatches *cl)
+{
+    free_line_matches(cl->matches);
+    cl->matches = NULL;
+    cl->last_used = 0;
+}
+
+static void discard_cached_lines(MatchCache *cache)
+{
+    if (cache->lines) {
+        for (size_t i = 0; i < MATCH_CACHE_SIZE; i++) {
+            discard_cached_line(cache->lines + i);
+        }
+    }
+}
+
+// Find the first non-empty match of `re` in `line`, starting at `*pos`
+static bool next_match(const regex_t *re, const char *line, size_t len, size_t *pos, MatchSpan *span)
+{
+    for (size_t p = *pos; p <= len; ) {
+        regmatch_t m;
+        if (!regexp_exec(re, line + p, len - p, 1, &m, p ? REG_NOTBOL : 0)) {
+            break;
+        }
+
+        size_t start = p + m.rm_so;
+        size_t end = p + m.rm_eo;
+        if (start == end) {
+            // Empty matches have nothing to highlight, so just skip a byte
+            p = end + 1;
+            continue;
+        }
+
+        *span = (MatchSpan){.start = start, .end = end};
+        *pos = end;
+        return true;
+    }
+
+    return false;
+}
+
+static LineMatches *find_matches(const regex_t *re, const char *line, size_t len)
+{
+    static MatchSpan *spans; // NOLINT(*-avoid-non-const-global-variables)
+    static size_t alloc; // NOLINT(*-avoid-non-const-global-variables)
+    size_t n = 0;
+
+    for (size_t pos = 0; ; n++) {
+        if (n >= alloc) {
+            alloc = MAX(alloc * 2, 16);
+            spans = xrenew(spans, alloc);
+        }
+        if (!next_match(re, line, len, &pos, &spans[n])) {
+            break;
+        }
+    }
+
+    if (n == 0) {
+        return &no_matches;
+    }
+
+    size_t size = sizeof(spans[0]) * n;
+    LineMatches *lm = xmalloc(xadd(sizeof(*lm), size));
+    lm->nr_spans = n;
+    memcpy(lm->spans, spans, size);
+    return lm;
+}
+
+// Find the entry for `line_nr`, or else an unused one (or the least
+// recently used one, if there are none)
+static CachedLineMatches *find_cached_line(MatchCache *cache, size_t line_nr)
+{
+    if (!cache->lines) {
+        cache->lines = xcalloc(MATCH_CACHE_SIZE, sizeof(*cache->lines));
+    }
+
+    CachedLineMatches *lru = cache->lines;
+    for (size_t i = 0; i < MATCH_CACHE_SIZE; i++) {
+        CachedLineMatches *cl = cache->lines + i;
+        if (cl->matches && cl->line_nr == line_nr) {
+            return cl;
+        }
+        if (cl->last_used < lru->last_used) {
+            lru = cl;
+        }
+    }
+
+    discard_cached_line(lru);
+    return lru;
+}
+
+// Get the matches of `re` within `line` (which excludes the newline),
+// either from the cache or (if not yet cached) by matching it now. Only
+// the most recently used lines are kept, so the memory used doesn't
+// depend on the number (or position) of the lines drawn. The whole cache
+// is discarded if `generation` differs from the one the cached lines
+// were matched with. The returned LineMatches remain valid until the
+// next call.
+const LineMatches *match_cache_get (
+    MatchCache *cache,
+    const regex_t *re,
+    unsigned int generation,
+    StringView line,
+    size_t line_nr
+) {
+    if (cache->generation != generation) {
+        discard_cached_lines(cache);
+        cache->generation = generation;
+    }
+
+    CachedLineMatches *cl = find_cached_line(cache, line_nr);
+    cl->last_used = ++cache->clock;
+    if (!cl->matches) {
+        cl->matches = find_matches(re, line.data, line.length);
+        cl->line_nr = line_nr;
+    }
+    return cl->matches;
+}
+
+// Discard the cached matches for lines `first` to `first + del_lines`
+// (inclusive) and renumber the lines that follow them by the difference
+// between `ins_lines` and `del_lines`, as for hl_insert() and hl_delete()
+void match_cache_edit(MatchCache *cache, size_t first, size_t del_lines, size_t ins_lines)
+{
+    CachedLineMatches *lines = cache->lines;
+    if (!lines) {
+        return;
+    }
+
+    for (size_t i = 0; i < MATCH_CACHE_SIZE; i++) {
+        CachedLineMatches *cl = lines + i;
+        if (!cl->matches || cl->line_nr < first) {
+            continue;
+        }
+        if (cl->line_nr <= first + del_lines) {
+            discard_cached_line(cl);
+            continue;
+        }
+        cl->line_nr = cl->line_nr - del_lines + ins_lines;
+    }
+}
+
+void match_cache_free(MatchCache *cache)
+{
+    discard_cached_lines(cache);
+    free(cache->lines);
+    *cache = (MatchCache){.lines = NULL};
+}
+
+enum {
+    // Max. size of each counted MatchCountChunk, which also bounds the
+    // amount of text matched by match_count_get_position()
+    MATCH_COUNT_CHUNK_LINES = 256,
+    MATCH_COUNT_CHUNK_BYTES = 64 << 10,
+};
+
+// Count the non-empty matches (as for next_match()) starting within the
+// `len` bytes at `bi`, and set `*last` to the Buffer offset of the last
+// one. The matches are found with a RegexpStream, as for do_search_fwd(),
+// so patterns containing newlines are counted as they're searched for,
+// by also including the text that such matches could extend into.
+static size_t count_matches(const regex_t *re, const char *pattern, BlockIter bi, size_t len, size_t *last)
+{
+    RegexpStream rs;
+    regexp_stream_init(&rs, re, pattern, bi, SIZE_MAX);
+    const size_t stop = rs.offset + len;
+
+    BlockIter end = bi;
+    block_iter_skip_bytes(&end, len);
+    size_t extra = 0;
+    for (size_t n = rs.pattern_nl + !block_iter_is_bol(&end); n; n--) {
+        size_t line_len = block_iter_eat_line(&end);
+        if (line_len == 0) {
+            break; // EOF
+        }
+        extra += line_len;
+    }
+
+    regexp_stream_reset(&rs, bi, stop + extra);
+    rs.stop = stop;
+
+    size_t count = 0;
+    regmatch_t m;
+    while (regexp_stream_next(&rs, 1, &m)) {
+        size_t so = rs.text_offset + m.rm_so;
+        size_t eo = rs.text_offset + m.rm_eo;
+        if (so >= stop) {
+            break;
+        }
+        if (so == eo) {
+            regexp_stream_seek(&rs, so + 1, false);
+            continue;
+        }
+        count++;
+        *last = so;
+        regexp_stream_seek(&rs, eo, false);
+    }
+
+    regexp_stream_free(&rs);
+    return count;
+}
+
+static void reset_match_count(MatchCount *mc, const char *pattern, unsigned int generation, size_t nr_lines)
+{
+    if (mc->alloc == 0) {
+        mc->alloc = 16;
+        mc->chunks = xrenew(mc->chunks, mc->alloc);
+    }
+
+    mc->chunks[0] = (MatchCountChunk){.nr_lines = nr_lines, .nr_matches = SIZE_MAX};
+    mc->nr_chunks = (nr_lines > 0);
+    mc->nr_lines = nr_lines;
+    mc->nr_pending_lines = nr_lines;
+    mc->generation = generation;
+    mc->pattern_nl = count_nl(pattern, strlen(pattern));
+}
+
+// Insert `n` uninitialized chunks at index `idx`
+static void insert_chunks(MatchCount *mc, size_t idx, size_t n)
+{
+    BUG_ON(idx > mc->nr_chunks);
+    size_t count = mc->nr_chunks + n;
+    if (count > mc->alloc) {
+        mc->alloc = MAX(count, mc->alloc * 2);
+        mc->chunks = xrenew(mc->chunks, mc->alloc);
+    }
+
+    MatchCountChunk *c = mc->chunks + idx;
+    memmove(c + n, c, (mc->nr_chunks - idx) * sizeof(*c));
+    mc->nr_chunks = count;
+}
+
+// Return the index of the chunk containing `line` (or the last chunk,
+// if `line` is past the end) and set `*start` to its first line number
+static size_t find_chunk(const MatchCount *mc, size_t line, size_t *start)
+{
+    BUG_ON(mc->nr_chunks == 0);
+    size_t first = 0;
+    size_t i = 0;
+    for (size_t n = mc->nr_chunks - 1; i < n; i++) {
+        size_t next = first + mc->chunks[i].nr_lines;
+        if (line < next) {
+            break;
+        }
+        first = next;
+    }
+    *start = first;
+    return i;
+}
+
+// Whether match_count_continue() has anything to do
+bool match_count_pending(const MatchCount *mc, unsigned int generation, size_t nr_lines)
+{
+    if (!mc->enabled) {
+        return false;
+    }
+    bool stale = (mc->generation != generation || mc->nr_lines != nr_lines);
+    return stale || mc->nr_pending_lines > 0;
+}
+
+// Count the matches in (roughly) `max_bytes` of the lines not yet
+// counted. The counts are reset if `generation` or `nr_lines` differ
+// from those of the previous call, i.e. if the regex changed or the
+// Buffer changed without match_count_edit() being called (e.g. when
+// loading progressively). Returns true if anything was counted.
+bool match_count_continue (
+    MatchCount *mc,
+    const regex_t *re,
+    const char *pattern,
+    unsigned int generation,
+    BlockIter bof,
+    size_t nr_lines,
+    size_t max_bytes
+) {
+    if (mc->generation != generation || mc->nr_lines != nr_lines) {
+        reset_match_count(mc, pattern, generation, nr_lines);
+    }
+
+    size_t nbytes = 0;
+    size_t line_nr = 0;
+    bool counted = false;
+
+    for (size_t i = 0; i < mc->nr_chunks && nbytes < max_bytes; i++) {
+        MatchCountChunk *chunk = &mc->chunks[i];
+        if (chunk->nr_matches != SIZE_MAX) {
+            line_nr += chunk->nr_lines;
+            continue;
+        }
+
+        BlockIter bi = bof;
+        block_iter_goto_line(&bi, line_nr);
+        const BlockIter chunk_start = bi;
+        size_t n = 0;
+        size_t chunk_bytes = 0;
+        while (
+            n < chunk->nr_lines
+            && n < MATCH_COUNT_CHUNK_LINES
+            && chunk_bytes < MATCH_COUNT_CHUNK_BYTES
+        ) {
+            size_t line_len = block_iter_eat_line(&bi);
+            if (line_len == 0) {
+                break; // EOF
+            }
+            chunk_bytes += line_len;
+            n++;
+        }
+
+        size_t last;
+        size_t matches = count_matches(re, pattern, chunk_start, chunk_bytes, &last);
+
+        if (n == 0) {
+            // Lines past EOF (which shouldn't exist, unless `nr_lines`
+            // was wrong) are treated as having no matches
+            n = chunk->nr_lines;
+        }
+
+        size_t remaining = chunk->nr_lines - n;
+        if (remaining) {
+            insert_chunks(mc, i + 1, 1);
+            chunk = &mc->chunks[i];
+            chunk[1] = (MatchCountChunk){.nr_lines = remaining, .nr_matches = SIZE_MAX};
+        }
+
+        chunk->nr_lines = n;
+        chunk->nr_matches = matches;
+        mc->nr_pending_lines -= n;
+        line_nr += n;
+        nbytes += chunk_bytes;
+        counted = true;
+    }
+
+    return counted;
+}
+
+// Get the position of the cursor (on line `line_nr`) relative to the
+// matches counted so far. Returns true if a match starts at the cursor
+// and the counts are for `generation` (i.e. if the position should be
+// shown), otherwise false.
+bool match_count_get_position (
+    const MatchCount *mc,
+    const regex_t *re,
+    const char *pattern,
+    unsigned int generation,
+    BlockIter cursor,
+    size_t line_nr,
+    MatchPosition *pos
+) {
+    if (!mc->enabled || mc->generation != generation || mc->nr_chunks == 0) {
+        return false;
+    }
+
+    // Count the matches in the cursor line, up to (and at) the cursor
+    const size_t cursor_offset = block_iter_get_offset(&cursor);
+    BlockIter bol = cursor;
+    size_t cx = block_iter_bol(&bol);
+    StringView line = block_iter_get_line_with_nl(&bol);
+    size_t last = SIZE_MAX;
+    size_t line_matches = count_matches(re, pattern, bol, MIN(cx + 1, line.length), &last);
+    if (line_matches == 0 || last != cursor_offset) {
+        return false;
+    }
+
+    size_t total = 0;
+    size_t before = 0; // Matches in the chunks before the cursor chunk
+    bool known = true; // Whether `before` is complete
+    size_t chunk_start;
+    size_t cursor_chunk = find_chunk(mc, line_nr, &chunk_start);
+    for (size_t i = 0, n = mc->nr_chunks; i < n; i++) {
+        size_t matches = mc->chunks[i].nr_matches;
+        if (matches == SIZE_MAX) {
+            known = known && (i > cursor_chunk);
+            continue;
+        }
+        total += matches;
+        before += (i < cursor_chunk) ? matches : 0;
+    }
+
+    size_t index = 0;
+    if (known) {
+        // Count the matches in the cursor chunk, before the cursor line
+        BlockIter bi = cursor;
+        block_iter_goto_line(&bi, chunk_start);
+        size_t len = cursor_offset - cx - block_iter_get_offset(&bi);
+        index = before + line_matches + count_matches(re, pattern, bi, len, &last);
+    }
+
+    *pos = (MatchPosition) {
+        .index = index,
+        .total = total,
+        .partial = (mc->nr_pending_lines > 0),
+    };
+
+    return true;
+}
+
+// Discard the counts for the chunks containing lines `first` to
+// `first + del_lines`, as for match_cache_edit(). Matches of a pattern
+// containing N newlines can start up to N lines before an edited line
+// (see count_matches()), so the chunks containing those lines are also
+// discarded.
+void match_count_edit(MatchCount *mc, size_t first, size_t del_lines, size_t ins_lines)
+{
+    if (mc->nr_chunks == 0) {
+        return;
+    }
+
+    size_t start;
+    size_t i = find_chunk(mc, first - MIN(first, mc->pattern_nl), &start);
+    size_t j = find_chunk(mc, first + del_lines, &start);
+    size_t lines = 0;
+    size_t pending = 0;
+    for (size_t k = i; k <= j; k++) {
+        const MatchCountChunk *c = &mc->chunks[k];
+        lines += c->nr_lines;
+        pending += (c->nr_matches == SIZE_MAX) ? c->nr_lines : 0;
+    }
+
+    // Replace chunks i..j with a single (uncounted) chunk
+    BUG_ON(lines < del_lines);
+    lines = lines - del_lines + ins_lines;
+    MatchCountChunk *c = mc->chunks + i;
+    size_t tail = mc->nr_chunks - (j + 1);
+    memmove(c + 1, mc->chunks + j + 1, tail * sizeof(*c));
+    *c = (MatchCountChunk){.nr_lines = lines, .nr_matches = SIZE_MAX};
+    mc->nr_chunks = i + 1 + tail;
+    mc->nr_lines = mc->nr_lines - del_lines + ins_lines;
+    mc->nr_pending_lines = mc->nr_pending_lines - pending + lines;
+}
+
+void match_count_free(MatchCount *mc)
+{
+    free(mc->chunks);
+    *mc = (MatchCount){.chunks = NULL};
+}
+
+void match_list_reset(MatchList *list, unsigned int generation, size_t start, size_t end)
+{
+    list->nr_spans = 0;
+    list->start = start;
+    list->end = end;
+    list->generation = generation;
+}
+
+void match_list_append(MatchList *list, size_t start, size_t end)
+{
+    BUG_ON(list->nr_spans && start < list->spans[list->nr_spans - 1].end);
+    if (list->nr_spans >= list->alloc) {
+        list->alloc = MAX(list->alloc * 2, 16);
+        list->spans = xrenew(list->spans, list->alloc);
+    }
+    list->spans[list->nr_spans++] = (MatchSpan){.start = start, .end = end};
+}
+
+// Find the last match starting before `limit` (and, if `skip` is true,
+// also ending at or before it). Since the matches don't overlap, both
+// their start and end offsets are in ascending order and so the matches
+// satisfying these conditions are always a prefix of `spans`.
+bool match_list_find_last(const MatchList *list, size_t limit, bool skip, size_t *offset)
+{
+    BUG_ON(limit > list->end);
+    size_t lo = 0;
+    size_t hi = list->nr_spans;
+    while (lo < hi) {
+        size_t mid = lo + ((hi - lo) / 2);
+        const MatchSpan *span = &list->spans[mid];
+        if (span->start < limit && (!skip || span->end <= limit)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        return false;
+    }
+
+    *offset = list->spans[lo - 1].start;
+    return true;
+}
+
+void match_list_free(MatchList *list)
+{
+    free(list->spans);
+    *list = (MatchList){.spans = NULL};
+}
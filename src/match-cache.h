@@ -0,0 +1,99 @@
+#ifndef MATCH_CACHE_H
+#define MATCH_CACHE_H
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "block-iter.h"
+#include "util/macros.h"
+#include "util/string-view.h"
+
+typedef struct {
+    size_t start;
+    size_t end;
+} MatchSpan;
+
+// Non-empty, non-overlapping matches of a regex within a single line
+typedef struct {
+    size_t nr_spans;
+    MatchSpan spans[];
+} LineMatches;
+
+// The matches of a regex within a recently drawn line
+typedef struct {
+    LineMatches *matches; // Or NULL, if unused
+    size_t line_nr;
+    size_t last_used; // Value of MatchCache::clock when last used
+} CachedLineMatches;
+
+// Matches of a regex for the most recently drawn lines of a Buffer, which
+// are found as lines are drawn (see match_cache_get()) and discarded for
+// lines that are subsequently edited (see match_cache_edit())
+typedef struct {
+    CachedLineMatches *lines; // Fixed-size array (or NULL, if nothing cached yet)
+    size_t clock; // Incremented each time an entry of `lines` is used
+    unsigned int generation; // SearchState::generation of the regex used for `lines`
+} MatchCache;
+
+typedef struct {
+    size_t nr_lines;
+    size_t nr_matches; // Or SIZE_MAX, if not yet counted
+} MatchCountChunk;
+
+// Total number of matches of a regex in a Buffer, counted incrementally
+// in chunks of lines (see match_count_continue()), so that only the
+// chunks containing edited lines need to be counted again (see
+// match_count_edit())
+typedef struct {
+    MatchCountChunk *chunks;
+    size_t nr_chunks;
+    size_t alloc;
+    size_t nr_lines; // Sum of `chunks[i].nr_lines`
+    size_t nr_pending_lines; // Lines in chunks not yet counted
+    unsigned int generation; // SearchState::generation of the regex used for `chunks`
+    size_t pattern_nl; // Number of newlines in the pattern of the regex (see match_count_edit())
+    bool enabled; // Whether matches are counted (i.e. after searching in the Buffer)
+} MatchCount;
+
+typedef struct {
+    size_t index; // Matches starting before or at the cursor (or 0, if not yet known)
+    size_t total; // Matches counted so far
+    bool partial; // Whether `total` is only a lower bound (i.e. still counting)
+} MatchPosition;
+
+// Matches of a regex found by the most recent reverse search (see
+// do_search_bwd()), which are reused when searching backwards again
+// from an earlier position in the same range of text, instead of
+// matching all of the text before that position again
+typedef struct {
+    MatchSpan *spans; // Buffer offsets of the matches, in order
+    size_t nr_spans;
+    size_t alloc;
+    size_t start; // Buffer offset at which matching started
+    size_t end; // All matches starting before this offset are in `spans`
+    unsigned int generation; // SearchState::generation of the regex (or 0, if `spans` is invalid)
+} MatchList;
+
+const LineMatches *match_cache_get (
+    MatchCache *cache,
+    const regex_t *re,
+    unsigned int generation,
+    StringView line,
+    size_t line_nr
+) NONNULL_ARGS_AND_RETURN;
+
+void match_cache_edit(MatchCache *cache, size_t first, size_t del_lines, size_t ins_lines) NONNULL_ARGS;
+void match_cache_free(MatchCache *cache) NONNULL_ARGS;
+
+bool match_count_pending(const MatchCount *mc, unsigned int generation, size_t nr_lines) NONNULL_ARGS WARN_UNUSED_RESULT;
+bool match_count_continue(MatchCount *mc, const regex_t *re, const char *pattern, unsigned int generation, BlockIter bof, size_t nr_lines, size_t max_bytes) NONNULL_ARGS;
+bool match_count_get_position(const MatchCount *mc, const regex_t *re, const char *pattern, unsigned int generation, BlockIter cursor, size_t line_nr, MatchPosition *pos) NONNULL_ARGS WARN_UNUSED_RESULT;
+void match_count_edit(MatchCount *mc, size_t first, size_t del_lines, size_t ins_lines) NONNULL_ARGS;
+void match_count_free(MatchCount *mc) NONNULL_ARGS;
+
+void match_list_reset(MatchList *list, unsigned int generation, size_t start, size_t end) NONNULL_ARGS;
+void match_list_append(MatchList *list, size_t start, size_t end) NONNULL_ARGS;
+bool match_list_find_last(const MatchList *list, size_t limit, bool skip, size_t *offset) NONNULL_ARGS WARN_UNUSED_RESULT;
+void match_list_free(MatchList *list) NONNULL_ARGS;
+
+#endif
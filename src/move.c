@@ -1,6 +1,7 @@
 #include "move.h"
 #include "buffer.h"
 #include "indent.h"
+#include "load-save.h"
 #include "util/ascii.h"
 #include "util/debug.h"
 #include "util/utf8.h"
@@ -169,6 +170,7 @@ void move_bof(View *view)
 
 void move_eof(View *view)
 {
+    load_buffer_finish(view->buffer);
     block_iter_eof(&view->cursor);
     view_reset_preferred_x(view);
 }
@@ -176,6 +178,9 @@ void move_eof(View *view)
 void move_to_line(View *view, size_t line)
 {
     BUG_ON(line == 0);
+    if (line > view->buffer->nl) {
+        load_buffer_finish(view->buffer);
+    }
     view->center_on_scroll = true;
     block_iter_goto_line(&view->cursor, line - 1);
 }
@@ -9,7 +9,7 @@
 #include "util/xmalloc.h"
 #include "util/xstring.h"
 
-static void free_message(Message *m)
+void free_message(Message *m)
 {
     if (m->loc) {
         file_location_free(m->loc);
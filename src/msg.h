@@ -22,6 +22,7 @@ typedef struct {
 } MessageList;
 
 Message *new_message(const char *msg, size_t len) RETURNS_NONNULL;
+void free_message(Message *m) NONNULL_ARGS;
 void add_message(MessageList *msgs, Message *m) NONNULL_ARGS;
 bool activate_current_message(const MessageList *msgs, Window *window, ErrorBuffer *ebuf) NONNULL_ARG(1, 2);
 void activate_current_message_save(const MessageList *msgs, PointerArray *bookmarks, const View *view, ErrorBuffer *ebuf) NONNULL_ARG(1, 2, 3);
@@ -476,6 +476,7 @@ static const char *const ws_error_values[] = {
 };
 
 static const OptionDesc option_desc[] = {
+    FSIZE_OPT("async-load-threshold", G(async_load_threshold), NULL),
     BOOL_OPT("auto-indent", C(auto_indent), NULL),
     BOOL_OPT("brace-indent", L(brace_indent), NULL),
     ENUM_OPT("case-sensitive-search", G(case_sensitive_search), tristate_enum, NULL),
@@ -489,14 +490,17 @@ static const OptionDesc option_desc[] = {
     FSIZE_OPT("filesize-limit", G(filesize_limit), NULL),
     STR_OPT("filetype", L(filetype), validate_filetype, filetype_changed),
     BOOL_OPT("fsync", C(fsync), NULL),
+    BOOL_OPT("highlight-search", G(highlight_search), redraw_screen),
     REGEX_OPT("indent-regex", L(indent_regex), NULL),
     UINT8_OPT("indent-width", C(indent_width), 1, INDENT_WIDTH_MAX, NULL),
     BOOL_OPT("lock-files", G(lock_files), NULL),
+    FSIZE_OPT("mmap-threshold", G(mmap_threshold), NULL),
     ENUM_OPT("msg-compile", G(msg_compile), msg_enum, NULL),
     ENUM_OPT("msg-tag", G(msg_tag), msg_enum, NULL),
     ENUM_OPT("newline", G(crlf_newlines), newline_enum, NULL),
     BOOL_OPT("optimize-true-color", G(optimize_true_color), redraw_screen),
     BOOL_OPT("overwrite", C(overwrite), overwrite_changed),
+    BOOL_OPT("persistent-undo", G(persistent_undo), NULL),
     ENUM_OPT("save-unmodified", C(save_unmodified), save_unmodified_enum, NULL),
     UINT8_OPT("scroll-margin", G(scroll_margin), 0, 100, redraw_screen),
     BOOL_OPT("select-cursor-char", G(select_cursor_char), redraw_screen),
@@ -505,10 +509,12 @@ static const OptionDesc option_desc[] = {
     STR_OPT("statusline-left", G(statusline_left), validate_statusline_format, NULL),
     STR_OPT("statusline-right", G(statusline_right), validate_statusline_format, NULL),
     BOOL_OPT("syntax", C(syntax), syntax_changed),
+    BOOL_OPT("syntax-cache", G(syntax_cache), NULL),
     FSIZE_OPT("syntax-line-limit", G(syntax_line_limit), NULL),
     BOOL_OPT("tab-bar", G(tab_bar), redraw_screen),
     UINT8_OPT("tab-width", C(tab_width), 1, TAB_WIDTH_MAX, redraw_buffer),
     UINT_OPT("text-width", C(text_width), 1, TEXT_WIDTH_MAX, NULL),
+    FSIZE_OPT("undo-memory-limit", G(undo_memory_limit), NULL),
     BOOL_OPT("utf8-bom", G(utf8_bom), NULL),
     ENUM_OPT("window-separator", G(window_separator), window_separator_enum, window_separator_changed),
     FLAG_OPT("ws-error", C(ws_error), ws_error_values, redraw_buffer),
@@ -69,11 +69,14 @@ typedef struct {
     COMMON_OPTIONS;
     // Only global
     bool display_special;
+    bool highlight_search;
     bool lock_files;
+    bool persistent_undo;
     bool optimize_true_color;
     bool select_cursor_char;
     bool set_window_title;
     bool show_line_numbers;
+    bool syntax_cache;
     bool tab_bar;
     bool utf8_bom; // Default value for new files
     uint8_t scroll_margin;
@@ -83,8 +86,11 @@ typedef struct {
     uint8_t msg_compile; // Default EditorState::messages[] index for `compile`
     uint8_t msg_tag; // Default EditorState::messages[] index for `tag`
     unsigned int esc_timeout; // See term_read_input()
+    uint_least64_t async_load_threshold; // Minimum file size for load_buffer_continue()
     uint_least64_t filesize_limit; // Size limit imposed by load_buffer()
+    uint_least64_t mmap_threshold; // Minimum file size for mapped Blocks (see read_blocks())
     uint_least64_t syntax_line_limit; // Line length at which LocalOptions::syntax is disabled
+    uint_least64_t undo_memory_limit; // Per-Buffer limit for ChangeArena::memory_usage
     const char *statusline_left;
     const char *statusline_right;
 } GlobalOptions;
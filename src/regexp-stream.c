@@ -0,0 +1,269 @@
+#include <stdint.h>
+#include <string.h>
+#include "regexp-stream.h"
+#include "regexp.h"
+#include "util/debug.h"
+#include "util/xmemrchr.h"
+
+/*
+ * Matching is done directly on the contents of each Block, with each
+ * regexp_exec() call covering as many lines as the Block contains,
+ * instead of one call per line. Lines never span multiple Blocks (see
+ * sanity_check_blocks()), so matches of patterns without newlines can
+ * always be found within a single Block.
+ *
+ * A pattern containing N newlines can match text spanning N + 1 lines,
+ * which may straddle the boundary between 2 (or more) Blocks. Matches
+ * starting in the last N lines of a Block are therefore searched for
+ * again, in a small window of text copied from both sides of the Block
+ * boundary (RegexpStream::joined), which includes up to N more lines
+ * from the Block(s) that follow. Matches spanning more than N + 1 lines
+ * (e.g. due to "\n*") are only found when they're within one Block.
+ */
+
+// Without REG_STARTEND, regexp_exec() makes a copy of the text it's
+// given, so the amount of text searched per call is limited to roughly
+// this many bytes (rounded up to the end of a line)
+#define CHUNK_MAX (HAVE_REG_STARTEND ? SIZE_MAX : 256)
+
+void regexp_stream_init(RegexpStream *rs, const regex_t *re, const char *pattern, BlockIter bi, size_t end)
+{
+    size_t nl = 0;
+    for (const char *p = pattern; (p = strchr(p, '\n')); p++) {
+        nl++;
+    }
+
+    *rs = (RegexpStream) {
+        .re = re,
+        .stop = SIZE_MAX,
+        .pattern_nl = nl,
+        .joined = STRING_INIT,
+    };
+
+    regexp_stream_reset(rs, bi, end);
+}
+
+// Continue searching from `bi` (e.g. after the Buffer has been modified),
+// up until Buffer offset `end`
+void regexp_stream_reset(RegexpStream *rs, BlockIter bi, size_t end)
+{
+    rs->bi = bi;
+    rs->offset = block_iter_get_offset(&bi);
+    rs->end = end;
+}
+
+void regexp_stream_free(RegexpStream *rs)
+{
+    string_free(&rs->joined);
+}
+
+// Return the offset of the start of the last `n` lines of `buf` (which
+// must end with a newline), or 0 if it contains fewer lines
+static size_t last_lines_start(const char *buf, size_t len, size_t n)
+{
+    BUG_ON(len == 0 || buf[len - 1] != '\n');
+    size_t pos = len - 1; // Position of the newline ending the last line
+    for (size_t i = 0; i < n; i++) {
+        const char *nl = xmemrchr(buf, '\n', pos);
+        if (!nl) {
+            return 0;
+        }
+        pos = (size_t)(nl - buf);
+    }
+    return pos + 1;
+}
+
+static void shift_matches(regmatch_t *matches, size_t nmatch, size_t offset)
+{
+    for (size_t i = 0; i < nmatch; i++) {
+        if (matches[i].rm_so >= 0) {
+            matches[i].rm_so += offset;
+            matches[i].rm_eo += offset;
+        }
+    }
+}
+
+static void set_text(RegexpStream *rs, const char *text, size_t len, size_t offset)
+{
+    rs->text = text;
+    rs->text_len = len;
+    rs->text_offset = offset;
+}
+
+// Search for a match starting within the last `tail_len` bytes of
+// `chunk`, in a window that also includes up to RegexpStream::pattern_nl
+// lines of the text that follows `chunk`
+static bool find_across_blocks (
+    RegexpStream *rs,
+    const char *chunk,
+    size_t len,
+    size_t tail_len,
+    int notbol,
+    size_t nmatch,
+    regmatch_t *matches
+) {
+    String *joined = &rs->joined;
+    string_clear(joined);
+    string_append_buf(joined, chunk + len - tail_len, tail_len);
+
+    BlockIter bi = rs->bi;
+    bi.offset += len;
+    size_t remaining = rs->end - (rs->offset + len);
+    for (size_t nl = rs->pattern_nl; nl && remaining; ) {
+        block_iter_normalize(&bi);
+        const char *p = bi.blk->data + bi.offset;
+        size_t avail = MIN(bi.blk->size - bi.offset, remaining);
+        if (avail == 0) {
+            break; // EOF
+        }
+
+        size_t n = avail;
+        for (size_t pos = 0; nl && pos < avail; nl--) {
+            const char *eol = memchr(p + pos, '\n', avail - pos);
+            if (!eol) {
+                break;
+            }
+            pos = (size_t)(eol - p) + 1;
+            n = pos;
+        }
+
+        string_append_buf(joined, p, n);
+        remaining -= n;
+        bi.offset += n;
+    }
+
+    const char *text = joined->buffer;
+    size_t text_len = joined->len;
+    bool complete = (text[text_len - 1] == '\n');
+    int eflags = ((tail_len == len) ? notbol : 0) | (complete ? REG_NOTEOL : 0);
+    if (
+        !regexp_exec(rs->re, text, text_len, nmatch, matches, eflags)
+        || (size_t)matches[0].rm_so >= tail_len
+    ) {
+        return false;
+    }
+
+    set_text(rs, text, text_len, rs->offset + len - tail_len);
+    return true;
+}
+
+// Search `len` bytes of contiguous text at RegexpStream::bi
+static bool find_in_chunk(RegexpStream *rs, size_t len, bool at_end, size_t nmatch, regmatch_t *matches)
+{
+    const char *chunk = rs->bi.blk->data + rs->bi.offset;
+    const bool complete = (chunk[len - 1] == '\n');
+    const int notbol = block_iter_is_bol(&rs->bi) ? 0 : REG_NOTBOL;
+    const size_t k = rs->pattern_nl;
+
+    // The position after a final newline belongs to the next line, but
+    // matches are otherwise allowed to start anywhere in `chunk`, except
+    // for in the last `k` lines, when matches could continue beyond it
+    size_t start_limit = len + !complete;
+    if (k > 0 && !at_end) {
+        BUG_ON(!complete);
+        start_limit = last_lines_start(chunk, len, k);
+    }
+
+    for (size_t pos = 0; pos < start_limit; ) {
+        int eflags = (pos ? 0 : notbol) | (complete ? REG_NOTEOL : 0);
+        if (
+            !regexp_exec(rs->re, chunk + pos, len - pos, nmatch, matches, eflags)
+            || pos + (size_t)matches[0].rm_so >= start_limit
+        ) {
+            break;
+        }
+
+        shift_matches(matches, nmatch, pos);
+        const size_t so = matches[0].rm_so;
+        const size_t eo = matches[0].rm_eo;
+        if (k > 0 || !memchr(chunk + so, '\n', eo - so)) {
+            set_text(rs, chunk, len, rs->offset);
+            return true;
+        }
+
+        // The pattern contains no newlines, but matched one anyway (e.g.
+        // via "[[:space:]]"), so search only the line where this match
+        // started, as if the text had been split into lines
+        const char *sol = xmemrchr(chunk + pos, '\n', so - pos);
+        const size_t line_start = sol ? (size_t)(sol - chunk) + 1 : pos;
+        const size_t line_end = (size_t)((const char*)memchr(chunk + so, '\n', len - so) - chunk);
+        eflags = (line_start ? 0 : notbol);
+        const char *line = chunk + line_start;
+        if (regexp_exec(rs->re, line, line_end - line_start, nmatch, matches, eflags)) {
+            shift_matches(matches, nmatch, line_start);
+            set_text(rs, chunk, len, rs->offset);
+            return true;
+        }
+
+        pos = line_end + 1;
+    }
+
+    if (k == 0 || at_end) {
+        return false;
+    }
+
+    return find_across_blocks(rs, chunk, len, len - start_limit, notbol, nmatch, matches);
+}
+
+// Find the next match, starting at or after the current position. The
+// offsets in `matches` are relative to RegexpStream::text, which is
+// valid until the next call or until the Buffer is modified. The stream
+// position isn't advanced past the match (see regexp_stream_seek()).
+// Matches starting after RegexpStream::stop may or may not be found.
+bool regexp_stream_next(RegexpStream *rs, size_t nmatch, regmatch_t *matches)
+{
+    BUG_ON(nmatch == 0);
+    BlockIter *bi = &rs->bi;
+
+    while (rs->offset < rs->end && rs->offset < rs->stop) {
+        block_iter_normalize(bi);
+        const Block *blk = bi->blk;
+        const char *chunk = blk->data + bi->offset;
+        size_t len = MIN(blk->size - bi->offset, rs->end - rs->offset);
+        if (len == 0) {
+            break; // EOF
+        }
+
+        if (len > CHUNK_MAX) {
+            const char *eol = memchr(chunk + CHUNK_MAX - 1, '\n', len - (CHUNK_MAX - 1));
+            len = eol ? (size_t)(eol - chunk) + 1 : len;
+        }
+
+        bool at_end =
+            rs->offset + len == rs->end
+            || (bi->offset + len == blk->size && blk->node.next == bi->head)
+        ;
+
+        if (find_in_chunk(rs, len, at_end, nmatch, matches)) {
+            return true;
+        }
+
+        rs->offset += len;
+        bi->offset += len;
+    }
+
+    return false;
+}
+
+// Move forward to Buffer offset `offset` (which must not be before the
+// current position) and then, if `next_line` is true, to the start of
+// the line after the one containing `offset`
+void regexp_stream_seek(RegexpStream *rs, size_t offset, bool next_line)
+{
+    BUG_ON(offset < rs->offset);
+    BlockIter *bi = &rs->bi;
+    for (size_t count = offset - rs->offset; count; ) {
+        block_iter_normalize(bi);
+        size_t n = MIN(count, bi->blk->size - bi->offset);
+        if (n == 0) {
+            break; // EOF
+        }
+        bi->offset += n;
+        rs->offset += n;
+        count -= n;
+    }
+
+    if (next_line) {
+        rs->offset += block_iter_eat_line(bi);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef REGEXP_STREAM_H
+#define REGEXP_STREAM_H
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "block-iter.h"
+#include "util/macros.h"
+#include "util/string.h"
+
+// State for finding successive matches of a regex in the text of a
+// Buffer, without splitting it into lines (see regexp_stream_next())
+typedef struct {
+    const regex_t *re;
+    BlockIter bi; // Start of the text not yet searched
+    size_t offset; // Buffer offset of `bi`
+    size_t end; // Buffer offset at which the searched text ends
+    size_t stop; // Buffer offset after which no more matches are needed
+    size_t pattern_nl; // Number of newlines in the pattern
+    String joined; // Text copied from both sides of a Block boundary
+    const char *text; // Text that the offsets of the last match are relative to
+    size_t text_len; // Length of `text`
+    size_t text_offset; // Buffer offset of `text`
+} RegexpStream;
+
+void regexp_stream_init(RegexpStream *rs, const regex_t *re, const char *pattern, BlockIter bi, size_t end) NONNULL_ARGS;
+void regexp_stream_reset(RegexpStream *rs, BlockIter bi, size_t end) NONNULL_ARGS;
+bool regexp_stream_next(RegexpStream *rs, size_t nmatch, regmatch_t *matches) NONNULL_ARGS WARN_UNUSED_RESULT;
+void regexp_stream_seek(RegexpStream *rs, size_t offset, bool next_line) NONNULL_ARGS;
+void regexp_stream_free(RegexpStream *rs) NONNULL_ARGS;
+
+#endif
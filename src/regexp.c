@@ -6,12 +6,33 @@
 #include "util/debug.h"
 #include "util/hashmap.h"
 #include "util/intern.h"
+#include "util/ptr-array.h"
 #include "util/xmalloc.h"
 #include "util/xstring.h"
 
 // NOLINTNEXTLINE(*-avoid-non-const-global-variables)
 static HashMap interned_regexps = {.flags = HMAP_BORROWED_KEYS};
 
+enum {
+    REGEXP_CACHE_SIZE = 32,
+};
+
+typedef struct {
+    regex_t re;
+    char *pattern;
+    int flags;
+    unsigned int refcount; // Number of regexp_cache_get() calls not yet released
+} CachedRegexp;
+
+// Regexes compiled by regexp_cache_get(), most recently used first
+// NOLINTNEXTLINE(*-avoid-non-const-global-variables)
+static struct {
+    PointerArray entries;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} regexp_cache;
+
 bool regexp_error_msg(ErrorBuffer *ebuf, const regex_t *re, const char *pattern, int err)
 {
     if (!ebuf) {
@@ -126,6 +147,42 @@ size_t string_append_escaped_regex(String *s, StringView pattern)
     return esc_len;
 }
 
+// If `pattern` (as an ERE) contains no special characters, other than
+// backslash-escaped ones, return the (unescaped) text that it matches
+// literally. Otherwise, return NULL.
+char *regexp_get_literal(const char *pattern)
+{
+    size_t len = strlen(pattern);
+    char *literal = xmalloc(len + 1);
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        char ch = pattern[i];
+        if (ch == '\\') {
+            // Escapes of ordinary characters (e.g. "\w" or "\<") have
+            // special meanings in some implementations
+            ch = pattern[++i];
+            if (!is_regex_special_char(ch)) {
+                goto nonliteral;
+            }
+        } else if (is_regex_special_char(ch) || ch == '\n') {
+            goto nonliteral;
+        }
+        literal[n++] = ch;
+    }
+
+    if (n == 0) {
+        goto nonliteral;
+    }
+
+    literal[n] = '\0';
+    return literal;
+
+nonliteral:
+    free(literal);
+    return NULL;
+}
+
 const InternedRegexp *regexp_intern(ErrorBuffer *ebuf, const char *pattern)
 {
     if (pattern[0] == '\0') {
@@ -165,8 +222,108 @@ static void free_interned_regexp(InternedRegexp *ir)
     free(ir);
 }
 
+// Return the number of bytes used by the regexp_intern() cache and set
+// `*nr_regexps` to the number of entries. Note that the memory allocated
+// internally by regcomp(3) is opaque and thus not included.
+size_t interned_regexps_memory_usage(size_t *nr_regexps)
+{
+    const HashMap *map = &interned_regexps;
+    *nr_regexps = map->count;
+    return hashmap_memory_usage(map) + (map->count * sizeof(InternedRegexp));
+}
+
 void free_interned_regexps(void)
 {
     BUG_ON(!(interned_regexps.flags & HMAP_BORROWED_KEYS));
     hashmap_free(&interned_regexps, FREE_FUNC(free_interned_regexp));
 }
+
+static void free_cached_regexp(CachedRegexp *cr)
+{
+    regfree(&cr->re);
+    free(cr->pattern);
+    free(cr);
+}
+
+// Get a regex compiled from `pattern` with the exact regcomp(3) `flags`
+// given (i.e. DEFAULT_REGEX_FLAGS aren't added implicitly), either from
+// the cache of recently used regexes or by compiling it and adding it to
+// the cache. The returned regex remains valid until it's passed to
+// regexp_cache_release(), after which it may be evicted by another call.
+const regex_t *regexp_cache_get(ErrorBuffer *ebuf, const char *pattern, int flags)
+{
+    PointerArray *entries = &regexp_cache.entries;
+    for (size_t i = 0, n = entries->count; i < n; i++) {
+        CachedRegexp *cr = entries->ptrs[i];
+        if (cr->flags == flags && streq(cr->pattern, pattern)) {
+            ptr_array_move(entries, i, 0);
+            cr->refcount++;
+            regexp_cache.hits++;
+            return &cr->re;
+        }
+    }
+
+    regexp_cache.misses++;
+    CachedRegexp *cr = xmalloc(sizeof(*cr));
+    int err = regcomp(&cr->re, pattern, flags);
+    if (unlikely(err)) {
+        regexp_error_msg(ebuf, &cr->re, pattern, err);
+        free(cr);
+        return NULL;
+    }
+
+    cr->pattern = xstrdup(pattern);
+    cr->flags = flags;
+    cr->refcount = 1;
+    ptr_array_insert(entries, cr, 0);
+
+    // Evict the least recently used regexes, except for those still in
+    // use (which are evicted later, if they remain unused)
+    for (size_t i = entries->count; i > 0 && entries->count > REGEXP_CACHE_SIZE; ) {
+        const CachedRegexp *lru = entries->ptrs[--i];
+        if (lru->refcount == 0) {
+            free_cached_regexp(ptr_array_remove_index(entries, i));
+            regexp_cache.evictions++;
+        }
+    }
+
+    return &cr->re;
+}
+
+void regexp_cache_release(const regex_t *re)
+{
+    if (!re) {
+        return;
+    }
+
+    const PointerArray *entries = &regexp_cache.entries;
+    for (size_t i = 0, n = entries->count; i < n; i++) {
+        CachedRegexp *cr = entries->ptrs[i];
+        if (&cr->re == re) {
+            BUG_ON(cr->refcount == 0);
+            cr->refcount--;
+            return;
+        }
+    }
+
+    BUG("regex not found in cache");
+}
+
+RegexpCacheStats regexp_cache_stats(void)
+{
+    return (RegexpCacheStats) {
+        .hits = regexp_cache.hits,
+        .misses = regexp_cache.misses,
+        .evictions = regexp_cache.evictions,
+        .entries = regexp_cache.entries.count,
+        .capacity = REGEXP_CACHE_SIZE,
+    };
+}
+
+void free_cached_regexps(void)
+{
+    ptr_array_free_cb(&regexp_cache.entries, FREE_FUNC(free_cached_regexp));
+    regexp_cache.hits = 0;
+    regexp_cache.misses = 0;
+    regexp_cache.evictions = 0;
+}
@@ -43,6 +43,15 @@ typedef struct {
     regex_t re; // regex(3) object, compiled with regcomp(3)
 } InternedRegexp;
 
+// Statistics for the regexp_cache_get() cache (see `show regexp`)
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries; // Number of regexes currently cached
+    size_t capacity; // Number of regexes cached before evicting any
+} RegexpCacheStats;
+
 // Platform-specific patterns for matching word boundaries, as detected
 // and initialized by regexp_get_word_boundary_tokens()
 typedef struct {
@@ -57,10 +66,17 @@ bool regexp_error_msg(ErrorBuffer *ebuf, const regex_t *re, const char *pattern,
 char *regexp_escape(const char *pattern, size_t len) NONNULL_ARGS WARN_UNUSED_RESULT;
 size_t regexp_escapeb(char *buf, size_t buflen, const char *pat, size_t plen) NONNULL_ARG(1) NONNULL_ARG_IF_NONZERO_LENGTH(3, 4);
 size_t string_append_escaped_regex(String *s, StringView pattern) NONNULL_ARGS;
+char *regexp_get_literal(const char *pattern) NONNULL_ARGS WARN_UNUSED_RESULT;
 
 const InternedRegexp *regexp_intern(ErrorBuffer *ebuf, const char *pattern) NONNULL_ARG(2) WARN_UNUSED_RESULT;
 bool regexp_is_interned(const char *pattern) NONNULL_ARGS;
 void free_interned_regexps(void);
+size_t interned_regexps_memory_usage(size_t *nr_regexps) NONNULL_ARGS;
+
+const regex_t *regexp_cache_get(ErrorBuffer *ebuf, const char *pattern, int flags) NONNULL_ARG(2) WARN_UNUSED_RESULT;
+void regexp_cache_release(const regex_t *re);
+RegexpCacheStats regexp_cache_stats(void);
+void free_cached_regexps(void);
 
 WARN_UNUSED_RESULT NONNULL_ARG(1, 2) NONNULL_ARG_IF_NONZERO_LENGTH(5, 4)
 bool regexp_exec (
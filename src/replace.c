@@ -1,9 +1,13 @@
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "replace.h"
 #include "buffer.h"
 #include "change.h"
 #include "command/error.h"
 #include "editor.h"
+#include "load-save.h"
+#include "regexp-stream.h"
 #include "regexp.h"
 #include "selection.h"
 #include "ui.h"
@@ -46,47 +50,70 @@ static void build_replacement (
     }
 }
 
+static bool has_newline(BlockIter bi, size_t count)
+{
+    while (count) {
+        block_iter_normalize(&bi);
+        size_t n = MIN(count, bi.blk->size - bi.offset);
+        BUG_ON(n == 0);
+        if (memchr(bi.blk->data + bi.offset, '\n', n)) {
+            return true;
+        }
+        bi.offset += n;
+        count -= n;
+    }
+    return false;
+}
+
+// Continue after a match, or at the start of the next line if only
+// one match per line is to be replaced (or the match was empty)
+static bool skip_to_next_line(const RegexpStream *rs, const regmatch_t *match, ReplaceFlags flags)
+{
+    if (match->rm_so == match->rm_eo) {
+        return true;
+    }
+    // A (multi-line) match ending with a newline already ends at the
+    // start of the next line
+    return !(flags & REPLACE_GLOBAL) && rs->text[match->rm_eo - 1] != '\n';
+}
+
 /*
- * s/abc/x
- *
- * string                to match against
- * -------------------------------------------
- * "foo abc bar abc baz" "foo abc bar abc baz"
- * "foo x bar abc baz"   " bar abc baz"
+ * Interactive counterpart of replace_all(), which moves the cursor to
+ * each match and asks whether it should be replaced (until the answer
+ * is "a" or "q"). Each replacement is a separate Change and invalidates
+ * the text the RegexpStream refers to, so it's reset after each one.
  */
-static unsigned int replace_on_line (
+static unsigned int replace_confirm (
     EditorState *e,
-    StringView line,
-    regex_t *re,
+    const regex_t *re,
+    const char *pattern,
     const char *format,
-    BlockIter *bi,
-    ReplaceFlags *flagsp
+    BlockIter bi,
+    size_t nr_bytes,
+    ReplaceFlags *flagsp,
+    size_t *nr_lines_ptr
 ) {
-    const char *buf = line.data;
     View *view = e->view;
-    char *alloc = NULL;
     ReplaceFlags flags = *flagsp;
+    size_t end = block_iter_get_offset(&bi) + nr_bytes;
+    RegexpStream rs;
+    regexp_stream_init(&rs, re, pattern, bi, end);
     regmatch_t matches[32];
-    size_t pos = 0;
-    int eflags = 0;
+    BlockIter last_end = bi; // End of the last replaced text
+    size_t last_end_offset = SIZE_MAX;
+    size_t nr_lines = 0;
     unsigned int nr = 0;
 
-    while (regexp_exec (
-        re,
-        buf + pos,
-        line.length - pos,
-        ARRAYLEN(matches),
-        matches,
-        eflags
-    )) {
-        regoff_t match_len = matches[0].rm_eo - matches[0].rm_so;
-        bool skip = false;
+    while (regexp_stream_next(&rs, ARRAYLEN(matches), matches)) {
+        size_t so = rs.text_offset + matches[0].rm_so;
+        size_t match_len = matches[0].rm_eo - matches[0].rm_so;
+        bool next_line = skip_to_next_line(&rs, &matches[0], flags);
 
         // Move cursor to beginning of the text to replace
-        block_iter_skip_bytes(bi, matches[0].rm_so);
-        view->cursor = *bi;
+        block_iter_goto_offset(&view->cursor, so);
 
         if (flags & REPLACE_CONFIRM) {
+            bool skip = false;
             e->screen_update |= UPDATE_CURRENT_BUFFER;
             switch (status_prompt(e, "Replace? [Y/n/a/q]", "ynaq")) {
             case 'y':
@@ -96,64 +123,143 @@ static unsigned int replace_on_line (
                 break;
             case 'a':
                 flags &= ~REPLACE_CONFIRM;
-                *flagsp = flags;
 
                 // Record rest of the changes as one chain
                 begin_change_chain();
                 break;
             case 'q':
             case 0:
-                *flagsp = flags | REPLACE_CANCEL;
+                flags |= REPLACE_CANCEL;
                 goto out;
             }
-        }
 
-        if (skip) {
-            // Move cursor after the matched text
-            block_iter_skip_bytes(&view->cursor, match_len);
-        } else {
-            String b = STRING_INIT;
-            build_replacement(&b, buf + pos, format, matches);
-
-            // line ref is invalidated by modification
-            if (buf == line.data && line.length != 0) {
-                BUG_ON(alloc);
-                alloc = xmemdup(buf, line.length);
-                buf = alloc;
+            if (skip) {
+                // Move cursor after the matched text
+                block_iter_skip_bytes(&view->cursor, match_len);
+                regexp_stream_seek(&rs, so + match_len, next_line);
+                continue;
             }
+        }
 
-            buffer_replace_bytes(view, match_len, b.buffer, b.len);
-            nr++;
+        if (last_end_offset == SIZE_MAX || has_newline(last_end, so - last_end_offset)) {
+            nr_lines++;
+        }
 
-            // Update selection length
-            if (view->selection) {
-                view->sel_eo += b.len;
-                view->sel_eo -= match_len;
-            }
+        String b = STRING_INIT;
+        build_replacement(&b, rs.text, format, matches);
+        buffer_replace_bytes(view, match_len, b.buffer, b.len);
+        end = end + b.len - match_len;
+        nr++;
 
-            // Move cursor after the replaced text
-            block_iter_skip_bytes(&view->cursor, b.len);
-            string_free(&b);
+        // Update selection length
+        if (view->selection) {
+            view->sel_eo += b.len;
+            view->sel_eo -= match_len;
         }
-        *bi = view->cursor;
 
-        if (!match_len) {
-            break;
+        // Move cursor after the replaced text
+        block_iter_skip_bytes(&view->cursor, b.len);
+        last_end = view->cursor;
+        last_end_offset = so + b.len;
+        string_free(&b);
+
+        regexp_stream_reset(&rs, view->cursor, end);
+        regexp_stream_seek(&rs, last_end_offset, next_line);
+    }
+
+out:
+    regexp_stream_free(&rs);
+    *flagsp = flags;
+    *nr_lines_ptr = nr_lines;
+    return nr;
+}
+
+/*
+ * Non-interactive counterpart of replace_confirm(), which makes a single
+ * pass over the `nr_bytes` bytes at `bi` to find every match (in the text
+ * as it is before any replacements are made) and then applies all of the
+ * replacements with buffer_replace_edits(). That costs one pass over the
+ * Blocks and one update of the line-based state of the Buffer, instead of
+ * one of each for every match. Only the matched text is removed (and kept
+ * for undo) and the text in between matches is never copied.
+ */
+static unsigned int replace_all (
+    View *view,
+    const regex_t *re,
+    const char *pattern,
+    const char *format,
+    BlockIter bi,
+    size_t nr_bytes,
+    ReplaceFlags flags,
+    size_t *nr_lines_ptr
+) {
+    RegexpStream rs;
+    regexp_stream_init(&rs, re, pattern, bi, block_iter_get_offset(&bi) + nr_bytes);
+    String text = STRING_INIT; // Replacement text of all edits
+    TextEdit *edits = NULL;
+    size_t nr_edits = 0;
+    size_t alloc = 0;
+    regmatch_t matches[32];
+    BlockIter last_end = bi; // End of the last match
+    size_t last_end_offset = SIZE_MAX;
+    size_t nr_lines = 0;
+    unsigned int nr_substitutions = 0;
+
+    while (regexp_stream_next(&rs, ARRAYLEN(matches), matches)) {
+        size_t so = rs.text_offset + matches[0].rm_so;
+        size_t eo = rs.text_offset + matches[0].rm_eo;
+        if (last_end_offset == SIZE_MAX) {
+            block_iter_goto_offset(&last_end, so);
+            last_end_offset = so;
+            nr_lines++;
+        } else if (has_newline(last_end, so - last_end_offset)) {
+            nr_lines++;
         }
 
-        if (!(flags & REPLACE_GLOBAL)) {
-            break;
+        size_t len = text.len;
+        build_replacement(&text, rs.text, format, matches);
+        if (so != eo || text.len != len) {
+            if (nr_edits >= alloc) {
+                alloc = MAX(alloc * 2, 16);
+                edits = xrenew(edits, alloc);
+            }
+            edits[nr_edits++] = (TextEdit) {
+                .offset = so,
+                .del_count = eo - so,
+                .ins_count = text.len - len,
+            };
         }
 
-        pos += matches[0].rm_so + match_len;
+        block_iter_skip_bytes(&last_end, eo - last_end_offset);
+        last_end_offset = eo;
+        nr_substitutions++;
+        regexp_stream_seek(&rs, eo, skip_to_next_line(&rs, &matches[0], flags));
+    }
+
+    regexp_stream_free(&rs);
 
-        // Don't match beginning of line again
-        eflags = REG_NOTBOL;
+    // The replacement text of each edit follows that of the previous one
+    const char *ins = text.buffer;
+    for (size_t i = 0; i < nr_edits; i++) {
+        edits[i].ins = ins;
+        ins += edits[i].ins_count;
     }
 
-out:
-    free(alloc);
-    return nr;
+    // This leaves the cursor after the last replaced text
+    buffer_replace_edits(view, edits, nr_edits);
+
+    if (view->selection) {
+        // Update selection length
+        for (size_t i = 0; i < nr_edits; i++) {
+            view->sel_eo += edits[i].ins_count;
+            view->sel_eo -= edits[i].del_count;
+        }
+    }
+
+    free(edits);
+    string_free(&text);
+    *nr_lines_ptr = nr_lines;
+    return nr_substitutions;
 }
 
 bool reg_replace(EditorState *e, const char *pattern, const char *format, ReplaceFlags flags)
@@ -167,10 +273,9 @@ bool reg_replace(EditorState *e, const char *pattern, const char *format, Replac
     re_flags |= (flags & REPLACE_IGNORE_CASE) ? REG_ICASE : 0;
     re_flags |= (flags & REPLACE_BASIC) ? 0 : DEFAULT_REGEX_FLAGS;
 
-    regex_t re;
-    int err = regcomp(&re, pattern, re_flags);
-    if (unlikely(err)) {
-        return regexp_error_msg(ebuf, &re, pattern, err);
+    const regex_t *re = regexp_cache_get(ebuf, pattern, re_flags);
+    if (unlikely(!re)) {
+        return false;
     }
 
     View *view = e->view;
@@ -186,6 +291,7 @@ bool reg_replace(EditorState *e, const char *pattern, const char *format, Replac
         nr_bytes = info.eo - info.so;
         swapped = info.swapped;
     } else {
+        load_buffer_finish(view->buffer);
         const Block *blk;
         block_for_each(blk, &view->buffer->blocks) {
             nr_bytes += blk->size;
@@ -194,42 +300,22 @@ bool reg_replace(EditorState *e, const char *pattern, const char *format, Replac
         swapped = false;
     }
 
-    // Record multiple changes as one chain only when replacing all
-    if (!(flags & REPLACE_CONFIRM)) {
-        begin_change_chain();
-    }
-
     unsigned int nr_substitutions = 0;
     size_t nr_lines = 0;
-    while (1) {
-        StringView line = block_iter_get_line(&bi);
-
-        // Number of bytes to process
-        size_t count = line.length;
-        if (line.length > nr_bytes) {
-            // End of selection is not full line
-            line.length = nr_bytes;
-        }
-
-        unsigned int nr = replace_on_line(e, line, &re, format, &bi, &flags);
-        if (nr) {
-            nr_substitutions += nr;
-            nr_lines++;
-        }
-
-        if (flags & REPLACE_CANCEL || count + 1 >= nr_bytes) {
-            break;
-        }
-
-        nr_bytes -= count + 1;
-        block_iter_next_line(&bi);
+    if (!(flags & REPLACE_CONFIRM)) {
+        nr_substitutions = replace_all(view, re, pattern, format, bi, nr_bytes, flags, &nr_lines);
+        goto out;
     }
 
+    nr_substitutions = replace_confirm(e, re, pattern, format, bi, nr_bytes, &flags, &nr_lines);
     if (!(flags & REPLACE_CONFIRM)) {
+        // Answering "a" at the prompt records the remaining changes as
+        // one chain (see replace_confirm())
         end_change_chain(view);
     }
 
-    regfree(&re);
+out:
+    regexp_cache_release(re);
 
     if (nr_substitutions) {
         info_msg (
@@ -1,125 +1,288 @@
 #include <stdlib.h>
+#include <string.h>
 #include "search.h"
 #include "block-iter.h"
 #include "buffer.h"
 #include "editor.h"
+#include "load-save.h"
+#include "regexp-stream.h"
 #include "regexp.h"
 #include "util/ascii.h"
 #include "util/xmalloc.h"
+#include "util/xmemmem.h"
+#include "util/xmemrchr.h"
+#include "util/xstring.h"
 #include "window.h"
 
-// Recurses at most once
-// NOLINTNEXTLINE(misc-no-recursion)
-static bool do_search_fwd(View *view, regex_t *regex, BlockIter *bi, bool skip)
+static void goto_match(View *view, BlockIter *bi, size_t offset)
 {
-    int flags = block_iter_is_bol(bi) ? 0 : REG_NOTBOL;
+    block_iter_goto_offset(bi, offset);
+    view->cursor = *bi;
+    view->center_on_scroll = true;
+    view_reset_preferred_x(view);
+}
 
-    do {
-        if (block_iter_is_eof(bi)) {
-            return false;
+static bool do_search_fwd(View *view, const regex_t *regex, const char *pattern, BlockIter *bi, bool skip)
+{
+    RegexpStream rs;
+    regexp_stream_init(&rs, regex, pattern, *bi, SIZE_MAX);
+    const size_t cursor_offset = rs.offset;
+    regmatch_t match;
+    bool found;
+
+    while ((found = regexp_stream_next(&rs, 1, &match))) {
+        size_t offset = rs.text_offset + match.rm_so;
+        if (!skip || offset != cursor_offset) {
+            goto_match(view, bi, offset);
+            break;
+        }
+
+        // Ignore match at current cursor position. It's safe to skip
+        // at least one byte, because every line ends with a newline.
+        size_t count = match.rm_eo - match.rm_so;
+        regexp_stream_seek(&rs, offset + MAX(count, 1), false);
+        skip = false;
+    }
+
+    regexp_stream_free(&rs);
+    return found;
+}
+
+// Find the last match starting before `cx` bytes into the line at `bi`
+// (or anywhere before `bi`, if `cx` is negative). The Blocks before the
+// cursor are searched in reverse order, but matches within each Block are
+// found from the start, so that the same (leftmost, non-overlapping)
+// matches are considered as when searching forwards. The matches found
+// in the cursor's Block are remembered (see MatchList), so that stepping
+// backwards through a long line (or Block) only matches it once, instead
+// of matching all of the text before the cursor again for every step.
+static bool do_search_bwd (
+    View *view,
+    const regex_t *regex,
+    const char *pattern,
+    unsigned int generation,
+    BlockIter *bi,
+    ssize_t cx,
+    bool skip
+) {
+    BlockIter blk_start = *bi;
+    blk_start.offset = 0;
+    size_t start = block_iter_get_offset(&blk_start);
+    size_t limit = start + bi->offset + MAX(cx, 0);
+
+    MatchList *list = &view->buffer->reverse_matches;
+    size_t found = SIZE_MAX;
+    bool cached = list->generation == generation && list->start == start && limit <= list->end;
+    if (cached) {
+        if (match_list_find_last(list, limit, skip, &found)) {
+            goto_match(view, bi, found);
+            return true;
         }
+    } else {
+        match_list_reset(list, generation, start, limit);
+    }
+
+    RegexpStream rs;
+    regexp_stream_init(&rs, regex, pattern, blk_start, SIZE_MAX);
 
+    while (1) {
+        rs.stop = limit;
         regmatch_t match;
-        StringView line = block_iter_get_line(bi);
-
-        // NOTE: If this is the first iteration then `line.data` contains
-        // a partial line (text starting from the cursor position) and if
-        // `match.rm_so` is 0 then the match is at the beginning of the
-        // text, which is the same as the cursor position.
-        if (regexp_exec(regex, line.data, line.length, 1, &match, flags)) {
-            if (skip && match.rm_so == 0) {
-                // Ignore match at current cursor position
-                regoff_t count = match.rm_eo;
-                if (count == 0) {
-                    // It is safe to skip one byte because every line
-                    // has one extra byte (newline) that is not in line.data
-                    count = 1;
-                }
-                block_iter_skip_bytes(bi, (size_t)count);
-                return do_search_fwd(view, regex, bi, false);
+        while (!cached && regexp_stream_next(&rs, 1, &match)) {
+            size_t so = rs.text_offset + match.rm_so;
+            size_t eo = rs.text_offset + match.rm_eo;
+            if (so >= limit) {
+                // Ignore match at or after cursor
+                break;
+            }
+            if (list) {
+                match_list_append(list, so, eo);
+            }
+            if (skip && eo > limit) {
+                // Ignore match overlapping the word under the cursor
+                // (for `search -rw`)
+                break;
             }
+            // This might be what we want (last match before cursor)
+            found = so;
+            // Continue after the match or, for zero length matches, at
+            // the start of the next line
+            regexp_stream_seek(&rs, eo, so == eo);
+        }
 
-            block_iter_skip_bytes(bi, match.rm_so);
-            view->cursor = *bi;
-            view->center_on_scroll = true;
-            view_reset_preferred_x(view);
-            return true;
+        if (found != SIZE_MAX) {
+            goto_match(view, bi, found);
+            break;
         }
 
-        skip = false; // Not at cursor position any more
-        flags = 0;
-    } while (block_iter_next_line(bi));
+        const Block *blk = blk_start.blk;
+        if (blk->node.prev == blk_start.head) {
+            break;
+        }
 
-    return false;
+        limit = block_iter_get_offset(&blk_start);
+        blk_start.blk = BLOCK(blk->node.prev);
+        regexp_stream_reset(&rs, blk_start, SIZE_MAX);
+        skip = false;
+        cached = false;
+        list = NULL; // Only the matches in the cursor's Block are kept
+    }
+
+    regexp_stream_free(&rs);
+    return found != SIZE_MAX;
 }
 
-static bool do_search_bwd(View *view, regex_t *regex, BlockIter *bi, ssize_t cx, bool skip)
+typedef struct {
+    const char *str;
+    size_t len;
+    bool icase;
+    bool can_overlap; // Whether 2 matches can overlap (e.g. "aa" in "aaa")
+} LiteralPattern;
+
+static const char *find_literal(const LiteralPattern *lit, const char *buf, size_t len)
 {
-    if (block_iter_is_eof(bi)) {
-        goto next;
+    if (len < lit->len) {
+        return NULL;
+    }
+    if (lit->icase) {
+        return xmemmem_icase(buf, len, lit->str, lit->len);
     }
+    return xmemmem(buf, len, lit->str, lit->len);
+}
 
-    do {
-        regmatch_t match;
-        int flags = 0;
-        regoff_t offset = -1;
-        regoff_t pos = 0;
-        StringView line = block_iter_get_line(bi);
-
-        while (
-            pos <= line.length
-            && regexp_exec(regex, line.data + pos, line.length - pos, 1, &match, flags)
-        ) {
-            flags = REG_NOTBOL;
-            if (cx >= 0) {
-                if (pos + match.rm_so >= cx) {
-                    // Ignore match at or after cursor
-                    break;
-                }
-                if (skip && pos + match.rm_eo > cx) {
-                    // Search -rw should not find word under cursor
-                    break;
-                }
-            }
+static const char *rfind_literal(const LiteralPattern *lit, const char *buf, size_t len)
+{
+    if (lit->icase) {
+        return xmemrmem_icase(buf, len, lit->str, lit->len);
+    }
+    return xmemrmem(buf, len, lit->str, lit->len);
+}
 
-            // This might be what we want (last match before cursor)
-            offset = pos + match.rm_so;
-            pos += match.rm_eo;
+static void goto_literal_match(View *view, BlockIter *bi, Block *blk, size_t offset)
+{
+    bi->blk = blk;
+    bi->offset = offset;
+    view->cursor = *bi;
+    view->center_on_scroll = true;
+    view_reset_preferred_x(view);
+}
 
-            if (match.rm_so == match.rm_eo) {
-                // Zero length match
-                break;
+// Like do_search_fwd(), but for patterns that match literally (see
+// regexp_get_literal()). Such matches can never span multiple lines
+// and therefore never span multiple Blocks either, so the data of each
+// Block can be scanned as a whole, instead of calling regexec(3) for
+// every line.
+static bool do_search_fwd_literal(View *view, const LiteralPattern *lit, BlockIter *bi, bool skip)
+{
+    Block *blk = bi->blk;
+    size_t offset = bi->offset;
+
+    while (1) {
+        const char *match = find_literal(lit, blk->data + offset, blk->size - offset);
+        if (match) {
+            size_t pos = (size_t)(match - blk->data);
+            if (skip && pos == offset) {
+                // Ignore match at current cursor position
+                offset += lit->len;
+                skip = false;
+                continue;
             }
+            goto_literal_match(view, bi, blk, pos);
+            return true;
+        }
+
+        if (blk->node.next == bi->head) {
+            return false;
+        }
+
+        blk = BLOCK(blk->node.next);
+        offset = 0;
+        skip = false;
+    }
+}
+
+// Find the last (non-overlapping, leftmost-first) match between `pos`
+// and `limit` in `blk`, by scanning forwards from `pos`, which must be
+// the start of a line
+static const char *find_last_literal (
+    const LiteralPattern *lit,
+    const Block *blk,
+    size_t pos,
+    size_t limit,
+    bool skip
+) {
+    const char *found = NULL;
+    while (pos < limit) {
+        const char *match = find_literal(lit, blk->data + pos, blk->size - pos);
+        if (!match) {
+            break;
+        }
+        size_t start = (size_t)(match - blk->data);
+        if (start >= limit || (skip && start + lit->len > limit)) {
+            break;
+        }
+        found = match;
+        pos = start + lit->len;
+    }
+    return found;
+}
+
+// Like do_search_bwd(), but for patterns that match literally. The same
+// (non-overlapping, leftmost-first) matches are found as in the regex
+// version, but since such matches never span lines and (if the pattern
+// can't overlap itself) every occurrence of the pattern is also a match,
+// the text can be searched in reverse, instead of scanning each Block
+// forwards from the start.
+static bool do_search_bwd_literal(View *view, const LiteralPattern *lit, BlockIter *bi, ssize_t cx, bool skip)
+{
+    Block *blk = bi->blk;
+
+    // Only matches starting before `limit` (and, if `skip` is true, also
+    // ending at or before it) are considered
+    size_t limit = (cx >= 0) ? bi->offset + cx : blk->size;
+
+    while (1) {
+        size_t end = skip ? limit : MIN(limit + lit->len - 1, blk->size);
+        const char *found = rfind_literal(lit, blk->data, end);
+        if (found && lit->can_overlap) {
+            // Occurrences in the same line may overlap each other, so
+            // the line has to be scanned forwards, as when searching
+            // forwards (e.g. "aa" matches "aaa" only at offset 0)
+            size_t pos = (size_t)(found - blk->data);
+            const char *nl = xmemrchr(blk->data, '\n', pos);
+            pos = nl ? (size_t)(nl - blk->data) + 1 : 0;
+            found = find_last_literal(lit, blk, pos, limit, skip);
+            BUG_ON(!found);
         }
 
-        if (offset >= 0) {
-            block_iter_skip_bytes(bi, offset);
-            view->cursor = *bi;
-            view->center_on_scroll = true;
-            view_reset_preferred_x(view);
+        if (found) {
+            goto_literal_match(view, bi, blk, (size_t)(found - blk->data));
             return true;
         }
 
-        next:
-        cx = -1;
-    } while (block_iter_prev_line(bi));
+        if (blk->node.prev == bi->head) {
+            return false;
+        }
 
-    return false;
+        blk = BLOCK(blk->node.prev);
+        limit = blk->size;
+        skip = false;
+    }
 }
 
 bool search_tag(View *view, ErrorBuffer *ebuf, const char *pattern)
 {
     // DEFAULT_REGEX_FLAGS is not used here because pattern has been
     // escaped by parse_ex_pattern() for use as a POSIX BRE
-    regex_t regex;
-    int err = regcomp(&regex, pattern, REG_NEWLINE);
-    if (unlikely(err)) {
-        regexp_error_msg(ebuf, &regex, pattern, err);
+    const regex_t *regex = regexp_cache_get(ebuf, pattern, REG_NEWLINE);
+    if (unlikely(!regex)) {
+        return false;
     }
 
+    load_buffer_finish(view->buffer);
     BlockIter bi = block_iter(view->buffer);
-    bool found = do_search_fwd(view, &regex, &bi, false);
-    regfree(&regex);
+    bool found = do_search_fwd(view, regex, pattern, &bi, false);
+    regexp_cache_release(regex);
 
     if (!found) {
         // Don't center view to cursor unnecessarily
@@ -136,42 +299,134 @@ static bool has_upper(const char *str)
     return strview_contains_char_type(strview(str), ASCII_UPPER);
 }
 
-static bool update_regex(SearchState *search, ErrorBuffer *ebuf, SearchCaseSensitivity cs)
+static bool is_icase(const char *pattern, SearchCaseSensitivity cs)
 {
-    const char *pattern = search->pattern;
-    bool icase = (cs == CSS_FALSE) || (cs == CSS_AUTO && !has_upper(pattern));
-    int flags = REG_NEWLINE | (icase ? REG_ICASE : 0);
-    if (flags == search->re_flags) {
-        return true;
+    return (cs == CSS_FALSE) || (cs == CSS_AUTO && !has_upper(pattern));
+}
+
+static bool is_ascii(const char *str)
+{
+    for (size_t i = 0; str[i]; i++) {
+        if ((unsigned char)str[i] >= 0x80) {
+            return false;
+        }
     }
+    return true;
+}
 
-    if (search->re_flags) {
-        regfree(&search->regex);
-        search->re_flags = 0;
+// Return true if some proper prefix of `str` is also a suffix of it,
+// in which case 2 occurrences of `str` can overlap
+static bool has_border(const char *str, size_t len, bool icase)
+{
+    for (size_t n = 1; n < len; n++) {
+        const char *suffix = str + len - n;
+        if (icase ? mem_equal_icase(str, suffix, n) : mem_equal(str, suffix, n)) {
+            return true;
+        }
     }
+    return false;
+}
 
-    if (regexp_compile(ebuf, &search->regex, pattern, flags)) {
-        search->re_flags = flags;
+// Return true (and initialize `lit`) if the literal fast path can be
+// used for the current search, i.e. if the pattern contains no special
+// characters and (for case-insensitive searches) only ASCII characters,
+// since REG_ICASE may also fold the case of non-ASCII characters
+static bool get_literal_pattern(const SearchState *search, bool icase, LiteralPattern *lit)
+{
+    const char *literal = search->literal;
+    if (!literal || (icase && !is_ascii(literal))) {
+        return false;
+    }
+    *lit = (LiteralPattern) {
+        .str = literal,
+        .len = strlen(literal),
+        .icase = icase,
+        .can_overlap = has_border(literal, strlen(literal), icase),
+    };
+    return true;
+}
+
+static bool update_regex(SearchState *search, ErrorBuffer *ebuf, bool icase)
+{
+    const char *pattern = search->pattern;
+    int flags = DEFAULT_REGEX_FLAGS | REG_NEWLINE | (icase ? REG_ICASE : 0);
+    if (search->regex && flags == search->re_flags) {
         return true;
     }
 
-    regfree(&search->regex);
-    return false;
+    regexp_cache_release(search->regex);
+    search->regex = regexp_cache_get(ebuf, pattern, flags);
+    if (!search->regex) {
+        return false;
+    }
+
+    // Generations are unique across all SearchStates, so that the
+    // caches keyed by them (see MatchCache) can't be confused by
+    // another SearchState having compiled a different pattern
+    static unsigned int generation; // NOLINT(*-avoid-non-const-global-variables)
+    search->re_flags = flags;
+    search->generation = ++generation;
+    return true;
 }
 
 void search_free_regexp(SearchState *search)
 {
-    if (search->re_flags) {
-        regfree(&search->regex);
-        search->re_flags = 0;
-    }
+    regexp_cache_release(search->regex);
     free(search->pattern);
+    free(search->literal);
+    search->regex = NULL;
+    search->pattern = NULL;
+    search->literal = NULL;
 }
 
 void search_set_regexp(SearchState *search, const char *pattern)
 {
     search_free_regexp(search);
     search->pattern = xstrdup(pattern);
+    search->literal = regexp_get_literal(pattern);
+}
+
+// Get the regex for the most recent search pattern, compiled with the
+// same case sensitivity as the most recent search (e.g. for highlighting
+// its matches), or NULL if there's no pattern
+const regex_t *search_get_regex(SearchState *search)
+{
+    if (!search->pattern || !update_regex(search, NULL, search->icase)) {
+        return NULL;
+    }
+    return search->regex;
+}
+
+static bool do_search_next_literal (
+    View *view,
+    const SearchState *search,
+    ErrorBuffer *ebuf,
+    const LiteralPattern *lit,
+    bool skip
+) {
+    load_buffer_finish(view->buffer);
+
+    BlockIter bi = view->cursor;
+    if (!search->reverse) {
+        if (do_search_fwd_literal(view, lit, &bi, true)) {
+            return true;
+        }
+        block_iter_bof(&bi);
+        if (do_search_fwd_literal(view, lit, &bi, false)) {
+            return info_msg(ebuf, "Continuing at top");
+        }
+    } else {
+        size_t cursor_x = block_iter_bol(&bi);
+        if (do_search_bwd_literal(view, lit, &bi, cursor_x, skip)) {
+            return true;
+        }
+        block_iter_eof(&bi);
+        if (do_search_bwd_literal(view, lit, &bi, -1, false)) {
+            return info_msg(ebuf, "Continuing at bottom");
+        }
+    }
+
+    return error_msg(ebuf, "Pattern '%s' not found", search->pattern);
 }
 
 bool do_search_next(View *view, SearchState *search, ErrorBuffer *ebuf, SearchCaseSensitivity cs, bool skip)
@@ -179,27 +434,38 @@ bool do_search_next(View *view, SearchState *search, ErrorBuffer *ebuf, SearchCa
     if (!search->pattern) {
         return error_msg(ebuf, "No previous search pattern");
     }
-    if (!update_regex(search, ebuf, cs)) {
+
+    bool icase = is_icase(search->pattern, cs);
+    search->icase = icase;
+    view->buffer->match_count.enabled = true; // See continue_match_count()
+    LiteralPattern lit;
+    if (get_literal_pattern(search, icase, &lit)) {
+        return do_search_next_literal(view, search, ebuf, &lit, skip);
+    }
+
+    if (!update_regex(search, ebuf, icase)) {
         return false;
     }
 
+    load_buffer_finish(view->buffer);
+
     BlockIter bi = view->cursor;
-    regex_t *regex = &search->regex;
+    const regex_t *regex = search->regex;
     if (!search->reverse) {
-        if (do_search_fwd(view, regex, &bi, true)) {
+        if (do_search_fwd(view, regex, search->pattern, &bi, true)) {
             return true;
         }
         block_iter_bof(&bi);
-        if (do_search_fwd(view, regex, &bi, false)) {
+        if (do_search_fwd(view, regex, search->pattern, &bi, false)) {
             return info_msg(ebuf, "Continuing at top");
         }
     } else {
         size_t cursor_x = block_iter_bol(&bi);
-        if (do_search_bwd(view, regex, &bi, cursor_x, skip)) {
+        if (do_search_bwd(view, regex, search->pattern, search->generation, &bi, cursor_x, skip)) {
             return true;
         }
         block_iter_eof(&bi);
-        if (do_search_bwd(view, regex, &bi, -1, false)) {
+        if (do_search_bwd(view, regex, search->pattern, search->generation, &bi, -1, false)) {
             return info_msg(ebuf, "Continuing at bottom");
         }
     }
@@ -14,9 +14,12 @@ typedef enum {
 } SearchCaseSensitivity;
 
 typedef struct {
-    regex_t regex;
+    const regex_t *regex; // From regexp_cache_get() (or NULL, if not yet compiled)
     char *pattern;
-    int re_flags; // If zero, regex hasn't been compiled
+    char *literal; // Text matched by `pattern`, if it has no special characters
+    int re_flags; // Flags `regex` was compiled with
+    unsigned int generation; // Changed (to a unique value) whenever `regex` is compiled
+    bool icase; // Whether the most recent search was case-insensitive
     bool reverse;
 } SearchState;
 
@@ -44,6 +47,7 @@ static inline bool search_prev(View *view, SearchState *search, ErrorBuffer *ebu
 
 bool search_tag(View *view, ErrorBuffer *ebuf, const char *pattern) NONNULL_ARG(1, 3) WARN_UNUSED_RESULT;
 void search_set_regexp(SearchState *search, const char *pattern) NONNULL_ARGS;
+const regex_t *search_get_regex(SearchState *search) NONNULL_ARGS;
 void search_free_regexp(SearchState *search) NONNULL_ARGS;
 
 #endif
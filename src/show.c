@@ -21,6 +21,7 @@
 #include "mode.h"
 #include "msg.h"
 #include "options.h"
+#include "regexp.h"
 #include "syntax/color.h"
 #include "tag.h"
 #include "terminal/cursor.h"
@@ -32,6 +33,7 @@
 #include "util/environ.h"
 #include "util/intern.h"
 #include "util/log.h"
+#include "util/numtostr.h"
 #include "util/unicode.h"
 #include "util/xmalloc.h"
 #include "util/xsnprintf.h"
@@ -587,6 +589,196 @@ static String dump_options_and_fileopts(EditorState *e)
     return str;
 }
 
+typedef struct {
+    const Buffer *buffer;
+    BufferMemoryUsage usage;
+    uintmax_t total;
+} BufferMemoryEntry;
+
+static int buffer_memory_cmp(const void *ap, const void *bp)
+{
+    const BufferMemoryEntry *a = ap;
+    const BufferMemoryEntry *b = bp;
+    return (a->total < b->total) - (a->total > b->total); // Descending
+}
+
+// Get the memory usage of every Buffer, sorted by largest total first
+static BufferMemoryEntry *get_buffers_memory_usage(const PointerArray *buffers)
+{
+    const size_t count = buffers->count;
+    BufferMemoryEntry *array = xmallocarray(count, sizeof(*array));
+    for (size_t i = 0; i < count; i++) {
+        BufferMemoryEntry *entry = &array[i];
+        entry->buffer = buffers->ptrs[i];
+        buffer_get_memory_usage(entry->buffer, &entry->usage);
+        entry->total = buffer_memory_total(&entry->usage);
+    }
+    qsort(array, count, sizeof(array[0]), buffer_memory_cmp);
+    return array;
+}
+
+typedef struct {
+    const char *name;
+    size_t count;
+    size_t bytes;
+} GlobalMemoryUsage;
+
+static void get_global_memory_usage(const EditorState *e, GlobalMemoryUsage usage[static 5])
+{
+    size_t nr_strings, nr_regexps;
+    size_t string_bytes = interned_strings_memory_usage(&nr_strings);
+    size_t regexp_bytes = interned_regexps_memory_usage(&nr_regexps);
+    usage[0] = (GlobalMemoryUsage){"interned_strings", nr_strings, string_bytes};
+    usage[1] = (GlobalMemoryUsage){"interned_regexps", nr_regexps, regexp_bytes};
+
+    const History *ch = &e->command_history;
+    const History *sh = &e->search_history;
+    const FileHistory *fh = &e->file_history;
+    usage[2] = (GlobalMemoryUsage){"command_history", ch->entries.count, history_memory_usage(ch)};
+    usage[3] = (GlobalMemoryUsage){"search_history", sh->entries.count, history_memory_usage(sh)};
+    usage[4] = (GlobalMemoryUsage){"file_history", fh->entries.count, file_history_memory_usage(fh)};
+}
+
+static String dump_memory(EditorState *e)
+{
+    const size_t nr_buffers = e->buffers.count;
+    BufferMemoryEntry *array = get_buffers_memory_usage(&e->buffers);
+    String buf = string_new(1024 + (nr_buffers * 128));
+    char total[HRSIZE_MAX], text[HRSIZE_MAX], slack[HRSIZE_MAX];
+    char undo[HRSIZE_MAX], states[HRSIZE_MAX], other[HRSIZE_MAX];
+
+    string_append_literal (
+        &buf,
+        "Buffers:\n--------\n\n"
+        "     Total       Text      Slack       Undo     States      Other"
+        "   Blocks  Changes     ID  Name\n"
+    );
+
+    uintmax_t grand_total = 0;
+    for (size_t i = 0; i < nr_buffers; i++) {
+        const BufferMemoryEntry *entry = &array[i];
+        const BufferMemoryUsage *u = &entry->usage;
+        uintmax_t undo_bytes = u->undo_text + u->undo_other;
+        uintmax_t other_bytes = u->block_headers + u->heredoc_bytes;
+        grand_total += entry->total;
+        string_sprintf (
+            &buf,
+            "%10s %10s %10s %10s %10s %10s %8ju %8ju %6lu  %s\n",
+            human_readable_size(entry->total, total),
+            human_readable_size(u->block_payload, text),
+            human_readable_size(u->block_slack, slack),
+            human_readable_size(undo_bytes, undo),
+            human_readable_size(u->line_states_bytes, states),
+            human_readable_size(other_bytes, other),
+            u->blocks,
+            u->changes,
+            entry->buffer->id,
+            buffer_filename(entry->buffer)
+        );
+    }
+
+    string_sprintf(&buf, "%10s  (all buffers)\n", human_readable_size(grand_total, total));
+    free(array);
+
+    GlobalMemoryUsage global[5];
+    get_global_memory_usage(e, global);
+    string_append_literal(&buf, "\nGlobal:\n-------\n\n     Total    Entries  Name\n");
+    for (size_t i = 0; i < ARRAYLEN(global); i++) {
+        const GlobalMemoryUsage *g = &global[i];
+        string_sprintf (
+            &buf,
+            "%10s %10zu  %s\n",
+            human_readable_size(g->bytes, total),
+            g->count,
+            g->name
+        );
+    }
+
+    string_append_literal (
+        &buf,
+        "\nNotes:\n------\n\n"
+        "• Mapped file contents (see `mmap-threshold`) aren't included\n"
+        "• \"Other\" is Block structs and states merged for heredocs\n"
+        "  (which belong to the syntax and may be shared between buffers)\n"
+        "• Memory allocated internally by regcomp(3) isn't included\n"
+    );
+
+    return buf;
+}
+
+// Like dump_memory(), but in a format that's trivial to parse (i.e.
+// one "name value" pair per line, with values in exact bytes/counts)
+static String dump_memory_stats(EditorState *e)
+{
+    const size_t nr_buffers = e->buffers.count;
+    BufferMemoryEntry *array = get_buffers_memory_usage(&e->buffers);
+    String buf = string_new(1024 + (nr_buffers * 512));
+
+    for (size_t i = 0; i < nr_buffers; i++) {
+        const BufferMemoryEntry *entry = &array[i];
+        const BufferMemoryUsage *u = &entry->usage;
+        const unsigned long id = entry->buffer->id;
+        const struct {
+            const char *name;
+            uintmax_t value;
+        } fields[] = {
+            {"total", entry->total},
+            {"blocks", u->blocks},
+            {"block_headers", u->block_headers},
+            {"block_payload", u->block_payload},
+            {"block_slack", u->block_slack},
+            {"block_mapped", u->block_mapped},
+            {"arena_slabs", u->arena_slabs},
+            {"changes", u->changes},
+            {"undo_text", u->undo_text},
+            {"undo_other", u->undo_other},
+            {"line_start_states", u->line_states},
+            {"line_start_states_bytes", u->line_states_bytes},
+            {"heredoc_states", u->heredoc_states},
+            {"heredoc_states_bytes", u->heredoc_bytes},
+        };
+        for (size_t j = 0; j < ARRAYLEN(fields); j++) {
+            string_sprintf(&buf, "buffer.%lu.%s %ju\n", id, fields[j].name, fields[j].value);
+        }
+    }
+
+    free(array);
+    GlobalMemoryUsage global[5];
+    get_global_memory_usage(e, global);
+    for (size_t i = 0; i < ARRAYLEN(global); i++) {
+        const GlobalMemoryUsage *g = &global[i];
+        string_sprintf(&buf, "global.%s.count %zu\n", g->name, g->count);
+        string_sprintf(&buf, "global.%s.bytes %zu\n", g->name, g->bytes);
+    }
+
+    return buf;
+}
+
+static String dump_regexp_cache(EditorState* UNUSED_ARG(e))
+{
+    const RegexpCacheStats stats = regexp_cache_stats();
+    const size_t lookups = stats.hits + stats.misses;
+    const unsigned int hit_pct = lookups ? (unsigned int)((stats.hits * 100) / lookups) : 0;
+    size_t nr_interned;
+    interned_regexps_memory_usage(&nr_interned);
+    String buf = string_new(512);
+    string_sprintf (
+        &buf,
+        "Compiled regex cache:\n---------------------\n\n"
+        "   Entries: %zu (of %zu)\n"
+        "      Hits: %zu (%u%%)\n"
+        "    Misses: %zu\n"
+        " Evictions: %zu\n"
+        "\nInterned regexes (for filetypes and file options): %zu\n",
+        stats.entries, stats.capacity,
+        stats.hits, hit_pct,
+        stats.misses,
+        stats.evictions,
+        nr_interned
+    );
+    return buf;
+}
+
 static String dump_paste(EditorState *e)
 {
     const Clipboard *clip = &e->clipboard;
@@ -621,10 +813,13 @@ static const ShowHandler show_handlers[] = {
     {"hi", DTERC, do_dump_hl_styles, show_color, collect_hl_styles},
     {"include", 0, do_dump_builtin_configs, show_builtin, do_collect_builtin_includes},
     {"macro", DTERC, do_dump_macro, NULL, NULL},
+    {"memory", 0, dump_memory, NULL, NULL},
+    {"memstats", 0, dump_memory_stats, NULL, NULL},
     {"msg", MSGLINE, do_dump_messages_a, show_msg, collect_show_msg_args},
     {"open", LASTLINE, dump_file_history, NULL, NULL},
     {"option", DTERC, dump_options_and_fileopts, show_option, collect_all_options},
     {"paste", 0, dump_paste, NULL, NULL},
+    {"regexp", 0, dump_regexp_cache, NULL, NULL},
     {"search", LASTLINE, dump_search_history, NULL, NULL},
     {"set", DTERC, do_dump_options, show_option, collect_all_options},
     {"setenv", DTERC, dump_setenv, show_env, do_collect_env},
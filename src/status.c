@@ -3,6 +3,8 @@
 #include <string.h>
 #include "status.h"
 #include "cmdline.h"
+#include "editor.h"
+#include "match-cache.h"
 #include "search.h"
 #include "selection.h"
 #include "util/debug.h"
@@ -201,6 +203,38 @@ static void add_status_pos(Formatter *f)
     }
 }
 
+// Show the index of the search match at the cursor and the total number
+// of matches (as counted by continue_match_count()), e.g. as "[3/17]", or
+// as "[3/17+]" or "[?/17+]" while still counting
+static void add_search_position(Formatter *f)
+{
+    const View *view = f->window->view;
+    const Buffer *buffer = view->buffer;
+    if (likely(!buffer->match_count.enabled)) {
+        return;
+    }
+
+    SearchState *search = &f->window->editor->search;
+    const regex_t *re = search_get_regex(search);
+    MatchPosition pos;
+    if (
+        !re
+        || !match_count_get_position (
+            &buffer->match_count, re, search->pattern, search->generation,
+            view->cursor, view->cy, &pos
+        )
+    ) {
+        return;
+    }
+
+    const char *plus = pos.partial ? "+" : "";
+    if (pos.index == 0) {
+        add_status_format(f, "[?/%zu%s]", pos.total, plus);
+    } else {
+        add_status_format(f, "[%zu/%zu%s]", pos.index, pos.total, plus);
+    }
+}
+
 static void add_misc_status(Formatter *f)
 {
     static const struct {
@@ -221,6 +255,7 @@ static void add_misc_status(Formatter *f)
 
     const View *view = f->window->view;
     if (view->selection == SELECT_NONE) {
+        add_search_position(f);
         return;
     }
 
@@ -0,0 +1,1057 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.h"
+#include "config.h"
+#include "editor.h"
+#include "syntax/bitset.h"
+#include "syntax/merge.h"
+#include "util/debug.h"
+#include "util/hash.h"
+#include "util/hashset.h"
+#include "util/intern.h"
+#include "util/log.h"
+#include "util/path.h"
+#include "util/readfile.h"
+#include "util/string.h"
+#include "util/xmalloc.h"
+#include "util/xreadwrite.h"
+#include "util/xstring.h"
+#include "version.h"
+
+/*
+ * When the `syntax-cache` option is enabled, the syntaxes defined by each
+ * successful call to load_syntax() are saved to $DTE_HOME/syntax-cache/<hash>,
+ * where <hash> is derived from the filename passed to load_syntax(). Each
+ * cache file consists of a SyntaxCacheHeader, followed by the dte version,
+ * the filename and then the body, which contains:
+ *
+ * • Every file read by the "include" and "require" commands, along with
+ *   the length and hash of its contents (see SyntaxSource)
+ * • The number of prefixes used by merge_syntax() at the time of saving
+ * • Every Syntax defined by the loaded text (or by the files it read),
+ *   including all of its lists, default styles, states and conditions
+ *
+ * A cache file is only used if the dte version, the loaded text and the
+ * contents of every file it read are the same as when it was saved, in
+ * which case loading it costs an mmap(3) call and a single pass over the
+ * body, instead of parsing and running every command. Files that were
+ * read by "require" are skipped if they've already been required (exactly
+ * as cmd_require() would do) and the syntaxes defined by them are then
+ * looked up by name, instead of being decoded again.
+ *
+ * All integers in the body are variable-length (as in serialize_changes())
+ * and strings are prefixed by their length. The states of each Syntax are
+ * referred to by index and other syntaxes (and their lists) by name. Since
+ * the cache is only an optimization, any failure to read or write it is
+ * only logged and load_syntax() simply falls back to parsing the text.
+ */
+
+typedef struct {
+    char magic[8];
+    uint64_t flags; // SyntaxLoadFlags
+    uint64_t version_len;
+    uint64_t filename_len;
+    uint64_t text_len;
+    uint64_t text_hash;
+    uint64_t body_len;
+    uint64_t body_hash;
+} SyntaxCacheHeader;
+
+// Bits of the flags stored for each SyntaxSource, Syntax, StringList
+// and State
+enum {
+    CF_SOURCE_BUILTIN = 1 << 0,
+    CF_SOURCE_REQUIRED = 1 << 1,
+    CF_SYNTAX_HEREDOC = 1 << 0,
+    CF_SYNTAX_USED = 1 << 1,
+    CF_SYNTAX_WARNED = 1 << 2,
+    CF_LIST_USED = 1 << 0,
+    CF_LIST_DEFINED = 1 << 1,
+    CF_LIST_ICASE = 1 << 2,
+    CF_STATE_DEFINED = 1 << 0,
+    CF_STATE_VISITED = 1 << 1,
+    CF_STATE_COPIED = 1 << 2,
+};
+
+static const char syntax_cache_magic[8] = "dtesyn01";
+
+static char *get_cache_file_path(const char *dir, const char *filename, SyntaxLoadFlags flags)
+{
+    uintmax_t hash = fnv_1a_hash(filename, strlen(filename));
+    return xasprintf("%s/syntax-cache/%016jx.%u", dir, hash, (unsigned int)flags);
+}
+
+static SyntaxCacheHeader make_header (
+    SyntaxLoadFlags flags,
+    StringView text,
+    size_t filename_len,
+    StringView body
+) {
+    SyntaxCacheHeader header = {
+        .flags = flags,
+        .version_len = STRLEN(VERSION),
+        .filename_len = filename_len,
+        .text_len = text.length,
+        .text_hash = fnv_1a_hash(text.data, text.length),
+        .body_len = body.length,
+        .body_hash = fnv_1a_hash(body.data, body.length),
+    };
+    memcpy(header.magic, syntax_cache_magic, sizeof(header.magic));
+    return header;
+}
+
+// Get the length and hash of the current contents of a file read by
+// the "include" or "require" commands
+static bool hash_source(const char *path, bool builtin, size_t *lenp, size_t *hashp)
+{
+    if (builtin) {
+        const BuiltinConfig *cfg = get_builtin_config(path);
+        if (!cfg) {
+            return false;
+        }
+        *lenp = cfg->text.length;
+        *hashp = fnv_1a_hash(cfg->text.data, cfg->text.length);
+        return true;
+    }
+
+    char *buf;
+    ssize_t size = read_file(path, &buf, 0);
+    if (size < 0) {
+        return false;
+    }
+
+    *lenp = size;
+    *hashp = fnv_1a_hash(buf, size);
+    free(buf);
+    return true;
+}
+
+// Record a file about to be read by the "include" or "require" commands
+// and return its index
+size_t syntax_recording_add_source (
+    SyntaxRecording *rec,
+    const char *path,
+    SyntaxLoadFlags flags,
+    bool required
+) {
+    SyntaxSource *src = xmalloc(sizeof(*src));
+    *src = (SyntaxSource) {
+        .path = xstrdup(path),
+        .parent = rec->current_source,
+        .builtin = !!(flags & SYN_BUILTIN),
+        .required = required,
+    };
+
+    if (!hash_source(path, src->builtin, &src->text_len, &src->text_hash)) {
+        rec->uncacheable = true;
+    }
+
+    ptr_array_append(&rec->sources, src);
+    return rec->sources.count;
+}
+
+static void free_source(SyntaxSource *src)
+{
+    free(src->path);
+    free(src);
+}
+
+void syntax_recording_free(SyntaxRecording *rec)
+{
+    ptr_array_free_cb(&rec->sources, FREE_FUNC(free_source));
+    ptr_array_free(&rec->syntaxes);
+}
+
+static void append_uint(String *buf, uintmax_t x)
+{
+    for (; x >= 0x80; x >>= 7) {
+        string_append_byte(buf, (x & 0x7F) | 0x80);
+    }
+    string_append_byte(buf, x);
+}
+
+static void append_str(String *buf, const char *str, size_t len)
+{
+    append_uint(buf, len);
+    string_append_buf(buf, str, len);
+}
+
+static void append_cstr(String *buf, const char *str)
+{
+    append_str(buf, str, strlen(str));
+}
+
+// Append `str` with a length prefix of 1 more than its length, or a
+// length prefix of 0, if `str` is NULL
+static void append_optional_str(String *buf, const char *str)
+{
+    if (!str) {
+        append_uint(buf, 0);
+        return;
+    }
+    size_t len = strlen(str);
+    append_uint(buf, len + 1);
+    string_append_buf(buf, str, len);
+}
+
+static int ptr_cmp(const void *ap, const void *bp)
+{
+    uintptr_t a = (uintptr_t)*(void *const *)ap;
+    uintptr_t b = (uintptr_t)*(void *const *)bp;
+    return (a > b) - (a < b);
+}
+
+// Append the index of `state` in `states` (sorted by address), plus 1,
+// or 0 if `state` is NULL
+static bool append_state_idx(String *buf, const PointerArray *states, const State *state)
+{
+    if (!state) {
+        append_uint(buf, 0);
+        return true;
+    }
+
+    void **ptr = ptr_array_bsearch(*states, state, ptr_cmp);
+    if (!ptr) {
+        return false;
+    }
+
+    append_uint(buf, (ptr - states->ptrs) + 1);
+    return true;
+}
+
+static bool encode_action(String *buf, const PointerArray *states, const Action *a)
+{
+    if (!append_state_idx(buf, states, a->destination)) {
+        return false;
+    }
+    append_optional_str(buf, a->emit_name);
+    return true;
+}
+
+// Find the recorded Syntax that owns `list`, which is either the Syntax
+// containing the condition or a sub-syntax that was merged into it
+static const Syntax *find_list_owner (
+    const SyntaxRecording *rec,
+    const StringList *list,
+    const char **namep
+) {
+    for (size_t i = 0, n = rec->syntaxes.count; i < n; i++) {
+        const RecordedSyntax *r = rec->syntaxes.ptrs[i];
+        const HashMap *lists = &r->syntax->string_lists;
+        for (HashMapIter it = hashmap_iter(lists); hashmap_next(&it); ) {
+            if (it.entry->value == list) {
+                *namep = it.entry->key;
+                return r->syntax;
+            }
+        }
+    }
+    return NULL;
+}
+
+static bool encode_condition (
+    String *buf,
+    const SyntaxRecording *rec,
+    const PointerArray *states,
+    const Condition *cond
+) {
+    const ConditionData *u = &cond->u;
+    append_uint(buf, cond->type);
+
+    switch (cond->type) {
+    case COND_CHAR:
+    case COND_CHAR_BUFFER:
+        for (unsigned int i = 0; i < 256; i += 8) {
+            unsigned char byte = 0;
+            for (unsigned int j = 0; j < 8; j++) {
+                byte |= bitset_contains(u->bitset, i + j) << j;
+            }
+            string_append_byte(buf, byte);
+        }
+        break;
+    case COND_CHAR1:
+        string_append_byte(buf, u->ch);
+        break;
+    case COND_BUFIS:
+    case COND_BUFIS_ICASE:
+    case COND_STR:
+    case COND_STR2:
+    case COND_STR_ICASE:
+        append_str(buf, u->str.buf, u->str.len);
+        break;
+    case COND_RECOLOR:
+        append_uint(buf, u->recolor_len);
+        break;
+    case COND_INLIST:
+    case COND_INLIST_BUFFER: {
+        const char *list_name;
+        const Syntax *owner = find_list_owner(rec, u->str_list, &list_name);
+        if (!owner) {
+            return false;
+        }
+        append_cstr(buf, owner->name);
+        append_cstr(buf, list_name);
+        break;
+    }
+    case COND_HEREDOCEND:
+        if (u->heredocend.length) {
+            // Delimiters are only set for heredocs merged at runtime
+            return false;
+        }
+        break;
+    case COND_RECOLOR_BUFFER:
+        break;
+    }
+
+    return encode_action(buf, states, &cond->a);
+}
+
+static bool encode_state (
+    String *buf,
+    const SyntaxRecording *rec,
+    const PointerArray *states,
+    const State *s
+) {
+    if (s->heredoc.states.count) {
+        // Heredoc states are only added at runtime
+        return false;
+    }
+
+    unsigned int flags = (s->defined ? CF_STATE_DEFINED : 0)
+        | (s->visited ? CF_STATE_VISITED : 0)
+        | (s->copied ? CF_STATE_COPIED : 0);
+
+    const Syntax *subsyn = s->heredoc.subsyntax;
+    append_optional_str(buf, s->emit_name);
+    append_uint(buf, flags);
+    append_uint(buf, (unsigned int)s->type);
+    if (!encode_action(buf, states, &s->default_action)) {
+        return false;
+    }
+    append_optional_str(buf, subsyn ? subsyn->name : NULL);
+
+    append_uint(buf, s->conds.count);
+    for (size_t i = 0, n = s->conds.count; i < n; i++) {
+        if (!encode_condition(buf, rec, states, s->conds.ptrs[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool encode_syntax(String *buf, const SyntaxRecording *rec, const Syntax *syn)
+{
+    append_uint(buf, syn->string_lists.count);
+    for (HashMapIter it = hashmap_iter(&syn->string_lists); hashmap_next(&it); ) {
+        const StringList *list = it.entry->value;
+        const HashSet *set = &list->strings;
+        unsigned int flags = (list->used ? CF_LIST_USED : 0)
+            | (list->defined ? CF_LIST_DEFINED : 0)
+            | (hashset_is_icase(set) ? CF_LIST_ICASE : 0);
+
+        append_cstr(buf, it.entry->key);
+        append_uint(buf, flags);
+        append_uint(buf, set->nr_entries);
+        for (HashSetIter sit = hashset_iter(set); hashset_next(&sit); ) {
+            append_str(buf, sit.entry->str, sit.entry->str_len);
+        }
+    }
+
+    append_uint(buf, syn->default_styles.count);
+    for (HashMapIter it = hashmap_iter(&syn->default_styles); hashmap_next(&it); ) {
+        append_cstr(buf, it.entry->key);
+        append_cstr(buf, it.entry->value);
+    }
+
+    // States are stored in order of address, so that the index of each
+    // destination can be found with a binary search
+    PointerArray states = PTR_ARRAY_INIT;
+    ptr_array_init(&states, syn->states.count);
+    for (HashMapIter it = hashmap_iter(&syn->states); hashmap_next(&it); ) {
+        ptr_array_append(&states, it.entry->value);
+    }
+    ptr_array_sort(&states, ptr_cmp);
+
+    append_uint(buf, states.count);
+    for (size_t i = 0, n = states.count; i < n; i++) {
+        const State *s = states.ptrs[i];
+        append_cstr(buf, s->name);
+    }
+
+    bool r = append_state_idx(buf, &states, syn->start_state);
+    for (size_t i = 0, n = states.count; r && i < n; i++) {
+        r = encode_state(buf, rec, &states, states.ptrs[i]);
+    }
+
+    ptr_array_free_array(&states);
+    return r;
+}
+
+static bool encode_body(String *buf, const SyntaxRecording *rec)
+{
+    append_uint(buf, rec->sources.count);
+    for (size_t i = 0, n = rec->sources.count; i < n; i++) {
+        const SyntaxSource *src = rec->sources.ptrs[i];
+        unsigned int flags = (src->builtin ? CF_SOURCE_BUILTIN : 0)
+            | (src->required ? CF_SOURCE_REQUIRED : 0);
+        append_uint(buf, flags);
+        append_uint(buf, src->parent);
+        append_uint(buf, src->text_len);
+        append_uint(buf, src->text_hash);
+        append_cstr(buf, src->path);
+    }
+
+    append_uint(buf, merge_get_prefix_count());
+    append_uint(buf, rec->syntaxes.count);
+
+    String blob = string_new(4096);
+    bool r = true;
+    for (size_t i = 0, n = rec->syntaxes.count; r && i < n; i++) {
+        const RecordedSyntax *rs = rec->syntaxes.ptrs[i];
+        const Syntax *syn = rs->syntax;
+        unsigned int flags = (syn->heredoc ? CF_SYNTAX_HEREDOC : 0)
+            | (syn->used ? CF_SYNTAX_USED : 0)
+            | (syn->warned_unused_subsyntax ? CF_SYNTAX_WARNED : 0);
+
+        string_clear(&blob);
+        r = encode_syntax(&blob, rec, syn);
+        append_cstr(buf, syn->name);
+        append_uint(buf, rs->source);
+        append_uint(buf, flags);
+        append_str(buf, blob.buffer, blob.len);
+    }
+
+    string_free(&blob);
+    return r;
+}
+
+static bool write_cache_file(const char *dir, const char *path, const String *buf)
+{
+    char *cache_dir = xasprintf("%s/syntax-cache", dir);
+    int err = mkdir(cache_dir, 0700);
+    free(cache_dir);
+    if (err != 0 && errno != EEXIST) {
+        LOG_ERRNO("mkdir");
+        return false;
+    }
+
+    // Write to a temporary file and then rename it, so that other dte
+    // processes never see a partially written cache file
+    char *tmp = xasprintf("%s.%jd.tmp", path, (intmax_t)getpid());
+    int fd = xopen(tmp, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERRNO("open");
+        free(tmp);
+        return false;
+    }
+
+    bool r = xwrite_all(fd, buf->buffer, buf->len) >= 0;
+    LOG_ERRNO_ON(!r, "write");
+    SystemErrno close_err = xclose(fd);
+    if (r && close_err != 0) {
+        LOG_ERROR("close: %s", strerror(close_err));
+        r = false;
+    }
+
+    if (r && rename(tmp, path) != 0) {
+        LOG_ERRNO("rename");
+        r = false;
+    }
+
+    if (!r) {
+        unlink(tmp);
+    }
+
+    free(tmp);
+    return r;
+}
+
+// Save the syntaxes recorded by load_syntax(), which must have loaded
+// `text` without errors
+void syntax_cache_save (
+    EditorState *e,
+    const SyntaxRecording *rec,
+    StringView text,
+    const char *filename,
+    SyntaxLoadFlags flags
+) {
+    BUG_ON(rec->uncacheable);
+    const size_t filename_len = strlen(filename);
+    String buf = string_new(16384);
+    string_append_memset(&buf, 0, sizeof(SyntaxCacheHeader));
+    string_append_buf(&buf, VERSION, STRLEN(VERSION));
+    string_append_buf(&buf, filename, filename_len);
+    const size_t header_len = buf.len;
+
+    if (!encode_body(&buf, rec)) {
+        LOG_INFO("syntaxes from %s can't be cached", filename);
+        string_free(&buf);
+        return;
+    }
+
+    StringView body = string_view(buf.buffer + header_len, buf.len - header_len);
+    SyntaxCacheHeader header = make_header(flags, text, filename_len, body);
+    memcpy(buf.buffer, &header, sizeof(header));
+
+    char *path = get_cache_file_path(e->user_config_dir, filename, flags);
+    if (write_cache_file(e->user_config_dir, path, &buf)) {
+        LOG_INFO("saved syntax cache: %s", path);
+    }
+
+    free(path);
+    string_free(&buf);
+}
+
+typedef struct {
+    StringView data;
+    bool failed; // Set when reading past the end of `data`
+} CacheReader;
+
+static size_t read_uint(CacheReader *r)
+{
+    StringView *sv = &r->data;
+    size_t val = 0;
+    for (size_t i = 0, shift = 0; i < sv->length && shift < BITSIZE(val); i++, shift += 7) {
+        unsigned char byte = sv->data[i];
+        val |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            strview_remove_prefix(sv, i + 1);
+            return val;
+        }
+    }
+
+    r->failed = true;
+    sv->length = 0;
+    return 0;
+}
+
+static StringView read_bytes(CacheReader *r, size_t len)
+{
+    StringView *sv = &r->data;
+    if (unlikely(len > sv->length)) {
+        r->failed = true;
+        len = sv->length;
+    }
+
+    StringView bytes = string_view(sv->data, len);
+    strview_remove_prefix(sv, len);
+    return bytes;
+}
+
+static StringView read_str(CacheReader *r)
+{
+    return read_bytes(r, read_uint(r));
+}
+
+static char *read_cstr(CacheReader *r)
+{
+    StringView str = read_str(r);
+    return xstrcut(str.data, str.length);
+}
+
+// Read a string appended by append_optional_str() and return false if
+// it was NULL
+static bool read_optional_str(CacheReader *r, StringView *strp)
+{
+    size_t len = read_uint(r);
+    if (len == 0) {
+        return false;
+    }
+    *strp = read_bytes(r, len - 1);
+    return true;
+}
+
+static const char *read_optional_interned(CacheReader *r)
+{
+    StringView str;
+    return read_optional_str(r, &str) ? mem_intern(str.data, str.length) : NULL;
+}
+
+// Find a Syntax decoded from the cache file (including the one currently
+// being decoded) or one loaded by an earlier call to load_syntax()
+static Syntax *find_syntax_for_cache (
+    const PointerArray *decoded,
+    const HashMap *syntaxes,
+    const char *name
+) {
+    for (size_t i = 0, n = decoded->count; i < n; i++) {
+        Syntax *syn = decoded->ptrs[i];
+        if (streq(syn->name, name)) {
+            return syn;
+        }
+    }
+    return find_any_syntax(syntaxes, name);
+}
+
+static bool decode_action (
+    CacheReader *r,
+    const Syntax *syn,
+    const PointerArray *states,
+    Action *a,
+    bool has_destination
+) {
+    size_t idx = read_uint(r);
+    if (idx > states->count) {
+        return false;
+    }
+
+    a->destination = idx ? states->ptrs[idx - 1] : NULL;
+    a->emit_name = read_optional_interned(r);
+    if (!has_destination) {
+        return !a->destination && a->emit_name;
+    }
+
+    // Only sub-syntaxes can have NULL destinations (i.e. "END"), which
+    // merge_syntax() replaces with the return state
+    return a->destination || is_subsyntax(syn);
+}
+
+static bool decode_condition (
+    CacheReader *r,
+    const Syntax *syn,
+    const PointerArray *states,
+    const PointerArray *decoded,
+    const HashMap *syntaxes,
+    Condition *cond
+) {
+    size_t type = read_uint(r);
+    if (type > COND_HEREDOCEND) {
+        return false;
+    }
+
+    ConditionData *u = &cond->u;
+    cond->type = type;
+
+    switch (cond->type) {
+    case COND_CHAR:
+    case COND_CHAR_BUFFER: {
+        StringView bits = read_bytes(r, 256 / 8);
+        for (size_t i = 0; i < bits.length; i++) {
+            unsigned char byte = bits.data[i];
+            for (unsigned int j = 0; j < 8; j++) {
+                if (byte & (1u << j)) {
+                    bitset_add(u->bitset, (i * 8) + j);
+                }
+            }
+        }
+        break;
+    }
+    case COND_CHAR1: {
+        StringView ch = read_bytes(r, 1);
+        u->ch = ch.length ? ch.data[0] : 0;
+        break;
+    }
+    case COND_BUFIS:
+    case COND_BUFIS_ICASE:
+    case COND_STR:
+    case COND_STR2:
+    case COND_STR_ICASE: {
+        StringView str = read_str(r);
+        if (str.length > sizeof(u->str.buf)) {
+            return false;
+        }
+        memcpy(u->str.buf, str.data, str.length);
+        u->str.len = str.length;
+        break;
+    }
+    case COND_RECOLOR:
+        // See cmd_recolor()
+        u->recolor_len = read_uint(r);
+        if (u->recolor_len < 1 || u->recolor_len > 2500) {
+            return false;
+        }
+        break;
+    case COND_INLIST:
+    case COND_INLIST_BUFFER: {
+        char *syntax_name = read_cstr(r);
+        char *list_name = read_cstr(r);
+        const Syntax *owner = find_syntax_for_cache(decoded, syntaxes, syntax_name);
+        u->str_list = owner ? find_string_list(owner, list_name) : NULL;
+        free(syntax_name);
+        free(list_name);
+        if (!u->str_list) {
+            return false;
+        }
+        break;
+    }
+    case COND_HEREDOCEND:
+    case COND_RECOLOR_BUFFER:
+        break;
+    }
+
+    bool has_dest = cond_type_has_destination(cond->type);
+    return decode_action(r, syn, states, &cond->a, has_dest) && !r->failed;
+}
+
+static bool decode_state (
+    CacheReader *r,
+    const Syntax *syn,
+    const PointerArray *states,
+    const PointerArray *decoded,
+    const HashMap *syntaxes,
+    State *s
+) {
+    s->emit_name = read_optional_interned(r);
+    unsigned int flags = read_uint(r);
+    size_t type = read_uint(r);
+    if (!s->emit_name || type > STATE_HEREDOCBEGIN) {
+        return false;
+    }
+
+    s->defined = !!(flags & CF_STATE_DEFINED);
+    s->visited = !!(flags & CF_STATE_VISITED);
+    s->copied = !!(flags & CF_STATE_COPIED);
+    s->type = type;
+    if (!decode_action(r, syn, states, &s->default_action, true)) {
+        return false;
+    }
+
+    StringView subsyn_name;
+    if (read_optional_str(r, &subsyn_name)) {
+        char *name = xstrcut(subsyn_name.data, subsyn_name.length);
+        Syntax *subsyn = find_syntax_for_cache(decoded, syntaxes, name);
+        free(name);
+        if (!subsyn || !is_subsyntax(subsyn)) {
+            return false;
+        }
+        s->heredoc.subsyntax = subsyn;
+    }
+
+    if ((s->type == STATE_HEREDOCBEGIN) != !!s->heredoc.subsyntax) {
+        return false;
+    }
+
+    size_t nr_conds = read_uint(r);
+    if (r->failed || nr_conds > r->data.length) {
+        return false;
+    }
+
+    if (nr_conds) {
+        ptr_array_init(&s->conds, nr_conds);
+    }
+
+    for (size_t i = 0; i < nr_conds; i++) {
+        Condition *cond = xcalloc1(sizeof(*cond));
+        ptr_array_append(&s->conds, cond);
+        if (!decode_condition(r, syn, states, decoded, syntaxes, cond)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool decode_lists(CacheReader *r, Syntax *syn)
+{
+    size_t nr_lists = read_uint(r);
+    for (size_t i = 0; i < nr_lists && !r->failed; i++) {
+        char *name = read_cstr(r);
+        unsigned int flags = read_uint(r);
+        size_t nr_strings = read_uint(r);
+        if (r->failed || nr_strings > r->data.length || find_string_list(syn, name)) {
+            free(name);
+            return false;
+        }
+
+        StringList *list = xcalloc1(sizeof(*list));
+        list->used = !!(flags & CF_LIST_USED);
+        list->defined = !!(flags & CF_LIST_DEFINED);
+        hashset_init(&list->strings, nr_strings, flags & CF_LIST_ICASE);
+        hashmap_insert(&syn->string_lists, name, list);
+
+        for (size_t j = 0; j < nr_strings; j++) {
+            StringView str = read_str(r);
+            hashset_insert(&list->strings, str.data, str.length);
+        }
+    }
+    return !r->failed;
+}
+
+static bool decode_default_styles(CacheReader *r, Syntax *syn)
+{
+    size_t nr_styles = read_uint(r);
+    for (size_t i = 0; i < nr_styles && !r->failed; i++) {
+        char *name = read_cstr(r);
+        StringView value = read_str(r);
+        if (r->failed || hashmap_get(&syn->default_styles, name)) {
+            free(name);
+            return false;
+        }
+        const char *interned = mem_intern(value.data, value.length);
+        hashmap_insert(&syn->default_styles, name, (char*)interned);
+    }
+    return !r->failed;
+}
+
+// Decode the contents of `syn`, as encoded by encode_syntax()
+static bool decode_syntax (
+    CacheReader *r,
+    Syntax *syn,
+    const PointerArray *decoded,
+    const HashMap *syntaxes
+) {
+    if (!decode_lists(r, syn) || !decode_default_styles(r, syn)) {
+        return false;
+    }
+
+    size_t nr_states = read_uint(r);
+    if (r->failed || nr_states == 0 || nr_states > r->data.length) {
+        return false;
+    }
+
+    PointerArray states = PTR_ARRAY_INIT;
+    ptr_array_init(&states, nr_states);
+    bool ok = true;
+    for (size_t i = 0; ok && i < nr_states; i++) {
+        char *name = read_cstr(r);
+        if (r->failed || find_state(syn, name)) {
+            free(name);
+            ok = false;
+            break;
+        }
+        State *s = xcalloc1(sizeof(*s));
+        s->name = name;
+        hashmap_insert(&syn->states, name, s);
+        ptr_array_append(&states, s);
+    }
+
+    size_t start = ok ? read_uint(r) : 0;
+    ok = ok && start >= 1 && start <= nr_states;
+    if (ok) {
+        syn->start_state = states.ptrs[start - 1];
+    }
+
+    for (size_t i = 0; ok && i < nr_states; i++) {
+        ok = decode_state(r, syn, &states, decoded, syntaxes, states.ptrs[i]);
+    }
+
+    ptr_array_free_array(&states);
+    return ok && !r->failed && r->data.length == 0;
+}
+
+typedef struct {
+    StringView path;
+    bool builtin;
+    bool required;
+    bool skipped; // Already required (or read by a skipped source)
+} CachedSource;
+
+// Decode the body of a cache file (see encode_body()) and add the decoded
+// syntaxes to EditorState::syntaxes, if (and only if) every source is
+// unchanged, the whole body is valid and it defines the main syntax
+static Syntax *decode_body(EditorState *e, StringView body, const char *main_name)
+{
+    CacheReader r = {.data = body};
+    const size_t nr_sources = read_uint(&r);
+    if (r.failed || nr_sources > r.data.length) {
+        return NULL;
+    }
+
+    // Index 0 is the text passed to load_syntax(), as in SyntaxRecording
+    CachedSource *sources = xcalloc(nr_sources + 1, sizeof(*sources));
+    PointerArray decoded = PTR_ARRAY_INIT;
+    PointerArray used = PTR_ARRAY_INIT;
+    bool ok = true;
+
+    for (size_t i = 1; ok && i <= nr_sources; i++) {
+        CachedSource *src = &sources[i];
+        unsigned int flags = read_uint(&r);
+        size_t parent = read_uint(&r);
+        size_t text_len = read_uint(&r);
+        size_t text_hash = read_uint(&r);
+        src->path = read_str(&r);
+        src->builtin = !!(flags & CF_SOURCE_BUILTIN);
+        src->required = !!(flags & CF_SOURCE_REQUIRED);
+        if (r.failed || parent >= i) {
+            ok = false;
+            break;
+        }
+
+        const HashSet *set = src->builtin ? &e->required_syntax_builtins : &e->required_syntax_files;
+        src->skipped = sources[parent].skipped
+            || (src->required && hashset_get(set, src->path.data, src->path.length));
+        if (src->skipped) {
+            continue;
+        }
+
+        char *path = xstrcut(src->path.data, src->path.length);
+        size_t len, hash;
+        ok = hash_source(path, src->builtin, &len, &hash) && len == text_len && hash == text_hash;
+        free(path);
+    }
+
+    const size_t nr_prefixes = ok ? read_uint(&r) : 0;
+    const size_t nr_syntaxes = ok ? read_uint(&r) : 0;
+    ok = ok && !r.failed;
+
+    for (size_t i = 0; ok && i < nr_syntaxes; i++) {
+        char *name = read_cstr(&r);
+        size_t source = read_uint(&r);
+        unsigned int flags = read_uint(&r);
+        StringView blob = read_str(&r);
+        if (r.failed || source > nr_sources) {
+            free(name);
+            ok = false;
+            break;
+        }
+
+        if (sources[source].skipped) {
+            // Defined by a file already required by an earlier load
+            Syntax *syn = find_any_syntax(&e->syntaxes, name);
+            free(name);
+            ok = !!syn;
+            if (syn && (flags & CF_SYNTAX_USED)) {
+                ptr_array_append(&used, syn);
+            }
+            continue;
+        }
+
+        if (find_syntax_for_cache(&decoded, &e->syntaxes, name)) {
+            free(name);
+            ok = false;
+            break;
+        }
+
+        Syntax *syn = xcalloc1(sizeof(*syn));
+        syn->name = name;
+        syn->heredoc = !!(flags & CF_SYNTAX_HEREDOC);
+        syn->used = !!(flags & CF_SYNTAX_USED);
+        syn->warned_unused_subsyntax = !!(flags & CF_SYNTAX_WARNED);
+        ptr_array_append(&decoded, syn);
+
+        CacheReader br = {.data = blob};
+        ok = decode_syntax(&br, syn, &decoded, &e->syntaxes);
+        ok = ok && !(syn->heredoc && !is_subsyntax(syn)); // See finalize_syntax()
+    }
+
+    // The main syntax can't already exist (see syntax_cache_load()), so
+    // finding it here means that it was decoded
+    Syntax *main_syn = NULL;
+    if (ok && r.data.length == 0) {
+        main_syn = find_syntax_for_cache(&decoded, &e->syntaxes, main_name);
+    }
+
+    if (!main_syn || is_subsyntax(main_syn)) {
+        ptr_array_free_cb(&decoded, FREE_FUNC(free_syntax));
+        ptr_array_free_array(&used);
+        free(sources);
+        return NULL;
+    }
+
+    for (size_t i = 0, n = decoded.count; i < n; i++) {
+        Syntax *syn = decoded.ptrs[i];
+        hashmap_insert(&e->syntaxes, syn->name, syn);
+    }
+
+    for (size_t i = 0, n = used.count; i < n; i++) {
+        Syntax *syn = used.ptrs[i];
+        syn->used = true;
+    }
+
+    for (size_t i = 1; i <= nr_sources; i++) {
+        const CachedSource *src = &sources[i];
+        if (src->required && !src->skipped) {
+            HashSet *set = src->builtin ? &e->required_syntax_builtins : &e->required_syntax_files;
+            hashset_insert(set, src->path.data, src->path.length);
+        }
+    }
+
+    // Merged states keep the prefixes they were given when the cache file
+    // was saved, so they must never be given to any states merged later
+    merge_skip_prefixes(MIN(nr_prefixes, UINT_MAX));
+
+    ptr_array_free_array(&decoded);
+    ptr_array_free_array(&used);
+    free(sources);
+    return main_syn;
+}
+
+static Syntax *decode_cache_file (
+    EditorState *e,
+    StringView data,
+    StringView text,
+    const char *filename,
+    SyntaxLoadFlags flags
+) {
+    const size_t filename_len = strlen(filename);
+    const size_t version_len = STRLEN(VERSION);
+    const size_t skip = sizeof(SyntaxCacheHeader) + version_len + filename_len;
+    if (data.length < skip) {
+        return NULL;
+    }
+
+    SyntaxCacheHeader header;
+    memcpy(&header, data.data, sizeof(header));
+    StringView body = string_view(data.data + skip, data.length - skip);
+    SyntaxCacheHeader expected = make_header(flags, text, filename_len, body);
+    const char *version = data.data + sizeof(header);
+    const char *name = version + version_len;
+
+    if (
+        memcmp(&header, &expected, sizeof(header)) != 0
+        || memcmp(version, VERSION, version_len) != 0
+        || memcmp(name, filename, filename_len) != 0
+    ) {
+        return NULL;
+    }
+
+    return decode_body(e, body, path_basename(filename));
+}
+
+// Load the syntaxes saved by syntax_cache_save() for `text` and return
+// the main syntax, or NULL if there's no valid cache file for `text`
+// (or any of the files read by it)
+Syntax *syntax_cache_load (
+    EditorState *e,
+    StringView text,
+    const char *filename,
+    SyntaxLoadFlags flags
+) {
+    char *path = get_cache_file_path(e->user_config_dir, filename, flags);
+    int fd = xopen(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERRNO_ON(errno != ENOENT, "open");
+        free(path);
+        return NULL;
+    }
+
+    // The main syntax must be defined by the cache file itself, so if
+    // it already exists, load_syntax() has to report the error
+    Syntax *syntax = NULL;
+    struct stat st;
+    if (find_any_syntax(&e->syntaxes, path_basename(filename))) {
+        goto out;
+    }
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        goto out;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERRNO("mmap");
+        goto out;
+    }
+
+    StringView data = string_view(map, st.st_size);
+    syntax = decode_cache_file(e, data, text, filename, flags);
+    if (syntax) {
+        LOG_INFO("loaded syntax cache: %s", path);
+    } else {
+        LOG_INFO("ignoring stale syntax cache: %s", path);
+    }
+
+    munmap(map, st.st_size);
+
+out:
+    xclose(fd);
+    free(path);
+    return syntax;
+}
@@ -0,0 +1,50 @@
+#ifndef SYNTAX_CACHE_H
+#define SYNTAX_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "syntax/state.h"
+#include "syntax/syntax.h"
+#include "util/macros.h"
+#include "util/ptr-array.h"
+#include "util/string-view.h"
+
+// A file read by the "include" or "require" commands, while recording
+typedef struct {
+    char *path;
+    size_t parent; // Index of the source containing the command
+    size_t text_len;
+    size_t text_hash;
+    bool builtin;
+    bool required;
+} SyntaxSource;
+
+// A Syntax defined while recording and the index of the source
+// containing its definition
+typedef struct {
+    Syntax *syntax; // Borrowed (owned by EditorState::syntaxes)
+    size_t source;
+} RecordedSyntax;
+
+// Everything load_syntax() needs to know, in addition to the resulting
+// syntaxes themselves, in order to decide whether they can be cached and
+// whether a cache file is still valid when loading it. Sources are
+// identified by index, where 0 is the text passed to load_syntax() and
+// N is `sources.ptrs[N - 1]`.
+typedef struct SyntaxRecording {
+    PointerArray sources; // SyntaxSource
+    PointerArray syntaxes; // RecordedSyntax
+    size_t current_source; // Source currently being executed
+    size_t syntax_source; // Source containing SyntaxLoader::current_syntax
+    bool uncacheable;
+} SyntaxRecording;
+
+struct EditorState;
+
+size_t syntax_recording_add_source(SyntaxRecording *rec, const char *path, SyntaxLoadFlags flags, bool required) NONNULL_ARGS;
+void syntax_recording_free(SyntaxRecording *rec) NONNULL_ARGS;
+
+Syntax *syntax_cache_load(struct EditorState *e, StringView text, const char *filename, SyntaxLoadFlags flags) NONNULL_ARGS WARN_UNUSED_RESULT;
+void syntax_cache_save(struct EditorState *e, const SyntaxRecording *rec, StringView text, const char *filename, SyntaxLoadFlags flags) NONNULL_ARGS;
+
+#endif
@@ -19,6 +19,7 @@ static const char builtin_style_names[NR_BSE][16] = {
     [BSE_LINENUMBER] = "linenumber",
     [BSE_NOLINE] = "noline",
     [BSE_NONTEXT] = "nontext",
+    [BSE_SEARCHMATCH] = "searchmatch",
     [BSE_SELECTION] = "selection",
     [BSE_STATUSLINE] = "statusline",
     [BSE_TABBAR] = "tabbar",
@@ -21,6 +21,7 @@ typedef enum {
     BSE_LINENUMBER,
     BSE_NOLINE,
     BSE_NONTEXT,
+    BSE_SEARCHMATCH,
     BSE_SELECTION,
     BSE_STATUSLINE,
     BSE_TABBAR,
@@ -1,31 +1,67 @@
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include "highlight.h"
 #include "syntax/merge.h"
 #include "util/arith.h"
 #include "util/bit.h"
+#include "util/byte-class.h"
 #include "util/intern.h"
+#include "util/macros.h"
+#include "util/time-util.h"
 #include "util/xmalloc.h"
 #include "util/xstring.h"
 
+enum {
+    // Bytes of text between checkpoints, until the speed of highlighting
+    // has been measured (see update_interval())
+    CHECKPOINT_BYTES_DEFAULT = 8 << 10,
+    CHECKPOINT_BYTES_MIN = 1 << 10,
+    CHECKPOINT_BYTES_MAX = 64 << 10,
+    // Maximum number of lines between checkpoints, regardless of bytes
+    CHECKPOINT_LINES_MAX = 1024,
+    // Minimum amount of text highlighted in one go, for measuring speed
+    CHECKPOINT_SAMPLE_BYTES = 256 << 10,
+    // Number of lines kept in LineStates::cache
+    LINE_CACHE_SIZE = 256,
+    // Length of a run of bytes before find_run_end() switches to SIMD
+    RUN_SCAN_MIN_BYTES = 16,
+};
+
+// Approximate time it should take to highlight all of the lines from one
+// checkpoint to the next, in nanoseconds
+#define CHECKPOINT_TARGET_NS 50000.0
+
 static bool state_is_valid(const State *st)
 {
     return ((uintptr_t)st & 1) == 0;
 }
 
-static void mark_state_invalid(void **ptrs, size_t idx)
+static void mark_state_invalid(LineStateCheckpoint *c)
 {
-    const State *st = ptrs[idx];
-    ptrs[idx] = (State*)((uintptr_t)st | 1);
+    c->state = (State*)((uintptr_t)c->state | 1);
 }
 
-static bool states_equal(void **ptrs, size_t idx, const State *b)
+static bool states_equal(const LineStateCheckpoint *c, const State *b)
 {
-    const State *a = (State*)((uintptr_t)ptrs[idx] & ~(uintptr_t)1);
+    const State *a = (State*)((uintptr_t)c->state & ~(uintptr_t)1);
     return a == b;
 }
 
+// Get a buffer for the style of each byte of a line of length `len`,
+// as returned by highlight_line() and hl_line_cached()
+static const TermStyle **get_style_buffer(size_t len)
+{
+    static const TermStyle **styles; // NOLINT(*-avoid-non-const-global-variables)
+    static size_t alloc; // NOLINT(*-avoid-non-const-global-variables)
+    if (len > alloc) {
+        alloc = next_multiple(len, 128);
+        styles = xrenew(styles, alloc);
+    }
+    return styles;
+}
+
 static bool bufis(const ConditionData *u, const char *buf, size_t len)
 {
     size_t ulen = u->str.len;
@@ -72,6 +108,28 @@ static State *handle_heredoc (
     return s->state;
 }
 
+// Return the end of the run of bytes starting at `i` that map to the
+// same list of conditions as `list` (see compile_state()). Most runs
+// are short (e.g. single spaces), so the first few bytes are tested
+// with `dispatch` and only longer runs are handed to byte_class_span(),
+// for which the overhead of a SIMD scan is then worthwhile.
+static size_t find_run_end (
+    const CompiledState *cs,
+    size_t list,
+    const char *line,
+    size_t i,
+    size_t len
+) {
+    size_t end = MIN(i + RUN_SCAN_MIN_BYTES, len);
+    while (i < end && cs->dispatch[(unsigned char)line[i]] == list) {
+        i++;
+    }
+    if (i < end || i == len) {
+        return i;
+    }
+    return i + byte_class_span(&cs->classes[list], line + i, len - i);
+}
+
 // Line should be terminated with \n unless it's the last line
 static const TermStyle **highlight_line (
     Syntax *syn,
@@ -80,18 +138,12 @@ static const TermStyle **highlight_line (
     StringView line_sv,
     State **ret
 ) {
-    static const TermStyle **styles; // NOLINT(*-avoid-non-const-global-variables)
-    static size_t alloc; // NOLINT(*-avoid-non-const-global-variables)
     const char *const line = line_sv.data;
     const size_t len = line_sv.length;
+    const TermStyle **styles = get_style_buffer(len);
     size_t i = 0;
     ssize_t sidx = -1;
 
-    if (len > alloc) {
-        alloc = next_multiple(len, 128);
-        styles = xrenew(styles, alloc);
-    }
-
     top:
     if (i >= len) {
         BUG_ON(i > len);
@@ -99,12 +151,40 @@ static const TermStyle **highlight_line (
         return styles;
     }
 
-    for (size_t ci = 0, n = state->conds.count; ci < n; ci++) {
-        const Condition *cond = state->conds.ptrs[ci];
+    // Only test the conditions that can match the current byte (see
+    // compile_state()). States are compiled when first used, since many
+    // of them are never reached in a given buffer.
+    if (unlikely(!state->compiled.conds)) {
+        compile_state(state);
+    }
+    const CompiledState *cs = &state->compiled;
+    const size_t list = cs->dispatch[(unsigned char)line[i]];
+    const PackedCondition *cond = cs->conds + cs->lists[list];
+    const PackedCondition *conds_end = cs->conds + cs->lists[list + 1];
+
+    // Consume runs of bytes that leave the state unchanged (e.g. the
+    // contents of strings and comments) in one go, instead of one by one
+    if (bitset_contains(cs->run_lists, list)) {
+        size_t run_end = find_run_end(cs, list, line, i + 1, len);
+        if (cond == conds_end) {
+            i += set_style_range(styles, state->default_action.emit_style, i, run_end);
+            sidx = -1;
+            goto top;
+        }
+        if (cond->type != COND_CHAR_BUFFER) {
+            sidx = -1;
+        } else if (sidx < 0) {
+            sidx = i;
+        }
+        i += set_style_range(styles, cond->emit_style, i, run_end);
+        goto top;
+    }
+
+    for (; cond < conds_end; cond++) {
         const ConditionData *u = &cond->u;
         const ConditionType condtype = cond->type;
-        const TermStyle *style = cond->a.emit_style;
-        State *dest = cond->a.destination;
+        const TermStyle *style = cond->emit_style;
+        State *dest = cond->destination;
         switch (condtype) {
         case COND_CHAR_BUFFER:
             if (!bitset_contains(u->bitset, line[i])) {
@@ -238,228 +318,482 @@ static const TermStyle **highlight_line (
     goto top;
 }
 
-static void resize_line_states(PointerArray *s, size_t count)
+
+static void resize_checkpoints(LineStates *lss, size_t count)
 {
-    if (s->alloc < count) {
-        s->alloc = next_multiple(count, 64);
-        s->ptrs = xrenew(s->ptrs, s->alloc);
+    if (lss->alloc < count) {
+        lss->alloc = next_multiple(count, 64);
+        lss->checkpoints = xrenew(lss->checkpoints, lss->alloc);
     }
 }
 
-static void move_line_states (
-    PointerArray *s,
-    size_t to,
-    size_t from,
-    size_t count
-) {
-    memmove(s->ptrs + to, s->ptrs + from, count * sizeof(*s->ptrs));
+static void insert_checkpoints(LineStates *lss, size_t idx, size_t count)
+{
+    BUG_ON(idx > lss->count);
+    resize_checkpoints(lss, lss->count + count);
+    LineStateCheckpoint *c = lss->checkpoints + idx;
+    memmove(c + count, c, (lss->count - idx) * sizeof(*c));
+    lss->count += count;
 }
 
-static void block_iter_move_down(BlockIter *bi, size_t count)
+// Find the checkpoint of the lines that `line_nr` is part of and set
+// `*start` to the line number of the checkpoint
+static size_t find_checkpoint(const LineStates *lss, size_t line_nr, size_t *start)
 {
+    const LineStateCheckpoint *c = lss->checkpoints;
+    size_t first = 0;
+    size_t i = 0;
+    for (size_t n = lss->count - 1; i < n && first + c[i].nr_lines <= line_nr; i++) {
+        first += c[i].nr_lines;
+    }
+    *start = first;
+    return i;
+}
+
+// Make the checkpoint of `line_nr` the last one, so that no states are
+// kept for the lines after it
+static void truncate_checkpoints(LineStates *lss, size_t line_nr)
+{
+    size_t start;
+    size_t i = find_checkpoint(lss, line_nr, &start);
+    lss->checkpoints[i].nr_lines = 0;
+    lss->count = i + 1;
+    lss->nr_lines = start;
+    lss->tail_bytes = SIZE_MAX;
+}
+
+// Add the start state of line `lss->nr_lines + 1` (the line after the
+// last known state), where `len` is the length of the line before it.
+// This adds a new checkpoint only if there have been enough lines or
+// bytes since the previous one.
+static void append_line_state(LineStates *lss, State *next, size_t len)
+{
+    size_t n = lss->count;
+    LineStateCheckpoint *c = lss->checkpoints;
+    size_t interval = lss->interval ? lss->interval : CHECKPOINT_BYTES_DEFAULT;
+    lss->nr_lines++;
+
+    if (
+        n >= 2
+        && lss->tail_bytes < interval
+        && c[n - 2].nr_lines < CHECKPOINT_LINES_MAX
+    ) {
+        // Extend the lines of the second last checkpoint
+        lss->tail_bytes += len;
+        c[n - 2].nr_lines++;
+        c[n - 1].state = next;
+        return;
+    }
+
+    resize_checkpoints(lss, n + 1);
+    c = lss->checkpoints;
+    c[n - 1].nr_lines = 1;
+    c[n] = (LineStateCheckpoint){.state = next, .nr_lines = 0};
+    lss->count++;
+    lss->tail_bytes = len;
+}
+
+// Adjust the number of bytes between new checkpoints so that highlighting
+// the lines from one to the next takes about CHECKPOINT_TARGET_NS, based
+// on having just highlighted `bytes` of text since `start`
+static void update_interval(LineStates *lss, size_t bytes, const struct timespec *start)
+{
+    struct timespec end;
+    if (bytes < CHECKPOINT_SAMPLE_BYTES || !xgettime(&end)) {
+        return;
+    }
+
+    double ms = timespec_to_fp_milliseconds(timespec_subtract(&end, start));
+    if (ms <= 0) {
+        return;
+    }
+
+    double interval = (bytes / (ms * 1e6)) * CHECKPOINT_TARGET_NS;
+    lss->interval = CLAMP(interval, CHECKPOINT_BYTES_MIN, CHECKPOINT_BYTES_MAX);
+}
+
+// Highlight `count` lines from `bi`, starting with `state`, and return the
+// start state of the line after them
+static State *highlight_lines (
+    Syntax *syn,
+    State *state,
+    const StyleMap *sm,
+    BlockIter *bi,
+    size_t count,
+    size_t *budget
+) {
     while (count--) {
+        StringView line = block_iter_get_line_with_nl(bi);
         block_iter_eat_line(bi);
+        highlight_line(syn, state, sm, line, &state);
+        *budget = saturating_subtract(*budget, line.length + 1);
     }
+    return state;
 }
 
-static ssize_t fill_hole (
+// Make the start states of all lines up to and including `line_nr` known,
+// by filling in any invalidated checkpoints and adding new ones. This
+// highlights roughly `max_bytes` of text at most (but always makes some
+// progress) and returns false if there's more to do, in which case calling
+// it again continues from where it left off.
+bool hl_fill_start_states (
     Syntax *syn,
-    PointerArray *line_start_states,
+    LineStates *line_start_states,
     const StyleMap *sm,
     BlockIter *bi,
-    ssize_t sidx,
-    ssize_t eidx
+    size_t line_nr,
+    size_t max_bytes
 ) {
-    void **ptrs = line_start_states->ptrs;
-    ssize_t idx = sidx;
+    if (!syn) {
+        return true;
+    }
 
-    while (idx < eidx) {
-        State *st;
-        StringView line = block_iter_get_line_with_nl(bi);
-        block_iter_eat_line(bi);
-        highlight_line(syn, ptrs[idx++], sm, line, &st);
+    LineStates *lss = line_start_states;
+    LineStateCheckpoint *c = lss->checkpoints;
+    size_t budget = max_bytes;
+    size_t bi_line = SIZE_MAX;
+    size_t start = 0;
 
-        if (ptrs[idx] == st) {
-            // Was not invalidated and didn't change
+    // Update invalid
+    for (size_t i = 1, n = lss->count; i < n; i++) {
+        size_t prev_start = start;
+        start += c[i - 1].nr_lines;
+        if (start > line_nr) {
             break;
         }
+        if (state_is_valid(c[i].state)) {
+            continue;
+        }
+        if (budget == 0) {
+            return false;
+        }
 
-        if (states_equal(ptrs, idx, st)) {
-            // Was invalidated and didn't change
-            ptrs[idx] = st;
-        } else {
-            // Invalidated or not but changed anyway
-            ptrs[idx] = st;
-            if (idx == eidx) {
-                mark_state_invalid(ptrs, idx + 1);
-            }
+        if (bi_line != prev_start) {
+            block_iter_goto_line(bi, prev_start);
+        }
+
+        State *st = highlight_lines(syn, c[i - 1].state, sm, bi, c[i - 1].nr_lines, &budget);
+        bi_line = start;
+        if (!states_equal(&c[i], st) && i + 1 < n) {
+            // Changed, so the next state might also change
+            mark_state_invalid(&c[i + 1]);
         }
+        c[i].state = st;
     }
-    return idx - sidx;
+
+    if (lss->nr_lines >= line_nr) {
+        return true;
+    }
+
+    // Add new
+    struct timespec start_time;
+    bool timing = xgettime(&start_time);
+    size_t highlighted = 0;
+    if (bi_line != lss->nr_lines) {
+        block_iter_goto_line(bi, lss->nr_lines);
+    }
+
+    while (lss->nr_lines < line_nr && budget > 0) {
+        StringView line = block_iter_get_line_with_nl(bi);
+        block_iter_eat_line(bi);
+        State *st;
+        highlight_line(syn, lss->checkpoints[lss->count - 1].state, sm, line, &st);
+        append_line_state(lss, st, line.length);
+        budget = saturating_subtract(budget, line.length + 1);
+        highlighted += line.length;
+    }
+
+    if (timing) {
+        update_interval(lss, highlighted, &start_time);
+    }
+
+    return lss->nr_lines >= line_nr;
 }
 
-void hl_fill_start_states (
+// Return the start state of `line_nr`, by highlighting the lines between
+// it and its checkpoint. The states up to `line_nr` must already be known
+// (see hl_fill_start_states()). `bi` can be any BlockIter of the Buffer.
+State *hl_get_start_state (
     Syntax *syn,
-    PointerArray *line_start_states,
+    const LineStates *line_start_states,
     const StyleMap *sm,
     BlockIter *bi,
     size_t line_nr
 ) {
-    if (!syn) {
-        return;
+    const LineStates *lss = line_start_states;
+    BUG_ON(line_nr > lss->nr_lines);
+    size_t start;
+    size_t i = find_checkpoint(lss, line_nr, &start);
+    State *state = lss->checkpoints[i].state;
+    BUG_ON(!state_is_valid(state));
+    if (start == line_nr) {
+        return state;
     }
 
-    PointerArray *s = line_start_states;
-    ssize_t current_line = 0;
-    ssize_t idx = 0;
+    size_t budget = SIZE_MAX;
+    block_iter_goto_line(bi, start);
+    return highlight_lines(syn, state, sm, bi, line_nr - start, &budget);
+}
 
-    // NOTE: "+ 2" so that you don't have to worry about overflow in fill_hole()
-    resize_line_states(s, line_nr + 2);
-    State **states = (State **)s->ptrs;
+// Highlight `line`, starting from `*state`, and set `*state` to the start
+// state of the next line
+const TermStyle **hl_line (
+    Syntax *syn,
+    State **state,
+    const StyleMap *sm,
+    StringView line
+) {
+    return highlight_line(syn, *state, sm, line, state);
+}
 
-    // Update invalid
-    ssize_t last = line_nr;
-    if (last >= s->count) {
-        last = s->count - 1;
+// Find the CachedLine for `line_nr`, or else an unused one (or the least
+// recently used one, if there are none)
+static CachedLine *find_cached_line(LineStates *lss, size_t line_nr)
+{
+    if (!lss->cache) {
+        lss->cache = xcalloc(LINE_CACHE_SIZE, sizeof(*lss->cache));
     }
-    while (1) {
-        while (idx <= last && state_is_valid(states[idx])) {
-            idx++;
+
+    CachedLine *lru = lss->cache;
+    for (size_t i = 0; i < LINE_CACHE_SIZE; i++) {
+        CachedLine *cl = lss->cache + i;
+        if (cl->state && cl->line_nr == line_nr) {
+            return cl;
         }
-        if (idx > last) {
-            break;
+        if (cl->last_used < lru->last_used) {
+            lru = cl;
         }
-
-        // Go to line before first hole
-        idx--;
-        block_iter_move_down(bi, idx - current_line);
-        current_line = idx;
-
-        // NOTE: might not fill entire hole, which is ok
-        ssize_t count = fill_hole(syn, s, sm, bi, idx, last);
-        idx += count;
-        current_line += count;
     }
 
-    // Add new
-    block_iter_move_down(bi, s->count - 1 - current_line);
-    while (s->count - 1 < line_nr) {
-        StringView line = block_iter_get_line_with_nl(bi);
-        highlight_line (
-            syn,
-            states[s->count - 1],
-            sm,
-            line,
-            &states[s->count]
-        );
-        s->count++;
-        block_iter_eat_line(bi);
+    lru->state = NULL;
+    return lru;
+}
+
+static void add_style_span(CachedLine *cl, const TermStyle *style, size_t length)
+{
+    if (cl->nr_spans == cl->alloc) {
+        cl->alloc = next_multiple(cl->nr_spans + 1, 8);
+        cl->spans = xrenew(cl->spans, cl->alloc);
     }
+    cl->spans[cl->nr_spans++] = (StyleSpan){.style = style, .length = length};
 }
 
-const TermStyle **hl_line (
+// Like hl_line(), but using (and updating) a cache of the styles of the
+// most recently highlighted lines, which is used for drawing lines that
+// haven't changed since they were last drawn (e.g. when scrolling back
+// and forth, or moving the cursor between lines). Cached lines are
+// discarded by hl_insert() and hl_delete(), when edited.
+const TermStyle **hl_line_cached (
     Syntax *syn,
-    PointerArray *line_start_states,
+    LineStates *line_start_states,
+    State **state,
     const StyleMap *sm,
     StringView line,
-    size_t line_nr,
-    bool *next_changed
+    size_t line_nr
 ) {
-    *next_changed = false;
-    if (!syn) {
-        return NULL;
-    }
-
-    PointerArray *s = line_start_states;
-    BUG_ON(line_nr >= s->count);
-    State *next;
-    const TermStyle **styles = highlight_line(syn, s->ptrs[line_nr++], sm, line, &next);
-
-    if (line_nr == s->count) {
-        resize_line_states(s, s->count + 1);
-        s->ptrs[s->count++] = next;
-        *next_changed = true;
-    } else if (s->ptrs[line_nr] == next) {
-        // Was not invalidated and didn't change
-    } else if (states_equal(s->ptrs, line_nr, next)) {
-        // Was invalidated and didn't change
-        s->ptrs[line_nr] = next;
-        // *next_changed = 1;
-    } else {
-        // Invalidated or not but changed anyway
-        s->ptrs[line_nr] = next;
-        *next_changed = true;
-        if (line_nr + 1 < s->count) {
-            mark_state_invalid(s->ptrs, line_nr + 1);
+    LineStates *lss = line_start_states;
+    CachedLine *cl = find_cached_line(lss, line_nr);
+    cl->last_used = ++lss->cache_clock;
+
+    if (cl->state == *state && cl->length == line.length) {
+        const TermStyle **styles = get_style_buffer(line.length);
+        size_t pos = 0;
+        for (size_t i = 0, n = cl->nr_spans; i < n; i++) {
+            const StyleSpan *span = cl->spans + i;
+            pos += set_style_range(styles, span->style, pos, pos + span->length);
+        }
+        BUG_ON(pos != line.length);
+        *state = cl->next;
+        return styles;
+    }
+
+    State *start = *state;
+    const TermStyle **styles = highlight_line(syn, start, sm, line, state);
+    cl->state = start;
+    cl->next = *state;
+    cl->line_nr = line_nr;
+    cl->length = line.length;
+    cl->nr_spans = 0;
+
+    for (size_t i = 0, len = line.length; i < len; ) {
+        const TermStyle *style = styles[i];
+        size_t run = 1;
+        while (i + run < len && styles[i + run] == style) {
+            run++;
         }
+        add_style_span(cl, style, run);
+        i += run;
     }
+
     return styles;
 }
 
+// Discard the cached styles of lines `first` to `first + del_lines`
+// (inclusive) and renumber the lines that follow them, as for
+// match_cache_edit()
+static void line_cache_edit(LineStates *lss, size_t first, size_t del_lines, size_t ins_lines)
+{
+    CachedLine *cache = lss->cache;
+    if (!cache) {
+        return;
+    }
+
+    for (size_t i = 0; i < LINE_CACHE_SIZE; i++) {
+        CachedLine *cl = cache + i;
+        if (!cl->state || cl->line_nr < first) {
+            continue;
+        }
+        if (cl->line_nr <= first + del_lines) {
+            cl->state = NULL;
+            cl->last_used = 0;
+            continue;
+        }
+        cl->line_nr = cl->line_nr - del_lines + ins_lines;
+    }
+}
+
+// Discard all cached line styles, e.g. when the TermStyles they refer to
+// may have been freed (see update_all_syntax_styles())
+void hl_clear_line_cache(LineStates *line_start_states)
+{
+    CachedLine *cache = line_start_states->cache;
+    if (!cache) {
+        return;
+    }
+    for (size_t i = 0; i < LINE_CACHE_SIZE; i++) {
+        cache[i].state = NULL;
+        cache[i].last_used = 0;
+    }
+}
+
+// Forget all start states, except that of the first line (which is constant)
+void hl_reset_start_states(LineStates *line_start_states, State *start_state)
+{
+    LineStates *lss = line_start_states;
+    resize_checkpoints(lss, 1);
+    lss->checkpoints[0] = (LineStateCheckpoint){.state = start_state, .nr_lines = 0};
+    lss->count = 1;
+    lss->nr_lines = 0;
+    lss->tail_bytes = 0;
+    hl_clear_line_cache(lss);
+}
+
+void hl_free_line_states(LineStates *line_start_states)
+{
+    LineStates *lss = line_start_states;
+    if (lss->cache) {
+        for (size_t i = 0; i < LINE_CACHE_SIZE; i++) {
+            free(lss->cache[i].spans);
+        }
+        free(lss->cache);
+    }
+    free(lss->checkpoints);
+    *lss = (LineStates){.checkpoints = NULL};
+}
+
+size_t hl_line_states_memory_usage(const LineStates *line_start_states)
+{
+    const LineStates *lss = line_start_states;
+    size_t total = lss->alloc * sizeof(lss->checkpoints[0]);
+    if (lss->cache) {
+        total += LINE_CACHE_SIZE * sizeof(lss->cache[0]);
+        for (size_t i = 0; i < LINE_CACHE_SIZE; i++) {
+            total += lss->cache[i].alloc * sizeof(StyleSpan);
+        }
+    }
+    return total;
+}
+
 // Called after text has been inserted to re-highlight changed lines
-void hl_insert(PointerArray *line_start_states, size_t first, size_t lines)
+void hl_insert(LineStates *line_start_states, size_t first, size_t lines)
 {
-    PointerArray *s = line_start_states;
-    if (first >= s->count) {
+    LineStates *lss = line_start_states;
+    line_cache_edit(lss, first, 0, lines);
+    if (first >= lss->nr_lines) {
         // Nothing to re-highlight
         return;
     }
 
-    size_t last = first + lines;
-    if (last + 1 >= s->count) {
+    if (first + lines >= lss->nr_lines) {
         // Last already highlighted lines changed; there's nothing to
         // gain, so throw them away
-        s->count = first + 1;
+        truncate_checkpoints(lss, first);
         return;
     }
 
-    // Add room for new line states
-    if (lines) {
-        size_t to = last + 1;
-        size_t from = first + 1;
-        resize_line_states(s, s->count + lines);
-        move_line_states(s, to, from, s->count - from);
-        s->count += lines;
+    // Add the new lines to the checkpoint of the first changed line and
+    // invalidate the start state of the next checkpoint
+    size_t start;
+    size_t i = find_checkpoint(lss, first, &start);
+    LineStateCheckpoint *c = lss->checkpoints;
+    c[i].nr_lines += lines;
+    lss->nr_lines += lines;
+    mark_state_invalid(&c[i + 1]);
+
+    size_t total = c[i].nr_lines;
+    if (total <= CHECKPOINT_LINES_MAX) {
+        return;
     }
 
-    // Invalidate start states of new and changed lines
-    for (size_t i = first + 1; i <= last + 1; i++) {
-        mark_state_invalid(s->ptrs, i);
+    // Split the lines into new (invalidated) checkpoints, so that getting
+    // the state of any of them doesn't require highlighting too many
+    const size_t step = CHECKPOINT_LINES_MAX / 2;
+    size_t extra = (total - 1) / step;
+    insert_checkpoints(lss, i + 1, extra);
+    c = lss->checkpoints;
+    c[i].nr_lines = step;
+    for (size_t j = i + 1, end = i + extra; j <= end; j++) {
+        c[j].state = NULL;
+        c[j].nr_lines = (j == end) ? total - (extra * step) : step;
+        mark_state_invalid(&c[j]);
     }
 }
 
 // Called after text has been deleted to re-highlight changed lines
-void hl_delete(PointerArray *line_start_states, size_t first, size_t lines)
+void hl_delete(LineStates *line_start_states, size_t first, size_t lines)
 {
-    PointerArray *s = line_start_states;
-    if (s->count == 1) {
-        return;
-    }
-
-    if (first >= s->count) {
+    LineStates *lss = line_start_states;
+    line_cache_edit(lss, first, lines, 0);
+    if (first >= lss->nr_lines) {
         // Nothing to highlight
         return;
     }
 
-    size_t last = first + lines;
-    if (last + 1 >= s->count) {
+    if (first + lines >= lss->nr_lines) {
         // Last already highlighted lines changed; there's nothing to
         // gain, so throw them away
-        s->count = first + 1;
+        truncate_checkpoints(lss, first);
         return;
     }
 
     // There are already highlighted lines after changed lines; try to
     // save the work
 
-    // Remove deleted lines (states)
-    if (lines) {
-        size_t to = first + 1;
-        size_t from = last + 1;
-        move_line_states(s, to, from, s->count - from);
-        s->count -= lines;
+    // Remove the checkpoints of deleted lines, by merging their lines
+    // into the checkpoint of the first changed line
+    LineStateCheckpoint *c = lss->checkpoints;
+    size_t start = 0;
+    size_t changed = 0;
+    size_t n = 0;
+    for (size_t i = 0, count = lss->count; i < count; i++) {
+        size_t line = start;
+        start += c[i].nr_lines;
+        if (line > first && line <= first + lines) {
+            c[n - 1].nr_lines += c[i].nr_lines;
+            continue;
+        }
+        if (line <= first) {
+            changed = n;
+        }
+        c[n++] = c[i];
     }
 
+    BUG_ON(c[changed].nr_lines <= lines);
+    BUG_ON(changed + 1 >= n);
+    c[changed].nr_lines -= lines;
+    lss->nr_lines -= lines;
+    lss->count = n;
+
     // Invalidate line start state after the changed line
-    mark_state_invalid(s->ptrs, first + 1);
+    mark_state_invalid(&c[changed + 1]);
 }
@@ -8,7 +8,7 @@
 #include "syntax/syntax.h"
 #include "terminal/style.h"
 #include "util/debug.h"
-#include "util/ptr-array.h"
+#include "util/macros.h"
 #include "util/string-view.h"
 
 // Set styles in range [start,end] and return number of styles set
@@ -25,24 +25,85 @@ static inline size_t set_style_range (
     return end - start;
 }
 
+// The syntax State at the start of some line, along with the number of
+// lines until the next checkpoint
+typedef struct {
+    State *state; // Lowest bit is 1 if invalidated
+    size_t nr_lines;
+} LineStateCheckpoint;
+
+// A run of bytes with the same style
+typedef struct {
+    const TermStyle *style;
+    size_t length;
+} StyleSpan;
+
+// The styles of a recently highlighted line (see hl_line_cached())
+typedef struct {
+    State *state; // Start state of the line (or NULL, if unused)
+    State *next; // Start state of the next line
+    size_t line_nr;
+    size_t length; // Length of the line (including newline)
+    size_t last_used; // Value of LineStates::cache_clock when last used
+    StyleSpan *spans;
+    size_t nr_spans;
+    size_t alloc;
+} CachedLine;
+
+// The start states of the highlighted lines of a Buffer. Only the state
+// of the first line of every few is stored, and the states of the lines
+// in between are recomputed when needed (see hl_get_start_state()).
+// The last checkpoint always has `nr_lines == 0` and holds the start
+// state of the first line after all of the other checkpoints.
+typedef struct {
+    LineStateCheckpoint *checkpoints;
+    size_t count;
+    size_t alloc;
+    size_t nr_lines; // Sum of LineStateCheckpoint::nr_lines
+    size_t tail_bytes; // Bytes between the last 2 checkpoints (approximately)
+    size_t interval; // Bytes between checkpoints (adjusted to highlighting speed)
+    CachedLine *cache; // Styles of recently drawn lines (or NULL, if none yet)
+    size_t cache_clock; // Incremented each time a CachedLine is used
+} LineStates;
+
 const TermStyle **hl_line (
     Syntax *syn,
-    PointerArray *line_start_states,
+    State **state,
+    const StyleMap *sm,
+    StringView line
+) NONNULL_ARGS;
+
+const TermStyle **hl_line_cached (
+    Syntax *syn,
+    LineStates *line_start_states,
+    State **state,
     const StyleMap *sm,
     StringView line,
+    size_t line_nr
+) NONNULL_ARGS;
+
+bool hl_fill_start_states (
+    Syntax *syn,
+    LineStates *line_start_states,
+    const StyleMap *sm,
+    BlockIter *bi,
     size_t line_nr,
-    bool *next_changed
-);
+    size_t max_bytes
+) NONNULL_ARG(2, 3, 4);
 
-void hl_fill_start_states (
+State *hl_get_start_state (
     Syntax *syn,
-    PointerArray *line_start_states,
+    const LineStates *line_start_states,
     const StyleMap *sm,
     BlockIter *bi,
     size_t line_nr
-);
+) NONNULL_ARGS_AND_RETURN;
 
-void hl_insert(PointerArray *line_start_states, size_t first, size_t lines);
-void hl_delete(PointerArray *line_start_states, size_t first, size_t lines);
+void hl_reset_start_states(LineStates *line_start_states, State *start_state) NONNULL_ARGS;
+void hl_clear_line_cache(LineStates *line_start_states) NONNULL_ARGS;
+void hl_free_line_states(LineStates *line_start_states) NONNULL_ARGS;
+size_t hl_line_states_memory_usage(const LineStates *line_start_states) NONNULL_ARGS WARN_UNUSED_RESULT;
+void hl_insert(LineStates *line_start_states, size_t first, size_t lines) NONNULL_ARGS;
+void hl_delete(LineStates *line_start_states, size_t first, size_t lines) NONNULL_ARGS;
 
 #endif
@@ -56,13 +56,15 @@ static void fix_conditions (
     }
 }
 
+// The number of prefixes generated by make_prefix_str()
+static unsigned int prefix_counter;
+
 // Generate a prefix for merged state names, to avoid clashes
 static StringView make_prefix_str(char *buf)
 {
-    static unsigned int counter;
     size_t n = 0;
     buf[n++] = 'm';
-    n += buf_uint_to_str(counter++, buf + n);
+    n += buf_uint_to_str(prefix_counter++, buf + n);
     buf[n++] = '-';
     return string_view(buf, n);
 }
@@ -96,6 +98,10 @@ State *merge_syntax(Syntax *syn, SyntaxMerge *merge, const StyleMap *styles)
             BUG_ON(s->conds.alloc != 0);
         }
 
+        // The copied conditions are compiled by highlight_line(), when
+        // the state is first used
+        s->compiled = (CompiledState){.conds = NULL};
+
         // Mark unvisited, so that return-only states get visited
         s->visited = false;
 
@@ -120,3 +126,15 @@ State *merge_syntax(Syntax *syn, SyntaxMerge *merge, const StyleMap *styles)
     merge->subsyn->used = true;
     return start_state;
 }
+
+unsigned int merge_get_prefix_count(void)
+{
+    return prefix_counter;
+}
+
+// Ensure none of the first `count` prefixes are generated again, since
+// they may already be used by states loaded by syntax_cache_load()
+void merge_skip_prefixes(unsigned int count)
+{
+    prefix_counter = MAX(prefix_counter, count);
+}
@@ -14,5 +14,7 @@ typedef struct {
 } SyntaxMerge;
 
 State *merge_syntax(Syntax *syn, SyntaxMerge *m, const StyleMap *styles) NONNULL_ARGS_AND_RETURN;
+unsigned int merge_get_prefix_count(void) WARN_UNUSED_RESULT;
+void merge_skip_prefixes(unsigned int count);
 
 #endif
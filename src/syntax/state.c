@@ -9,6 +9,7 @@
 #include "config.h"
 #include "editor.h"
 #include "filetype.h"
+#include "syntax/cache.h"
 #include "syntax/merge.h"
 #include "util/bsearch.h"
 #include "util/debug.h"
@@ -24,7 +25,18 @@
 
 static bool in_syntax(const SyntaxLoader *syn, ErrorBuffer *ebuf)
 {
-    return likely(syn->current_syntax) || error_msg(ebuf, "No syntax started");
+    if (unlikely(!syn->current_syntax)) {
+        return error_msg(ebuf, "No syntax started");
+    }
+
+    SyntaxRecording *rec = syn->recording;
+    if (rec && rec->current_source != rec->syntax_source) {
+        // Syntaxes modified by more than one source can't be attributed
+        // to either of them (see decode_body())
+        rec->uncacheable = true;
+    }
+
+    return true;
 }
 
 static bool in_state(const SyntaxLoader *syn, ErrorBuffer *ebuf)
@@ -100,20 +112,47 @@ static bool in_subsyntax(const SyntaxLoader *syn, ErrorBuffer *ebuf)
     return ss || error_msg(ebuf, "Destination state 'END' only allowed in a subsyntax");
 }
 
-static Syntax *must_find_subsyntax (
-    const HashMap *syntaxes,
-    ErrorBuffer *ebuf,
-    const char *name
-) {
-    Syntax *syntax = find_any_syntax(syntaxes, name);
+static bool is_recorded_syntax(const SyntaxRecording *rec, const Syntax *syntax)
+{
+    for (size_t i = 0, n = rec->syntaxes.count; i < n; i++) {
+        const RecordedSyntax *r = rec->syntaxes.ptrs[i];
+        if (r->syntax == syntax) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_recorded_require(const SyntaxRecording *rec, const char *path, bool builtin)
+{
+    for (size_t i = 0, n = rec->sources.count; i < n; i++) {
+        const SyntaxSource *src = rec->sources.ptrs[i];
+        if (src->required && src->builtin == builtin && streq(src->path, path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static Syntax *must_find_subsyntax(EditorState *e, const char *name)
+{
+    Syntax *syntax = find_any_syntax(&e->syntaxes, name);
     if (unlikely(!syntax)) {
-        error_msg(ebuf, "No such syntax '%s'", name);
+        error_msg(&e->err, "No such syntax '%s'", name);
         return NULL;
     }
     if (unlikely(!is_subsyntax(syntax))) {
-        error_msg(ebuf, "Syntax '%s' is not a subsyntax", name);
+        error_msg(&e->err, "Syntax '%s' is not a subsyntax", name);
         return NULL;
     }
+
+    SyntaxRecording *rec = e->syn.recording;
+    if (rec && !is_recorded_syntax(rec, syntax)) {
+        // Defined by an earlier load_syntax() call, which the cache
+        // can't depend on
+        rec->uncacheable = true;
+    }
+
     return syntax;
 }
 
@@ -123,7 +162,7 @@ static bool subsyntax_call (
     const char *ret,
     State **dest
 ) {
-    Syntax *subsyn = must_find_subsyntax(&e->syntaxes, &e->err, name);
+    Syntax *subsyn = must_find_subsyntax(e, name);
 
     SyntaxMerge m = {
         .subsyn = subsyn,
@@ -335,7 +374,7 @@ static bool cmd_heredocbegin(EditorState *e, const CommandArgs *a)
         return false;
     }
 
-    Syntax *subsyn = must_find_subsyntax(&e->syntaxes, &e->err, a->args[0]);
+    Syntax *subsyn = must_find_subsyntax(e, a->args[0]);
     if (!subsyn) {
         return false;
     }
@@ -371,7 +410,7 @@ static bool cmd_heredocend(EditorState *e, const CommandArgs *a)
 }
 
 // Forward declaration, used in cmd_include() and cmd_require()
-static SystemErrno read_syntax(EditorState *e, const char *filename, SyntaxLoadFlags flags);
+static SystemErrno read_syntax(EditorState *e, const char *filename, SyntaxLoadFlags flags, bool required);
 
 static bool cmd_include(EditorState *e, const CommandArgs *a)
 {
@@ -379,7 +418,7 @@ static bool cmd_include(EditorState *e, const CommandArgs *a)
     if (a->flags[0] == 'b') {
         flags |= SYN_BUILTIN;
     }
-    SystemErrno err = read_syntax(e, a->args[0], flags);
+    SystemErrno err = read_syntax(e, a->args[0], flags, false);
     return !err;
 }
 
@@ -505,14 +544,18 @@ static bool cmd_require(EditorState *e, const CommandArgs *a)
         flags |= SYN_BUILTIN;
     }
 
+    SyntaxLoader *syn = &e->syn;
     if (hashset_get(set, path, path_len)) {
+        if (syn->recording && !is_recorded_require(syn->recording, path, flags & SYN_BUILTIN)) {
+            // Required by an earlier load_syntax() call (see above)
+            syn->recording->uncacheable = true;
+        }
         return true;
     }
 
-    SyntaxLoader *syn = &e->syn;
     const SyntaxLoadFlags save = syn->flags;
     syn->flags &= ~SYN_WARN_ON_UNUSED_SUBSYN;
-    SystemErrno err = read_syntax(e, path, flags);
+    SystemErrno err = read_syntax(e, path, flags, true);
     syn->flags = save;
     if (err) {
         return false;
@@ -594,6 +637,14 @@ static bool finish_syntax(SyntaxLoader *syn, ErrorBuffer *ebuf, HashMap *syntaxe
     if (!r) {
         free_syntax(syntax);
     }
+
+    SyntaxRecording *rec = syn->recording;
+    if (r && rec) {
+        RecordedSyntax *recorded = xmalloc(sizeof(*recorded));
+        *recorded = (RecordedSyntax){.syntax = syntax, .source = rec->syntax_source};
+        ptr_array_append(&rec->syntaxes, recorded);
+    }
+
     syn->current_syntax = NULL;
     return r;
 }
@@ -611,6 +662,10 @@ static bool cmd_syntax(EditorState *e, const CommandArgs *a)
         syntax->warned_unused_subsyntax = true;
     }
 
+    if (syn->recording) {
+        syn->recording->syntax_source = syn->recording->current_source;
+    }
+
     syn->current_syntax = syntax;
     syn->current_state = NULL;
     return true;
@@ -677,23 +732,40 @@ static ConfigFlags syn_flags_to_cfg_flags(SyntaxLoadFlags flags)
 static SystemErrno read_syntax (
     EditorState *e,
     const char *filename,
-    SyntaxLoadFlags flags
+    SyntaxLoadFlags flags,
+    bool required
 ) {
+    SyntaxRecording *rec = e->syn.recording;
+    size_t parent = 0;
+    if (rec) {
+        parent = rec->current_source;
+        rec->current_source = syntax_recording_add_source(rec, filename, flags, required);
+    }
+
     CommandRunner runner = cmdrunner_for_syntaxes(e);
-    return read_config(&runner, filename, syn_flags_to_cfg_flags(flags));
+    SystemErrno err = read_config(&runner, filename, syn_flags_to_cfg_flags(flags));
+
+    if (rec) {
+        rec->current_source = parent;
+    }
+    return err;
 }
 
-Syntax *load_syntax (
+// Parse and run the commands in `config_text` and, if `recording` is
+// non-NULL, record everything syntax_cache_save() needs to save the result
+static Syntax *parse_syntax (
     EditorState *e,
     StringView config_text,
     const char *config_filename,
-    SyntaxLoadFlags flags
+    SyntaxLoadFlags flags,
+    SyntaxRecording *recording
 ) {
     SyntaxLoader *syn = &e->syn;
     *syn = (SyntaxLoader) {
         .current_syntax = NULL,
         .current_state = NULL,
         .flags = flags | SYN_WARN_ON_UNUSED_SUBSYN,
+        .recording = recording,
     };
 
     ErrorBuffer *ebuf = &e->err;
@@ -717,6 +789,7 @@ Syntax *load_syntax (
     }
 
     ebuf->sourcepos = save;
+    syn->recording = NULL;
 
     if (!r) {
         return NULL;
@@ -734,7 +807,37 @@ Syntax *load_syntax (
         return NULL;
     }
 
-    if (e->status != EDITOR_INITIALIZING) {
+    return syntax;
+}
+
+Syntax *load_syntax (
+    EditorState *e,
+    StringView config_text,
+    const char *config_filename,
+    SyntaxLoadFlags flags
+) {
+    // Linting relies on the errors produced while parsing, so it never
+    // uses the cache
+    const bool use_cache = e->options.syntax_cache && !(flags & SYN_LINT);
+    Syntax *syntax = use_cache ? syntax_cache_load(e, config_text, config_filename, flags) : NULL;
+
+    if (!syntax) {
+        SyntaxRecording rec = {.uncacheable = false};
+        const unsigned int nr_errors = e->err.nr_errors;
+        syntax = parse_syntax(e, config_text, config_filename, flags, use_cache ? &rec : NULL);
+        if (
+            syntax
+            && use_cache
+            && !rec.uncacheable
+            && e->err.nr_errors == nr_errors
+            && is_recorded_syntax(&rec, syntax)
+        ) {
+            syntax_cache_save(e, &rec, config_text, config_filename, flags);
+        }
+        syntax_recording_free(&rec);
+    }
+
+    if (syntax && e->status != EDITOR_INITIALIZING) {
         update_syntax_styles(syntax, &e->styles);
     }
 
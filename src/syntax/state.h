@@ -16,6 +16,7 @@ typedef struct {
     Syntax *current_syntax;
     State *current_state;
     SyntaxLoadFlags flags;
+    struct SyntaxRecording *recording; // See load_syntax() (or NULL, if not caching)
 } SyntaxLoader;
 
 struct EditorState;
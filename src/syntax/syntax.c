@@ -1,9 +1,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include "syntax.h"
+#include "util/arith.h"
+#include "util/ascii.h"
+#include "util/bit.h"
+#include "util/debug.h"
 #include "util/str-util.h"
 #include "util/xmalloc.h"
 #include "util/xsnprintf.h"
+#include "util/xstring.h"
 
 StringList *find_string_list(const Syntax *syn, const char *name)
 {
@@ -46,6 +51,12 @@ static void free_condition(Condition *cond)
     free(cond);
 }
 
+static void free_compiled_state(CompiledState *cs)
+{
+    free(cs->conds);
+    *cs = (CompiledState){.conds = NULL};
+}
+
 static void free_heredoc_state(HeredocState *s)
 {
     free(s);
@@ -53,6 +64,7 @@ static void free_heredoc_state(HeredocState *s)
 
 static void free_state(State *s)
 {
+    free_compiled_state(&s->compiled);
     ptr_array_free_cb(&s->conds, FREE_FUNC(free_condition));
     ptr_array_free_cb(&s->heredoc.states, FREE_FUNC(free_heredoc_state));
     free(s);
@@ -71,6 +83,49 @@ static void free_syntax_contents(Syntax *syn)
     hashmap_free(&syn->default_styles, NULL);
 }
 
+static size_t state_memory_usage(const State *s)
+{
+    size_t conds = s->conds.alloc * sizeof(s->conds.ptrs[0]);
+    conds += s->conds.count * sizeof(Condition);
+    const CompiledState *cs = &s->compiled;
+    if (cs->conds) {
+        conds += cs->nr_conds * sizeof(cs->conds[0]);
+        conds += (cs->nr_lists + 1) * sizeof(cs->lists[0]);
+        conds += cs->nr_lists * sizeof(cs->classes[0]);
+    }
+    return sizeof(*s) + strlen(s->name) + 1 + conds;
+}
+
+// Count the States added to `syn` by merging heredoc sub-syntaxes at
+// runtime (see handle_heredoc()) and return the (approximate) number of
+// bytes used by them
+size_t syntax_heredoc_memory_usage(const Syntax *syn, size_t *nr_states)
+{
+    size_t total = 0;
+    size_t count = 0;
+    for (HashMapIter it = hashmap_iter(&syn->states); hashmap_next(&it); ) {
+        const State *s = it.entry->value;
+        const PointerArray *heredocs = &s->heredoc.states;
+        if (heredocs->count == 0) {
+            continue;
+        }
+
+        // Each merge copies every State of the sub-syntax
+        size_t subsyn_size = 0;
+        const HashMap *subsyn_states = &s->heredoc.subsyntax->states;
+        for (HashMapIter sit = hashmap_iter(subsyn_states); hashmap_next(&sit); ) {
+            subsyn_size += state_memory_usage(sit.entry->value);
+        }
+
+        count += heredocs->count * subsyn_states->count;
+        total += heredocs->alloc * sizeof(heredocs->ptrs[0]);
+        total += heredocs->count * (sizeof(HeredocState) + subsyn_size);
+    }
+
+    *nr_states = count;
+    return total;
+}
+
 void free_syntax(Syntax *syn)
 {
     free_syntax_contents(syn);
@@ -89,6 +144,180 @@ void free_syntaxes(HashMap *syntaxes)
     hashmap_free(syntaxes, FREE_FUNC(free_syntax_cb));
 }
 
+// Add every byte that `cond` could possibly match at (i.e. those where
+// it can't be ruled out by the current byte alone) to `set`
+static void get_cond_bytes(const Condition *cond, BitSetWord set[BITSET_NR_WORDS(256)])
+{
+    const ConditionData *u = &cond->u;
+    const size_t nr_words = BITSET_NR_WORDS(256);
+    switch (cond->type) {
+    case COND_CHAR:
+    case COND_CHAR_BUFFER:
+        memcpy(set, u->bitset, nr_words * sizeof(*set));
+        return;
+    case COND_CHAR1:
+        bitset_add(set, u->ch);
+        return;
+    case COND_STR:
+    case COND_STR2:
+        if (u->str.len == 0) {
+            break;
+        }
+        bitset_add(set, u->str.buf[0]);
+        return;
+    case COND_STR_ICASE:
+        if (u->str.len == 0) {
+            break;
+        }
+        bitset_add(set, ascii_tolower(u->str.buf[0]));
+        bitset_add(set, ascii_toupper(u->str.buf[0]));
+        return;
+    case COND_HEREDOCEND:
+        if (u->heredocend.length == 0) {
+            break;
+        }
+        bitset_add(set, u->heredocend.data[0]);
+        return;
+    case COND_BUFIS:
+    case COND_BUFIS_ICASE:
+    case COND_INLIST:
+    case COND_INLIST_BUFFER:
+    case COND_RECOLOR:
+    case COND_RECOLOR_BUFFER:
+        // These depend only on previously buffered bytes, or (in the
+        // case of the recolor conditions) have side effects regardless
+        // of the current byte
+        break;
+    }
+
+    for (size_t i = 0; i < nr_words; i++) {
+        set[i] = bitset_word_max();
+    }
+}
+
+static bool cond_type_is_char(ConditionType type)
+{
+    return type == COND_CHAR || type == COND_CHAR1 || type == COND_CHAR_BUFFER;
+}
+
+// Return true if every byte mapped to the list of conditions from `cond`
+// to `end` leaves the state unchanged and gets the same style, so that
+// highlight_line() can consume a whole run of such bytes in one go. For
+// the "char" conditions, being in the list implies a match.
+static bool list_consumes_runs (
+    const State *s,
+    const PackedCondition *cond,
+    const PackedCondition *end
+) {
+    if (cond == end) {
+        return s->type == STATE_EAT && s->default_action.destination == s;
+    }
+    return cond->destination == s && cond_type_is_char(cond->type);
+}
+
+// Compile the conditions of `s` into a CompiledState, with one list of
+// conditions for every distinct subset of them that can match some byte.
+// The order of conditions is preserved within each list, so testing only
+// the list for the current byte gives the same result as testing all of
+// `s->conds` in order.
+void compile_state(State *s)
+{
+    CompiledState *cs = &s->compiled;
+    free_compiled_state(cs);
+
+    // Make a bitset of the applicable conditions for every byte value
+    const size_t nr_conds = s->conds.count;
+    const size_t nr_words = MAX(BITSET_NR_WORDS(nr_conds), 1);
+    BitSetWord *sets = xcalloc(256 * nr_words, sizeof(*sets));
+    for (size_t i = 0; i < nr_conds; i++) {
+        BitSetWord bytes[BITSET_NR_WORDS(256)] = {0};
+        get_cond_bytes(s->conds.ptrs[i], bytes);
+        const BitSetWord bit = ((BitSetWord)1) << (i % BITSET_WORD_BITS);
+        BitSetWord *words = sets + (i / BITSET_WORD_BITS);
+        for (size_t w = 0; w < ARRAYLEN(bytes); w++) {
+            for (BitSetWord x = bytes[w]; x; x &= x - 1) {
+                size_t ch = (w * BITSET_WORD_BITS) + umax_ctz(x);
+                words[ch * nr_words] |= bit;
+            }
+        }
+    }
+
+    // Find the distinct sets (usually only a handful) and map each byte
+    // value to the index of its set. Adjacent bytes usually have the same
+    // set (e.g. in ranges like a-z), so the previous one is tried first.
+    const size_t set_size = nr_words * sizeof(*sets);
+    size_t distinct[256];
+    size_t nr_lists = 0;
+    size_t total = 0;
+    for (size_t ch = 0; ch < 256; ch++) {
+        const BitSetWord *set = sets + (ch * nr_words);
+        if (ch > 0 && mem_equal(set, set - nr_words, set_size)) {
+            cs->dispatch[ch] = cs->dispatch[ch - 1];
+            continue;
+        }
+        size_t list = 0;
+        while (list < nr_lists && !mem_equal(set, sets + (distinct[list] * nr_words), set_size)) {
+            list++;
+        }
+        if (list == nr_lists) {
+            distinct[nr_lists++] = ch;
+            for (size_t w = 0; w < nr_words; w++) {
+                total += u64_popcount(set[w]);
+            }
+        }
+        cs->dispatch[ch] = list;
+    }
+
+    // Copy the conditions of each set into a contiguous list
+    size_t conds_size = total * sizeof(cs->conds[0]);
+    size_t lists_size = (nr_lists + 1) * sizeof(cs->lists[0]);
+    size_t classes_size = nr_lists * sizeof(cs->classes[0]);
+    static_assert(ALIGNOF(PackedCondition) % ALIGNOF(uint32_t) == 0);
+    static_assert(ALIGNOF(ByteClass) == 1);
+    cs->conds = xmalloc(conds_size + lists_size + classes_size);
+    cs->lists = (uint32_t*)((char*)cs->conds + conds_size);
+    cs->classes = (ByteClass*)((char*)cs->lists + lists_size);
+    memset(cs->classes, 0, classes_size);
+    size_t n = 0;
+    for (size_t list = 0; list < nr_lists; list++) {
+        const BitSetWord *set = sets + (distinct[list] * nr_words);
+        cs->lists[list] = n;
+        for (size_t i = 0; i < nr_conds; i++) {
+            if (!(set[i / BITSET_WORD_BITS] & (((BitSetWord)1) << (i % BITSET_WORD_BITS)))) {
+                continue;
+            }
+            const Condition *cond = s->conds.ptrs[i];
+            cs->conds[n++] = (PackedCondition) {
+                .type = cond->type,
+                .index = i,
+                .u = cond->u,
+                .destination = cond->a.destination,
+                .emit_style = cond->a.emit_style,
+            };
+        }
+    }
+
+    BUG_ON(n != total);
+    cs->lists[nr_lists] = n;
+    cs->nr_conds = n;
+    cs->nr_lists = nr_lists;
+    free(sets);
+
+    // Find the lists that can consume runs of bytes, as is typical for
+    // the contents of strings and comments, and record which bytes they
+    // apply to, for use with byte_class_span()
+    for (unsigned int ch = 0; ch < 256; ch++) {
+        byte_class_add(&cs->classes[cs->dispatch[ch]], ch);
+    }
+    for (size_t list = 0; list < nr_lists; list++) {
+        const PackedCondition *first = cs->conds + cs->lists[list];
+        const PackedCondition *end = cs->conds + cs->lists[list + 1];
+        if (list_consumes_runs(s, first, end)) {
+            bitset_add(cs->run_lists, list);
+        }
+    }
+}
+
 bool finalize_syntax(HashMap *syntaxes, Syntax *syn, ErrorBuffer *ebuf)
 {
     if (syn->states.count == 0) {
@@ -184,6 +413,16 @@ void update_state_styles(const Syntax *syn, State *s, const StyleMap *styles)
         update_action_style(syn, &c->a, styles);
     }
     update_action_style(syn, &s->default_action, styles);
+
+    CompiledState *cs = &s->compiled;
+    if (cs->conds) {
+        // Update the styles copied by compile_state()
+        for (size_t i = 0, n = cs->nr_conds; i < n; i++) {
+            PackedCondition *pc = &cs->conds[i];
+            const Condition *c = s->conds.ptrs[pc->index];
+            pc->emit_style = c->a.emit_style;
+        }
+    }
 }
 
 void update_syntax_styles(Syntax *syn, const StyleMap *styles)
@@ -7,6 +7,7 @@
 #include "command/error.h"
 #include "syntax/bitset.h"
 #include "syntax/color.h"
+#include "util/byte-class.h"
 #include "util/hashmap.h"
 #include "util/hashset.h"
 #include "util/macros.h"
@@ -72,6 +73,29 @@ typedef struct {
     Action a;
 } Condition;
 
+// A Condition, copied by value into a CompiledState
+typedef struct {
+    ConditionType type;
+    uint32_t index; // Index of the original Condition in `State::conds`
+    ConditionData u;
+    struct State *destination;
+    const TermStyle *emit_style;
+} PackedCondition;
+
+// The conditions of a State, compiled into lists of PackedConditions
+// (see compile_state()), so that highlight_line() only tests those that
+// can match the byte at the current position and without following a
+// pointer for each one
+typedef struct {
+    PackedCondition *conds; // All lists, stored back to back (or NULL, if not compiled)
+    uint32_t *lists; // Offset of each list in `conds`, plus `nr_conds` (same allocation as `conds`)
+    ByteClass *classes; // Bytes mapped to each list in `dispatch` (same allocation as `conds`)
+    uint32_t nr_conds;
+    uint16_t nr_lists;
+    uint8_t dispatch[256]; // Index of the list in `lists` for each byte
+    BitSetWord run_lists[BITSET_NR_WORDS(256)]; // Lists that consume whole runs of their bytes
+} CompiledState;
+
 typedef struct {
     char *name;
     HashMap states;
@@ -87,6 +111,7 @@ typedef struct State {
     char *name;
     const char *emit_name; // Interned
     PointerArray conds;
+    CompiledState compiled; // Compiled from `conds` when first used (see compile_state())
 
     bool defined;
     bool visited;
@@ -119,8 +144,10 @@ static inline bool cond_type_has_destination(ConditionType type)
 
 StringList *find_string_list(const Syntax *syn, const char *name);
 State *find_state(const Syntax *syn, const char *name);
+void compile_state(State *s) NONNULL_ARGS;
 bool finalize_syntax(HashMap *syntaxes, Syntax *syn, ErrorBuffer *ebuf);
 void free_syntax(Syntax *syn);
+size_t syntax_heredoc_memory_usage(const Syntax *syn, size_t *nr_states) NONNULL_ARGS;
 
 Syntax *find_any_syntax(const HashMap *syntaxes, const char *name);
 Syntax *find_syntax(const HashMap *syntaxes, const char *name);
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -338,6 +339,41 @@ static KeyCode term_read_input_modern(Terminal *term)
     return (key == KEY_IGNORE) ? KEY_NONE : key;
 }
 
+// Return true if there's input already buffered or if input can be read
+// from the terminal without blocking
+bool term_input_pending(const Terminal *term)
+{
+    if (term->ibuf.len) {
+        return true;
+    }
+
+    struct timeval tv = {.tv_sec = 0};
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(STDIN_FILENO, &set);
+    return select(1, &set, NULL, NULL, &tv) > 0;
+}
+
+// Wait until there's input to be read from the terminal, or until `fd`
+// (if not -1) becomes readable or a signal is caught. Returns true in the
+// first case, or if there's already input buffered.
+bool term_wait_for_input(const Terminal *term, int fd)
+{
+    if (term->ibuf.len || fd < 0) {
+        return true;
+    }
+
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(STDIN_FILENO, &set);
+    FD_SET(fd, &set);
+    int rc = select(MAX(fd, STDIN_FILENO) + 1, &set, NULL, NULL, NULL);
+    if (rc < 0) {
+        return errno != EINTR;
+    }
+    return FD_ISSET(STDIN_FILENO, &set);
+}
+
 KeyCode term_read_input(Terminal *term, unsigned int esc_timeout_ms)
 {
     if (term->features & TFLAG_KITTY_KEYBOARD) {
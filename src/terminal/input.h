@@ -6,5 +6,7 @@
 #include "util/macros.h"
 
 KeyCode term_read_input(Terminal *term, unsigned int esc_timeout_ms) NONNULL_ARGS;
+bool term_input_pending(const Terminal *term) NONNULL_ARGS WARN_UNUSED_RESULT;
+bool term_wait_for_input(const Terminal *term, int fd) NONNULL_ARGS WARN_UNUSED_RESULT;
 
 #endif
@@ -1,10 +1,16 @@
 #include "ui.h"
+#include "load-save.h"
 #include "util/numtostr.h"
 #include "util/strtonum.h"
 
-static size_t tab_title_width(size_t tab_number, const char *filename)
+static size_t tab_title_width(size_t tab_number, const Buffer *buffer)
 {
-    return 3 + size_str_width(tab_number) + u_str_width(filename);
+    size_t w = 3 + size_str_width(tab_number) + u_str_width(buffer_filename(buffer));
+    if (unlikely(buffer->loader)) {
+        // Space for load progress (e.g. " 42%")
+        w += 2 + size_str_width(load_buffer_progress(buffer));
+    }
+    return w;
 }
 
 static size_t get_first_tab_idx(const Window *window)
@@ -44,7 +50,7 @@ static void calculate_tabbar(Window *window)
             // Make sure current tab is visible
             window->first_tab_idx = MIN(i, window->first_tab_idx);
         }
-        size_t w = tab_title_width(i + 1, buffer_filename(view->buffer));
+        size_t w = tab_title_width(i + 1, view->buffer);
         view->tt_width = w;
         view->tt_truncated_width = w;
         total_w += w;
@@ -131,6 +137,12 @@ static void print_tab_title(Terminal *term, const StyleMap *styles, const View *
     term_put_char(obuf, is_modified ? '+' : ':');
     term_put_str(obuf, filename);
 
+    if (unlikely(view->buffer->loader)) {
+        term_put_char(obuf, ' ');
+        term_put_str(obuf, uint_to_str(load_buffer_progress(view->buffer)));
+        term_put_char(obuf, '%');
+    }
+
     size_t ntabs = view->window->views.count;
     bool right_overflow = (obuf->x == (obuf->width - 1) && idx < (ntabs - 1));
     term_put_char(obuf, right_overflow ? '>' : ' ');
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "ui.h"
 #include "indent.h"
 #include "selection.h"
@@ -5,6 +6,7 @@
 #include "util/ascii.h"
 #include "util/debug.h"
 #include "util/utf8.h"
+#include "util/xmalloc.h"
 #include "util/xstring.h"
 
 typedef struct {
@@ -21,6 +23,8 @@ typedef struct {
     size_t indent_size;
     size_t trailing_ws_offset;
     const TermStyle **styles;
+    const LineMatches *matches; // Search matches to highlight (or NULL)
+    size_t match_idx; // Index of the first span in `matches` not yet passed
 } LineInfo;
 
 static void mask_selection_and_current_line (
@@ -37,6 +41,17 @@ static void mask_selection_and_current_line (
     }
 }
 
+static bool is_search_match(LineInfo *info, size_t pos)
+{
+    const LineMatches *m = info->matches;
+    size_t i = info->match_idx;
+    while (i < m->nr_spans && m->spans[i].end <= pos) {
+        i++;
+    }
+    info->match_idx = i;
+    return i < m->nr_spans && m->spans[i].start <= pos;
+}
+
 static bool is_non_text(CodePoint u, bool display_special)
 {
     if (u == '\t') {
@@ -132,6 +147,10 @@ static CodePoint screen_next_char (
         mask_style(&style, &styles->builtin[BSE_WSERROR]);
     }
 
+    if (info->matches && is_search_match(info, pos)) {
+        mask_style(&style, &styles->builtin[BSE_SEARCHMATCH]);
+    }
+
     mask_selection_and_current_line(styles, info, &style);
     set_style(term, styles, &style);
     info->offset += count;
@@ -264,7 +283,8 @@ static LineInfo line_info_init(const View *view, const BlockIter *bi, size_t lin
 static void line_info_set_line (
     LineInfo *info,
     StringView line,
-    const TermStyle **styles
+    const TermStyle **styles,
+    const LineMatches *matches
 ) {
     BUG_ON(line.length == 0);
     BUG_ON(line.data[line.length - 1] != '\n');
@@ -273,6 +293,8 @@ static void line_info_set_line (
     info->size = line.length - 1;
     info->pos = 0;
     info->styles = styles;
+    info->matches = matches;
+    info->match_idx = 0;
 
     {
         size_t i, n;
@@ -344,10 +366,34 @@ static void print_line (
     term_clear_eol(term);
 }
 
+// Get the start state of each line in the editable area of `window`,
+// as last drawn by update_range(), or NULL for lines that haven't been
+// drawn at the current position of `view`
+static void **get_drawn_states(Window *window, const View *view)
+{
+    PointerArray *states = &window->drawn_states;
+    size_t n = MAX(window->edit_h, 1);
+    if (states->alloc < n) {
+        states->alloc = n;
+        states->ptrs = xrenew(states->ptrs, n);
+        states->count = 0;
+    }
+
+    if (states->count != n || window->drawn_view != view || window->drawn_vy != view->vy) {
+        memset(states->ptrs, 0, n * sizeof(states->ptrs[0]));
+        states->count = n;
+        window->drawn_view = view;
+        window->drawn_vy = view->vy;
+    }
+
+    return states->ptrs;
+}
+
 void update_range (
     Terminal *term,
     const View *view,
     const StyleMap *styles,
+    const SearchState *hlsearch,
     long y1,
     long y2,
     bool display_special
@@ -377,10 +423,25 @@ void update_range (
     y2 -= view->vy;
 
     bool got_line = !block_iter_is_eof(&bi);
-    Syntax *syn = view->buffer->syntax;
-    PointerArray *lss = &view->buffer->line_start_states;
-    BlockIter tmp = block_iter(view->buffer);
-    hl_fill_start_states(syn, lss, styles, &tmp, info.line_nr);
+    Buffer *buffer = view->buffer;
+    Syntax *syn = buffer->syntax;
+    LineStates *lss = &buffer->line_start_states;
+    MatchCache *match_cache = &buffer->match_cache;
+    BlockIter tmp = block_iter(buffer);
+
+    // Filling in the start states of all lines above the first visible
+    // one could take a long time (e.g. after jumping to the end of a
+    // large file), so only a bounded amount of work is done here. If
+    // that isn't enough, the lines are drawn with provisional styles and
+    // the rest of the work is done while idle (see continue_highlight()).
+    bool provisional = !hl_fill_start_states(syn, lss, styles, &tmp, info.line_nr, 1 << 20);
+    State *state = NULL;
+    void **drawn_states = NULL;
+    if (syn) {
+        state = provisional ? syn->start_state : hl_get_start_state(syn, lss, styles, &tmp, info.line_nr);
+        drawn_states = get_drawn_states(view->window, view);
+    }
+
     long i;
 
     for (i = y1; got_line && i < y2; i++) {
@@ -388,9 +449,20 @@ void update_range (
         term_move_cursor(obuf, edit_x, edit_y + i);
 
         StringView line = block_iter_get_line_with_nl(&bi);
-        bool next_changed;
-        const TermStyle **hlstyles = hl_line(syn, lss, styles, line, info.line_nr, &next_changed);
-        line_info_set_line(&info, line, hlstyles);
+        bool next_changed = false;
+        const TermStyle **hlstyles = NULL;
+        if (syn) {
+            drawn_states[i] = state;
+            hlstyles = hl_line_cached(syn, lss, &state, styles, line, info.line_nr);
+            next_changed = (i + 1 < edit_h && drawn_states[i + 1] != state);
+        }
+        const LineMatches *matches = NULL;
+        if (hlsearch) {
+            StringView text = string_view(line.data, line.length - 1);
+            const regex_t *re = hlsearch->regex;
+            matches = match_cache_get(match_cache, re, hlsearch->generation, text, info.line_nr);
+        }
+        line_info_set_line(&info, line, hlstyles, matches);
         print_line(term, &info, styles, display_special);
 
         got_line = !!block_iter_next_line(&bi);
@@ -403,6 +475,16 @@ void update_range (
         }
     }
 
+    if (syn) {
+        // Have the start states filled in up to one screen ahead of the
+        // last line drawn, so that scrolling down doesn't have to do it
+        size_t ahead = MIN(info.line_nr + edit_h, buffer->nl);
+        if (provisional || lss->nr_lines < ahead) {
+            buffer->hl_target = MAX(buffer->hl_target, ahead);
+            buffer->hl_provisional |= provisional;
+        }
+    }
+
     if (i < y2 && info.line_nr == view->cy) {
         // Dummy empty line is shown only if cursor is on it
         TermStyle style = styles->builtin[BSE_DEFAULT];
@@ -74,6 +74,15 @@ static void update_line_numbers (
     }
 }
 
+// Get the SearchState whose matches should be highlighted, if any
+static const SearchState *get_hlsearch(EditorState *e)
+{
+    if (!e->options.highlight_search || !search_get_regex(&e->search)) {
+        return NULL;
+    }
+    return &e->search;
+}
+
 static void update_window_full(Window *window, void* UNUSED_ARG(data))
 {
     EditorState *e = window->editor;
@@ -92,8 +101,9 @@ static void update_window_full(Window *window, void* UNUSED_ARG(data))
     }
 
     bool display_special = options->display_special;
+    const SearchState *hlsearch = get_hlsearch(e);
     long y2 = view->vy + window->edit_h;
-    update_range(term, view, styles, view->vy, y2, display_special);
+    update_range(term, view, styles, hlsearch, view->vy, y2, display_special);
     update_status_line(window);
 }
 
@@ -108,7 +118,8 @@ static void update_window (
     Terminal *term,
     Window *window,
     const StyleMap *styles,
-    const GlobalOptions *options
+    const GlobalOptions *options,
+    const SearchState *hlsearch
 ) {
     if (options->tab_bar && window->update_tabbar) {
         print_tabbar(term, styles, window);
@@ -124,7 +135,7 @@ static void update_window (
 
     long y1 = MAX(buffer->changed_line_min, view->vy);
     long y2 = MIN(buffer->changed_line_max, view->vy + window->edit_h - 1);
-    update_range(term, view, styles, y1, y2 + 1, options->display_special);
+    update_range(term, view, styles, hlsearch, y1, y2 + 1, options->display_special);
     update_status_line(window);
 }
 
@@ -135,7 +146,13 @@ void update_buffer_windows (
     const StyleMap *styles,
     const GlobalOptions *options
 ) {
-    const Buffer *buffer = current_view->buffer;
+    Buffer *buffer = current_view->buffer;
+    const SearchState *hlsearch = get_hlsearch(current_view->window->editor);
+    if (hlsearch && buffer->match_cache.generation != hlsearch->generation) {
+        // The search regex changed since matches were last highlighted
+        mark_all_lines_changed(buffer);
+    }
+
     for (size_t i = 0, n = buffer->views.count; i < n; i++) {
         View *view = buffer->views.ptrs[i];
         if (view != view->window->view) {
@@ -150,6 +167,6 @@ void update_buffer_windows (
             // This has already been done for the current view
             view_update(view);
         }
-        update_window(term, view->window, styles, options);
+        update_window(term, view->window, styles, options, hlsearch);
     }
 }
@@ -2,6 +2,7 @@
 #include "ui.h"
 #include "editor.h"
 #include "frame.h"
+#include "syntax/highlight.h"
 #include "syntax/syntax.h"
 #include "terminal/cursor.h"
 #include "terminal/ioctl.h"
@@ -173,6 +174,10 @@ void update_screen(EditorState *e, const ScreenState *s)
 
     if (unlikely(flags & UPDATE_SYNTAX_STYLES)) {
         update_all_syntax_styles(&e->syntaxes, styles);
+        for (size_t i = 0, n = e->buffers.count; i < n; i++) {
+            Buffer *b = e->buffers.ptrs[i];
+            hl_clear_line_cache(&b->line_start_states);
+        }
     }
 
     start_update(term);
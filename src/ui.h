@@ -67,6 +67,7 @@ void update_range (
     Terminal *term,
     const View *view,
     const StyleMap *styles,
+    const SearchState *hlsearch,
     long y1,
     long y2,
     bool display_special
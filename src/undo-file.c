@@ -0,0 +1,238 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "undo-file.h"
+#include "change.h"
+#include "load-save.h"
+#include "util/debug.h"
+#include "util/hash.h"
+#include "util/log.h"
+#include "util/string-view.h"
+#include "util/string.h"
+#include "util/xmalloc.h"
+#include "util/xreadwrite.h"
+
+/*
+ * The undo history of each file is saved to $DTE_HOME/undo/<hash>, where
+ * <hash> is derived from the absolute filename. Each undo file consists
+ * of an UndoFileHeader, followed by the absolute filename (to rule out
+ * hash collisions) and then the output of serialize_changes().
+ *
+ * The history only applies to the exact text it was saved with, so it's
+ * ignored unless the identity of the file (as recorded in the header)
+ * still matches the FileInfo of the Buffer. When it does, the undo file
+ * is mapped by undo_file_open() but only decoded by undo_file_load(),
+ * when the history is first needed (e.g. by undo(), redo() or the first
+ * edit). Opening a file therefore costs no more than an open(3), fstat(3)
+ * and mmap(3) call, regardless of how much history there is.
+ */
+
+typedef struct {
+    char magic[8];
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    uint64_t mtime_sec;
+    uint64_t mtime_nsec;
+    uint64_t filename_len;
+    uint64_t saved_idx; // See serialize_changes()
+} UndoFileHeader;
+
+static const char undo_file_magic[8] = "dteundo1";
+
+static char *get_undo_file_path(const char *dir, const char *abs_filename)
+{
+    uintmax_t hash = fnv_1a_hash(abs_filename, strlen(abs_filename));
+    return xasprintf("%s/undo/%016jx", dir, hash);
+}
+
+static UndoFileHeader make_header(const Buffer *buffer, size_t filename_len, uint64_t saved_idx)
+{
+    const FileInfo *info = &buffer->file;
+    UndoFileHeader header = {
+        .dev = info->dev,
+        .ino = info->ino,
+        .size = info->size,
+        .mtime_sec = info->mtime.tv_sec,
+        .mtime_nsec = info->mtime.tv_nsec,
+        .filename_len = filename_len,
+        .saved_idx = saved_idx,
+    };
+    memcpy(header.magic, undo_file_magic, sizeof(header.magic));
+    return header;
+}
+
+// Map the undo file for `buffer` (if there is one and it still matches the
+// file it was saved for), so that undo_file_load() can decode it later
+void undo_file_open(Buffer *buffer, const char *dir)
+{
+    const char *filename = buffer->abs_filename;
+    BUG_ON(!filename);
+    BUG_ON(buffer->undo_file.data);
+    if (buffer->file.mode == 0) {
+        // New file
+        return;
+    }
+
+    char *path = get_undo_file_path(dir, filename);
+    int fd = xopen(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERRNO_ON(errno != ENOENT, "open");
+        free(path);
+        return;
+    }
+
+    struct stat st;
+    UndoFileHeader header;
+    const size_t filename_len = strlen(filename);
+    const size_t min_size = sizeof(header) + filename_len;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uintmax_t)st.st_size < min_size) {
+        goto out;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERRNO("mmap");
+        goto out;
+    }
+
+    memcpy(&header, map, sizeof(header));
+    UndoFileHeader expected = make_header(buffer, filename_len, header.saved_idx);
+    if (
+        memcmp(&header, &expected, sizeof(header)) != 0
+        || memcmp((char*)map + sizeof(header), filename, filename_len) != 0
+    ) {
+        LOG_INFO("ignoring stale undo file: %s", path);
+        munmap(map, st.st_size);
+        goto out;
+    }
+
+    LOG_INFO("mapped undo file: %s", path);
+    buffer->undo_file = string_view(map, st.st_size);
+
+out:
+    xclose(fd);
+    free(path);
+}
+
+// Decode the undo file mapped by undo_file_open(), if any, into the
+// (still empty) undo tree of `buffer`
+void undo_file_load(Buffer *buffer)
+{
+    const StringView map = buffer->undo_file;
+    if (likely(!map.data)) {
+        return;
+    }
+
+    UndoFileHeader header;
+    memcpy(&header, map.data, sizeof(header));
+    const size_t skip = sizeof(header) + header.filename_len;
+    StringView data = string_view(map.data + skip, map.length - skip);
+    size_t saved_idx = MIN(header.saved_idx, SIZE_MAX);
+
+    // The history is checked against the size of the text, so all of it
+    // must be present (see deserialize_changes())
+    load_buffer_finish(buffer);
+    if (!deserialize_changes(buffer, data, saved_idx)) {
+        LOG_WARNING("invalid undo file for %s", buffer->abs_filename);
+    }
+
+    undo_file_close(buffer);
+}
+
+// Unmap the undo file mapped by undo_file_open(), if any, without using it
+void undo_file_close(Buffer *buffer)
+{
+    StringView map = buffer->undo_file;
+    if (map.data) {
+        munmap((void*)map.data, map.length);
+        buffer->undo_file = string_view(NULL, 0);
+    }
+}
+
+// Save the undo history of `buffer`, for the version of the file last
+// loaded or saved (i.e. Buffer::saved_change and Buffer::file), or remove
+// the undo file if there's no history that could apply to it
+bool undo_file_save(Buffer *buffer, const char *dir, ErrorBuffer *ebuf)
+{
+    const char *filename = buffer->abs_filename;
+    if (!filename || buffer->file.mode == 0) {
+        return true;
+    }
+
+    undo_file_load(buffer);
+    char *path = get_undo_file_path(dir, filename);
+    const size_t filename_len = strlen(filename);
+    String buf = string_new(4096);
+    string_append_memset(&buf, 0, sizeof(UndoFileHeader));
+    string_append_buf(&buf, filename, filename_len);
+    const size_t header_len = buf.len;
+    size_t saved_idx = serialize_changes(buffer, &buf);
+
+    if (saved_idx == SIZE_MAX || buf.len == header_len) {
+        // Nothing to save (or nothing that applies to the saved file)
+        if (unlink(path) != 0 && errno != ENOENT) {
+            LOG_ERRNO("unlink");
+        }
+        string_free(&buf);
+        free(path);
+        return true;
+    }
+
+    UndoFileHeader header = make_header(buffer, filename_len, saved_idx);
+    memcpy(buf.buffer, &header, sizeof(header));
+
+    char *undo_dir = xasprintf("%s/undo", dir);
+    if (mkdir(undo_dir, 0700) != 0 && errno != EEXIST) {
+        error_msg(ebuf, "Error creating %s: %s", undo_dir, strerror(errno));
+        goto error;
+    }
+
+    // Write to a temporary file and then rename it, so that an interrupted
+    // write can never leave a truncated undo file behind
+    char *tmp = xasprintf("%s.tmp", path);
+    int fd = xopen(tmp, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        error_msg(ebuf, "Error creating %s: %s", tmp, strerror(errno));
+        free(tmp);
+        goto error;
+    }
+
+    if (xwrite_all(fd, buf.buffer, buf.len) < 0) {
+        error_msg(ebuf, "Error writing %s: %s", tmp, strerror(errno));
+        xclose(fd);
+        goto error_unlink;
+    }
+
+    SystemErrno err = xclose(fd);
+    if (err != 0) {
+        error_msg(ebuf, "Error closing %s: %s", tmp, strerror(err));
+        goto error_unlink;
+    }
+
+    if (rename(tmp, path) != 0) {
+        error_msg(ebuf, "Renaming %s to %s: %s", tmp, path, strerror(errno));
+        goto error_unlink;
+    }
+
+    free(tmp);
+    free(undo_dir);
+    string_free(&buf);
+    free(path);
+    return true;
+
+error_unlink:
+    unlink(tmp);
+    free(tmp);
+error:
+    free(undo_dir);
+    string_free(&buf);
+    free(path);
+    return false;
+}
@@ -0,0 +1,14 @@
+#ifndef UNDO_FILE_H
+#define UNDO_FILE_H
+
+#include <stdbool.h>
+#include "buffer.h"
+#include "command/error.h"
+#include "util/macros.h"
+
+void undo_file_open(Buffer *buffer, const char *dir) NONNULL_ARGS;
+void undo_file_load(Buffer *buffer) NONNULL_ARGS;
+void undo_file_close(Buffer *buffer) NONNULL_ARGS;
+bool undo_file_save(Buffer *buffer, const char *dir, ErrorBuffer *ebuf) NONNULL_ARGS;
+
+#endif
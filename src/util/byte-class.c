@@ -0,0 +1,165 @@
+#include "byte-class.h"
+#include "bit.h"
+
+/*
+ * Finding the end of a run of bytes from an arbitrary set is the main
+ * cost of highlighting comments, strings and whitespace (see
+ * highlight_line()). The SIMD kernels here test 16 or 32 bytes at a time,
+ * by using the low 4 bits of each byte to look up its row in a ByteClass
+ * (with pshufb) and the high 4 bits to look up the bit within that row.
+ * Since pshufb can't be assumed for x86-64 (i.e. it requires SSSE3), the
+ * best implementation for the current CPU is selected at startup (via
+ * CONSTRUCTOR), with a portable, byte-at-a-time fallback otherwise.
+ */
+
+#if defined(__x86_64__) && !defined(__TINYC__) \
+    && (GNUC_AT_LEAST(4, 9) || HAS_ATTRIBUTE(target)) \
+    && (GNUC_AT_LEAST(4, 8) || HAS_BUILTIN(__builtin_cpu_supports))
+    #include <immintrin.h>
+    #define HAVE_SIMD_KERNELS 1
+#endif
+
+size_t byte_class_span_portable(const ByteClass *bc, const char *buf, size_t len)
+{
+    size_t i = 0;
+    while (i < len && byte_class_contains(bc, buf[i])) {
+        i++;
+    }
+    return i;
+}
+
+#if HAVE_SIMD_KERNELS
+#define SSSE3 __attribute__((__target__("ssse3")))
+#define AVX2 __attribute__((__target__("avx2")))
+
+// Return a vector with a 0xFF byte for each byte of `v` that isn't a
+// member of the class described by `rows_lo` and `rows_hi`
+SSSE3 static __m128i ssse3_nonmembers(__m128i v, __m128i rows_lo, __m128i rows_hi)
+{
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i idx_mask = _mm_set1_epi8((char)0x8F);
+    const __m128i top_bit = _mm_set1_epi8((char)0x80);
+
+    // pshufb gives 0 for indices with the top bit set, so each byte only
+    // finds its row in one of the 2 tables
+    __m128i idx = _mm_and_si128(v, idx_mask);
+    __m128i row_lo = _mm_shuffle_epi8(rows_lo, idx);
+    __m128i row_hi = _mm_shuffle_epi8(rows_hi, _mm_xor_si128(idx, top_bit));
+    __m128i row = _mm_or_si128(row_lo, row_hi);
+
+    __m128i high_nibbles = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+    __m128i bit = _mm_shuffle_epi8(bits, high_nibbles);
+    return _mm_cmpeq_epi8(_mm_and_si128(row, bit), _mm_setzero_si128());
+}
+
+SSSE3 static size_t byte_class_span_ssse3(const ByteClass *bc, const char *buf, size_t len)
+{
+    const __m128i rows_lo = _mm_loadu_si128((const __m128i*)bc->rows[0]);
+    const __m128i rows_hi = _mm_loadu_si128((const __m128i*)bc->rows[1]);
+    size_t i = 0;
+    while (len - i >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+        unsigned int mask = _mm_movemask_epi8(ssse3_nonmembers(v, rows_lo, rows_hi));
+        if (mask) {
+            return i + u32_ctz(mask);
+        }
+        i += 16;
+    }
+
+    if (i == len || len < 16) {
+        return i + byte_class_span_portable(bc, buf + i, len - i);
+    }
+
+    // Test the remaining bytes with an overlapping load of the last 16,
+    // ignoring the results for those already tested above
+    size_t start = len - 16;
+    __m128i v = _mm_loadu_si128((const __m128i*)(buf + start));
+    unsigned int mask = _mm_movemask_epi8(ssse3_nonmembers(v, rows_lo, rows_hi));
+    mask >>= i - start;
+    return mask ? i + u32_ctz(mask) : len;
+}
+
+AVX2 static uint32_t avx2_nonmembers(const char *buf, __m256i rows_lo, __m256i rows_hi)
+{
+    const __m256i bits = _mm256_setr_epi8 (
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128
+    );
+    const __m256i idx_mask = _mm256_set1_epi8((char)0x8F);
+    const __m256i top_bit = _mm256_set1_epi8((char)0x80);
+
+    // See ssse3_nonmembers()
+    __m256i v = _mm256_loadu_si256((const __m256i*)buf);
+    __m256i idx = _mm256_and_si256(v, idx_mask);
+    __m256i row_lo = _mm256_shuffle_epi8(rows_lo, idx);
+    __m256i row_hi = _mm256_shuffle_epi8(rows_hi, _mm256_xor_si256(idx, top_bit));
+    __m256i row = _mm256_or_si256(row_lo, row_hi);
+
+    __m256i high_nibbles = _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+    __m256i bit = _mm256_shuffle_epi8(bits, high_nibbles);
+    __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), _mm256_setzero_si256());
+    return (uint32_t)_mm256_movemask_epi8(miss);
+}
+
+AVX2 static size_t byte_class_span_avx2(const ByteClass *bc, const char *buf, size_t len)
+{
+    if (len < 32) {
+        // Avoid using (and having to clear) the upper halves of the AVX
+        // registers before calling a function that uses SSE encodings
+        return byte_class_span_ssse3(bc, buf, len);
+    }
+
+    const __m256i rows_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)bc->rows[0]));
+    const __m256i rows_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)bc->rows[1]));
+    size_t i = 0;
+    while (len - i >= 32) {
+        uint32_t mask = avx2_nonmembers(buf + i, rows_lo, rows_hi);
+        if (mask) {
+            return i + u32_ctz(mask);
+        }
+        i += 32;
+    }
+
+    if (i == len) {
+        return len;
+    }
+
+    // See byte_class_span_ssse3()
+    size_t start = len - 32;
+    uint32_t mask = avx2_nonmembers(buf + start, rows_lo, rows_hi) >> (i - start);
+    return mask ? i + u32_ctz(mask) : len;
+}
+#endif
+
+typedef struct {
+    const char *name;
+    size_t (*span)(const ByteClass *bc, const char *buf, size_t len);
+} ByteClassSpanImpl;
+
+static const ByteClassSpanImpl portable_impl = {"portable", byte_class_span_portable};
+static const ByteClassSpanImpl *impl = &portable_impl; // NOLINT(*-avoid-non-const-global-variables)
+
+#if HAVE_SIMD_KERNELS
+static const ByteClassSpanImpl ssse3_impl = {"ssse3", byte_class_span_ssse3};
+static const ByteClassSpanImpl avx2_impl = {"avx2", byte_class_span_avx2};
+
+CONSTRUCTOR static void select_impl(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl = &avx2_impl;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        impl = &ssse3_impl;
+    }
+}
+#endif
+
+size_t byte_class_span(const ByteClass *bc, const char *buf, size_t len)
+{
+    return impl->span(bc, buf, len);
+}
+
+const char *byte_class_span_impl_name(void)
+{
+    return impl->name;
+}
@@ -0,0 +1,35 @@
+#ifndef UTIL_BYTE_CLASS_H
+#define UTIL_BYTE_CLASS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "macros.h"
+
+// A set of byte values, stored as 2 tables of 16 rows (indexed by the
+// low 4 bits of a byte) of 8 bits (indexed by the high 4 bits, modulo 8),
+// so that membership can be tested with SIMD table lookups
+typedef struct {
+    uint8_t rows[2][16]; // For bytes 0x00-0x7F and 0x80-0xFF respectively
+} ByteClass;
+
+static inline void byte_class_add(ByteClass *bc, unsigned char ch)
+{
+    bc->rows[ch >> 7][ch & 0xF] |= 1u << ((ch >> 4) & 7);
+}
+
+static inline bool byte_class_contains(const ByteClass *bc, unsigned char ch)
+{
+    return (bc->rows[ch >> 7][ch & 0xF] >> ((ch >> 4) & 7)) & 1;
+}
+
+// Return the length of the initial run of bytes in `buf` that are
+// members of `bc` (like strspn(3), but with a precomputed set)
+size_t byte_class_span(const ByteClass *bc, const char *buf, size_t len) NONNULL_ARG(1) NONNULL_ARG_IF_NONZERO_LENGTH(2, 3);
+
+// Portable version of the above, exposed for testing and benchmarking
+size_t byte_class_span_portable(const ByteClass *bc, const char *buf, size_t len) NONNULL_ARG(1) NONNULL_ARG_IF_NONZERO_LENGTH(2, 3);
+
+const char *byte_class_span_impl_name(void) RETURNS_NONNULL;
+
+#endif
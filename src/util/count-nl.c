@@ -0,0 +1,229 @@
+#include <stdint.h>
+#include <string.h>
+#include "count-nl.h"
+
+/*
+ * Counting newlines is the main cost of loading files and of inserting
+ * or deleting large amounts of text, since every Block must keep an
+ * accurate Block::nl. The functions here use SIMD where available, with
+ * the best implementation for the current CPU being selected at startup
+ * (via CONSTRUCTOR) and a portable, word-at-a-time fallback otherwise.
+ *
+ * All implementations accumulate matches in 8-bit lanes (by subtracting
+ * the all-ones comparison results) and only widen them to a full count
+ * every 255 iterations, which avoids any per-byte branching.
+ */
+
+#if defined(__x86_64__) && defined(__SSE2__) && !defined(__TINYC__)
+    #include <immintrin.h>
+    #define HAVE_SSE2_KERNELS 1
+    #if (GNUC_AT_LEAST(4, 9) || HAS_ATTRIBUTE(target)) \
+        && (GNUC_AT_LEAST(4, 8) || HAS_BUILTIN(__builtin_cpu_supports))
+        #define HAVE_AVX2_KERNELS 1
+    #endif
+#endif
+
+#define WORD_ONES 0x0101010101010101ULL
+#define WORD_HIGH 0x8080808080808080ULL
+#define WORD_LOW7 0x7F7F7F7F7F7F7F7FULL
+#define WORD_NL (WORD_ONES * '\n')
+
+static size_t count_nl_tail(const char *buf, size_t len)
+{
+    size_t nl = 0;
+    for (size_t i = 0; i < len; i++) {
+        nl += (buf[i] == '\n');
+    }
+    return nl;
+}
+
+static size_t copy_count_nl_tail(char *dst, const char *src, size_t len)
+{
+    size_t nl = 0;
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = src[i];
+        nl += (src[i] == '\n');
+    }
+    return nl;
+}
+
+// Return a word with 0x01 in each byte position where `word` has '\n'
+// and 0x00 elsewhere (without any carries between bytes)
+static uint64_t word_nl_bytes(uint64_t word)
+{
+    uint64_t x = word ^ WORD_NL;
+    uint64_t t = ((x & WORD_LOW7) + WORD_LOW7) | x;
+    return (~t & WORD_HIGH) >> 7;
+}
+
+// Sum the bytes of a word of 8-bit counters
+static size_t word_sum_bytes(uint64_t acc)
+{
+    uint64_t pairs = (acc & 0x00FF00FF00FF00FFULL) + ((acc >> 8) & 0x00FF00FF00FF00FFULL);
+    return (pairs * 0x0001000100010001ULL) >> 48;
+}
+
+size_t count_nl_portable(const char *buf, size_t len)
+{
+    size_t nl = 0;
+    size_t i = 0;
+    while (len - i >= 8) {
+        size_t n = MIN((len - i) / 8, 255);
+        uint64_t acc = 0;
+        for (size_t end = i + (n * 8); i < end; i += 8) {
+            uint64_t word;
+            memcpy(&word, buf + i, 8);
+            acc += word_nl_bytes(word);
+        }
+        nl += word_sum_bytes(acc);
+    }
+    return nl + count_nl_tail(buf + i, len - i);
+}
+
+size_t copy_count_nl_portable(char *dst, const char *src, size_t len)
+{
+    size_t nl = 0;
+    size_t i = 0;
+    while (len - i >= 8) {
+        size_t n = MIN((len - i) / 8, 255);
+        uint64_t acc = 0;
+        for (size_t end = i + (n * 8); i < end; i += 8) {
+            uint64_t word;
+            memcpy(&word, src + i, 8);
+            memcpy(dst + i, &word, 8);
+            acc += word_nl_bytes(word);
+        }
+        nl += word_sum_bytes(acc);
+    }
+    return nl + copy_count_nl_tail(dst + i, src + i, len - i);
+}
+
+#if HAVE_SSE2_KERNELS
+static size_t sse2_sum_bytes(__m128i acc)
+{
+    __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+    return (size_t)_mm_cvtsi128_si64(sums) + (size_t)_mm_extract_epi16(sums, 4);
+}
+
+static size_t count_nl_sse2(const char *buf, size_t len)
+{
+    const __m128i nlv = _mm_set1_epi8('\n');
+    size_t nl = 0;
+    size_t i = 0;
+    while (len - i >= 16) {
+        size_t n = MIN((len - i) / 16, 255);
+        __m128i acc = _mm_setzero_si128();
+        for (size_t end = i + (n * 16); i < end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, nlv));
+        }
+        nl += sse2_sum_bytes(acc);
+    }
+    return nl + count_nl_tail(buf + i, len - i);
+}
+
+static size_t copy_count_nl_sse2(char *dst, const char *src, size_t len)
+{
+    const __m128i nlv = _mm_set1_epi8('\n');
+    size_t nl = 0;
+    size_t i = 0;
+    while (len - i >= 16) {
+        size_t n = MIN((len - i) / 16, 255);
+        __m128i acc = _mm_setzero_si128();
+        for (size_t end = i + (n * 16); i < end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+            _mm_storeu_si128((__m128i*)(dst + i), v);
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, nlv));
+        }
+        nl += sse2_sum_bytes(acc);
+    }
+    return nl + copy_count_nl_tail(dst + i, src + i, len - i);
+}
+#endif
+
+#if HAVE_AVX2_KERNELS
+#define AVX2 __attribute__((__target__("avx2")))
+
+AVX2 static size_t avx2_sum_bytes(__m256i acc)
+{
+    __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    return (size_t)_mm_cvtsi128_si64(s) + (size_t)_mm_extract_epi16(s, 4);
+}
+
+AVX2 static size_t count_nl_avx2(const char *buf, size_t len)
+{
+    const __m256i nlv = _mm256_set1_epi8('\n');
+    size_t nl = 0;
+    size_t i = 0;
+    while (len - i >= 32) {
+        size_t n = MIN((len - i) / 32, 255);
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t end = i + (n * 32); i < end; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(buf + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, nlv));
+        }
+        nl += avx2_sum_bytes(acc);
+    }
+    return nl + count_nl_sse2(buf + i, len - i);
+}
+
+AVX2 static size_t copy_count_nl_avx2(char *dst, const char *src, size_t len)
+{
+    const __m256i nlv = _mm256_set1_epi8('\n');
+    size_t nl = 0;
+    size_t i = 0;
+    while (len - i >= 32) {
+        size_t n = MIN((len - i) / 32, 255);
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t end = i + (n * 32); i < end; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+            _mm256_storeu_si256((__m256i*)(dst + i), v);
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, nlv));
+        }
+        nl += avx2_sum_bytes(acc);
+    }
+    return nl + copy_count_nl_sse2(dst + i, src + i, len - i);
+}
+#endif
+
+typedef struct {
+    const char *name;
+    size_t (*count)(const char *buf, size_t len);
+    size_t (*copy_count)(char *dst, const char *src, size_t len);
+} CountNewlineImpl;
+
+#if HAVE_SSE2_KERNELS
+    static const CountNewlineImpl default_impl = {"sse2", count_nl_sse2, copy_count_nl_sse2};
+#else
+    static const CountNewlineImpl default_impl = {"portable", count_nl_portable, copy_count_nl_portable};
+#endif
+
+static const CountNewlineImpl *impl = &default_impl; // NOLINT(*-avoid-non-const-global-variables)
+
+#if HAVE_AVX2_KERNELS
+static const CountNewlineImpl avx2_impl = {"avx2", count_nl_avx2, copy_count_nl_avx2};
+
+CONSTRUCTOR static void select_impl(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl = &avx2_impl;
+    }
+}
+#endif
+
+size_t count_nl(const char *buf, size_t len)
+{
+    return impl->count(buf, len);
+}
+
+size_t copy_count_nl(char *dst, const char *src, size_t len)
+{
+    return impl->copy_count(dst, src, len);
+}
+
+const char *count_nl_impl_name(void)
+{
+    return impl->name;
+}
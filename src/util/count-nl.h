@@ -0,0 +1,24 @@
+#ifndef UTIL_COUNT_NL_H
+#define UTIL_COUNT_NL_H
+
+#include <stddef.h>
+#include "macros.h"
+
+#define COPY_COUNT_NL_ARGS \
+    NONNULL_ARG_IF_NONZERO_LENGTH(1, 3) \
+    NONNULL_ARG_IF_NONZERO_LENGTH(2, 3)
+
+// Return the number of '\n' bytes in `buf`
+size_t count_nl(const char *buf, size_t len) NONNULL_ARG_IF_NONZERO_LENGTH(1, 2);
+
+// Copy `len` bytes from `src` to (non-overlapping) `dst` and return the
+// number of '\n' bytes copied
+size_t copy_count_nl(char *dst, const char *src, size_t len) COPY_COUNT_NL_ARGS;
+
+// Portable versions of the above, exposed for testing and benchmarking
+size_t count_nl_portable(const char *buf, size_t len) NONNULL_ARG_IF_NONZERO_LENGTH(1, 2);
+size_t copy_count_nl_portable(char *dst, const char *src, size_t len) COPY_COUNT_NL_ARGS;
+
+const char *count_nl_impl_name(void) RETURNS_NONNULL;
+
+#endif
@@ -247,6 +247,13 @@ void hashmap_clear(HashMap *map, FreeFunction free_value)
     memset(map->entries, 0, len * sizeof(*map->entries));
 }
 
+// Return the number of bytes allocated for the table of `map` (but not
+// for the keys or values it points to)
+size_t hashmap_memory_usage(const HashMap *map)
+{
+    return map->entries ? (map->mask + 1) * sizeof(*map->entries) : 0;
+}
+
 void hashmap_free(HashMap *map, FreeFunction free_value)
 {
     hashmap_clear(map, free_value);
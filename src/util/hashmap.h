@@ -72,6 +72,7 @@ void *hashmap_insert_or_replace(HashMap *map, char *key, void *value) NONNULL_AR
 void *hashmap_remove(HashMap *map, const char *key) NONNULL_ARGS WARN_UNUSED_RESULT;
 void hashmap_clear(HashMap *map, FreeFunction free_value) NONNULL_ARG(1);
 void hashmap_free(HashMap *map, FreeFunction free_value) NONNULL_ARG(1);
+size_t hashmap_memory_usage(const HashMap *map) NONNULL_ARGS WARN_UNUSED_RESULT;
 HashMapEntry *hashmap_find(const HashMap *map, const char *key) NONNULL_ARGS WARN_UNUSED_RESULT;
 
 NONNULL_ARGS WARN_UNUSED_RESULT
@@ -42,6 +42,12 @@ void hashset_init(HashSet *set, size_t size, bool icase)
     }
 }
 
+// Return true if `set` was initialized with `icase` set to true
+bool hashset_is_icase(const HashSet *set)
+{
+    return set->equal == mem_equal_icase;
+}
+
 void hashset_free(HashSet *set)
 {
     for (size_t i = 0, n = set->table_size; i < n; i++) {
@@ -55,6 +61,18 @@ void hashset_free(HashSet *set)
     free(set->table);
 }
 
+// Return the number of bytes allocated for the table and entries of `set`
+size_t hashset_memory_usage(const HashSet *set)
+{
+    size_t total = set->table_size * sizeof(set->table[0]);
+    for (size_t i = 0, n = set->table_size; i < n; i++) {
+        for (const HashSetEntry *h = set->table[i]; h; h = h->next) {
+            total += sizeof(*h) + h->str_len + 1;
+        }
+    }
+    return total;
+}
+
 static size_t get_slot(const HashSet *set, const char *str, size_t str_len)
 {
     const size_t hash = set->hash(str, str_len);
@@ -60,6 +60,8 @@ static inline bool hashset_next(HashSetIter *iter)
 
 void hashset_init(HashSet *set, size_t initial_size, bool icase);
 void hashset_free(HashSet *set);
+bool hashset_is_icase(const HashSet *set) NONNULL_ARGS WARN_UNUSED_RESULT;
+size_t hashset_memory_usage(const HashSet *set) NONNULL_ARGS WARN_UNUSED_RESULT;
 HashSetEntry *hashset_get(const HashSet *set, const char *str, size_t str_len);
 HashSetEntry *hashset_insert(HashSet *set, const char *str, size_t str_len);
 
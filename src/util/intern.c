@@ -20,6 +20,14 @@ bool mem_is_intern(const void *data, size_t len)
     return entry && entry->str == data;
 }
 
+// Return the number of bytes used by interned strings and set
+// `*nr_strings` to the number of them
+size_t interned_strings_memory_usage(size_t *nr_strings)
+{
+    *nr_strings = interned_strings.nr_entries;
+    return hashset_memory_usage(&interned_strings);
+}
+
 void free_interned_strings(void)
 {
     hashset_free(&interned_strings);
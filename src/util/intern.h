@@ -10,6 +10,7 @@
 const void *mem_intern(const void *data, size_t len) NONNULL_ARGS_AND_RETURN WARN_UNUSED_RESULT;
 bool mem_is_intern(const void *data, size_t len) WARN_UNUSED_RESULT;
 void free_interned_strings(void);
+size_t interned_strings_memory_usage(size_t *nr_strings) NONNULL_ARGS;
 
 static inline const char *str_intern(const char *str)
 {
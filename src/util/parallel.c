@@ -0,0 +1,175 @@
+#include "buildvar-threads.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "parallel.h"
+#include "arith.h"
+#include "debug.h"
+#include "log.h"
+#include "xmalloc.h"
+
+#if THREADS_DISABLE == 0
+    #include <pthread.h>
+#endif
+
+size_t get_nr_cpus(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (size_t)n : 1;
+#else
+    return 1;
+#endif
+}
+
+static void run_serial(ParallelFunc fn, void *data, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        fn(data, i);
+    }
+}
+
+#if THREADS_DISABLE == 0
+
+struct ThreadGroup {
+    ThreadFunc fn;
+    void *data;
+    size_t nr_threads;
+    pthread_t threads[];
+};
+
+static void *thread_main(void *arg)
+{
+    const ThreadGroup *group = arg;
+    group->fn(group->data);
+    return NULL;
+}
+
+// Start up to `n` threads, which each call fn(data) once, and return a
+// handle for waiting for them to finish (see join_threads()). Returns
+// NULL if no threads could be started, in which case the caller should
+// do the work itself.
+ThreadGroup *start_threads(ThreadFunc fn, void *data, size_t n)
+{
+    if (n == 0) {
+        return NULL;
+    }
+
+    ThreadGroup *group = xmalloc(xadd(sizeof(*group), xmul(n, sizeof(group->threads[0]))));
+    group->fn = fn;
+    group->data = data;
+    group->nr_threads = 0;
+
+    // Block all signals while creating the threads, so that they inherit
+    // a full signal mask and signals continue to be delivered only to the
+    // main thread (see signals.c)
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    for (size_t i = 0; i < n; i++) {
+        int err = pthread_create(&group->threads[i], NULL, thread_main, group);
+        if (unlikely(err)) {
+            // Not fatal, since the remaining work will still be done by
+            // the threads already started (or the calling thread)
+            LOG_ERROR("pthread_create(): %s", strerror(err));
+            break;
+        }
+        group->nr_threads++;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (group->nr_threads == 0) {
+        free(group);
+        return NULL;
+    }
+    return group;
+}
+
+// Wait for all threads started by start_threads() to return
+void join_threads(ThreadGroup *group)
+{
+    if (!group) {
+        return;
+    }
+
+    for (size_t i = 0, n = group->nr_threads; i < n; i++) {
+        int err = pthread_join(group->threads[i], NULL);
+        if (unlikely(err)) {
+            LOG_ERROR("pthread_join(): %s", strerror(err));
+        }
+    }
+
+    free(group);
+}
+
+typedef struct {
+    ParallelFunc fn;
+    void *data;
+    size_t n;
+    size_t next;
+    pthread_mutex_t mutex;
+} ParallelJob;
+
+static void run_job(void *arg)
+{
+    ParallelJob *job = arg;
+    while (1) {
+        pthread_mutex_lock(&job->mutex);
+        size_t idx = job->next;
+        job->next += (idx < job->n);
+        pthread_mutex_unlock(&job->mutex);
+        if (idx >= job->n) {
+            return;
+        }
+        job->fn(job->data, idx);
+    }
+}
+
+void run_in_parallel(ParallelFunc fn, void *data, size_t n, size_t max_threads)
+{
+    size_t nr_workers = MIN(n, max_threads);
+    if (nr_workers <= 1) {
+        run_serial(fn, data, n);
+        return;
+    }
+
+    ParallelJob job = {.fn = fn, .data = data, .n = n};
+    int err = pthread_mutex_init(&job.mutex, NULL);
+    if (unlikely(err)) {
+        LOG_ERROR("pthread_mutex_init(): %s", strerror(err));
+        run_serial(fn, data, n);
+        return;
+    }
+
+    // The calling thread also runs jobs, so one less thread is needed
+    ThreadGroup *threads = start_threads(run_job, &job, nr_workers - 1);
+    run_job(&job);
+    join_threads(threads);
+    pthread_mutex_destroy(&job.mutex);
+}
+
+#else
+
+ThreadGroup *start_threads(ThreadFunc fn, void *data, size_t n)
+{
+    (void)fn;
+    (void)data;
+    (void)n;
+    return NULL;
+}
+
+void join_threads(ThreadGroup *group)
+{
+    BUG_ON(group);
+}
+
+void run_in_parallel(ParallelFunc fn, void *data, size_t n, size_t max_threads)
+{
+    (void)max_threads;
+    run_serial(fn, data, n);
+}
+
+#endif
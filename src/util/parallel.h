@@ -0,0 +1,20 @@
+#ifndef UTIL_PARALLEL_H
+#define UTIL_PARALLEL_H
+
+#include <stddef.h>
+#include "macros.h"
+
+typedef void (*ParallelFunc)(void *data, size_t idx);
+typedef void (*ThreadFunc)(void *data);
+typedef struct ThreadGroup ThreadGroup;
+
+// Call fn(data, i) for every `i` in the range 0..n-1, using up to
+// `max_threads` threads (including the calling thread), and return
+// when all calls have completed. The order of calls is unspecified.
+void run_in_parallel(ParallelFunc fn, void *data, size_t n, size_t max_threads) NONNULL_ARG(1);
+
+ThreadGroup *start_threads(ThreadFunc fn, void *data, size_t n) NONNULL_ARG(1) WARN_UNUSED_RESULT;
+void join_threads(ThreadGroup *group);
+size_t get_nr_cpus(void);
+
+#endif
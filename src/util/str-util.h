@@ -119,20 +119,4 @@ static inline char *buf_next_line(char *buf, size_t *posp, size_t size)
     return get_delim_str(buf, posp, size, '\n');
 }
 
-NONNULL_ARGS
-static inline size_t count_nl(const char *buf, size_t size)
-{
-    const char *end = buf + size;
-    size_t nl = 0;
-    while (buf < end) {
-        buf = memchr(buf, '\n', end - buf);
-        if (!buf) {
-            break;
-        }
-        buf++;
-        nl++;
-    }
-    return nl;
-}
-
 #endif
@@ -6,6 +6,7 @@
 #include <sys/types.h>
 #include "macros.h"
 #include "maybebool.h"
+#include "string-view.h"
 
 NONNULL_ARGS WARN_UNUSED_RESULT
 static inline DIR *xopendir(const char *path)
@@ -36,6 +37,15 @@ static inline int xclosedir(DIR *dir)
     return closedir(dir); // NOLINT(*-unsafe-functions)
 }
 
+// Entries that are never relevant to anything that lists directories
+// (e.g. filename completion)
+static inline bool is_ignored_dir_entry(StringView name)
+{
+    return unlikely(name.length == 0)
+        || strview_equal_cstring(name, ".")
+        || strview_equal_cstring(name, "..");
+}
+
 MaybeBool is_dir_or_symlink_to_dir(const struct dirent *ent, int dir_fd) NONNULL_ARGS WARN_UNUSED_RESULT;
 
 #endif
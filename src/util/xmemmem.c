@@ -1,7 +1,19 @@
 #include "build-defs.h"
+#include <stdint.h>
 #include <string.h>
 #include "xmemmem.h"
+#include "ascii.h"
+#include "bit.h"
 #include "debug.h"
+#include "xmemrchr.h"
+#include "xstring.h"
+
+#if defined(__x86_64__) && defined(__SSE2__) && !defined(__TINYC__)
+    #include <immintrin.h>
+    #define HAVE_SSE2_KERNEL 1
+#else
+    #define HAVE_SSE2_KERNEL 0
+#endif
 
 void *xmemmem(const void *haystack, size_t hlen, const void *needle, size_t nlen)
 {
@@ -46,3 +58,168 @@ void *xmemmem(const void *haystack, size_t hlen, const void *needle, size_t nlen
     BUG("unexpected loop break");
     return NULL;
 }
+
+/*
+ * The case-insensitive (ASCII only) search below compares the first and
+ * last bytes of the needle against every candidate position and only
+ * compares the bytes in between when both of those match. Case folding
+ * of the 2 "anchor" bytes is done by OR-ing the haystack with 0x20, but
+ * only when the anchor is a letter; for any letter `c`, (x | 0x20) is
+ * equal to ascii_tolower(c) if and only if x is c in either case.
+ */
+
+typedef struct {
+    unsigned char first;
+    unsigned char first_mask;
+    unsigned char last;
+    unsigned char last_mask;
+} Anchors;
+
+static Anchors get_anchors(const unsigned char *needle, size_t nlen)
+{
+    unsigned char first = needle[0];
+    unsigned char last = needle[nlen - 1];
+    return (Anchors) {
+        .first = ascii_tolower(first),
+        .first_mask = ascii_isalpha(first) ? 0x20 : 0,
+        .last = ascii_tolower(last),
+        .last_mask = ascii_isalpha(last) ? 0x20 : 0,
+    };
+}
+
+static bool is_match_icase(const unsigned char *h, const unsigned char *needle, size_t nlen)
+{
+    // The first and last bytes have already been compared
+    return nlen <= 2 || mem_equal_icase(h + 1, needle + 1, nlen - 2);
+}
+
+// Search candidate positions [i, end) without SIMD
+static void *search_icase_tail (
+    const unsigned char *h,
+    size_t i,
+    size_t end,
+    const unsigned char *needle,
+    size_t nlen,
+    Anchors a
+) {
+    const size_t last = nlen - 1;
+    for (; i < end; i++) {
+        if (
+            (h[i] | a.first_mask) == a.first
+            && (h[i + last] | a.last_mask) == a.last
+            && is_match_icase(h + i, needle, nlen)
+        ) {
+            return (void*)(h + i);
+        }
+    }
+    return NULL;
+}
+
+void *xmemmem_icase_portable(const void *haystack, size_t hlen, const void *needle, size_t nlen)
+{
+    BUG_ON(nlen == 0);
+    if (nlen > hlen) {
+        return NULL;
+    }
+    const unsigned char *n = needle;
+    return search_icase_tail(haystack, 0, hlen - nlen + 1, n, nlen, get_anchors(n, nlen));
+}
+
+#if HAVE_SSE2_KERNEL
+static void *xmemmem_icase_sse2(const void *haystack, size_t hlen, const void *needle, size_t nlen)
+{
+    BUG_ON(nlen == 0);
+    if (nlen > hlen) {
+        return NULL;
+    }
+
+    const unsigned char *h = haystack;
+    const unsigned char *n = needle;
+    const Anchors a = get_anchors(n, nlen);
+    const __m128i first = _mm_set1_epi8((char)a.first);
+    const __m128i first_mask = _mm_set1_epi8((char)a.first_mask);
+    const __m128i last = _mm_set1_epi8((char)a.last);
+    const __m128i last_mask = _mm_set1_epi8((char)a.last_mask);
+    const size_t end = hlen - nlen + 1; // Number of candidate positions
+    size_t i = 0;
+
+    for (; end - i >= 16; i += 16) {
+        __m128i f = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i l = _mm_loadu_si128((const __m128i*)(h + i + nlen - 1));
+        __m128i feq = _mm_cmpeq_epi8(_mm_or_si128(f, first_mask), first);
+        __m128i leq = _mm_cmpeq_epi8(_mm_or_si128(l, last_mask), last);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(feq, leq));
+        while (mask) {
+            size_t pos = i + u32_ctz(mask);
+            if (is_match_icase(h + pos, n, nlen)) {
+                return (void*)(h + pos);
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return search_icase_tail(h, i, end, n, nlen, a);
+}
+#endif
+
+// Like xmemmem(), but ignoring the case of ASCII letters
+void *xmemmem_icase(const void *haystack, size_t hlen, const void *needle, size_t nlen)
+{
+#if HAVE_SSE2_KERNEL
+    return xmemmem_icase_sse2(haystack, hlen, needle, nlen);
+#else
+    return xmemmem_icase_portable(haystack, hlen, needle, nlen);
+#endif
+}
+
+// Like xmemmem(), but finding the last occurrence of `needle`
+void *xmemrmem(const void *haystack, size_t hlen, const void *needle, size_t nlen)
+{
+    BUG_ON(nlen == 0);
+    if (nlen > hlen) {
+        return NULL;
+    }
+
+    const char *h = haystack;
+    int first_char = ((const unsigned char*)needle)[0];
+    size_t end = hlen - nlen + 1; // Number of candidate positions
+
+    while (end) {
+        // NOLINTNEXTLINE(readability-redundant-casting)
+        char *ptr = (void*)xmemrchr(h, first_char, end);
+        if (!ptr) {
+            return NULL;
+        }
+        if (memcmp(ptr, needle, nlen) == 0) {
+            return ptr;
+        }
+        end = (size_t)(ptr - h);
+    }
+
+    return NULL;
+}
+
+// Like xmemrmem(), but ignoring the case of ASCII letters
+void *xmemrmem_icase(const void *haystack, size_t hlen, const void *needle, size_t nlen)
+{
+    BUG_ON(nlen == 0);
+    if (nlen > hlen) {
+        return NULL;
+    }
+
+    const unsigned char *h = haystack;
+    const unsigned char *n = needle;
+    const Anchors a = get_anchors(n, nlen);
+    const size_t last = nlen - 1;
+    for (size_t i = hlen - nlen + 1; i-- > 0; ) {
+        if (
+            (h[i] | a.first_mask) == a.first
+            && (h[i + last] | a.last_mask) == a.last
+            && is_match_icase(h + i, n, nlen)
+        ) {
+            return (void*)(h + i);
+        }
+    }
+
+    return NULL;
+}
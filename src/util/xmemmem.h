@@ -5,5 +5,11 @@
 #include "macros.h"
 
 void *xmemmem(const void *haystack, size_t hlen, const void *needle, size_t nlen) PURE NONNULL_ARGS;
+void *xmemmem_icase(const void *haystack, size_t hlen, const void *needle, size_t nlen) PURE NONNULL_ARGS;
+void *xmemrmem(const void *haystack, size_t hlen, const void *needle, size_t nlen) PURE NONNULL_ARGS;
+void *xmemrmem_icase(const void *haystack, size_t hlen, const void *needle, size_t nlen) PURE NONNULL_ARGS;
+
+// Portable version of the above, exposed for testing and benchmarking
+void *xmemmem_icase_portable(const void *haystack, size_t hlen, const void *needle, size_t nlen) PURE NONNULL_ARGS;
 
 #endif
@@ -3,6 +3,7 @@
 #include "buffer.h"
 #include "indent.h"
 #include "util/ascii.h"
+#include "util/count-nl.h"
 #include "util/debug.h"
 #include "util/numtostr.h"
 #include "util/str-util.h"
@@ -12,18 +13,8 @@
 
 void view_update_cursor_y(View *view)
 {
-    const Buffer *buffer = view->buffer;
-    const Block *blk;
-    size_t nl = 0;
-    block_for_each(blk, &buffer->blocks) {
-        if (blk == view->cursor.blk) {
-            nl += count_nl(blk->data, view->cursor.offset);
-            view->cy = nl;
-            return;
-        }
-        nl += blk->nl;
-    }
-    BUG("unreachable");
+    const Block *blk = view->cursor.blk;
+    view->cy = block_get_line(blk) + count_nl(blk->data, view->cursor.offset);
 }
 
 void view_update_cursor_x(View *view)
@@ -206,7 +197,7 @@ StringView view_get_word_under_cursor(const View *view)
 String dump_buffer(const View *view)
 {
     const Buffer *buffer = view->buffer;
-    uintmax_t counts[2];
+    uintmax_t counts[4];
     char sizestr[FILESIZE_STR_MAX];
     buffer_count_blocks_and_bytes(buffer, counts);
     BUG_ON(counts[0] < 1);
@@ -245,6 +236,15 @@ String dump_buffer(const View *view)
         string_sprintf(&buf, "    Views: %zu\n", buffer->views.count);
     }
 
+    if (counts[2] || counts[3]) {
+        string_sprintf (
+            &buf,
+            "Compacted: %ju blocks, %s\n",
+            counts[2],
+            filesize_to_str(counts[3], sizestr)
+        );
+    }
+
     if (buffer->abs_filename) {
         const FileInfo *file = &buffer->file;
         unsigned int perms = file->mode & 07777;
@@ -8,6 +8,7 @@
 #include "load-save.h"
 #include "lock.h"
 #include "move.h"
+#include "undo-file.h"
 #include "util/path.h"
 #include "util/strtonum.h"
 #include "util/xmalloc.h"
@@ -91,6 +92,10 @@ View *window_open_buffer (
     buffer->abs_filename = absolute;
     buffer_update_short_filename(buffer, e->home_dir);
 
+    if (e->options.persistent_undo) {
+        undo_file_open(buffer, e->user_config_dir);
+    }
+
     if (e->options.lock_files) {
         if (!lock_file(&e->locks_ctx, ebuf, buffer->abs_filename)) {
             buffer->readonly = true;
@@ -177,6 +182,9 @@ void window_remove_view_at_index(Window *window, size_t view_idx)
             FileHistory *hist = &e->file_history;
             file_history_append(hist, view->cy + 1, view->cx_char + 1, path);
         }
+        if (e->options.persistent_undo) {
+            undo_file_save(buffer, e->user_config_dir, &e->err);
+        }
         buffer_remove_unlock_and_free(&e->buffers, buffer, &e->err, &e->locks_ctx);
     }
 
@@ -197,6 +205,7 @@ void window_free(Window *window)
 {
     window_remove_views(window);
     ptr_array_free_array(&window->views);
+    ptr_array_free_array(&window->drawn_states);
     window->frame = NULL;
     free(window);
 }
@@ -35,6 +35,9 @@ typedef struct Window {
     unsigned int lineno_width; // Width of line numbers bar (including padding)
     long lineno_first; // First visible line number, in previous screen update
     long lineno_last; // Last visible line number, in previous screen update
+    PointerArray drawn_states; // Syntax State at the start of each line, as last drawn (see update_range())
+    const View *drawn_view; // View that `drawn_states` were drawn for
+    long drawn_vy; // View::vy when `drawn_states` were drawn
 } Window;
 
 static inline View *window_get_first_view(const Window *window)
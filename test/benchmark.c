@@ -10,13 +10,18 @@
 #include "filetype.h"
 #include "indent.h"
 #include "options.h"
+#include "regexp.h"
 #include "terminal/color.h"
 #include "util/arith.h"
+#include "util/byte-class.h"
+#include "util/count-nl.h"
 #include "util/macros.h"
 #include "util/numtostr.h"
 #include "util/string-view.h"
 #include "util/time-util.h"
 #include "util/utf8.h"
+#include "util/xmalloc.h"
+#include "util/xmemmem.h"
 #include "util/xsnprintf.h"
 
 COLD PRINTF(1)
@@ -73,12 +78,17 @@ static uintmax_t timespec_to_ns(const struct timespec *ts)
     return ns;
 }
 
-PRINTF(3)
-static void report(const struct timespec *start, unsigned int iters, const char *fmt, ...)
+static uintmax_t elapsed_ns(const struct timespec *start)
 {
     struct timespec end = get_time();
     struct timespec duration = timespec_subtract(&end, start);
-    uintmax_t ns = timespec_to_ns(&duration);
+    return timespec_to_ns(&duration);
+}
+
+PRINTF(3)
+static void report(const struct timespec *start, unsigned int iters, const char *fmt, ...)
+{
+    uintmax_t ns = elapsed_ns(start);
     char name[64];
     va_list ap;
     va_start(ap, fmt);
@@ -87,6 +97,21 @@ static void report(const struct timespec *start, unsigned int iters, const char
     fprintf(stderr, "   BENCH  %-29s  %9ju ns/iter\n", name, ns / iters);
 }
 
+// Like report(), but for benchmarks where throughput is more meaningful
+// than latency (`nbytes` is the number of bytes processed in total)
+PRINTF(3)
+static void report_throughput(const struct timespec *start, uintmax_t nbytes, const char *fmt, ...)
+{
+    uintmax_t ns = elapsed_ns(start);
+    char name[64];
+    va_list ap;
+    va_start(ap, fmt);
+    xvsnprintf(name, sizeof name, fmt, ap);
+    va_end(ap);
+    double gbps = (double)nbytes / (double)MAX(ns, 1); // Bytes per ns == GB/s
+    fprintf(stderr, "   BENCH  %-29s  %9.2f GB/s\n", name, gbps);
+}
+
 static void do_bench_find_ft(const char *expected_ft, const char *filename)
 {
     BUG_ON(expected_ft[0] == '/');
@@ -285,6 +310,192 @@ static void bench_human_readable_size(void)
     report(&start, iterations, "human_readable_size()");
 }
 
+static void bench_count_nl(void)
+{
+    // 1MiB of text with line lengths varying between 0 and 119 bytes
+    const size_t len = 1 << 20;
+    char *src = xmalloc(len);
+    char *dst = xmalloc(len);
+    size_t nr_lines = 0;
+    for (size_t i = 0, linelen = 0; i < len; i++) {
+        bool eol = (linelen++ >= (nr_lines * 37) % 120);
+        src[i] = eol ? '\n' : 'a' + (i % 26);
+        nr_lines += eol;
+        linelen = eol ? 0 : linelen;
+    }
+
+    const char *impl = count_nl_impl_name();
+    unsigned int iterations = 300;
+    size_t accum = 0;
+    struct timespec start = get_time();
+    for (unsigned int i = 0; i < iterations; i++) {
+        accum += count_nl(src, len);
+    }
+    CHECK_RESULT(accum, iterations * nr_lines);
+    report_throughput(&start, (uintmax_t)len * iterations, "count_nl() [%s]", impl);
+
+    accum = 0;
+    start = get_time();
+    for (unsigned int i = 0; i < iterations; i++) {
+        accum += count_nl_portable(src, len);
+    }
+    CHECK_RESULT(accum, iterations * nr_lines);
+    report_throughput(&start, (uintmax_t)len * iterations, "count_nl() [portable]");
+
+    accum = 0;
+    start = get_time();
+    for (unsigned int i = 0; i < iterations; i++) {
+        accum += copy_count_nl(dst, src, len);
+    }
+    CHECK_RESULT(accum, iterations * nr_lines);
+    report_throughput(&start, (uintmax_t)len * iterations, "copy_count_nl() [%s]", impl);
+
+    accum = 0;
+    start = get_time();
+    for (unsigned int i = 0; i < iterations; i++) {
+        accum += copy_count_nl_portable(dst, src, len);
+    }
+    CHECK_RESULT(accum, iterations * nr_lines);
+    report_throughput(&start, (uintmax_t)len * iterations, "copy_count_nl() [portable]");
+
+    free(dst);
+    free(src);
+}
+
+static void bench_byte_class_span(void)
+{
+    // 1MiB of text with runs of letters varying between 0 and 119 bytes,
+    // each followed by a space
+    const size_t len = 1 << 20;
+    char *src = xmalloc(len);
+    size_t nr_runs = 0;
+    for (size_t i = 0, runlen = 0; i < len; i++) {
+        bool space = (runlen++ >= (nr_runs * 37) % 120);
+        src[i] = space ? ' ' : 'a' + (i % 26);
+        nr_runs += space;
+        runlen = space ? 0 : runlen;
+    }
+
+    ByteClass letters = {.rows = {{0}}};
+    for (unsigned char ch = 'a'; ch <= 'z'; ch++) {
+        byte_class_add(&letters, ch);
+    }
+
+    const char *impl = byte_class_span_impl_name();
+    unsigned int iterations = 300;
+    size_t accum = 0;
+    struct timespec start = get_time();
+    for (unsigned int i = 0; i < iterations; i++) {
+        for (size_t pos = 0; pos < len; pos++) {
+            size_t n = byte_class_span(&letters, src + pos, len - pos);
+            accum += n;
+            pos += n;
+        }
+    }
+    CHECK_RESULT(accum, iterations * (len - nr_runs));
+    report_throughput(&start, (uintmax_t)len * iterations, "byte_class_span() [%s]", impl);
+
+    accum = 0;
+    start = get_time();
+    for (unsigned int i = 0; i < iterations; i++) {
+        for (size_t pos = 0; pos < len; pos++) {
+            size_t n = byte_class_span_portable(&letters, src + pos, len - pos);
+            accum += n;
+            pos += n;
+        }
+    }
+    CHECK_RESULT(accum, iterations * (len - nr_runs));
+    report_throughput(&start, (uintmax_t)len * iterations, "byte_class_span() [portable]");
+
+    free(src);
+}
+
+static size_t count_regex_matches(const regex_t *re, const char *buf, size_t len)
+{
+    size_t count = 0;
+    for (size_t pos = 0; pos < len; ) {
+        const char *nl = memchr(buf + pos, '\n', len - pos);
+        size_t line_len = nl ? (size_t)(nl - buf) - pos : len - pos;
+        size_t start = 0;
+        regmatch_t m;
+        int flags = 0;
+        while (regexp_exec(re, buf + pos + start, line_len - start, 1, &m, flags)) {
+            count++;
+            start += m.rm_eo;
+            flags = REG_NOTBOL;
+        }
+        pos += line_len + 1;
+    }
+    return count;
+}
+
+static size_t count_literal_matches(const char *buf, size_t len, StringView lit, bool icase)
+{
+    size_t count = 0;
+    for (size_t pos = 0; pos + lit.length <= len; ) {
+        const char *h = buf + pos;
+        size_t hlen = len - pos;
+        const char *m = icase
+            ? xmemmem_icase(h, hlen, lit.data, lit.length)
+            : xmemmem(h, hlen, lit.data, lit.length)
+        ;
+        if (!m) {
+            break;
+        }
+        count++;
+        pos = (size_t)(m - buf) + lit.length;
+    }
+    return count;
+}
+
+// Compare the regex and literal code paths used by `search`, by counting
+// the matches of a rare string in 8MiB of text
+static void bench_search(void)
+{
+    const size_t len = 8 << 20;
+    char *text = xmalloc(len);
+    for (size_t i = 0; i < len; i++) {
+        text[i] = (i % 80 == 79) ? '\n' : "abcdefghijklmnop qrstuvwxyz"[(i * 7) % 27];
+    }
+
+    // Insert a (mixed case) match into every 1000th line
+    size_t nr_matches = 0;
+    for (size_t offset = 40; offset + 6 < len; offset += 1000 * 80) {
+        memcpy(text + offset, "NeeDLE", 6);
+        nr_matches++;
+    }
+
+    const StringView lit = strview("needle");
+    const unsigned int iterations = 10;
+    for (unsigned int icase = 0; icase <= 1; icase++) {
+        const char *suffix = icase ? ", icase" : "";
+        regex_t re;
+        int flags = DEFAULT_REGEX_FLAGS | REG_NEWLINE | (icase ? REG_ICASE : 0);
+        if (regcomp(&re, "needle", flags) != 0) {
+            error_exit("%s(): regcomp() failed", __func__);
+        }
+
+        size_t accum = 0;
+        struct timespec start = get_time();
+        for (unsigned int i = 0; i < iterations; i++) {
+            accum += count_regex_matches(&re, text, len);
+        }
+        CHECK_RESULT(accum, icase ? iterations * nr_matches : 0);
+        report_throughput(&start, (uintmax_t)len * iterations, "search [regex%s]", suffix);
+        regfree(&re);
+
+        accum = 0;
+        start = get_time();
+        for (unsigned int i = 0; i < iterations; i++) {
+            accum += count_literal_matches(text, len, lit, icase);
+        }
+        CHECK_RESULT(accum, icase ? iterations * nr_matches : 0);
+        report_throughput(&start, (uintmax_t)len * iterations, "search [literal%s]", suffix);
+    }
+
+    free(text);
+}
+
 int main(void)
 {
     struct timespec res;
@@ -307,5 +518,8 @@ int main(void)
     bench_u_set_char();
     bench_u_set_char_raw();
     bench_human_readable_size();
+    bench_count_nl();
+    bench_byte_class_span();
+    bench_search();
     return 0;
 }
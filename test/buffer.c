@@ -1,9 +1,26 @@
+#include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "test.h"
 #include "buffer.h"
+#include "commands.h"
+#include "edit.h"
 #include "editor.h"
 #include "indent.h"
+#include "load-save.h"
 #include "regexp.h"
+#include "replace.h"
+#include "search.h"
+#include "util/fd.h"
+#include "util/hash.h"
+#include "util/log.h"
+#include "util/readfile.h"
+#include "util/xmalloc.h"
+#include "util/xmemmem.h"
+#include "util/xreadwrite.h"
+#include "util/xsnprintf.h"
 
 static void test_find_buffer_by_id(TestContext *ctx)
 {
@@ -139,7 +156,7 @@ static void test_buffer_insert_bytes(TestContext *ctx)
     EditorState *e = ctx->userdata;
     View *view = window_open_empty_buffer(e->window);
     const Buffer *buffer = view->buffer;
-    uintmax_t counts[2];
+    uintmax_t counts[4];
     buffer_count_blocks_and_bytes(buffer, counts);
     EXPECT_EQ(counts[0], 1);
     EXPECT_EQ(counts[1], 0);
@@ -164,12 +181,1170 @@ static void test_buffer_insert_bytes(TestContext *ctx)
     window_close_current_view(e->window);
 }
 
+static void test_block_index(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    const Buffer *buffer = view->buffer;
+
+    // 200 lines of 100 bytes each, spread across many Blocks
+    char line[100];
+    memset(line, 'x', sizeof(line));
+    line[sizeof(line) - 1] = '\n';
+    for (size_t i = 0; i < 200; i++) {
+        block_iter_eof(&view->cursor);
+        buffer_insert_bytes(view, line, sizeof(line));
+    }
+
+    uintmax_t counts[4];
+    buffer_count_blocks_and_bytes(buffer, counts);
+    ASSERT_TRUE(counts[0] > 20);
+    EXPECT_EQ(counts[1], 200 * sizeof(line));
+    EXPECT_EQ(buffer->nl, 200);
+    EXPECT_EQ(block_total_size(view->cursor.blk), counts[1]);
+    EXPECT_EQ(block_total_nl(view->cursor.blk), 200);
+
+    size_t offset = 0;
+    size_t nl = 0;
+    const Block *blk;
+    block_for_each(blk, &buffer->blocks) {
+        EXPECT_EQ(block_get_offset(blk), offset);
+        EXPECT_EQ(block_get_line(blk), nl);
+        offset += blk->size;
+        nl += blk->nl;
+    }
+
+    for (size_t i = 0; i < 200; i += 7) {
+        block_iter_goto_line(&view->cursor, i);
+        EXPECT_EQ(block_iter_get_offset(&view->cursor), i * sizeof(line));
+        view_update_cursor_y(view);
+        EXPECT_EQ(view->cy, i);
+        block_iter_goto_offset(&view->cursor, i * sizeof(line) + 5);
+        EXPECT_EQ(block_iter_get_offset(&view->cursor), i * sizeof(line) + 5);
+    }
+
+    // Lines past EOF clamp to the last line
+    block_iter_goto_line(&view->cursor, 500);
+    EXPECT_TRUE(block_iter_is_eof(&view->cursor));
+
+    // Delete half of the text and check the index is still coherent
+    block_iter_goto_line(&view->cursor, 50);
+    buffer_delete_bytes(view, 100 * sizeof(line));
+    EXPECT_EQ(buffer->nl, 100);
+    EXPECT_EQ(block_total_nl(view->cursor.blk), 100);
+    EXPECT_EQ(block_total_size(view->cursor.blk), 100 * sizeof(line));
+    view_update_cursor_y(view);
+    EXPECT_EQ(view->cy, 50);
+    block_iter_goto_line(&view->cursor, 99);
+    EXPECT_EQ(block_iter_get_offset(&view->cursor), 99 * sizeof(line));
+
+    window_close_current_view(e->window);
+}
+
+static void test_compact_blocks(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+    EXPECT_EQ(buffer->compact_offset, SIZE_MAX);
+    EXPECT_FALSE(compact_blocks(view, SIZE_MAX));
+
+    char line[100];
+    memset(line, 'x', sizeof(line));
+    line[sizeof(line) - 1] = '\n';
+    for (size_t i = 0; i < 200; i++) {
+        block_iter_eof(&view->cursor);
+        buffer_insert_bytes(view, line, sizeof(line));
+    }
+
+    // Shorten every line to 10 bytes, leaving many undersized Blocks
+    for (size_t i = 0; i < 200; i++) {
+        block_iter_goto_offset(&view->cursor, i * 10);
+        buffer_delete_bytes(view, 90);
+    }
+
+    uintmax_t counts[4];
+    buffer_count_blocks_and_bytes(buffer, counts);
+    const uintmax_t nblocks = counts[0];
+    ASSERT_TRUE(nblocks > 20);
+    EXPECT_EQ(counts[1], 2000);
+    EXPECT_EQ(counts[2], 0);
+    EXPECT_EQ(counts[3], 0);
+    EXPECT_TRUE(buffer->compact_offset < 2000);
+
+    block_iter_goto_offset(&view->cursor, 1234);
+    EXPECT_TRUE(compact_blocks(view, 1));
+    EXPECT_FALSE(compact_blocks(view, SIZE_MAX));
+    EXPECT_EQ(buffer->compact_offset, SIZE_MAX);
+    EXPECT_EQ(block_iter_get_offset(&view->cursor), 1234);
+
+    buffer_count_blocks_and_bytes(buffer, counts);
+    EXPECT_TRUE(counts[0] <= 5);
+    EXPECT_EQ(counts[1], 2000);
+    EXPECT_EQ(counts[2], nblocks - counts[0]);
+    EXPECT_TRUE(counts[3] > 0);
+    EXPECT_EQ(buffer->nl, 200);
+    EXPECT_EQ(block_total_size(view->cursor.blk), 2000);
+
+    size_t offset = 0;
+    const Block *blk;
+    block_for_each(blk, &buffer->blocks) {
+        EXPECT_EQ(block_get_offset(blk), offset);
+        EXPECT_TRUE(blk->size <= 512);
+        EXPECT_TRUE(blk->alloc - blk->size < BLOCK_ALLOC_MULTIPLE);
+        offset += blk->size;
+    }
+
+    block_iter_bof(&view->cursor);
+    for (size_t i = 0; i < 200; i++) {
+        StringView l = get_current_line(view->cursor);
+        EXPECT_MEMEQ(l.data, l.length, "xxxxxxxxx", 9);
+        block_iter_next_line(&view->cursor);
+    }
+
+    window_close_current_view(e->window);
+}
+
+static void test_block_arena(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    const Buffer *buffer = view->buffer;
+    const BlockArena *arena = &buffer->arena;
+    EXPECT_EQ(arena->nr_slabs, 1);
+    EXPECT_EQ(arena->nr_foreign, 0);
+
+    char line[100];
+    memset(line, 'x', sizeof(line));
+    line[sizeof(line) - 1] = '\n';
+    for (size_t i = 0; i < 1000; i++) {
+        block_iter_eof(&view->cursor);
+        buffer_insert_bytes(view, line, sizeof(line));
+    }
+
+    // Every Block created by editing should be entirely within the arena
+    size_t nblocks = 0;
+    const Block *blk;
+    block_for_each(blk, &buffer->blocks) {
+        EXPECT_PTREQ(blk->arena, arena);
+        EXPECT_TRUE(blk->arena_header);
+        EXPECT_TRUE(blk->arena_data);
+        nblocks++;
+    }
+    EXPECT_TRUE(nblocks > 100);
+    EXPECT_TRUE(arena->nr_slabs > 1);
+    EXPECT_EQ(arena->nr_foreign, 0);
+
+    // A single line longer than BLOCK_ARENA_DATA_MAX can't be split and
+    // thus needs a Block with data allocated outside of the arena
+    char long_line[BLOCK_ARENA_DATA_MAX * 2];
+    memset(long_line, 'y', sizeof(long_line));
+    block_iter_bof(&view->cursor);
+    buffer_insert_bytes(view, long_line, sizeof(long_line));
+    EXPECT_EQ(arena->nr_foreign, 1);
+    EXPECT_FALSE(view->cursor.blk->arena_data);
+
+    // The over-sized allocation remains after deleting the line, until
+    // compact_blocks() moves it back into the arena
+    block_iter_bof(&view->cursor);
+    buffer_delete_bytes(view, sizeof(long_line));
+    EXPECT_EQ(arena->nr_foreign, 1);
+    EXPECT_FALSE(compact_blocks(view, SIZE_MAX));
+    EXPECT_EQ(arena->nr_foreign, 0);
+    EXPECT_TRUE(view->cursor.blk->arena_data);
+
+    size_t nl = 0;
+    block_for_each(blk, &buffer->blocks) {
+        nl += blk->nl;
+    }
+    EXPECT_EQ(nl, 1000);
+    EXPECT_EQ(block_total_size(view->cursor.blk), 1000 * sizeof(line));
+
+    // Freeing the Buffer releases all of the slabs at once
+    window_close_current_view(e->window);
+}
+
+static void test_buffer_get_memory_usage(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    const Buffer *buffer = view->buffer;
+    BufferMemoryUsage u;
+    buffer_get_memory_usage(buffer, &u);
+    EXPECT_EQ(u.blocks, 1);
+    EXPECT_EQ(u.block_payload, 0);
+    EXPECT_EQ(u.block_slack, BLOCK_ALLOC_MULTIPLE);
+    EXPECT_EQ(u.block_mapped, 0);
+    EXPECT_EQ(u.arena_slabs, BLOCK_SLAB_SIZE);
+    EXPECT_EQ(u.changes, 0);
+    EXPECT_EQ(u.undo_text, 0);
+    EXPECT_EQ(u.heredoc_states, 0);
+
+    static const char text[] = "line 1\nline 2\nline 3\n";
+    const size_t len = sizeof(text) - 1;
+    buffer_insert_bytes(view, text, len);
+    block_iter_bof(&view->cursor);
+    buffer_delete_bytes(view, 7);
+
+    buffer_get_memory_usage(buffer, &u);
+    EXPECT_EQ(u.blocks, 1);
+    EXPECT_EQ(u.block_headers, sizeof(Block));
+    EXPECT_EQ(u.block_payload, len - 7);
+    EXPECT_EQ(u.changes, 2);
+    EXPECT_EQ(u.undo_text, 7);
+    EXPECT_EQ(u.undo_other, 2 * sizeof(Change));
+    EXPECT_EQ(u.undo_text + u.undo_other, buffer->change_arena.memory_usage);
+    EXPECT_EQ(buffer_memory_total(&u), u.block_headers + u.block_payload + u.block_slack + u.undo_text + u.undo_other + u.line_states_bytes);
+
+    // Undo the deletion and then make a different change, so that the
+    // undo tree has a branch
+    EXPECT_TRUE(undo(view, &e->err));
+    block_iter_eof(&view->cursor);
+    buffer_insert_bytes(view, "x\n", 2);
+    buffer_get_memory_usage(buffer, &u);
+    EXPECT_EQ(u.changes, 3);
+    EXPECT_EQ(u.undo_text, 0); // Deleted text is only stored until it's undone
+    EXPECT_EQ(u.block_payload, len + 2);
+    EXPECT_EQ(u.undo_other, 3 * sizeof(Change) + 2 * sizeof(Change*));
+    EXPECT_EQ(u.undo_text + u.undo_other, buffer->change_arena.memory_usage);
+
+    window_close_current_view(e->window);
+}
+
+static void insert_unmerged(View *view, const char *text)
+{
+    begin_change(CHANGE_MERGE_NONE);
+    buffer_insert_bytes(view, text, strlen(text));
+    end_change();
+}
+
+static void test_undo_memory_limit(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    const uint_least64_t saved_limit = e->options.undo_memory_limit;
+    const size_t limit = 20 * sizeof(Change);
+    e->options.undo_memory_limit = limit;
+
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+    buffer->saved_change = buffer->cur_change;
+
+    // Record 100 single Changes, creating a dead redo branch halfway
+    for (size_t i = 0; i < 100; i++) {
+        insert_unmerged(view, "x\n");
+        if (i == 50) {
+            EXPECT_TRUE(undo(view, &e->err));
+        }
+    }
+
+    ASSERT_EQ(buffer->nl, 99);
+    EXPECT_TRUE(buffer->change_arena.memory_usage <= limit);
+    EXPECT_NULL(buffer->saved_change);
+    EXPECT_TRUE(buffer_modified(buffer));
+
+    uintmax_t counts[3];
+    count_changes(&buffer->change_head, counts);
+    EXPECT_EQ(counts[1] + counts[2], buffer->change_arena.memory_usage);
+    EXPECT_TRUE(counts[0] >= 15);
+    EXPECT_TRUE(counts[0] <= 20);
+
+    // The remaining history can still be undone (and redone)
+    size_t nr_undone = 0;
+    while (undo(view, &e->err)) {
+        nr_undone++;
+    }
+    EXPECT_EQ(nr_undone, counts[0]);
+    EXPECT_EQ(buffer->nl, 99 - nr_undone);
+    EXPECT_PTREQ(buffer->cur_change, &buffer->change_head);
+    EXPECT_TRUE(redo(view, &e->err, 0));
+    EXPECT_EQ(buffer->nl, 100 - nr_undone);
+
+    // Change chains are only ever evicted as a whole
+    for (size_t i = 0; i < 30; i++) {
+        begin_change_chain();
+        insert_unmerged(view, "a\n");
+        insert_unmerged(view, "b\n");
+        insert_unmerged(view, "c\n");
+        end_change_chain(view);
+    }
+
+    EXPECT_TRUE(buffer->change_arena.memory_usage <= limit);
+    count_changes(&buffer->change_head, counts);
+    EXPECT_EQ(counts[1] + counts[2], buffer->change_arena.memory_usage);
+    const size_t nl = buffer->nl;
+    while (undo(view, &e->err)) {
+        ;
+    }
+    EXPECT_EQ((nl - buffer->nl) % 3, 0);
+    EXPECT_TRUE(buffer->nl < nl);
+
+    window_close_current_view(e->window);
+    e->options.undo_memory_limit = saved_limit;
+}
+
+static char *get_buffer_text(View *view, size_t *len)
+{
+    BlockIter bi = block_iter(view->buffer);
+    block_iter_eof(&bi);
+    *len = block_iter_get_offset(&bi);
+    block_iter_bof(&bi);
+    return block_iter_get_bytes(&bi, *len);
+}
+
+static void edit_at(View *view, size_t offset, size_t del, const char *ins)
+{
+    block_iter_goto_offset(&view->cursor, offset);
+    begin_change(CHANGE_MERGE_NONE);
+    buffer_replace_bytes(view, del, ins, strlen(ins));
+    end_change();
+}
+
+static void test_undo_change_chain(TestContext *ctx)
+{
+    static const char base[] = "0123456789\nabcdefghij\n";
+    static const struct {
+        struct {
+            size_t offset;
+            size_t del;
+            const char *ins;
+        } edits[3];
+        const char *result;
+        size_t cursor_after_undo;
+    } tests[] = {
+        // In forward order (as done by e.g. `replace -c`); reversed as one batch
+        {{{1, 2, "XYZ"}, {8, 3, ""}, {12, 0, "++\n"}}, "0XYZ3456\nabc++\ndefghij\n", 1},
+        // In backward order; also reversed as one batch
+        {{{12, 0, "++\n"}, {7, 3, ""}, {1, 2, "XYZ"}}, "0XYZ3456\na++\nbcdefghij\n", 12},
+        // Overlapping and out of order; reversed one Change at a time
+        {{{5, 0, "__"}, {2, 5, "-"}, {15, 1, ""}}, "01-56789\nabcdefhij\n", 5},
+    };
+
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+    insert_unmerged(view, base);
+
+    for (size_t i = 0; i < ARRAYLEN(tests); i++) {
+        begin_change_chain();
+        for (size_t j = 0; j < ARRAYLEN(tests[i].edits); j++) {
+            const char *ins = tests[i].edits[j].ins;
+            edit_at(view, tests[i].edits[j].offset, tests[i].edits[j].del, ins);
+        }
+        end_change_chain(view);
+
+        const char *result = tests[i].result;
+        size_t len;
+        char *text = get_buffer_text(view, &len);
+        EXPECT_MEMEQ(text, len, result, strlen(result));
+        free(text);
+
+        EXPECT_TRUE(undo(view, &e->err));
+        text = get_buffer_text(view, &len);
+        EXPECT_MEMEQ(text, len, base, sizeof(base) - 1);
+        free(text);
+        EXPECT_EQ(block_iter_get_offset(&view->cursor), tests[i].cursor_after_undo);
+        EXPECT_EQ(buffer->nl, 2);
+
+        EXPECT_TRUE(redo(view, &e->err, 0));
+        text = get_buffer_text(view, &len);
+        EXPECT_MEMEQ(text, len, result, strlen(result));
+        free(text);
+
+        uintmax_t counts[3];
+        count_changes(&buffer->change_head, counts);
+        EXPECT_EQ(counts[1] + counts[2], buffer->change_arena.memory_usage);
+        EXPECT_TRUE(undo(view, &e->err));
+    }
+
+    window_close_current_view(e->window);
+}
+
+static void test_replace_all_sparse(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+
+    // 2 matches, separated by ~1MiB of text that doesn't match
+    const size_t nlines = 16 * 1024;
+    String text = string_new((nlines + 2) * 64);
+    string_append_cstring(&text, "foo\n");
+    for (size_t i = 0; i < nlines; i++) {
+        string_append_cstring(&text, "---------------------------------------------------------------\n");
+    }
+    string_append_cstring(&text, "foo\n");
+    const size_t size = text.len;
+    insert_unmerged(view, string_borrow_cstring(&text));
+    string_free(&text);
+    ASSERT_EQ(buffer->nl, nlines + 2);
+
+    // Another View of the same Buffer, with its cursor between the matches
+    View *other = window_add_buffer(e->window, buffer);
+    other->saved_cursor_offset = size / 2;
+    const size_t usage = buffer->change_arena.memory_usage;
+
+    View *saved_view = e->view;
+    e->view = view;
+    EXPECT_TRUE(reg_replace(e, "foo", "quux", REPLACE_GLOBAL));
+    e->view = saved_view;
+    EXPECT_EQ(buffer->nl, nlines + 2);
+    EXPECT_EQ(block_iter_get_offset(&view->cursor), size + 1);
+    EXPECT_EQ(other->saved_cursor_offset, size / 2 + 1);
+
+    // Only the matched text is stored for undo, along with 2 Changes for
+    // the edits and 2 for the chain barriers
+    uintmax_t counts[3];
+    count_changes(&buffer->change_head, counts);
+    EXPECT_EQ(counts[1] + counts[2], buffer->change_arena.memory_usage);
+    EXPECT_EQ(buffer->change_arena.memory_usage - usage, 4 * sizeof(Change) + 6);
+
+    EXPECT_TRUE(undo(view, &e->err));
+    EXPECT_EQ(other->saved_cursor_offset, size / 2);
+    size_t len;
+    char *buf = get_buffer_text(view, &len);
+    EXPECT_EQ(len, size);
+    EXPECT_MEMEQ(buf + len - 4, 4, "foo\n", 4);
+    free(buf);
+
+    // Undo and redo only edit the matched text, in one pass (see
+    // reverse_chain()), so the text stored for undo stays the same
+    EXPECT_TRUE(redo(view, &e->err, 0));
+    EXPECT_EQ(other->saved_cursor_offset, size / 2 + 1);
+    EXPECT_EQ(buffer->change_arena.memory_usage - usage, 4 * sizeof(Change) + 6);
+    buf = get_buffer_text(view, &len);
+    EXPECT_EQ(len, size + 2);
+    EXPECT_MEMEQ(buf + len - 5, 5, "quux\n", 5);
+    free(buf);
+
+    view_remove(other);
+    window_close_current_view(e->window);
+}
+
+static void test_persistent_undo(TestContext *ctx)
+{
+    static const char path[] = "build/test/undo.txt";
+    static const char text[] = "one\ntwo\n";
+    int fd = xopen(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQ(xwrite_all(fd, text, sizeof(text) - 1), sizeof(text) - 1);
+    ASSERT_EQ(xclose(fd), 0);
+
+    EditorState *e = ctx->userdata;
+    e->options.persistent_undo = true;
+    View *view = window_open_file(e->window, path, NULL);
+    ASSERT_NONNULL(view);
+    EXPECT_NULL(view->buffer->undo_file.data);
+    insert_unmerged(view, "A\n");
+    begin_change_chain();
+    insert_unmerged(view, "B\n");
+    insert_unmerged(view, "C\n");
+    end_change_chain(view);
+    EXPECT_TRUE(handle_normal_command(e, "save", false));
+    insert_unmerged(view, "D\n");
+    EXPECT_TRUE(buffer_modified(view->buffer));
+    window_close_current_view(e->window);
+
+    // The history should be mapped, but not decoded until it's needed
+    view = window_open_file(e->window, path, NULL);
+    ASSERT_NONNULL(view);
+    Buffer *buffer = view->buffer;
+    EXPECT_NONNULL(buffer->undo_file.data);
+    EXPECT_EQ(buffer->change_head.nr_prev, 0);
+    EXPECT_EQ(buffer->nl, 5);
+    EXPECT_FALSE(buffer_modified(buffer));
+
+    EXPECT_TRUE(undo(view, &e->err));
+    EXPECT_NULL(buffer->undo_file.data);
+    EXPECT_EQ(buffer->nl, 3);
+    EXPECT_TRUE(undo(view, &e->err));
+    EXPECT_EQ(buffer->nl, 2);
+    EXPECT_FALSE(undo(view, &e->err));
+    EXPECT_TRUE(buffer_modified(buffer));
+
+    // Changes made after the last save aren't kept
+    EXPECT_TRUE(redo(view, &e->err, 0));
+    EXPECT_TRUE(redo(view, &e->err, 0));
+    EXPECT_EQ(buffer->nl, 5);
+    EXPECT_FALSE(buffer_modified(buffer));
+    EXPECT_FALSE(redo(view, &e->err, 0));
+    uintmax_t counts[3];
+    count_changes(&buffer->change_head, counts);
+    EXPECT_EQ(counts[0], 5);
+    EXPECT_EQ(counts[1] + counts[2], buffer->change_arena.memory_usage);
+    const char *abs_filename = buffer->abs_filename;
+    const size_t filename_len = strlen(abs_filename);
+    uintmax_t hash = fnv_1a_hash(abs_filename, filename_len);
+    char *undo_path = xasprintf("%s/undo/%016jx", e->user_config_dir, hash);
+    char *undo_data;
+    ssize_t undo_size = read_file(undo_path, &undo_data, 0);
+    ASSERT_TRUE(undo_size > 0);
+    const char *filename = xmemmem(undo_data, undo_size, abs_filename, filename_len);
+    ASSERT_NONNULL(filename);
+    window_close_current_view(e->window);
+
+    // The first Change (after the header and filename) inserts "A\n" at
+    // offset 0 (see serialize_changes())
+    const size_t data_offset = (filename - undo_data) + filename_len;
+    ASSERT_TRUE(undo_size - data_offset > 5);
+    EXPECT_MEMEQ(undo_data + data_offset, 5, "\0\0\0\2\0", 5);
+
+    // A history that doesn't fit the text must be rejected as a whole,
+    // even though the header still matches (closing the Buffer then
+    // removes the undo file, since there's no history left)
+    static const struct {
+        size_t idx; // Index of the byte to corrupt, relative to `data_offset`
+        char val;
+    } corruptions[] = {
+        {1, 0x7F}, // `offset` past the end of the text
+        {2, 0x7F}, // `del_count` larger than the remaining data
+        {3, 0x7F}, // `ins_count` larger than the text it was inserted into
+    };
+
+    FOR_EACH_I(i, corruptions) {
+        char *byte = undo_data + data_offset + corruptions[i].idx;
+        char orig = *byte;
+        *byte = corruptions[i].val;
+        fd = xopen(undo_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        ASSERT_TRUE(fd >= 0);
+        ASSERT_EQ(xwrite_all(fd, undo_data, undo_size), undo_size);
+        ASSERT_EQ(xclose(fd), 0);
+        *byte = orig;
+
+        view = window_open_file(e->window, path, NULL);
+        ASSERT_NONNULL(view);
+        buffer = view->buffer;
+        IEXPECT_TRUE(!!buffer->undo_file.data);
+        IEXPECT_TRUE(!undo(view, &e->err));
+        IEXPECT_TRUE(!buffer->undo_file.data);
+        IEXPECT_EQ(buffer->change_head.nr_prev, 0);
+        IEXPECT_EQ(buffer->nl, 5);
+        window_close_current_view(e->window);
+    }
+
+    free(undo_data);
+    free(undo_path);
+
+    // Changes in branches not leading to the saved one are stored in
+    // their "reversed" form, which must also be accepted
+    view = window_open_file(e->window, path, NULL);
+    ASSERT_NONNULL(view);
+    insert_unmerged(view, "X\n");
+    EXPECT_TRUE(undo(view, &e->err));
+    insert_unmerged(view, "Y\n");
+    EXPECT_TRUE(handle_normal_command(e, "save", false));
+    window_close_current_view(e->window);
+    view = window_open_file(e->window, path, NULL);
+    ASSERT_NONNULL(view);
+    buffer = view->buffer;
+    EXPECT_EQ(buffer->nl, 6);
+    EXPECT_TRUE(undo(view, &e->err));
+    EXPECT_EQ(buffer->nl, 5);
+    EXPECT_EQ(buffer->change_head.nr_prev, 2);
+    EXPECT_TRUE(redo(view, &e->err, 1));
+    EXPECT_EQ(buffer->nl, 6);
+    EXPECT_TRUE(buffer_modified(buffer));
+    window_close_current_view(e->window);
+
+    // The history must be ignored, if the file has since been modified
+    fd = xopen(path, O_WRONLY | O_TRUNC | O_CLOEXEC, 0666);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQ(xwrite_all(fd, text, 4), 4);
+    ASSERT_EQ(xclose(fd), 0);
+    view = window_open_file(e->window, path, NULL);
+    ASSERT_NONNULL(view);
+    EXPECT_NULL(view->buffer->undo_file.data);
+    EXPECT_FALSE(undo(view, &e->err));
+    window_close_current_view(e->window);
+
+    e->options.persistent_undo = false;
+    int r = unlink(path);
+    LOG_ERRNO_ON(r, "unlink");
+}
+
+static void test_mapped_blocks(TestContext *ctx)
+{
+    // Create a file large enough to be mmap(3)'d by read_blocks()
+    static const char path[] = "build/test/mapped.txt";
+    const size_t nlines = 8000;
+    const size_t linelen = 10;
+    size_t size = nlines * linelen;
+    char *text = xmalloc(size + 1);
+    for (size_t i = 0; i < nlines; i++) {
+        xsnprintf(text + (i * linelen), linelen + 1, "%09zu\n", i);
+    }
+
+    int fd = xopen(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQ(xwrite_all(fd, text, size), size);
+    ASSERT_EQ(xclose(fd), 0);
+    free(text);
+
+    EditorState *e = ctx->userdata;
+    e->options.mmap_threshold = 64 << 10;
+    View *view = window_open_file(e->window, path, NULL);
+    e->options.mmap_threshold = 0;
+    ASSERT_NONNULL(view);
+
+    const Buffer *buffer = view->buffer;
+    const Block *first = BLOCK(buffer->blocks.next);
+    EXPECT_EQ(buffer->nl, nlines);
+    EXPECT_NONNULL(first->mapping);
+    EXPECT_EQ(first->alloc, 0);
+    EXPECT_EQ(block_total_size(first), size);
+
+    block_iter_goto_line(&view->cursor, 4000);
+    buffer_insert_bytes(view, "x\n", 2);
+    EXPECT_EQ(buffer->nl, nlines + 1);
+    block_iter_goto_line(&view->cursor, 4000);
+    StringView line = get_current_line(view->cursor);
+    EXPECT_MEMEQ(line.data, line.length, "x", 1);
+    block_iter_next_line(&view->cursor);
+    line = get_current_line(view->cursor);
+    EXPECT_MEMEQ(line.data, line.length, "000004000", 9);
+
+    block_iter_bof(&view->cursor);
+    buffer_delete_bytes(view, 5);
+    line = get_current_line(view->cursor);
+    EXPECT_MEMEQ(line.data, line.length, "0000", 4);
+
+    window_close_current_view(e->window);
+    int r = unlink(path);
+    LOG_ERRNO_ON(r, "unlink");
+}
+
+static void test_parallel_decode(TestContext *ctx)
+{
+    // Create a CRLF file large enough to be split into multiple chunks
+    // by file_decoder_read_utf8()
+    static const char path[] = "build/test/parallel.txt";
+    const size_t nlines = 400000;
+    const size_t linelen = 25;
+    size_t size = nlines * linelen;
+    char *text = xmalloc(size + 1);
+    for (size_t i = 0; i < nlines; i++) {
+        xsnprintf(text + (i * linelen), linelen + 1, "line %018zu\r\n", i);
+    }
+
+    int fd = xopen(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQ(xwrite_all(fd, text, size), size);
+    ASSERT_EQ(xclose(fd), 0);
+    free(text);
+
+    EditorState *e = ctx->userdata;
+    View *view = window_open_file(e->window, path, NULL);
+    ASSERT_NONNULL(view);
+
+    const Buffer *buffer = view->buffer;
+    EXPECT_TRUE(buffer->crlf_newlines);
+    EXPECT_EQ(buffer->nl, nlines);
+    EXPECT_EQ(block_total_size(view->cursor.blk), nlines * (linelen - 1));
+
+    size_t nl = 0;
+    const Block *blk;
+    block_for_each(blk, &buffer->blocks) {
+        EXPECT_EQ(block_get_line(blk), nl);
+        nl += blk->nl;
+    }
+
+    // Check every line is present, in order and with "\r" removed
+    char expected[32];
+    size_t nr_mismatched = 0;
+    block_iter_bof(&view->cursor);
+    for (size_t i = 0; i < nlines; i++) {
+        StringView line = get_current_line(view->cursor);
+        size_t n = xsnprintf(expected, sizeof(expected), "line %018zu", i);
+        nr_mismatched += !strview_equal(line, string_view(expected, n));
+        block_iter_next_line(&view->cursor);
+    }
+    EXPECT_EQ(nr_mismatched, 0);
+
+    window_close_current_view(e->window);
+    int r = unlink(path);
+    LOG_ERRNO_ON(r, "unlink");
+}
+
+static void test_async_load(TestContext *ctx)
+{
+    static const char path[] = "build/test/async.txt";
+    const size_t nlines = 100000;
+    const size_t linelen = 10;
+    size_t size = nlines * linelen;
+    char *text = xmalloc(size + 1);
+    for (size_t i = 0; i < nlines; i++) {
+        xsnprintf(text + (i * linelen), linelen + 1, "%09zu\n", i);
+    }
+
+    int fd = xopen(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQ(xwrite_all(fd, text, size), size);
+    ASSERT_EQ(xclose(fd), 0);
+    free(text);
+
+    EditorState *e = ctx->userdata;
+    e->options.async_load_threshold = 64 << 10;
+    View *view = window_open_file(e->window, path, NULL);
+    e->options.async_load_threshold = 0;
+    ASSERT_NONNULL(view);
+
+    // Only the first part of the file should have been loaded so far
+    Buffer *buffer = view->buffer;
+    EXPECT_NONNULL(buffer->loader);
+    EXPECT_TRUE(buffer->nl > 0);
+    EXPECT_TRUE(buffer->nl < nlines);
+    EXPECT_TRUE(load_buffer_progress(buffer) < 100);
+    EXPECT_EQ(block_total_size(view->cursor.blk), buffer->nl * linelen);
+
+    size_t nl = buffer->nl;
+    EXPECT_TRUE(load_buffer_continue(buffer, 128 << 10));
+    EXPECT_TRUE(buffer->nl > nl);
+    EXPECT_NONNULL(buffer->loader);
+
+    load_buffer_finish(buffer);
+    EXPECT_NULL(buffer->loader);
+    EXPECT_EQ(load_buffer_progress(buffer), 100);
+    EXPECT_EQ(buffer->nl, nlines);
+    EXPECT_EQ(block_total_size(view->cursor.blk), size);
+    EXPECT_FALSE(load_buffer_continue(buffer, 1));
+
+    char expected[16];
+    size_t nr_mismatched = 0;
+    block_iter_bof(&view->cursor);
+    for (size_t i = 0; i < nlines; i++) {
+        StringView line = get_current_line(view->cursor);
+        size_t n = xsnprintf(expected, sizeof(expected), "%09zu", i);
+        nr_mismatched += !strview_equal(line, string_view(expected, n));
+        block_iter_next_line(&view->cursor);
+    }
+    EXPECT_EQ(nr_mismatched, 0);
+
+    window_close_current_view(e->window);
+    int r = unlink(path);
+    LOG_ERRNO_ON(r, "unlink");
+}
+
+static void collect_search_matches (
+    View *view,
+    ErrorBuffer *ebuf,
+    const char *pattern,
+    SearchCaseSensitivity cs,
+    bool reverse,
+    bool expect_literal,
+    size_t offsets[static 12]
+) {
+    SearchState search = {.reverse = reverse};
+    search_set_regexp(&search, pattern);
+    BUG_ON(!!search.literal != expect_literal);
+    block_iter_bof(&view->cursor);
+    for (size_t i = 0; i < 12; i++) {
+        bool found = do_search_next(view, &search, ebuf, cs, false);
+        offsets[i] = found ? block_iter_get_offset(&view->cursor) : SIZE_MAX;
+    }
+    search_free_regexp(&search);
+}
+
+static void test_search_literal(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+
+    // Enough text for several Blocks, with a few matches in between
+    String text = string_new(4096);
+    for (size_t i = 0; i < 4000; i++) {
+        bool match = (i % 997 == 5);
+        string_append_cstring(&text, match ? "xx NeedLe needle\n" : "xx haystack haystack\n");
+    }
+    buffer_insert_bytes(view, text.buffer, text.len);
+    string_free(&text);
+    ASSERT_TRUE(buffer->blocks.next->next != &buffer->blocks);
+
+    // Literal patterns and equivalent patterns that aren't literal
+    static const char patterns[][2][16] = {
+        {"needle", "need[l]e"},
+        {"eedle n", "eedl[e] n"},
+        {"xx\\.", "xx[.]"},
+        {"e", "[e]"},
+    };
+
+    static const SearchCaseSensitivity cs[] = {CSS_TRUE, CSS_FALSE};
+    for (size_t i = 0; i < ARRAYLEN(patterns); i++) {
+        for (size_t j = 0; j < 4; j++) {
+            size_t expected[12], offsets[12];
+            bool reverse = j & 1;
+            const char *literal = patterns[i][0];
+            const char *nonliteral = patterns[i][1];
+            collect_search_matches(view, &e->err, nonliteral, cs[j >> 1], reverse, false, expected);
+            collect_search_matches(view, &e->err, literal, cs[j >> 1], reverse, true, offsets);
+            EXPECT_MEMEQ(offsets, sizeof(offsets), expected, sizeof(expected));
+        }
+    }
+
+    window_close_current_view(e->window);
+}
+
+static void test_search_multiline(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+
+    // Pairs of lines that are each matched by a multi-line pattern
+    String text = string_new(4096);
+    String expected = string_new(4096);
+    for (size_t i = 0; i < 3000; i++) {
+        string_sprintf(&text, "%zu a\nb %zu\n", i, i * 7);
+        string_sprintf(&expected, "%zu a+b=%zu\n", i, i * 7);
+    }
+    buffer_insert_bytes(view, text.buffer, text.len);
+    string_free(&text);
+
+    // Matches straddling Block boundaries should be found in both directions
+    size_t nr_straddling = 0;
+    const Block *blk;
+    block_for_each(blk, &buffer->blocks) {
+        size_t end = block_get_offset(blk) + blk->size;
+        if (blk->node.next == &buffer->blocks || blk->data[blk->size - 2] != 'a') {
+            continue;
+        }
+        SearchState search = {.reverse = false};
+        search_set_regexp(&search, "a\nb [0-9]+");
+        block_iter_goto_offset(&view->cursor, end - 3);
+        EXPECT_TRUE(do_search_next(view, &search, &e->err, CSS_TRUE, false));
+        EXPECT_EQ(block_iter_get_offset(&view->cursor), end - 2);
+        search.reverse = true;
+        block_iter_goto_offset(&view->cursor, end + 2);
+        EXPECT_TRUE(do_search_next(view, &search, &e->err, CSS_TRUE, false));
+        EXPECT_EQ(block_iter_get_offset(&view->cursor), end - 2);
+        search_free_regexp(&search);
+        nr_straddling++;
+    }
+    EXPECT_TRUE(nr_straddling > 0);
+
+    // reg_replace() operates on EditorState::view
+    View *saved_view = e->view;
+    e->view = view;
+    EXPECT_TRUE(reg_replace(e, "a\nb ([0-9]+)", "a+b=\\1", REPLACE_GLOBAL));
+    e->view = saved_view;
+    size_t len;
+    char *result = get_buffer_text(view, &len);
+    EXPECT_MEMEQ(result, len, expected.buffer, expected.len);
+    EXPECT_EQ(buffer->nl, 3000);
+    free(result);
+    string_free(&expected);
+
+    window_close_current_view(e->window);
+}
+
+static int offset_cmp(const void *ap, const void *bp)
+{
+    size_t a = *(const size_t*)ap;
+    size_t b = *(const size_t*)bp;
+    return (a > b) - (a < b);
+}
+
+// Search repeatedly from the start (or end) of the Buffer, until a match is found for the second
+// time, and return the (sorted) offsets of all matches found
+static size_t collect_all_matches (
+    View *view,
+    ErrorBuffer *ebuf,
+    SearchState *search,
+    size_t *offsets,
+    size_t max
+) {
+    size_t n = 0;
+    if (search->reverse) {
+        block_iter_eof(&view->cursor);
+    } else {
+        block_iter_bof(&view->cursor);
+    }
+    while (n < max && do_search_next(view, search, ebuf, CSS_TRUE, false)) {
+        size_t offset = block_iter_get_offset(&view->cursor);
+        if (n && offset == offsets[0]) {
+            break;
+        }
+        offsets[n++] = offset;
+    }
+    qsort(offsets, n, sizeof(offsets[0]), offset_cmp);
+    return n;
+}
+
+static void test_search_reverse(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+
+    // A single long line, with many matches for each pattern below
+    String text = string_new(65536);
+    for (size_t i = 0; i < 4000; i++) {
+        string_sprintf(&text, "x%zu aaa%s ", i, (i % 3) ? "a" : "");
+    }
+    string_append_byte(&text, '\n');
+    buffer_insert_bytes(view, text.buffer, text.len);
+    string_free(&text);
+    ASSERT_EQ(buffer->nl, 1);
+
+    // Literal patterns (including ones whose matches can overlap) and
+    // patterns that aren't literal. Searching backwards should find the
+    // same matches as searching forwards.
+    static const char patterns[][16] = {
+        "aa", "a[a]", "x1", "x1[0-9]*", "aaa", "a*a", "3 a",
+    };
+
+    const size_t max = 20000;
+    size_t *fwd = xmallocarray(max, sizeof(*fwd));
+    size_t *bwd = xmallocarray(max, sizeof(*bwd));
+    for (size_t i = 0; i < ARRAYLEN(patterns) * 2; i++) {
+        SearchState search = {.reverse = false};
+        search_set_regexp(&search, patterns[i >> 1]);
+        if (i & 1) {
+            // Make an edit before searching again, which should discard
+            // any matches remembered from the previous reverse search
+            block_iter_goto_offset(&view->cursor, 3000);
+            buffer_insert_bytes(view, STRN("x1 aa x1aaaaa "));
+        }
+        size_t n = collect_all_matches(view, &e->err, &search, fwd, max);
+        search.reverse = true;
+        size_t nr_bwd = collect_all_matches(view, &e->err, &search, bwd, max);
+        IEXPECT_TRUE(n > 100);
+        IEXPECT_EQ(nr_bwd, n);
+        EXPECT_MEMEQ(bwd, nr_bwd * sizeof(*bwd), fwd, n * sizeof(*fwd));
+        search_free_regexp(&search);
+    }
+
+    free(fwd);
+    free(bwd);
+    window_close_current_view(e->window);
+}
+
+static void test_match_cache(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+    MatchCache *cache = &buffer->match_cache;
+    buffer_insert_bytes(view, STRN("xaax\nb\naaaaa a\n"));
+
+    regex_t re;
+    ASSERT_TRUE(regexp_compile(NULL, &re, "a+|^", REG_NEWLINE));
+    const LineMatches *m = match_cache_get(cache, &re, 1, strview("xaax"), 0);
+    ASSERT_EQ(m->nr_spans, 1);
+    EXPECT_EQ(m->spans[0].start, 1);
+    EXPECT_EQ(m->spans[0].end, 3);
+    m = match_cache_get(cache, &re, 1, strview("b"), 1);
+    EXPECT_EQ(m->nr_spans, 0);
+    const LineMatches *m2 = match_cache_get(cache, &re, 1, strview("aaaaa a"), 2);
+    ASSERT_EQ(m2->nr_spans, 2);
+    EXPECT_EQ(m2->spans[0].start, 0);
+    EXPECT_EQ(m2->spans[0].end, 5);
+    EXPECT_EQ(m2->spans[1].start, 6);
+    EXPECT_EQ(m2->spans[1].end, 7);
+
+    // Cached lines are returned without matching them again
+    EXPECT_PTREQ(match_cache_get(cache, &re, 1, strview("zzz"), 2), m2);
+
+    // Splitting line 0 discards its matches and renumbers those that follow
+    block_iter_goto_offset(&view->cursor, 2);
+    buffer_insert_bytes(view, STRN("\n"));
+    EXPECT_PTREQ(match_cache_get(cache, &re, 1, strview("zzz"), 3), m2);
+
+    // Joining lines 1 and 2 moves them back
+    block_iter_goto_offset(&view->cursor, 5);
+    buffer_delete_bytes(view, 1);
+    EXPECT_PTREQ(match_cache_get(cache, &re, 1, strview("zzz"), 2), m2);
+
+    // Only the most recently used lines are kept, regardless of how far
+    // into the Buffer they are
+    for (size_t i = 0; i < 1000; i++) {
+        m = match_cache_get(cache, &re, 1, strview("xaa"), 50000000 + i);
+        IEXPECT_EQ(m->nr_spans, 1);
+    }
+    m = match_cache_get(cache, &re, 1, strview("zzz"), 2);
+    EXPECT_EQ(m->nr_spans, 0);
+
+    // A different generation (i.e. regex) invalidates everything
+    m = match_cache_get(cache, &re, 2, strview("aaaaa a"), 2);
+    EXPECT_EQ(m->nr_spans, 2);
+    EXPECT_EQ(cache->generation, 2);
+
+    regfree(&re);
+    window_close_current_view(e->window);
+}
+
+static void test_match_count(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+    MatchCount *mc = &buffer->match_count;
+
+    // Lines with numbers divisible by 3 contain 2 matches each
+    const size_t nlines = 1000;
+    String text = string_new(nlines * 8);
+    for (size_t i = 0; i < nlines; i++) {
+        string_append_cstring(&text, (i % 3) ? "---\n" : "-xx-x\n");
+    }
+    buffer_insert_bytes(view, text.buffer, text.len);
+    string_free(&text);
+    ASSERT_EQ(buffer->nl, nlines);
+
+    regex_t re;
+    ASSERT_TRUE(regexp_compile(NULL, &re, "x+", REG_NEWLINE));
+    EXPECT_FALSE(match_count_pending(mc, 1, buffer->nl));
+    mc->enabled = true;
+    EXPECT_TRUE(match_count_pending(mc, 1, buffer->nl));
+
+    // A `max_bytes` value of 1 counts a single chunk per call
+    BlockIter bof = block_iter(buffer);
+    EXPECT_TRUE(match_count_continue(mc, &re, "x+", 1, bof, buffer->nl, 1));
+    EXPECT_EQ(mc->nr_chunks, 2);
+    EXPECT_TRUE(match_count_pending(mc, 1, buffer->nl));
+
+    block_iter_goto_line(&view->cursor, 300);
+    view_update(view);
+    block_iter_skip_bytes(&view->cursor, 1);
+    MatchPosition pos;
+    ASSERT_TRUE(match_count_get_position(mc, &re, "x+", 1, view->cursor, 300, &pos));
+    EXPECT_EQ(pos.index, 0); // Not yet known
+    EXPECT_TRUE(pos.partial);
+
+    for (size_t i = 0; match_count_pending(mc, 1, buffer->nl); i++) {
+        ASSERT_TRUE(i < nlines);
+        EXPECT_TRUE(match_count_continue(mc, &re, "x+", 1, bof, buffer->nl, 1));
+    }
+
+    EXPECT_EQ(mc->nr_chunks, 4);
+    ASSERT_TRUE(match_count_get_position(mc, &re, "x+", 1, view->cursor, 300, &pos));
+    EXPECT_EQ(pos.index, 201);
+    EXPECT_EQ(pos.total, 668);
+    EXPECT_FALSE(pos.partial);
+
+    // Only a match start counts as a position
+    block_iter_skip_bytes(&view->cursor, 1);
+    EXPECT_FALSE(match_count_get_position(mc, &re, "x+", 1, view->cursor, 300, &pos));
+    block_iter_skip_bytes(&view->cursor, 2);
+    ASSERT_TRUE(match_count_get_position(mc, &re, "x+", 1, view->cursor, 300, &pos));
+    EXPECT_EQ(pos.index, 202);
+
+    // Editing a line only discards the count for the chunk containing it
+    block_iter_goto_line(&view->cursor, 600);
+    view_update(view);
+    buffer_insert_bytes(view, STRN("x\n"));
+    EXPECT_EQ(mc->nr_chunks, 4);
+    EXPECT_EQ(mc->nr_lines, nlines + 1);
+    EXPECT_EQ(mc->nr_pending_lines, 257);
+
+    block_iter_goto_line(&view->cursor, 300);
+    view_update(view);
+    block_iter_skip_bytes(&view->cursor, 1);
+    ASSERT_TRUE(match_count_get_position(mc, &re, "x+", 1, view->cursor, 300, &pos));
+    EXPECT_EQ(pos.index, 201);
+    EXPECT_EQ(pos.total, 668 - 170);
+    EXPECT_TRUE(pos.partial);
+
+    EXPECT_TRUE(match_count_continue(mc, &re, "x+", 1, bof, buffer->nl, SIZE_MAX));
+    EXPECT_FALSE(match_count_pending(mc, 1, buffer->nl));
+    EXPECT_EQ(mc->nr_chunks, 5);
+    ASSERT_TRUE(match_count_get_position(mc, &re, "x+", 1, view->cursor, 300, &pos));
+    EXPECT_EQ(pos.total, 669);
+    EXPECT_FALSE(pos.partial);
+
+    // A different generation (i.e. regex) discards all counts
+    EXPECT_FALSE(match_count_get_position(mc, &re, "x+", 2, view->cursor, 300, &pos));
+    EXPECT_TRUE(match_count_pending(mc, 2, buffer->nl));
+
+    regfree(&re);
+    window_close_current_view(e->window);
+}
+
+static void test_match_count_multiline(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    View *view = window_open_empty_buffer(e->window);
+    Buffer *buffer = view->buffer;
+    MatchCount *mc = &buffer->match_count;
+
+    // Every third line starts a match spanning 2 lines, including one that
+    // crosses the boundary between the first 2 chunks (see MatchCountChunk)
+    const size_t nlines = 3000;
+    String text = string_new(nlines * 4);
+    for (size_t i = 0; i < nlines; i++) {
+        static const char lines[3][5] = {"foo\n", "bar\n", "-\n"};
+        string_append_cstring(&text, lines[i % 3]);
+    }
+    buffer_insert_bytes(view, text.buffer, text.len);
+    string_free(&text);
+    ASSERT_EQ(buffer->nl, nlines);
+
+    const char pattern[] = "foo\nbar";
+    regex_t re;
+    ASSERT_TRUE(regexp_compile(NULL, &re, pattern, REG_NEWLINE));
+    mc->enabled = true;
+    BlockIter bof = block_iter(buffer);
+    EXPECT_TRUE(match_count_continue(mc, &re, pattern, 1, bof, buffer->nl, SIZE_MAX));
+    EXPECT_FALSE(match_count_pending(mc, 1, buffer->nl));
+
+    block_iter_goto_line(&view->cursor, 255);
+    view_update(view);
+    MatchPosition pos;
+    ASSERT_TRUE(match_count_get_position(mc, &re, pattern, 1, view->cursor, 255, &pos));
+    EXPECT_EQ(pos.index, 86);
+    EXPECT_EQ(pos.total, nlines / 3);
+    EXPECT_FALSE(pos.partial);
+
+    block_iter_goto_line(&view->cursor, 256);
+    view_update(view);
+    EXPECT_FALSE(match_count_get_position(mc, &re, pattern, 1, view->cursor, 256, &pos));
+
+    block_iter_goto_line(&view->cursor, nlines - 3);
+    view_update(view);
+    ASSERT_TRUE(match_count_get_position(mc, &re, pattern, 1, view->cursor, nlines - 3, &pos));
+    EXPECT_EQ(pos.index, nlines / 3);
+
+    // Editing the second line of a match also discards the count for the
+    // chunk where the match starts
+    block_iter_goto_line(&view->cursor, 256);
+    view_update(view);
+    buffer_delete_bytes(view, 1);
+    EXPECT_EQ(mc->nr_chunks, 11);
+    EXPECT_EQ(mc->nr_pending_lines, 512);
+    EXPECT_TRUE(match_count_continue(mc, &re, pattern, 1, bof, buffer->nl, SIZE_MAX));
+    EXPECT_FALSE(match_count_pending(mc, 1, buffer->nl));
+
+    block_iter_goto_line(&view->cursor, nlines - 3);
+    view_update(view);
+    ASSERT_TRUE(match_count_get_position(mc, &re, pattern, 1, view->cursor, nlines - 3, &pos));
+    EXPECT_EQ(pos.index, nlines / 3 - 1);
+    EXPECT_EQ(pos.total, nlines / 3 - 1);
+
+    regfree(&re);
+    window_close_current_view(e->window);
+}
+
 static const TestEntry tests[] = {
     TEST(test_find_buffer_by_id),
     TEST(test_buffer_mark_lines_changed),
     TEST(test_make_indent),
     TEST(test_get_indent_for_next_line),
     TEST(test_buffer_insert_bytes),
+    TEST(test_block_index),
+    TEST(test_compact_blocks),
+    TEST(test_block_arena),
+    TEST(test_buffer_get_memory_usage),
+    TEST(test_undo_memory_limit),
+    TEST(test_undo_change_chain),
+    TEST(test_replace_all_sparse),
+    TEST(test_persistent_undo),
+    TEST(test_search_literal),
+    TEST(test_search_multiline),
+    TEST(test_search_reverse),
+    TEST(test_match_cache),
+    TEST(test_match_count),
+    TEST(test_match_count_multiline),
+    TEST(test_mapped_blocks),
+    TEST(test_parallel_decode),
+    TEST(test_async_load),
 };
 
 const TestGroup buffer_tests = TEST_GROUP(tests);
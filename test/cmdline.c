@@ -286,6 +286,8 @@ static void test_complete_command(TestContext *ctx)
     complete_command_next(e);
     EXPECT_STRING_EQ_CSTRING(&c->buf, "show option ");
     complete_command_next(e);
+    EXPECT_STRING_EQ_CSTRING(&c->buf, "show option async-load-threshold");
+    complete_command_next(e);
     EXPECT_STRING_EQ_CSTRING(&c->buf, "show option auto-indent");
     reset_completion(c);
 
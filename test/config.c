@@ -114,6 +114,7 @@ static void test_exec_config(TestContext *ctx)
         "delete.txt",
         "new-line.txt",
         "tag.txt",
+        "search.txt",
     };
 
     // Delete output files left over from previous runs
@@ -29,10 +29,13 @@ static const struct {
     {"hi", CHECK_NAME | CHECK_PARSE},
     {"include", 0},
     {"macro", 0},
+    {"memory", 0},
+    {"memstats", 0},
     {"msg", ALLOW_EMPTY},
     {"open", 0},
     {"paste", 0},
     {"option", CHECK_PARSE},
+    {"regexp", 0},
     {"search", ALLOW_EMPTY},
     {"set", CHECK_NAME | CHECK_PARSE},
     {"setenv", CHECK_NAME | CHECK_PARSE},
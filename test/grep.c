@@ -0,0 +1,269 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "test.h"
+#include "bookmark.h"
+#include "commands.h"
+#include "editor.h"
+#include "grep.h"
+#include "msg.h"
+#include "util/xreadwrite.h"
+#include "util/xsnprintf.h"
+#include "util/str-util.h"
+
+static void make_dir(TestContext *ctx, const char *path)
+{
+    ASSERT_TRUE(mkdir(path, 0755) == 0 || errno == EEXIST);
+}
+
+static void make_file(TestContext *ctx, const char *path, const char *text, size_t len)
+{
+    int fd = xopen(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQ(xwrite_all(fd, text, len), len);
+    ASSERT_EQ(xclose(fd), 0);
+}
+
+static void expect_message (
+    TestContext *ctx,
+    const MessageList *msgs,
+    size_t idx,
+    const char *filename,
+    unsigned long line,
+    unsigned long column,
+    const char *text
+) {
+    ASSERT_TRUE(idx < msgs->array.count);
+    const Message *m = msgs->array.ptrs[idx];
+    ASSERT_NONNULL(m->loc);
+    EXPECT_STREQ(m->loc->filename, filename);
+    EXPECT_EQ(m->loc->line, line);
+    EXPECT_EQ(m->loc->column, column);
+    EXPECT_STREQ(m->msg, text);
+}
+
+static void test_grep_paths(TestContext *ctx)
+{
+    static const char a[] = "x\n\tfoo bar\r\nno\nbaz foo\xC3\xA4 foo";
+    static const char b[] = "one\ntwo foo\n";
+    static const char bin[] = "foo\0\n";
+
+    make_dir(ctx, "build/test/grep");
+    make_dir(ctx, "build/test/grep/sub");
+    make_dir(ctx, "build/test/grep/.hidden");
+    make_file(ctx, "build/test/grep/a.txt", a, sizeof(a) - 1);
+    make_file(ctx, "build/test/grep/sub/b.txt", b, sizeof(b) - 1);
+    make_file(ctx, "build/test/grep/.hidden/c.txt", b, sizeof(b) - 1);
+    make_file(ctx, "build/test/grep/.d.txt", b, sizeof(b) - 1);
+    make_file(ctx, "build/test/grep/bin.dat", bin, sizeof(bin) - 1);
+
+    // Symlinks to directories aren't followed, since they could lead to
+    // cycles like this one
+    int r = symlink(".", "build/test/grep/loop");
+    ASSERT_TRUE(r == 0 || errno == EEXIST);
+
+    MessageList msgs = {.pos = 0};
+    ErrorBuffer ebuf = {.print_to_stderr = false};
+    char dir[] = "build/test/grep";
+    char *paths[] = {dir, NULL};
+    EXPECT_TRUE(grep_paths(&msgs, &ebuf, "foo", false, paths));
+    EXPECT_EQ(msgs.array.count, 3);
+    expect_message(ctx, &msgs, 0, "build/test/grep/a.txt", 2, 2, "foo bar");
+    expect_message(ctx, &msgs, 1, "build/test/grep/a.txt", 4, 5, "baz foo\xC3\xA4 foo");
+    expect_message(ctx, &msgs, 2, "build/test/grep/sub/b.txt", 2, 5, "two foo");
+    clear_messages(&msgs);
+
+    EXPECT_TRUE(grep_paths(&msgs, &ebuf, "BAZ", true, paths));
+    EXPECT_TRUE(grep_paths(&msgs, &ebuf, "\xC3\xA4 FOO", true, paths));
+    EXPECT_TRUE(grep_paths(&msgs, &ebuf, "foo$", false, paths));
+    EXPECT_EQ(msgs.array.count, 4);
+    expect_message(ctx, &msgs, 0, "build/test/grep/a.txt", 4, 1, "baz foo\xC3\xA4 foo");
+    expect_message(ctx, &msgs, 1, "build/test/grep/a.txt", 4, 8, "baz foo\xC3\xA4 foo");
+    expect_message(ctx, &msgs, 2, "build/test/grep/a.txt", 4, 10, "baz foo\xC3\xA4 foo");
+    expect_message(ctx, &msgs, 3, "build/test/grep/sub/b.txt", 2, 5, "two foo");
+    clear_messages(&msgs);
+
+    // Patterns that could match across lines only match within them
+    EXPECT_TRUE(grep_paths(&msgs, &ebuf, "o[[:space:]]+t", false, paths));
+    EXPECT_EQ(msgs.array.count, 0);
+    EXPECT_TRUE(grep_paths(&msgs, &ebuf, "^$|^x", false, paths));
+    EXPECT_EQ(msgs.array.count, 1);
+    expect_message(ctx, &msgs, 0, "build/test/grep/a.txt", 1, 1, "x");
+    clear_messages(&msgs);
+
+    EXPECT_FALSE(grep_paths(&msgs, &ebuf, "(", false, paths));
+    char missing[] = "build/test/grep/missing";
+    char *missing_paths[] = {missing, NULL};
+    EXPECT_FALSE(grep_paths(&msgs, &ebuf, "foo", false, missing_paths));
+    EXPECT_TRUE(str_has_prefix(ebuf.buf, missing));
+    EXPECT_EQ(msgs.array.count, 0);
+}
+
+static void test_grep_paths_batches(TestContext *ctx)
+{
+    // Enough files for several batches, to check that results are
+    // added in the order the files were found
+    const size_t nfiles = 2500;
+    make_dir(ctx, "build/test/grep-many");
+    for (size_t i = 0; i < nfiles; i++) {
+        char path[64], text[32];
+        xsnprintf(path, sizeof path, "build/test/grep-many/%04zu.txt", i);
+        size_t len = xsnprintf(text, sizeof text, "%s\nline %zu\n", (i & 1) ? "odd" : "even", i);
+        make_file(ctx, path, text, len);
+    }
+
+    MessageList msgs = {.pos = 0};
+    ErrorBuffer ebuf = {.print_to_stderr = false};
+    char dir[] = "build/test/grep-many";
+    char *paths[] = {dir, NULL};
+    ASSERT_TRUE(grep_paths(&msgs, &ebuf, "^line [0-9]*[13579]$", false, paths));
+    ASSERT_EQ(msgs.array.count, nfiles / 2);
+
+    for (size_t i = 0, n = msgs.array.count; i < n; i++) {
+        char path[64], text[32];
+        size_t nr = (i * 2) + 1;
+        xsnprintf(path, sizeof path, "build/test/grep-many/%04zu.txt", nr);
+        xsnprintf(text, sizeof text, "line %zu", nr);
+        const Message *m = msgs.array.ptrs[i];
+        IEXPECT_STREQ(m->loc->filename, path);
+        IEXPECT_EQ(m->loc->line, 2);
+        IEXPECT_STREQ(m->msg, text);
+    }
+
+    clear_messages(&msgs);
+}
+
+static void test_grep_continue(TestContext *ctx)
+{
+    // Files in each directory are found before those in its subdirectories,
+    // which are walked in order (and before the next sibling directory)
+    static const char *const files[] = {
+        "build/test/grep-walk/b.txt",
+        "build/test/grep-walk/z.txt",
+        "build/test/grep-walk/d1/a.txt",
+        "build/test/grep-walk/d1/d3/a.txt",
+        "build/test/grep-walk/d2/a.txt",
+    };
+
+    make_dir(ctx, "build/test/grep-walk");
+    make_dir(ctx, "build/test/grep-walk/d1");
+    make_dir(ctx, "build/test/grep-walk/d1/d3");
+    make_dir(ctx, "build/test/grep-walk/d2");
+    for (size_t i = 0; i < ARRAYLEN(files); i++) {
+        make_file(ctx, files[i], "foo\n", 4);
+    }
+
+    MessageList msgs = {.pos = 0};
+    ErrorBuffer ebuf = {.print_to_stderr = false};
+    char dir[] = "build/test/grep-walk";
+    char file[] = "build/test/grep-walk/z.txt";
+    char *paths[] = {file, dir, NULL};
+    GrepSearch *gs = grep_start(&msgs, &ebuf, "foo", false, paths);
+    ASSERT_NONNULL(gs);
+    EXPECT_PTREQ(grep_get_messages(gs), &msgs);
+    EXPECT_STREQ(grep_get_pattern(gs), "foo");
+    while (grep_continue(gs, 100)) {
+        ;
+    }
+    grep_free(gs);
+
+    ASSERT_EQ(msgs.array.count, ARRAYLEN(files) + 1);
+    expect_message(ctx, &msgs, 0, files[1], 1, 1, "foo");
+    for (size_t i = 0; i < ARRAYLEN(files); i++) {
+        const Message *m = msgs.array.ptrs[i + 1];
+        IEXPECT_STREQ(m->loc->filename, files[i]);
+    }
+    clear_messages(&msgs);
+
+    // Cancelling a search in progress keeps only the results that were
+    // already added
+    gs = grep_start(&msgs, &ebuf, "foo", false, paths);
+    ASSERT_NONNULL(gs);
+    grep_free(gs);
+    EXPECT_EQ(msgs.array.count, 0);
+
+    gs = grep_start(&msgs, &ebuf, "foo", false, paths);
+    ASSERT_NONNULL(gs);
+    EXPECT_TRUE(grep_continue(gs, 0) || msgs.array.count == ARRAYLEN(files) + 1);
+    size_t count = msgs.array.count;
+    grep_free(gs);
+    EXPECT_EQ(msgs.array.count, count);
+    clear_messages(&msgs);
+
+    // Drive the search the way main_loop() does, by waiting for the
+    // wakeup fd whenever there's nothing to do but wait for the workers
+    gs = grep_start(&msgs, &ebuf, "foo", false, paths);
+    ASSERT_NONNULL(gs);
+    for (size_t nr_waits = 0; ; ) {
+        if (!grep_is_ready(gs)) {
+            struct pollfd pfd = {.fd = grep_get_wakeup_fd(gs), .events = POLLIN};
+            ASSERT_TRUE(pfd.fd >= 0);
+            ASSERT_EQ(poll(&pfd, 1, 10000), 1);
+            EXPECT_TRUE(grep_is_ready(gs));
+            ASSERT_TRUE(++nr_waits <= ARRAYLEN(files) + 1);
+            continue;
+        }
+        if (!grep_continue(gs, 0)) {
+            break;
+        }
+    }
+    grep_free(gs);
+    EXPECT_EQ(msgs.array.count, ARRAYLEN(files) + 1);
+    clear_messages(&msgs);
+
+    EXPECT_NULL(grep_start(&msgs, &ebuf, "(", false, paths));
+}
+
+static void test_grep_command(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    MessageList *msgs = &e->messages[0];
+    EXPECT_TRUE(handle_normal_command(e, "open", false));
+    View *view = e->view;
+    ASSERT_NONNULL(view);
+    size_t nr_bookmarks = e->bookmarks.count;
+
+    make_dir(ctx, "build/test/grep-cmd");
+    make_file(ctx, "build/test/grep-cmd/a.txt", STRN("x\nfoo\n"));
+    EXPECT_TRUE(handle_normal_command(e, "grep -A foo build/test/grep-cmd", false));
+    ASSERT_EQ(msgs->array.count, 1);
+    expect_message(ctx, msgs, 0, "build/test/grep-cmd/a.txt", 2, 1, "foo");
+    EXPECT_TRUE(e->view != view);
+    EXPECT_EQ(e->bookmarks.count, nr_bookmarks + 1);
+
+    // A search that can't be started leaves the previous results intact
+    clear_error(&e->err);
+    EXPECT_FALSE(handle_normal_command(e, "grep -A '(' build/test/grep-cmd", false));
+    EXPECT_EQ(msgs->array.count, 1);
+    EXPECT_FALSE(handle_normal_command(e, "grep -A foo build/test/grep-cmd/missing", false));
+    EXPECT_EQ(msgs->array.count, 1);
+    EXPECT_TRUE(handle_normal_command(e, "grep", false));
+    EXPECT_EQ(msgs->array.count, 1);
+    EXPECT_NULL(e->grep);
+
+    EXPECT_FALSE(handle_normal_command(e, "grep -A nomatch build/test/grep-cmd", false));
+    EXPECT_EQ(msgs->array.count, 0);
+
+    EXPECT_TRUE(handle_normal_command(e, "close", false));
+    EXPECT_PTREQ(e->view, view);
+    file_location_free(ptr_array_remove_index(&e->bookmarks, nr_bookmarks));
+    clear_error(&e->err);
+    EXPECT_TRUE(handle_normal_command(e, "close", false));
+}
+
+static const TestEntry tests[] = {
+    TEST(test_grep_paths),
+    TEST(test_grep_paths_batches),
+    TEST(test_grep_continue),
+};
+
+static const TestEntry tests_late[] = {
+    TEST(test_grep_command),
+};
+
+const TestGroup grep_tests = TEST_GROUP(tests);
+const TestGroup grep_tests_late = TEST_GROUP(tests_late);
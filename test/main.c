@@ -153,6 +153,7 @@ int main(int argc, char *argv[])
     run_tests(&ctx, &frame_tests);
     run_tests(&ctx, &ctags_tests);
     run_tests(&ctx, &spawn_tests);
+    run_tests(&ctx, &grep_tests);
     run_tests(&ctx, &status_tests);
 
     init_headless_mode(&ctx);
@@ -161,6 +162,7 @@ int main(int argc, char *argv[])
     run_tests(&ctx, &cmdline_tests_late);
     run_tests(&ctx, &buffer_tests);
     run_tests(&ctx, &indent_tests_late);
+    run_tests(&ctx, &grep_tests_late);
     run_tests(&ctx, &bookmark_tests);
     run_tests(&ctx, &syntax_tests);
     run_tests(&ctx, &dump_tests);
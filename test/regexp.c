@@ -1,6 +1,8 @@
 #include <stdlib.h>
+#include <string.h>
 #include "test.h"
 #include "regexp.h"
+#include "util/xsnprintf.h"
 
 static void test_regexp_escape(TestContext *ctx)
 {
@@ -17,8 +19,97 @@ static void test_regexp_escape(TestContext *ctx)
     regfree(&re);
 }
 
+static void test_regexp_get_literal(TestContext *ctx)
+{
+    static const struct {
+        const char *pattern;
+        const char *literal; // Or NULL, if `pattern` isn't literal
+    } tests[] = {
+        {"foo", "foo"},
+        {"foo bar-baz_123", "foo bar-baz_123"},
+        {"x\\.y", "x.y"},
+        {"\\(a\\|b\\)\\*\\\\", "(a|b)*\\"},
+        {"a]}", "a]}"},
+        {"x.y", NULL},
+        {"^foo", NULL},
+        {"foo$", NULL},
+        {"a|b", NULL},
+        {"a+", NULL},
+        {"[ab]", NULL},
+        {"a{2}", NULL},
+        {"\\<word\\>", NULL},
+        {"\\w", NULL},
+        {"trailing\\", NULL},
+        {"new\nline", NULL},
+        {"", NULL},
+    };
+
+    for (size_t i = 0; i < ARRAYLEN(tests); i++) {
+        char *literal = regexp_get_literal(tests[i].pattern);
+        const char *expected = tests[i].literal;
+        if (!expected) {
+            IEXPECT_TRUE(!literal);
+            free(literal);
+            continue;
+        }
+        IEXPECT_STREQ(literal, expected);
+        free(literal);
+
+        // Ensure the pattern matches the literal text
+        regex_t re;
+        ASSERT_TRUE(regexp_compile(NULL, &re, tests[i].pattern, REG_NEWLINE | REG_NOSUB));
+        IEXPECT_TRUE(regexp_exec(&re, expected, strlen(expected), 0, NULL, 0));
+        regfree(&re);
+    }
+}
+
+static void test_regexp_cache(TestContext *ctx)
+{
+    const RegexpCacheStats s0 = regexp_cache_stats();
+    const regex_t *re1 = regexp_cache_get(NULL, "a+b", REG_EXTENDED);
+    const regex_t *re2 = regexp_cache_get(NULL, "a+b", REG_EXTENDED);
+    const regex_t *re3 = regexp_cache_get(NULL, "a+b", REG_EXTENDED | REG_ICASE);
+    ASSERT_NONNULL(re1);
+    ASSERT_NONNULL(re3);
+    EXPECT_PTREQ(re1, re2);
+    EXPECT_TRUE(re1 != re3);
+    EXPECT_TRUE(regexp_exec(re1, STRN("xaab"), 0, NULL, 0));
+    EXPECT_FALSE(regexp_exec(re1, STRN("xAAB"), 0, NULL, 0));
+    EXPECT_TRUE(regexp_exec(re3, STRN("xAAB"), 0, NULL, 0));
+    EXPECT_NULL(regexp_cache_get(NULL, "(", REG_EXTENDED));
+
+    RegexpCacheStats s1 = regexp_cache_stats();
+    EXPECT_EQ(s1.hits - s0.hits, 1);
+    EXPECT_EQ(s1.misses - s0.misses, 3);
+    regexp_cache_release(re2);
+    regexp_cache_release(re3);
+
+    // Fill the cache with other (unreferenced) regexes, so that `re3`
+    // is evicted and `re1` (which is still referenced) isn't
+    for (size_t i = 0; i < s1.capacity; i++) {
+        char pattern[32];
+        xsnprintf(pattern, sizeof pattern, "x{%zu}", i + 1);
+        regexp_cache_release(regexp_cache_get(NULL, pattern, REG_EXTENDED));
+    }
+
+    s1 = regexp_cache_stats();
+    EXPECT_TRUE(s1.entries <= s1.capacity);
+    EXPECT_TRUE(s1.evictions > s0.evictions);
+    EXPECT_PTREQ(regexp_cache_get(NULL, "a+b", REG_EXTENDED), re1);
+    regexp_cache_release(re1);
+    regexp_cache_release(re1);
+
+    size_t misses = regexp_cache_stats().misses;
+    re3 = regexp_cache_get(NULL, "a+b", REG_EXTENDED | REG_ICASE);
+    ASSERT_NONNULL(re3);
+    EXPECT_EQ(regexp_cache_stats().misses, misses + 1);
+    regexp_cache_release(re3);
+}
+
 static const TestEntry tests[] = {
     TEST(test_regexp_escape),
+    TEST(test_regexp_get_literal),
+    TEST(test_regexp_cache),
 };
 
 const TestGroup regexp_tests = TEST_GROUP(tests);
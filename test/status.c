@@ -13,9 +13,9 @@ static void test_sf_format(TestContext *ctx)
         .options = {.filetype = "none"},
     };
 
-    Block *block = block_new(1);
+    Block *block = block_new(NULL, 1);
     list_init(&buffer.blocks);
-    list_insert_before(&block->node, &buffer.blocks);
+    block_append(block, &buffer.blocks);
 
     View view = {
         .buffer = &buffer,
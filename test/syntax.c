@@ -1,11 +1,20 @@
+#include <stdint.h>
+#include <string.h>
 #include "test.h"
 #include "block-iter.h"
+#include "change.h"
 #include "config.h"
 #include "editor.h"
 #include "syntax/bitset.h"
+#include "syntax/cache.h"
 #include "syntax/highlight.h"
+#include "util/hash.h"
 #include "util/log.h"
+#include "util/readfile.h"
+#include "util/string.h"
 #include "util/utf8.h"
+#include "util/xmalloc.h"
+#include "util/xreadwrite.h"
 #include "window.h"
 
 static void test_bitset(TestContext *ctx)
@@ -217,6 +226,90 @@ static void test_load_syntax_errors(TestContext *ctx)
     EXPECT_STREQ(ebuf->buf, "ren:1: eat: emit-name 'a' not needed (destination state uses same emit-name)");
 }
 
+static void test_compile_state(TestContext *ctx)
+{
+    EditorState *e = ctx->userdata;
+    StringView text = strview (
+        "syntax cst; "
+        "state a; "
+        "char -b a-z b; "
+        "str -i xY b; "
+        "char 0 this; "
+        "char -n 0-9 b; "
+        "eat this; "
+        "state b; "
+        "recolor x 1; "
+        "char q a; "
+        "eat this"
+    );
+
+    const Syntax *syntax = load_syntax(e, text, "cst", 0);
+    ASSERT_NONNULL(syntax);
+    State *a = syntax->start_state;
+    State *b = find_state(syntax, "b");
+    ASSERT_NONNULL(a);
+    ASSERT_NONNULL(b);
+
+    // States are only compiled when first used by highlight_line()
+    EXPECT_NULL(a->compiled.conds);
+    EXPECT_NULL(b->compiled.conds);
+    compile_state(a);
+    compile_state(b);
+
+    // Each byte maps to the list of conditions that can match it, in
+    // their original order
+    const CompiledState *cs = &a->compiled;
+    ASSERT_NONNULL(cs->conds);
+    EXPECT_EQ(cs->nr_lists, 6);
+    static const struct {
+        unsigned char ch;
+        uint8_t nr_conds;
+        uint8_t conds[3]; // Indices in `State::conds`
+    } tests[] = {
+        {'a', 2, {0, 3}},
+        {'x', 3, {0, 1, 3}},
+        {'X', 2, {1, 3}},
+        {'Y', 1, {3}},
+        {'0', 1, {2}},
+        {'5', 0, {0}},
+        {'\n', 1, {3}},
+        {0xFF, 1, {3}},
+    };
+
+    for (size_t i = 0; i < ARRAYLEN(tests); i++) {
+        size_t list = cs->dispatch[tests[i].ch];
+        size_t start = cs->lists[list];
+        size_t n = cs->lists[list + 1] - start;
+        IEXPECT_EQ(n, tests[i].nr_conds);
+        for (size_t j = 0; j < MIN(n, tests[i].nr_conds); j++) {
+            IEXPECT_EQ(cs->conds[start + j].index, tests[i].conds[j]);
+        }
+    }
+
+    // Lists that leave the state unchanged consume whole runs of their
+    // bytes, which are recorded for byte_class_span()
+    EXPECT_TRUE(bitset_contains(cs->run_lists, cs->dispatch['0'])); // char 0 this
+    EXPECT_TRUE(bitset_contains(cs->run_lists, cs->dispatch['5'])); // eat this
+    EXPECT_FALSE(bitset_contains(cs->run_lists, cs->dispatch['a']));
+    EXPECT_FALSE(bitset_contains(cs->run_lists, cs->dispatch['Y']));
+    const ByteClass *digits = &cs->classes[cs->dispatch['5']];
+    EXPECT_TRUE(byte_class_contains(digits, '1'));
+    EXPECT_TRUE(byte_class_contains(digits, '9'));
+    EXPECT_FALSE(byte_class_contains(digits, '0'));
+    EXPECT_FALSE(byte_class_contains(digits, 'a'));
+    EXPECT_EQ(byte_class_span(digits, "1234x", 5), 4);
+
+    // Conditions that don't depend on the current byte are in every list
+    cs = &b->compiled;
+    ASSERT_NONNULL(cs->conds);
+    EXPECT_EQ(cs->nr_lists, 2);
+    EXPECT_EQ(cs->nr_conds, 3);
+    EXPECT_EQ(cs->lists[cs->dispatch['a'] + 1] - cs->lists[cs->dispatch['a']], 1);
+    EXPECT_EQ(cs->lists[cs->dispatch['q'] + 1] - cs->lists[cs->dispatch['q']], 2);
+    EXPECT_EQ(cs->conds[cs->lists[cs->dispatch['q']] + 1].type, COND_CHAR1);
+    EXPECT_FALSE(bitset_contains(cs->run_lists, cs->dispatch['a'])); // recolor
+}
+
 static void test_hl_line(TestContext *ctx)
 {
     if (!get_builtin_config("syntax/c")) {
@@ -241,9 +334,9 @@ static void test_hl_line(TestContext *ctx)
     EXPECT_FALSE(syn->heredoc);
 
     const StyleMap *styles = &e->styles;
-    PointerArray *lss = &buffer->line_start_states;
+    LineStates *lss = &buffer->line_start_states;
     BlockIter tmp = block_iter(buffer);
-    hl_fill_start_states(syn, lss, styles, &tmp, buffer->nl);
+    EXPECT_TRUE(hl_fill_start_states(syn, lss, styles, &tmp, buffer->nl, SIZE_MAX));
     block_iter_goto_line(&view->cursor, line_nr - 1);
     view_update(view);
     ASSERT_EQ(view->cx, 0);
@@ -252,10 +345,9 @@ static void test_hl_line(TestContext *ctx)
     StringView line = get_current_line(view->cursor);
     ASSERT_EQ(line.length, 65);
 
-    bool next_changed;
-    const TermStyle **hl = hl_line(syn, lss, styles, line, line_nr, &next_changed);
+    State *state = hl_get_start_state(syn, lss, styles, &tmp, line_nr - 1);
+    const TermStyle **hl = hl_line(syn, &state, styles, line);
     ASSERT_NONNULL(hl);
-    EXPECT_TRUE(next_changed);
 
     const TermStyle *t = find_style(styles, "text");
     const TermStyle *c = find_style(styles, "constant");
@@ -298,10 +390,444 @@ static void test_hl_line(TestContext *ctx)
     window_close(window);
 }
 
+static void test_hl_fill_start_states(TestContext *ctx)
+{
+    if (!get_builtin_config("syntax/c")) {
+        LOG_INFO("syntax/c not available; skipping %s()", __func__);
+        return;
+    }
+
+    EditorState *e = ctx->userdata;
+    Window *window = e->window;
+    View *view = window_open_file(window, "test/data/test.c", NULL);
+    ASSERT_NONNULL(view);
+    Buffer *buffer = view->buffer;
+    Syntax *syn = buffer->syntax;
+    ASSERT_NONNULL(syn);
+    const size_t nl = buffer->nl;
+    ASSERT_TRUE(nl >= 4);
+
+    // A budget of 1 byte fills in one line per call
+    const StyleMap *styles = &e->styles;
+    LineStates *lss = &buffer->line_start_states;
+    ASSERT_EQ(lss->count, 1);
+    ASSERT_EQ(lss->nr_lines, 0);
+    lss->interval = 1; // Add a checkpoint for every line
+    size_t i = 0;
+    for (bool done = false; !done; i++) {
+        ASSERT_TRUE(i < nl);
+        BlockIter tmp = block_iter(buffer);
+        done = hl_fill_start_states(syn, lss, styles, &tmp, nl, 1);
+        IEXPECT_EQ(lss->nr_lines, i + 1);
+    }
+    EXPECT_EQ(i, nl);
+    EXPECT_EQ(lss->count, nl + 1);
+
+    // Provisional highlighting from the start state gives the same states
+    State *state = syn->start_state;
+    BlockIter bi = block_iter(buffer);
+    for (i = 0; i < nl; i++) {
+        StringView line = block_iter_get_line_with_nl(&bi);
+        block_iter_eat_line(&bi);
+        ASSERT_NONNULL(hl_line(syn, &state, styles, line));
+        BlockIter tmp = block_iter(buffer);
+        IEXPECT_TRUE(state == hl_get_start_state(syn, lss, styles, &tmp, i + 1));
+    }
+
+    // Invalidated states are also filled in incrementally
+    const LineStateCheckpoint *c = lss->checkpoints;
+    hl_insert(lss, 1, 0);
+    hl_insert(lss, 3, 0);
+    EXPECT_TRUE(((uintptr_t)c[2].state & 1) == 1);
+    EXPECT_TRUE(((uintptr_t)c[4].state & 1) == 1);
+    bi = block_iter(buffer);
+    EXPECT_FALSE(hl_fill_start_states(syn, lss, styles, &bi, nl, 1));
+    EXPECT_TRUE(((uintptr_t)c[2].state & 1) == 0);
+    EXPECT_TRUE(((uintptr_t)c[4].state & 1) == 1);
+    bi = block_iter(buffer);
+    EXPECT_TRUE(hl_fill_start_states(syn, lss, styles, &bi, nl, 1));
+    EXPECT_TRUE(((uintptr_t)c[4].state & 1) == 0);
+    EXPECT_EQ(lss->count, nl + 1);
+
+    window_close(window);
+}
+
+// Check that the start state of every line is the same as when
+// highlighting the whole Buffer from the first line
+static void check_start_states(TestContext *ctx, const StyleMap *styles, Buffer *buffer)
+{
+    Syntax *syn = buffer->syntax;
+    LineStates *lss = &buffer->line_start_states;
+    BlockIter bi = block_iter(buffer);
+    ASSERT_TRUE(hl_fill_start_states(syn, lss, styles, &bi, buffer->nl, SIZE_MAX));
+
+    size_t nr_lines = 0;
+    for (size_t i = 0; i < lss->count; i++) {
+        IEXPECT_TRUE(lss->checkpoints[i].nr_lines <= 1024);
+        nr_lines += lss->checkpoints[i].nr_lines;
+    }
+    EXPECT_EQ(nr_lines, lss->nr_lines);
+
+    State *state = syn->start_state;
+    bi = block_iter(buffer);
+    for (size_t i = 0; i <= buffer->nl; i++) {
+        BlockIter tmp = block_iter(buffer);
+        IEXPECT_TRUE(hl_get_start_state(syn, lss, styles, &tmp, i) == state);
+        StringView line = block_iter_get_line_with_nl(&bi);
+        block_iter_eat_line(&bi);
+        hl_line(syn, &state, styles, line);
+    }
+}
+
+static void test_line_start_states(TestContext *ctx)
+{
+    if (!get_builtin_config("syntax/c")) {
+        LOG_INFO("syntax/c not available; skipping %s()", __func__);
+        return;
+    }
+
+    EditorState *e = ctx->userdata;
+    Window *window = e->window;
+    View *view = window_open_file(window, "test/data/test.c", NULL);
+    ASSERT_NONNULL(view);
+    Buffer *buffer = view->buffer;
+    ASSERT_NONNULL(buffer->syntax);
+    const StyleMap *styles = &e->styles;
+    LineStates *lss = &buffer->line_start_states;
+    lss->interval = 64;
+
+    // Lines with comments that span several lines, so that inserting or
+    // deleting a single line changes the start states of many others
+    static const char text[] =
+        "int x;\n"
+        "/* a\n"
+        "b */ int y;\n"
+        "\n"
+    ;
+
+    block_iter_eof(&view->cursor);
+    for (size_t i = 0; i < 100; i++) {
+        buffer_insert_bytes(view, text, sizeof(text) - 1);
+        block_iter_eof(&view->cursor);
+    }
+    check_start_states(ctx, styles, buffer);
+    ASSERT_TRUE(lss->count > 20);
+
+    block_iter_goto_line(&view->cursor, 20);
+    buffer_insert_bytes(view, STRN("/*\n"));
+    check_start_states(ctx, styles, buffer);
+    block_iter_goto_line(&view->cursor, 20);
+    buffer_delete_bytes(view, 3);
+    check_start_states(ctx, styles, buffer);
+
+    // Insert enough lines to split the checkpoint they're added to
+    String str = string_new(3000 * (sizeof(text) - 1));
+    for (size_t i = 0; i < 3000; i++) {
+        string_append_buf(&str, text, sizeof(text) - 1);
+    }
+    block_iter_goto_line(&view->cursor, 50);
+    buffer_insert_bytes(view, str.buffer, str.len);
+    check_start_states(ctx, styles, buffer);
+
+    // Delete lines spanning many checkpoints
+    block_iter_goto_line(&view->cursor, 45);
+    size_t nl = buffer->nl;
+    buffer_delete_bytes(view, str.len + 1);
+    EXPECT_TRUE(buffer->nl < nl);
+    check_start_states(ctx, styles, buffer);
+    string_free(&str);
+
+    // Delete the last lines
+    block_iter_goto_line(&view->cursor, buffer->nl - 10);
+    buffer_delete_bytes(view, 15);
+    check_start_states(ctx, styles, buffer);
+
+    window_close(window);
+}
+
+static const CachedLine *find_cached_line(const LineStates *lss, size_t line_nr)
+{
+    for (size_t i = 0; lss->cache && i < 256; i++) {
+        const CachedLine *cl = lss->cache + i;
+        if (cl->state && cl->line_nr == line_nr) {
+            return cl;
+        }
+    }
+    return NULL;
+}
+
+static void test_hl_line_cached(TestContext *ctx)
+{
+    if (!get_builtin_config("syntax/c")) {
+        LOG_INFO("syntax/c not available; skipping %s()", __func__);
+        return;
+    }
+
+    EditorState *e = ctx->userdata;
+    Window *window = e->window;
+    View *view = window_open_file(window, "test/data/test.c", NULL);
+    ASSERT_NONNULL(view);
+    Buffer *buffer = view->buffer;
+    Syntax *syn = buffer->syntax;
+    ASSERT_NONNULL(syn);
+    const StyleMap *styles = &e->styles;
+    LineStates *lss = &buffer->line_start_states;
+    const size_t nl = buffer->nl;
+    ASSERT_TRUE(nl >= 6);
+
+    // The first pass highlights and caches each line and the second pass
+    // uses the cache, but both give the same results as hl_line()
+    for (size_t pass = 0; pass < 2; pass++) {
+        State *state = syn->start_state;
+        State *cached_state = syn->start_state;
+        BlockIter bi = block_iter(buffer);
+        for (size_t i = 0; i < nl; i++) {
+            StringView line = block_iter_get_line_with_nl(&bi);
+            block_iter_eat_line(&bi);
+            const TermStyle **hl = hl_line(syn, &state, styles, line);
+            const TermStyle *expected[128];
+            ASSERT_TRUE(line.length <= ARRAYLEN(expected));
+            memcpy(expected, hl, line.length * sizeof(hl[0]));
+
+            hl = hl_line_cached(syn, lss, &cached_state, styles, line, i);
+            IEXPECT_TRUE(cached_state == state);
+            IEXPECT_EQ(memcmp(hl, expected, line.length * sizeof(hl[0])), 0);
+
+            const CachedLine *cl = find_cached_line(lss, i);
+            ASSERT_NONNULL(cl);
+            size_t length = 0;
+            for (size_t j = 0; j < cl->nr_spans; j++) {
+                IEXPECT_TRUE(cl->spans[j].length > 0);
+                length += cl->spans[j].length;
+            }
+            IEXPECT_EQ(length, line.length);
+        }
+    }
+
+    // Edited lines are discarded and those after them are renumbered
+    const CachedLine *cl = find_cached_line(lss, 4);
+    ASSERT_NONNULL(cl);
+    const size_t length = cl->length;
+    block_iter_goto_line(&view->cursor, 2);
+    buffer_insert_bytes(view, STRN("\n"));
+    EXPECT_NULL(find_cached_line(lss, 2));
+    EXPECT_PTREQ(find_cached_line(lss, 5), cl);
+    EXPECT_EQ(cl->length, length);
+    EXPECT_NONNULL(find_cached_line(lss, 1));
+
+    block_iter_goto_line(&view->cursor, 1);
+    buffer_delete_bytes(view, 1);
+    EXPECT_NULL(find_cached_line(lss, 1));
+    EXPECT_NULL(find_cached_line(lss, 2));
+    EXPECT_PTREQ(find_cached_line(lss, 4), cl);
+    EXPECT_NONNULL(find_cached_line(lss, 0));
+
+    hl_clear_line_cache(lss);
+    EXPECT_NULL(find_cached_line(lss, 0));
+    EXPECT_NULL(find_cached_line(lss, 4));
+
+    window_close(window);
+}
+
+static bool write_file(const char *path, const char *text, size_t len)
+{
+    int fd = xopen(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    bool r = xwrite_all(fd, text, len) == len;
+    return !xclose(fd) && r;
+}
+
+static void expect_same_list(TestContext *ctx, const StringList *a, const StringList *b)
+{
+    EXPECT_EQ(a->used, b->used);
+    EXPECT_EQ(a->defined, b->defined);
+    EXPECT_EQ(hashset_is_icase(&a->strings), hashset_is_icase(&b->strings));
+    EXPECT_EQ(a->strings.nr_entries, b->strings.nr_entries);
+    for (HashSetIter it = hashset_iter(&a->strings); hashset_next(&it); ) {
+        const HashSetEntry *h = it.entry;
+        EXPECT_NONNULL(hashset_get(&b->strings, h->str, h->str_len));
+    }
+}
+
+static void expect_same_action(TestContext *ctx, const Action *a, const Action *b)
+{
+    EXPECT_PTREQ(a->emit_name, b->emit_name);
+    if (a->destination && b->destination) {
+        EXPECT_STREQ(a->destination->name, b->destination->name);
+    } else {
+        EXPECT_PTREQ(a->destination, b->destination);
+    }
+}
+
+static void expect_same_syntax(TestContext *ctx, const Syntax *a, const Syntax *b)
+{
+    EXPECT_STREQ(a->name, b->name);
+    EXPECT_STREQ(a->start_state->name, b->start_state->name);
+    EXPECT_EQ(a->heredoc, b->heredoc);
+    EXPECT_EQ(a->used, b->used);
+    EXPECT_EQ(a->warned_unused_subsyntax, b->warned_unused_subsyntax);
+
+    EXPECT_EQ(a->default_styles.count, b->default_styles.count);
+    for (HashMapIter it = hashmap_iter(&a->default_styles); hashmap_next(&it); ) {
+        EXPECT_PTREQ(hashmap_get(&b->default_styles, it.entry->key), it.entry->value);
+    }
+
+    EXPECT_EQ(a->string_lists.count, b->string_lists.count);
+    for (HashMapIter it = hashmap_iter(&a->string_lists); hashmap_next(&it); ) {
+        const StringList *list = find_string_list(b, it.entry->key);
+        ASSERT_NONNULL(list);
+        expect_same_list(ctx, it.entry->value, list);
+    }
+
+    EXPECT_EQ(a->states.count, b->states.count);
+    for (HashMapIter it = hashmap_iter(&a->states); hashmap_next(&it); ) {
+        const State *sa = it.entry->value;
+        const State *sb = find_state(b, sa->name);
+        ASSERT_NONNULL(sb);
+        EXPECT_PTREQ(sa->emit_name, sb->emit_name);
+        EXPECT_EQ(sa->defined, sb->defined);
+        EXPECT_EQ(sa->visited, sb->visited);
+        EXPECT_EQ(sa->copied, sb->copied);
+        EXPECT_EQ(sa->type, sb->type);
+        EXPECT_PTREQ(sa->heredoc.subsyntax, sb->heredoc.subsyntax);
+        expect_same_action(ctx, &sa->default_action, &sb->default_action);
+        ASSERT_EQ(sa->conds.count, sb->conds.count);
+        for (size_t i = 0, n = sa->conds.count; i < n; i++) {
+            const Condition *ca = sa->conds.ptrs[i];
+            const Condition *cb = sb->conds.ptrs[i];
+            IEXPECT_EQ(ca->type, cb->type);
+            expect_same_action(ctx, &ca->a, &cb->a);
+            if (ca->type == COND_INLIST || ca->type == COND_INLIST_BUFFER) {
+                expect_same_list(ctx, ca->u.str_list, cb->u.str_list);
+            } else {
+                EXPECT_MEMEQ(&ca->u, sizeof(ca->u), &cb->u, sizeof(cb->u));
+            }
+        }
+    }
+}
+
+static void test_syntax_cache(TestContext *ctx)
+{
+    static const char inc_text[] =
+        "syntax .scx-str\n"
+        "state str string\n"
+        "    char '\"' END string\n"
+        "    char '\\' esc\n"
+        "    eat this\n"
+        "state esc special\n"
+        "    inlist escs str\n"
+        "    eat str\n"
+        "list escs n t\n"
+    ;
+
+    static const char req_text[] =
+        "syntax .scx-req\n"
+        "state start heredoc\n"
+        "    heredocend END\n"
+        "    eat this\n"
+    ;
+
+    StringView text = strview (
+        "include $DTE_HOME/scx-inc\n"
+        "require -f $DTE_HOME/scx-req\n"
+        "syntax scx\n"
+        "state code\n"
+        "    char '\"' .scx-str:this\n"
+        "    str '<<' heredoc\n"
+        "    inlist kw this keyword\n"
+        "    str -i ab other\n"
+        "    char -bn 0-9 other\n"
+        "    eat this\n"
+        "state other\n"
+        "    recolor x 2\n"
+        "    bufis -i xy code\n"
+        "    noeat -b code\n"
+        "state heredoc\n"
+        "    heredocbegin .scx-req code\n"
+        "list -i kw if else\n"
+        "default keyword type\n"
+    );
+
+    EditorState *e = ctx->userdata;
+    ErrorBuffer *ebuf = &e->err;
+    const char *dir = e->user_config_dir;
+    char *inc_path = xasprintf("%s/scx-inc", dir);
+    char *req_path = xasprintf("%s/scx-req", dir);
+    uintmax_t hash = fnv_1a_hash(STRN("scx"));
+    char *cache_path = xasprintf("%s/syntax-cache/%016jx.0", dir, hash);
+    ASSERT_TRUE(write_file(inc_path, inc_text, sizeof(inc_text) - 1));
+    ASSERT_TRUE(write_file(req_path, req_text, sizeof(req_text) - 1));
+
+    // Loading the syntax (without errors) saves the cache file
+    e->options.syntax_cache = true;
+    clear_error(ebuf);
+    const unsigned int nr_errors = ebuf->nr_errors;
+    const Syntax *syntax = load_syntax(e, text, "scx", 0);
+    ASSERT_NONNULL(syntax);
+    EXPECT_EQ(ebuf->nr_errors, nr_errors);
+    EXPECT_STREQ(ebuf->buf, "");
+    const Syntax *str_syntax = find_any_syntax(&e->syntaxes, ".scx-str");
+    Syntax *req_syntax = find_any_syntax(&e->syntaxes, ".scx-req");
+    ASSERT_NONNULL(str_syntax);
+    ASSERT_NONNULL(req_syntax);
+
+    // Load the cache file into a separate set of syntaxes, where the
+    // required file has already been loaded (and is thus skipped)
+    HashMap syntaxes = e->syntaxes;
+    hashmap_init(&e->syntaxes, 8, HMAP_BORROWED_KEYS);
+    hashmap_insert(&e->syntaxes, req_syntax->name, req_syntax);
+
+    Syntax *cached = syntax_cache_load(e, text, "scx", 0);
+    ASSERT_NONNULL(cached);
+    Syntax *cached_str = find_any_syntax(&e->syntaxes, ".scx-str");
+    ASSERT_NONNULL(cached_str);
+    EXPECT_PTREQ(find_syntax(&e->syntaxes, "scx"), cached);
+    EXPECT_EQ(e->syntaxes.count, 3);
+    expect_same_syntax(ctx, cached, syntax);
+    expect_same_syntax(ctx, cached_str, str_syntax);
+    EXPECT_NULL(find_state(cached, "code")->compiled.conds);
+
+    EXPECT_PTREQ(hashmap_remove(&e->syntaxes, "scx"), cached);
+    EXPECT_PTREQ(hashmap_remove(&e->syntaxes, ".scx-str"), cached_str);
+    free_syntax(cached);
+    free_syntax(cached_str);
+
+    // The cache isn't used if the loaded text or any file read by it has
+    // changed, or if the cache file itself is corrupt
+    StringView changed_text = string_view(text.data, text.length - 1);
+    EXPECT_NULL(syntax_cache_load(e, changed_text, "scx", 0));
+    ASSERT_TRUE(write_file(inc_path, inc_text, sizeof(inc_text) - 2));
+    EXPECT_NULL(syntax_cache_load(e, text, "scx", 0));
+    ASSERT_TRUE(write_file(inc_path, inc_text, sizeof(inc_text) - 1));
+
+    char *buf;
+    ssize_t size = read_file(cache_path, &buf, 0);
+    ASSERT_TRUE(size > 0);
+    buf[size - 1] ^= 1;
+    EXPECT_TRUE(write_file(cache_path, buf, size));
+    EXPECT_NULL(syntax_cache_load(e, text, "scx", 0));
+    EXPECT_EQ(e->syntaxes.count, 1);
+    free(buf);
+
+    hashmap_free(&e->syntaxes, NULL);
+    e->syntaxes = syntaxes;
+    e->options.syntax_cache = false;
+    free(cache_path);
+    free(req_path);
+    free(inc_path);
+}
+
 static const TestEntry tests[] = {
     TEST(test_bitset),
     TEST(test_load_syntax_errors),
+    TEST(test_compile_state),
     TEST(test_hl_line),
+    TEST(test_hl_fill_start_states),
+    TEST(test_line_start_states),
+    TEST(test_hl_line_cached),
+    TEST(test_syntax_cache),
 };
 
 const TestGroup syntax_tests = TEST_GROUP(tests);
@@ -133,6 +133,8 @@ extern const TestGroup encoding_tests;
 extern const TestGroup error_tests;
 extern const TestGroup filetype_tests;
 extern const TestGroup frame_tests;
+extern const TestGroup grep_tests;
+extern const TestGroup grep_tests_late;
 extern const TestGroup history_tests;
 extern const TestGroup indent_tests;
 extern const TestGroup indent_tests_late;
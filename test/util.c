@@ -13,6 +13,8 @@
 #include "util/ascii.h"
 #include "util/base64.h"
 #include "util/bit.h"
+#include "util/byte-class.h"
+#include "util/count-nl.h"
 #include "util/fd.h"
 #include "util/fork-exec.h"
 #include "util/hashmap.h"
@@ -22,6 +24,7 @@
 #include "util/list.h"
 #include "util/log.h"
 #include "util/numtostr.h"
+#include "util/parallel.h"
 #include "util/path.h"
 #include "util/progname.h"
 #include "util/ptr-array.h"
@@ -3800,6 +3803,139 @@ static void test_fork_exec(TestContext *ctx)
     EXPECT_EQ(xclose(fd[0]), 0);
 }
 
+static void test_count_nl(TestContext *ctx)
+{
+    EXPECT_EQ(count_nl(NULL, 0), 0);
+    EXPECT_EQ(count_nl_portable(NULL, 0), 0);
+    EXPECT_EQ(copy_count_nl(NULL, NULL, 0), 0);
+    EXPECT_EQ(copy_count_nl_portable(NULL, NULL, 0), 0);
+
+    // Use enough text to cover the main loops, the periodic widening
+    // of the 8-bit counters (every 255 vectors) and the scalar tails,
+    // at every alignment
+    char src[9000];
+    char dst[sizeof(src)];
+    size_t total = 0;
+    for (size_t i = 0; i < sizeof(src); i++) {
+        bool nl = (i % 7 == 0) || (i > 5000 && i < 7000);
+        src[i] = nl ? '\n' : (char)(0x80 | i);
+        total += nl;
+    }
+
+    EXPECT_EQ(count_nl(src, sizeof(src)), total);
+    EXPECT_EQ(count_nl_portable(src, sizeof(src)), total);
+    EXPECT_EQ(copy_count_nl(dst, src, sizeof(src)), total);
+    EXPECT_MEMEQ(dst, sizeof(dst), src, sizeof(src));
+    EXPECT_EQ(copy_count_nl_portable(dst, src, sizeof(src)), total);
+    EXPECT_MEMEQ(dst, sizeof(dst), src, sizeof(src));
+
+    for (size_t i = 0; i < 40; i++) {
+        const char *buf = src + i;
+        for (size_t len = 0; len < 300; len += 1 + (len / 8)) {
+            size_t expected = 0;
+            for (size_t j = 0; j < len; j++) {
+                expected += (buf[j] == '\n');
+            }
+            IEXPECT_EQ(count_nl(buf, len), expected);
+            IEXPECT_EQ(count_nl_portable(buf, len), expected);
+            memset(dst, 0, len + 1);
+            IEXPECT_EQ(copy_count_nl(dst + 1, buf, len), expected);
+            IEXPECT_TRUE(mem_equal(dst + 1, buf, len));
+            IEXPECT_EQ(copy_count_nl_portable(dst, buf, len), expected);
+            IEXPECT_TRUE(mem_equal(dst, buf, len));
+        }
+    }
+
+    const char *name = count_nl_impl_name();
+    EXPECT_TRUE(
+        streq(name, "portable")
+        || streq(name, "sse2")
+        || streq(name, "avx2")
+    );
+}
+
+static void test_byte_class_span(TestContext *ctx)
+{
+    ByteClass bc = {.rows = {{0}}};
+    EXPECT_EQ(byte_class_span(&bc, NULL, 0), 0);
+    EXPECT_EQ(byte_class_span_portable(&bc, NULL, 0), 0);
+
+    // Members from both halves of the byte range and from every row
+    for (unsigned int ch = 0; ch < 256; ch++) {
+        if (ch % 3 != 0 && ch != '\n') {
+            byte_class_add(&bc, ch);
+        }
+    }
+    EXPECT_TRUE(byte_class_contains(&bc, 0x01));
+    EXPECT_TRUE(byte_class_contains(&bc, 0xFE));
+    EXPECT_FALSE(byte_class_contains(&bc, 0x00));
+    EXPECT_FALSE(byte_class_contains(&bc, 0xFF));
+    EXPECT_FALSE(byte_class_contains(&bc, '\n'));
+
+    // Runs of members of every length from 0 to 99, each ending with a
+    // non-member, which covers the main loops and the overlapping loads
+    // at the end of the SIMD kernels, at every alignment
+    char buf[5200];
+    size_t pos = 0;
+    for (size_t run = 0; run < 100; run++) {
+        for (size_t j = 0; j < run; j++) {
+            unsigned char ch = (unsigned char)((run * 7) + (j * 13));
+            while (!byte_class_contains(&bc, ch)) {
+                ch++;
+            }
+            buf[pos++] = ch;
+        }
+        buf[pos++] = (run & 1) ? '\n' : (char)0xFF;
+    }
+    ASSERT_TRUE(pos <= sizeof(buf));
+
+    for (size_t i = 0; i < pos; i++) {
+        size_t expected = 0;
+        while (byte_class_contains(&bc, buf[i + expected])) {
+            expected++;
+        }
+        IEXPECT_EQ(byte_class_span(&bc, buf + i, pos - i), expected);
+        IEXPECT_EQ(byte_class_span_portable(&bc, buf + i, pos - i), expected);
+        // Lengths that end the buffer within the run
+        size_t len = expected / 2;
+        IEXPECT_EQ(byte_class_span(&bc, buf + i, len), len);
+    }
+
+    // A run that ends exactly at the end of the buffer
+    memset(buf, 'a', 100);
+    for (size_t len = 0; len <= 100; len++) {
+        EXPECT_EQ(byte_class_span(&bc, buf, len), len);
+    }
+
+    const char *name = byte_class_span_impl_name();
+    EXPECT_TRUE(
+        streq(name, "portable")
+        || streq(name, "ssse3")
+        || streq(name, "avx2")
+    );
+}
+
+static void count_parallel_calls(void *data, size_t idx)
+{
+    unsigned int *counts = data;
+    counts[idx]++;
+}
+
+static void test_run_in_parallel(TestContext *ctx)
+{
+    EXPECT_TRUE(get_nr_cpus() >= 1);
+
+    unsigned int counts[100] = {0};
+    run_in_parallel(count_parallel_calls, counts, ARRAYLEN(counts), 8);
+    run_in_parallel(count_parallel_calls, counts, ARRAYLEN(counts), 1);
+    run_in_parallel(count_parallel_calls, counts, 10, 200);
+    run_in_parallel(count_parallel_calls, counts, 0, 4);
+
+    for (size_t i = 0; i < ARRAYLEN(counts); i++) {
+        IEXPECT_EQ(counts[i], (i < 10) ? 3 : 2);
+    }
+}
+
 static void test_xmemmem(TestContext *ctx)
 {
     static const char haystack[] = "finding a needle in a haystack";
@@ -3829,6 +3965,78 @@ static void test_xmemmem(TestContext *ctx)
     EXPECT_NULL(needle);
 }
 
+static void test_xmemmem_icase(TestContext *ctx)
+{
+    static const char haystack[] =
+        "@[`{ Finding a NeEdLe in a haystack, "
+        "or a needle@ in a HAYSTACK{ with some padding"
+    ;
+
+    static const struct {
+        const char *needle;
+        ssize_t offset; // Or -1, if not found
+    } tests[] = {
+        {"needle", 15},
+        {"NEEDLE", 15},
+        {"haystack", 27},
+        {"needle@", 42},
+        {"haystack{", 55},
+        {"`{", 2},
+        {"@{", -1}, // '@' and '`' differ only by 0x20, but aren't letters
+        {"[{", -1},
+        {"g", 11},
+        {"PADDING", 75},
+        {"paddings", -1},
+    };
+
+    const size_t hlen = sizeof(haystack) - 1;
+    for (size_t i = 0; i < ARRAYLEN(tests); i++) {
+        const char *needle = tests[i].needle;
+        const size_t nlen = strlen(needle);
+        const char *p1 = xmemmem_icase(haystack, hlen, needle, nlen);
+        const char *p2 = xmemmem_icase_portable(haystack, hlen, needle, nlen);
+        IEXPECT_EQ(p1 ? p1 - haystack : -1, tests[i].offset);
+        IEXPECT_EQ(p2 ? p2 - haystack : -1, tests[i].offset);
+    }
+
+    EXPECT_NULL(xmemmem_icase(haystack, 3, STRN("@[`{")));
+    EXPECT_PTREQ(xmemmem_icase(haystack, 4, STRN("@[`{")), haystack);
+
+    // Check a match at every position relative to the 16-byte vectors
+    // used by the SIMD implementation
+    char buf[80];
+    for (size_t i = 0; i + 5 <= sizeof(buf); i++) {
+        memset(buf, 'x', sizeof(buf));
+        memcpy(buf + i, "aBcDe", 5);
+        const char *p = xmemmem_icase(buf, sizeof(buf), STRN("abcde"));
+        IEXPECT_EQ(p ? p - buf : -1, i);
+        p = xmemmem_icase(buf, sizeof(buf), STRN("XAB"));
+        IEXPECT_EQ(p ? p - buf : -1, (ssize_t)i - 1);
+    }
+}
+
+static void test_xmemrmem(TestContext *ctx)
+{
+    static const char haystack[] = "a needle, a NEEDLE and a needle in a haystack";
+    const size_t hlen = sizeof(haystack) - 1;
+    EXPECT_PTREQ(xmemrmem(haystack, hlen, STRN("needle")), haystack + 25);
+    EXPECT_PTREQ(xmemrmem(haystack, 30, STRN("needle")), haystack + 2);
+    EXPECT_PTREQ(xmemrmem(haystack, 31, STRN("needle")), haystack + 25);
+    EXPECT_PTREQ(xmemrmem(haystack, hlen, STRN("a ")), haystack + 35);
+    EXPECT_PTREQ(xmemrmem(haystack, hlen, STRN("hay")), haystack + 37);
+    EXPECT_PTREQ(xmemrmem(haystack, hlen, STRN("stack")), haystack + 40);
+    EXPECT_PTREQ(xmemrmem(haystack, hlen, STRN("stacks")), NULL);
+    EXPECT_PTREQ(xmemrmem(haystack, 5, STRN("needle")), NULL);
+    EXPECT_PTREQ(xmemrmem(haystack, hlen, STRN("@")), NULL);
+
+    EXPECT_PTREQ(xmemrmem_icase(haystack, hlen, STRN("NeEdLe")), haystack + 25);
+    EXPECT_PTREQ(xmemrmem_icase(haystack, 30, STRN("needle")), haystack + 12);
+    EXPECT_PTREQ(xmemrmem_icase(haystack, 17, STRN("needle")), haystack + 2);
+    EXPECT_PTREQ(xmemrmem_icase(haystack, hlen, STRN("A HAY")), haystack + 35);
+    EXPECT_PTREQ(xmemrmem_icase(haystack, hlen, STRN("`")), NULL);
+    EXPECT_PTREQ(xmemrmem_icase(haystack, 4, STRN("needle")), NULL);
+}
+
 static void test_xmemrchr(TestContext *ctx)
 {
     static const char str[] = "123456789 abcdefedcba 987654321";
@@ -4047,7 +4255,12 @@ static const TestEntry tests[] = {
     TEST(test_fd_set_cloexec),
     TEST(test_fd_set_nonblock),
     TEST(test_fork_exec),
+    TEST(test_count_nl),
+    TEST(test_byte_class_span),
+    TEST(test_run_in_parallel),
     TEST(test_xmemmem),
+    TEST(test_xmemmem_icase),
+    TEST(test_xmemrmem),
     TEST(test_xmemrchr),
     TEST(test_str_to_bitflags),
     TEST(test_log_level_from_str),